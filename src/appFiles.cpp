@@ -0,0 +1,132 @@
+/**
+ *  @file       appFiles.cpp
+ *  @brief      Output files of applications source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:40
+ *   - Edited:  19.10.2026 23:40
+ */
+
+#include <iostream>                 //  cout, endl
+#include <cctype>                   //  isalnum()
+
+#include "debug.hpp"                //  log()
+#include "fileHandler.hpp"          //  initOFile()
+#include "appFiles.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+/*!
+ * @brief   Replaces characters which shouldn't be in a file name
+ */
+static std::string toFileName(const std::string &str)
+{
+    std::string r = str;
+    for (char &c : r)
+        if (!isalnum((unsigned char)c) && c != '.' && c != '-' && c != '_')
+            c = '_';
+    return r;
+}
+
+
+int parseSplitRule(const std::string &str, SplitRule &r)
+{
+    const size_t colon = str.find(':');
+    if (colon == 0 || colon == std::string::npos || colon + 1 >= str.length())
+        return -1;
+    r.file = str.substr(0, colon);
+    r.pattern = str.substr(colon + 1);
+    return (toFileName(r.file) == r.file) ? 0 : -1;
+}
+
+
+AppFiles::AppFiles(const std::string &oFilename, const std::vector<const char *> &devs,
+                   const std::vector<uint16_t> &linkTypes, const std::vector<SplitRule> &rules)
+    : stem(oFilename), devs(devs), linkTypes(linkTypes), rules(rules)
+{
+    const std::string ext = ".pcapng";
+    if (stem.size() > ext.size() && stem.compare(stem.size() - ext.size(), ext.size(), ext) == 0)
+        stem.resize(stem.size() - ext.size());
+}
+
+
+int AppFiles::route(AppId id, const std::string &name)
+{
+    if (id >= routes.size())
+        routes.resize(id + 1, -2);
+    int &r = routes[id];
+    r = -1;
+
+    std::string fileName;
+    if (rules.empty())
+    {
+        if (files.size() >= MAX_APP_FILES)
+        {
+            log(LogLevel::WARNING, "Too many applications, packets of '", name, "' stay in the output file.");
+            return r;
+        }
+        // the program without its path and arguments (delimited by '\0' on Linux)
+        std::string program = name.substr(0, name.find_first_of(std::string(" \0", 2)));
+        program = program.substr(program.rfind('/') + 1).substr(0, 32);
+        fileName = stem + "_" + std::to_string(id) + "_" + toFileName(program) + ".pcapng";
+    }
+    else
+    {
+        size_t i = 0;
+        while (i < rules.size() && name.find(rules[i].pattern) == std::string::npos)
+            i++;
+        if (i == rules.size())
+            return r;
+        fileName = stem + "_" + rules[i].file + ".pcapng";
+    }
+
+    // more rules can share a file
+    for (size_t i = 0; i < files.size(); i++)
+        if (files[i].name == fileName)
+            return r = files[i].out ? (int)i : -1;
+
+    files.emplace_back();
+    File &f = files.back();
+    f.name = fileName;
+    f.out.reset(new std::ofstream(fileName, std::ios::binary));
+    if (!*f.out || initOFile(*f.out, devs, linkTypes))
+    {
+        log(LogLevel::ERR, "Can't create file '", fileName, "', packets of '", name, "' stay in the output file.");
+        f.out.reset();
+        return r;
+    }
+    log(LogLevel::INFO, "File '", fileName, "' was created for '", name, "'.");
+    return r = files.size() - 1;
+}
+
+
+int AppFiles::flush()
+{
+    int ret = 0;
+    for (File &f : files)
+    {
+        if (!f.out)
+            continue;
+        f.out->flush();
+        if (f.out->bad())
+            ret = -1;
+    }
+    return ret;
+}
+
+
+void AppFiles::printStats() const
+{
+    for (const File &f : files)
+        if (f.out)
+            std::cout << f.packets << "' packets written to '" << f.name << "'." << std::endl;
+    std::cout << unsplit << "' packets left in the output file." << std::endl;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,127 @@
+/**
+ *  @file       appFiles.hpp
+ *  @brief      Output files of applications header file
+ *  @details    With --split the writer stores packets of every application into its own file
+ *              next to the output file, or with --split-app into a few files chosen by the name
+ *              of the application. Packets whose application isn't known and the mapping block
+ *              stay in the output file.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:40
+ *   - Edited:  19.10.2026 23:40
+ */
+
+#pragma once
+
+#include <fstream>              //  ofstream
+#include <memory>               //  unique_ptr
+#include <string>               //  string
+#include <vector>               //  vector
+#include <cstdint>              //  uint16_t
+
+#include "appRegistry.hpp"      //  AppId
+
+
+
+
+namespace NAMON
+{
+
+
+//! Maximum number of files opened by --split, packets of other applications stay in the output file
+const unsigned int      MAX_APP_FILES       = 64;
+//! How long a stored packet waits for its application with --split-app only (ms)
+const unsigned int      DEFAULT_SPLIT_DELAY = 100;
+
+
+/*!
+ * @struct  SplitRule
+ * @brief   Packets of applications whose name contains the pattern go to the file
+ */
+struct SplitRule
+{
+    std::string file;       //!< Name of the file, it is appended to the name of the output file
+    std::string pattern;    //!< Part of the application name (command line)
+};
+
+/*!
+ * @brief       Parses split rule in format <file>:<pattern>
+ * @param[in]   str     Rule description
+ * @param[out]  r       Parsed rule
+ * @return      Zero on success, -1 if the description is invalid
+ */
+int parseSplitRule(const std::string &str, SplitRule &r);
+
+
+/*!
+ * @class   AppFiles
+ * @brief   Files of applications used by the writer (see #NAMON::RingBuffer::write())
+ * @details Files are created when the first packet of their application comes, they have
+ *          the same section header and interfaces as the output file. Without rules every
+ *          application gets file <output>_<id>_<program>.pcapng (up to #NAMON::MAX_APP_FILES),
+ *          with rules the first matching rule gives file <output>_<file>.pcapng.
+ */
+class AppFiles
+{
+    /*!
+     * @brief   Opened file and the number of packets written into it
+     */
+    struct File
+    {
+        std::string name;                   //!< Name of the file
+        std::unique_ptr<std::ofstream> out; //!< The file, nullptr if it can't be created
+        unsigned long packets = 0;          //!< Number of packets
+    };
+    std::string stem;                       //!< Name of the output file without the extension
+    std::vector<const char *> devs;         //!< Capturing devices written into new files
+    std::vector<uint16_t> linkTypes;        //!< Link types of the devices
+    std::vector<SplitRule> rules;           //!< Rules, empty if every application has its own file
+    std::vector<File> files;                //!< Files in order of their creation
+    std::vector<int> routes;                //!< Index of the file of every application, -1 is the output file, -2 not known yet
+    unsigned long unsplit = 0;              //!< Number of packets left in the output file
+    /*!
+     * @brief   Finds the file of a new application and creates it if it's needed
+     * @return  Index of the file or -1 if packets stay in the output file
+     */
+    int route(AppId id, const std::string &name);
+public:
+    /*!
+     * @param[in]   oFilename   Name of the output file
+     * @param[in]   devs        Names of capturing devices
+     * @param[in]   linkTypes   LINKTYPE_* values of the devices
+     * @param[in]   rules       Rules of --split-app, empty for a file per application
+     */
+    AppFiles(const std::string &oFilename, const std::vector<const char *> &devs,
+             const std::vector<uint16_t> &linkTypes, const std::vector<SplitRule> &rules);
+    /*!
+     * @brief       Returns the file for the next packet of the application and counts the packet
+     * @param[in]   id      Application, #NAMON::NO_APP if it's not known
+     * @param[in]   name    Name of the application
+     * @return      The file or nullptr if the packet goes to the output file
+     */
+    std::ofstream * get(AppId id, const std::string &name)
+    {
+        if (id != NO_APP && (id >= routes.size() || routes[id] == -2))
+            route(id, name);
+        const int r = (id != NO_APP) ? routes[id] : -1;
+        if (r < 0)
+        {
+            unsplit++;
+            return nullptr;
+        }
+        files[r].packets++;
+        return files[r].out.get();
+    }
+    /*!
+     * @brief   Flushes all files
+     * @return  Zero on success, -1 if some of them failed (e.g. out of space)
+     */
+    int flush();
+    /*!
+     * @brief   Prints the number of packets in every file to the standard output
+     */
+    void printStats() const;
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,153 @@
+/**
+ *  @file       appFilter.cpp
+ *  @brief      Capture filter of one application source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 00:20
+ *   - Edited:  20.10.2026 05:40
+ */
+
+#include <algorithm>            //  find()
+#include <set>                  //  set
+#include <string>               //  string, to_string()
+
+#include "tcpip_headers.hpp"    //  PROTO_TCP, PROTO_UDP, PROTO_UDPLITE
+#include "appFilter.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+void AppFilter::addNames(const std::vector<std::string> &names)
+{
+    if (names.empty())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_kernel);
+        scannedNames.insert(names.begin(), names.end());
+    }
+    std::lock_guard<std::mutex> lock(m_added);
+    added.insert(added.end(), names.begin(), names.end());
+    hasAdded = true;
+}
+
+
+void AppFilter::takeAdded()
+{
+    std::vector<std::string> names;
+    {
+        std::lock_guard<std::mutex> lock(m_added);
+        names.swap(added);
+        hasAdded = false;
+    }
+    bool changed = false;
+    for (std::string &n : names)
+        changed |= exeNames.insert(std::move(n)).second;
+    if (changed)
+        for (uint8_t &v : verdicts)
+            if (v == 2)
+                v = 0;
+}
+
+
+std::string AppFilter::buildKernelExpr(const std::vector<AppSocket> &sockets)
+{
+    std::set<uint16_t> tcp, udp;
+    bool udplite = false;
+    for (const AppSocket &s : sockets)
+    {
+        if (s.proto == PROTO_TCP)
+            tcp.insert(s.port);
+        else if (s.proto == PROTO_UDP)
+            udp.insert(s.port);
+        else if (s.proto == PROTO_UDPLITE)
+            udplite = true;
+    }
+    auto ports = [](const char *proto, const std::set<uint16_t> &p) {
+        if (p.size() > MAX_FILTER_PORTS)
+            return std::string(" or ") + proto;
+        std::string expr;
+        for (uint16_t port : p)
+            expr += (expr.empty() ? "" : " or ") + std::string("port ") + std::to_string(port);
+        return expr.empty() ? expr : std::string(" or (") + proto + " and (" + expr + "))";
+    };
+
+    // non-first fragments don't have ports, the IPv6 fragment header hides them even in the first one
+    std::string expr = "(ip[6:2] & 0x1fff != 0) or (ip6 and ip6[6] == 44)";
+    // new connections, the cache adds their sockets before the next scan
+    expr += " or (ip and tcp[tcpflags] & tcp-syn != 0) or (ip6 and ip6[6] == 6 and ip6[53] & 2 != 0)";
+    expr += ports("tcp", tcp) + ports("udp", udp);
+    // the kernel filter can't read ports of UDP-Lite
+    if (udplite)
+        expr += " or ip proto 136 or ip6 proto 136";
+    return expr + " or (vlan and (" + expr + " or (vlan and (" + expr + "))))";
+}
+
+
+void AppFilter::setOnChange(const std::function<void()> &f)
+{
+    std::lock_guard<std::mutex> lock(m_kernel);
+    onChange = f;
+}
+
+
+bool AppFilter::setSockets(const std::vector<AppSocket> &scanned)
+{
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lock(m_kernel);
+        sockets = scanned;
+        for (const AppSocket &s : found)
+            if (std::find(sockets.begin(), sockets.end(), s) == sockets.end())
+                sockets.push_back(s);
+        found.clear();
+        changed = updateKernelExpr();
+        // under the lock, setOnChange() waits for a running call
+        if (changed && onChange)
+            onChange();
+    }
+    return changed;
+}
+
+
+bool AppFilter::addSocket(const AppSocket &s, const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_kernel);
+        if ((name.find(pattern) == std::string::npos && !scannedNames.count(name))
+            || std::find(sockets.begin(), sockets.end(), s) != sockets.end())
+            return false;
+        sockets.push_back(s);
+        found.push_back(s);
+        if (!updateKernelExpr())
+            return false;
+        if (onChange)
+            onChange();
+    }
+    return true;
+}
+
+
+bool AppFilter::updateKernelExpr()
+{
+    std::string expr = buildKernelExpr(sockets);
+    if (expr == kernel)
+        return false;
+    kernel.swap(expr);
+    version++;
+    return true;
+}
+
+
+unsigned int AppFilter::getKernelExpr(std::string &expr)
+{
+    std::lock_guard<std::mutex> lock(m_kernel);
+    expr = kernel;
+    return version;
+}
+
+
+}	// namespace NAMON
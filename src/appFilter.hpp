@@ -0,0 +1,175 @@
+/**
+ *  @file       appFilter.hpp
+ *  @brief      Capture filter of one application header file
+ *  @details    With --app only packets of applications matching a pattern are stored. Sockets
+ *              of the matching processes are found by a scan of the system repeated every
+ *              #NAMON::APP_RESCAN_INTERVAL and their ports are put into the kernel filter,
+ *              so most of the other traffic isn't copied to the userspace at all. Sockets opened
+ *              between two scans are added by the cache thread when it resolves their first
+ *              packet (e.g. a TCP SYN, which always passes). The writer then checks the
+ *              application of every packet found by the cache.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 00:20
+ *   - Edited:  20.10.2026 05:40
+ */
+
+#pragma once
+
+#include <atomic>               //  atomic
+#include <chrono>               //  seconds
+#include <functional>           //  function
+#include <mutex>                //  mutex
+#include <string>               //  string
+#include <unordered_set>        //  unordered_set
+#include <vector>               //  vector
+#include <cstdint>              //  uint8_t, uint16_t
+
+#include "appRegistry.hpp"      //  AppId
+
+
+
+
+namespace NAMON
+{
+
+
+//! How often sockets of matching processes are searched for
+const std::chrono::seconds  APP_RESCAN_INTERVAL { 1 };
+//! Maximum number of ports of one protocol in the kernel filter, with more of them the whole protocol passes
+const unsigned int          MAX_FILTER_PORTS    = 32;
+//! How long a stored packet waits for its application with --app (ms)
+const unsigned int          APP_FILTER_DELAY    = 100;
+
+
+/*!
+ * @struct  AppSocket
+ * @brief   Local port of a socket of a matching process
+ */
+struct AppSocket
+{
+    uint8_t proto = 0;      //!< Layer 4 protocol
+    uint16_t port = 0;      //!< Local port
+    bool operator==(const AppSocket &o) const   { return proto == o.proto && port == o.port; }
+};
+
+
+/*!
+ * @class   AppFilter
+ * @brief   Pattern of --app and the applications which match it
+ * @details The pattern is a part of the command line or of the path of the executable.
+ *          Names of applications are command lines, so applications matched only by their
+ *          executable are handed over by the scanning thread (see addNames()).
+ */
+class AppFilter
+{
+    std::string pattern;                        //!< Part of the command line or of the executable path
+    std::vector<uint8_t> verdicts;              //!< 0 not known, 1 matches, 2 doesn't match, indexed by AppId (writer thread)
+    std::unordered_set<std::string> exeNames;   //!< Command lines of processes matched by their executable (writer thread)
+    std::mutex m_added;                         //!< Mutex used to lock #NAMON::AppFilter::added
+    std::vector<std::string> added;             //!< Names added by the scanning thread since the writer took them
+    std::atomic<bool> hasAdded{ false };        //!< True if #NAMON::AppFilter::added isn't empty
+    std::mutex m_kernel;                        //!< Mutex used to lock the kernel filter members below
+    std::vector<AppSocket> sockets;             //!< Sockets in the kernel filter
+    std::vector<AppSocket> found;               //!< Sockets added by the cache thread since the last scan
+    std::unordered_set<std::string> scannedNames;   //!< Command lines of processes matched by their executable
+    std::string kernel;                         //!< Current kernel filter expression
+    std::atomic<unsigned int> version{ 0 };     //!< Incremented when the kernel filter changes
+    std::function<void()> onChange;             //!< Called when the kernel filter changes
+    unsigned long skipped = 0;                  //!< Number of packets which weren't stored (writer thread)
+public:
+    /*!
+     * @param[in]   pattern     Part of the command line or of the executable path
+     */
+    explicit AppFilter(const std::string &pattern) : pattern(pattern) {}
+    /*!
+     * @return  The pattern
+     */
+    const std::string & getPattern() const      { return pattern; }
+    /*!
+     * @brief       Checks whether packets of the application are stored (writer thread)
+     * @param[in]   id      Application, #NAMON::NO_APP doesn't match
+     * @param[in]   name    Name of the application
+     */
+    bool matches(AppId id, const std::string &name)
+    {
+        if (hasAdded)
+            takeAdded();
+        if (id == NO_APP)
+            return false;
+        if (id >= verdicts.size())
+            verdicts.resize(id + 1, 0);
+        if (verdicts[id] == 0)
+            verdicts[id] = (name.find(pattern) != std::string::npos || exeNames.count(name)) ? 1 : 2;
+        return verdicts[id] == 1;
+    }
+    /*!
+     * @brief   Counts a packet which isn't stored (writer thread)
+     */
+    void skip()                                 { skipped++; }
+    /*!
+     * @return  Number of packets which weren't stored
+     */
+    unsigned long getSkipped() const            { return skipped; }
+    /*!
+     * @brief       Adds names of processes whose executable matches (scanning thread)
+     * @param[in]   names   Command lines of the processes
+     */
+    void addNames(const std::vector<std::string> &names);
+    /*!
+     * @brief       Sets the function called when the kernel filter changes
+     * @details     It breaks capture loops, so capturing threads set the new filter. The function
+     *              is called under #NAMON::AppFilter::m_kernel, so after setOnChange(nullptr)
+     *              returns it isn't running and won't be called again.
+     */
+    void setOnChange(const std::function<void()> &f);
+    /*!
+     * @brief       Builds the kernel filter expression which passes packets of the sockets
+     * @details     IPv4 fragments but the first one and all IPv6 fragments always pass, ports
+     *              aren't in them. TCP SYNs always pass too, so the cache finds sockets opened
+     *              after the last scan (see addSocket()). VLAN tagged packets are nested the same
+     *              way as in prefilterExpr().
+     * @param[in]   sockets     Sockets of matching processes
+     * @return      pcap-filter expression
+     */
+    static std::string buildKernelExpr(const std::vector<AppSocket> &sockets);
+    /*!
+     * @brief       Replaces sockets in the kernel filter by the scanned ones (scanning thread)
+     * @details     Sockets added by the cache thread since the last scan are kept, the scan could
+     *              have read the system before they were opened.
+     * @param[in]   scanned     Sockets of matching processes
+     * @return      True if the kernel filter changed
+     */
+    bool setSockets(const std::vector<AppSocket> &scanned);
+    /*!
+     * @brief       Adds a socket whose application the cache resolved (cache thread)
+     * @param[in]   s       Local port of the socket
+     * @param[in]   name    Name of the application
+     * @return      True if the application matches and the kernel filter changed
+     */
+    bool addSocket(const AppSocket &s, const std::string &name);
+    /*!
+     * @brief       Returns the current kernel filter expression (capturing threads)
+     * @param[out]  expr    The expression, empty before the first scan
+     * @return      Version of the expression, see getVersion()
+     */
+    unsigned int getKernelExpr(std::string &expr);
+    /*!
+     * @return  Version of the kernel filter expression
+     */
+    unsigned int getVersion() const             { return version; }
+private:
+    /*!
+     * @brief   Takes names added by the scanning thread and forgets negative verdicts
+     */
+    void takeAdded();
+    /*!
+     * @brief   Builds the kernel filter expression of #NAMON::AppFilter::sockets
+     * @pre     #NAMON::AppFilter::m_kernel is locked
+     * @return  True if the expression changed
+     */
+    bool updateKernelExpr();
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,133 @@
+/**
+ *  @file       appRegistry.cpp
+ *  @brief      Interned application names source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 22:10
+ *   - Edited:  20.10.2026 00:50
+ */
+
+#include <algorithm>            //  sort(), stable_sort(), min()
+#include <atomic>               //  atomic
+#include <thread>               //  thread
+#include <utility>              //  pair
+
+#include "netflow.hpp"          //  Netflow
+#include "appRegistry.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+AppId AppRegistry::intern(const std::string &name)
+{
+    if (name.empty())
+        return NO_APP;
+    auto it = ids.find(name);
+    if (it != ids.end())
+        return it->second;
+    const AppId id = names.size();
+    names.push_back(name);
+    ids.emplace(name, id);
+    return id;
+}
+
+
+size_t AppResults::apps() const
+{
+    size_t n = 0;
+    for (const auto &r : results)
+        n += !r.empty();
+    return n;
+}
+
+
+size_t AppResults::flows() const
+{
+    size_t n = 0;
+    for (const auto &r : results)
+        n += r.size();
+    return n;
+}
+
+
+//! Minimum number of netflows per sorting thread, fewer aren't worth starting a thread for
+static const size_t MIN_FLOWS_PER_THREAD = 50000;
+
+
+/*!
+ * @brief       Sorts netflows by their start time
+ * @details     Start times are read into an array once, so the comparisons don't go through
+ *              the pointers into netflows scattered over the heap.
+ * @param[in]   keys    Buffer reused between calls
+ */
+static void sortFlows(std::vector<Netflow *> &flows, std::vector<std::pair<uint64_t, Netflow *>> &keys)
+{
+    keys.clear();
+    keys.reserve(flows.size());
+    for (Netflow *n : flows)
+        keys.emplace_back(n->getStartTime(), n);
+    auto earlier = [](const std::pair<uint64_t, Netflow *> &a, const std::pair<uint64_t, Netflow *> &b) {
+        return a.first < b.first;
+    };
+    if (std::is_sorted(keys.begin(), keys.end(), earlier))
+        return;
+    std::stable_sort(keys.begin(), keys.end(), earlier);
+    for (size_t i = 0; i < keys.size(); i++)
+        flows[i] = keys[i].second;
+}
+
+
+void AppResults::sort(unsigned int threads)
+{
+    if (sorted)
+        return;
+    std::vector<std::vector<Netflow *> *> todo;
+    size_t total = 0;
+    for (auto &r : results)
+    {
+        if (r.size() < 2)
+            continue;
+        todo.push_back(&r);
+        total += r.size();
+    }
+    // the biggest applications go first, so no thread ends with a big one alone
+    std::sort(todo.begin(), todo.end(), [](const std::vector<Netflow *> *a, const std::vector<Netflow *> *b) {
+        return a->size() > b->size();
+    });
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<size_t>({ threads, todo.size(), total / MIN_FLOWS_PER_THREAD + 1 });
+
+    std::atomic<size_t> next{ 0 };
+    auto work = [&todo, &next]() {
+        std::vector<std::pair<uint64_t, Netflow *>> keys;
+        for (size_t i = next++; i < todo.size(); i = next++)
+            sortFlows(*todo[i], keys);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; t++)
+        pool.emplace_back(work);
+    work();
+    for (std::thread &t : pool)
+        t.join();
+    sorted = true;
+}
+
+
+void AppResults::clear()
+{
+    for (auto &r : results)
+    {
+        for (Netflow *n : r)
+            delete n;
+        r.clear();
+    }
+    sorted = true;
+}
+
+
+}	// namespace NAMON
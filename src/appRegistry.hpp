@@ -0,0 +1,112 @@
+/**
+ *  @file       appRegistry.hpp
+ *  @brief      Interned application names header file
+ *  @details    Every application name (cmdline of the process) is stored once and cache
+ *              entries and results refer to it by a small integer ID. The registry is used
+ *              only by the cache thread and, before it starts or after it ends, by the main
+ *              thread, so it isn't locked.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 22:10
+ *   - Edited:  20.10.2026 00:50
+ */
+
+#pragma once
+
+#include <string>               //  string
+#include <vector>               //  vector
+#include <unordered_map>        //  unordered_map
+#include <cstdint>              //  uint32_t
+
+
+
+
+namespace NAMON
+{
+
+
+class Netflow;
+
+//! @brief  ID of an application in #NAMON::AppRegistry
+using AppId = uint32_t;
+//! @brief  ID of the empty name, the application is not known
+const AppId NO_APP = 0;
+
+
+/*!
+ * @class   AppRegistry
+ * @brief   Table of application names and their IDs
+ */
+class AppRegistry
+{
+    std::vector<std::string> names { "" };              //!< Names indexed by their ID
+    std::unordered_map<std::string, AppId> ids;         //!< IDs of names
+public:
+    /*!
+     * @brief       Returns ID of the name, the name is added if it isn't known yet
+     * @param[in]   name    Application name, the empty one is #NAMON::NO_APP
+     */
+    AppId intern(const std::string &name);
+    /*!
+     * @return  Name of the application
+     */
+    const std::string & name(AppId id) const    { return names[id]; }
+    /*!
+     * @return  Number of IDs including #NAMON::NO_APP, IDs are lower than this
+     */
+    size_t size() const                         { return names.size(); }
+};
+
+
+/*!
+ * @brief   Netflows of applications indexed by their ID
+ */
+class AppResults
+{
+    std::vector<std::vector<Netflow *>> results;        //!< Netflows indexed by the ID of their application
+    bool sorted = true;                                 //!< Netflows of every application are in order of their start time
+public:
+    /*!
+     * @brief       Adds a finished netflow of an application
+     * @param[in]   id  Application
+     * @param[in]   n   Netflow, it is deleted by clear()
+     */
+    void add(AppId id, Netflow *n)
+    {
+        if (id >= results.size())
+            results.resize(id + 1);
+        results[id].push_back(n);
+        sorted = false;
+    }
+    /*!
+     * @return  Netflows of the application
+     */
+    const std::vector<Netflow *> & get(AppId id) const
+    {
+        static const std::vector<Netflow *> empty;
+        return (id < results.size()) ? results[id] : empty;
+    }
+    /*!
+     * @return  Number of applications with at least one netflow
+     */
+    size_t apps() const;
+    /*!
+     * @return  Number of all netflows
+     */
+    size_t flows() const;
+    /*!
+     * @brief       Sorts netflows of every application by their start time
+     * @details     Applications are sorted in parallel, the biggest ones first. Netflows with the
+     *              same start time stay in order of their addition. It does nothing if no netflow
+     *              was added since the last call.
+     * @param[in]   threads     Maximum number of threads, 0 for the number of CPUs
+     */
+    void sort(unsigned int threads = 0);
+    /*!
+     * @brief   Deletes all netflows
+     */
+    void clear();
+};
+
+
+}	// namespace NAMON
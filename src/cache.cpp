@@ -4,12 +4,11 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 26.02.2017 23:52
- *   - Edited:  23.06.2017 11:56
+ *   - Edited:  20.10.2026 00:50
  */
 
 #include <iostream>             //  cout, endl;
 #include <atomic>               //  atomic
-#include <map>                  //  map
 
 #if defined(__linux__)
 #include <cstring>              //  memcmp(), memcpy()
@@ -28,7 +27,8 @@
 using namespace std;
 
 
-extern map<string, vector<NAMON::Netflow *>> g_finalResults;
+extern NAMON::AppResults g_finalResults;
+extern NAMON::AppRegistry g_apps;
 extern const atomic<int> shouldStop;
 
 
@@ -38,7 +38,53 @@ namespace NAMON
 {
 
 
-const int VALID_TIME = 3;      //!< Time of validity of TEntry record in cache in seconds
+const int VALID_TIME = 3;      //!< Default time of validity of TEntry record in cache in seconds
+
+static seconds defaultValidTime(VALID_TIME);    //!< Time of validity of protocols without their own one
+static seconds protoValidTimes[256];            //!< Time of validity of layer 4 protocols, zero means the default one
+
+
+
+int setValidTime(const string &spec)
+{
+    seconds *t = &defaultValidTime;
+    string value = spec;
+    const size_t colon = spec.find(':');
+    if (colon != string::npos)
+    {
+        const string proto = spec.substr(0, colon);
+        if (proto == "tcp")
+            t = &protoValidTimes[PROTO_TCP];
+        else if (proto == "udp")
+            t = &protoValidTimes[PROTO_UDP];
+        else if (proto == "udplite")
+            t = &protoValidTimes[PROTO_UDPLITE];
+        else
+            return -1;
+        value = spec.substr(colon + 1);
+    }
+
+    size_t end = 0;
+    unsigned long s = 0;
+    try
+    {
+        s = std::stoul(value, &end);
+    }
+    catch (std::exception &)
+    {
+        return -1;
+    }
+    if (end != value.length() || s == 0)
+        return -1;
+    *t = seconds(s);
+    return 0;
+}
+
+
+seconds getValidTime(uint8_t proto)
+{
+    return (protoValidTimes[proto] != seconds::zero()) ? protoValidTimes[proto] : defaultValidTime;
+}
 
 
 
@@ -85,11 +131,20 @@ bool TEntry::levelCompare(Netflow *n1)
 
 
 
+string const & TEntry::getAppName()
+{
+    return g_apps.name(appId);
+}
+
+
 void TEntry::print()
 {
 
-    cout << string((int)level, '-') << ">[" << (int)level << "] \"" << appName << "\" (inode/PID:" << inodeOrPid << ")\t"/* << (valid() ? "(valid)" : "(expired)") << "\t"*/;
-    n->print();
+    cout << string((int)level, '-') << ">[" << (int)level << "] \"" << getAppName() << "\" (inode/PID:" << inodeOrPid << ")\t"/* << (valid() ? "(valid)" : "(expired)") << "\t"*/;
+    if (n)
+        n->print();
+    else    // moved into the results by saveResults()
+        cout << "(saved)" << endl;
 }
 
 
@@ -247,11 +302,10 @@ void TTree::saveResults()
         if (record->isEntry())
         {
             TEntry *entryPtr = static_cast<TEntry *>(record);
-            if (entryPtr->getAppName() != "")
+            // pre-scanned sockets without any packet are not results
+            if (entryPtr->getAppId() != NO_APP && entryPtr->getNetflowPtr()->getEndTime() != 0)
             {
-                Netflow *res = new Netflow;
-                *res = *entryPtr->getNetflowPtr();
-                g_finalResults[entryPtr->getAppName()].push_back(res);
+                g_finalResults.add(entryPtr->getAppId(), entryPtr->releaseNetflowPtr());
             }
         }
         else
@@ -260,6 +314,18 @@ void TTree::saveResults()
 }
 
 
+void TTree::forEachEntry(const std::function<void(TEntry &)> &f)
+{
+    for (auto record : v)
+    {
+        if (record->isEntry())
+            f(*static_cast<TEntry *>(record));
+        else
+            static_cast<TTree *>(record)->forEachEntry(f);
+    }
+}
+
+
 void TTree::print()
 {
     cout << string((int)level, '-') << ">{" << (int)level << "} ";
@@ -313,8 +379,8 @@ Cache::~Cache()
 
 TEntryOrTTree *Cache::find(Netflow &n)
 {
-    auto iter = map->find(n.getLocalPort());
-    // if the netflow record either exists in the cache or there is a netflow with the same local port
+    auto iter = map->find(n.getHash());
+    // if the netflow record either exists in the cache or there is a netflow with the same hash
     if (iter != (*map).end())
     {
         if (iter->second->isTree())
@@ -337,15 +403,16 @@ TEntryOrTTree *Cache::find(Netflow &n)
 void Cache::insert(TEntry *newEntry)
 {
     Netflow &newNetflow = *newEntry->getNetflowPtr();
-    auto iter = map->find(newNetflow.getLocalPort());
+    const uint32_t hash = newNetflow.getHash();
+    auto iter = map->find(hash);
     if (iter != (*map).end())
-    { // Netflow record either exists in the cache (at least with the same local port)
+    { // Netflow record either exists in the cache (at least with the same hash)
         if (iter->second->isTree())
         { // insert it into a subtree
             static_cast<TTree*>(iter->second)->insert(newEntry);
         }
         else    
-        { // isEntry -> record with the same local port
+        { // isEntry -> record with the same hash
             TEntry *oldEntry = static_cast<TEntry*>(iter->second);
             // If the same netflow record already exists
             if (*oldEntry->getNetflowPtr() == newNetflow)
@@ -363,9 +430,9 @@ void Cache::insert(TEntry *newEntry)
         }
     }
     else
-    { // there isn't record with the same local port in the map
+    { // there isn't record with the same hash in the map
         newEntry->setLevel(TreeLevel::LOCAL_PORT);
-        (*map)[newNetflow.getLocalPort()] = newEntry;
+        (*map)[hash] = newEntry;
     }
 }
 
@@ -377,11 +444,9 @@ void Cache::saveResults()
         if (record.second->isEntry())
         {
             TEntry *entryPtr = static_cast<TEntry *>(record.second);
-            if (/*!entryPtr->valid() && */entryPtr->getAppName() != "")
+            if (/*!entryPtr->valid() && */entryPtr->getAppId() != NO_APP && entryPtr->getNetflowPtr()->getEndTime() != 0)
             {
-                Netflow *res = new Netflow;
-                *res = *entryPtr->getNetflowPtr();
-                g_finalResults[entryPtr->getAppName()].push_back(res);
+                g_finalResults.add(entryPtr->getAppId(), entryPtr->releaseNetflowPtr());
             }
         }
         else
@@ -390,6 +455,18 @@ void Cache::saveResults()
 }
 
 
+void Cache::forEachEntry(const std::function<void(TEntry &)> &f)
+{
+    for (auto record : *map)
+    {
+        if (record.second->isEntry())
+            f(*static_cast<TEntry *>(record.second));
+        else
+            static_cast<TTree *>(record.second)->forEachEntry(f);
+    }
+}
+
+
 void Cache::print()
 {
     for (auto m : *map)
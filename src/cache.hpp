@@ -4,7 +4,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 02.03.2017 04:32
- *   - Edited:  23.06.2017 11:57
+ *   - Edited:  20.10.2026 01:20
  */
 
 #pragma once
@@ -13,8 +13,10 @@
 #include <vector>           //  vector
 #include <unordered_map>    //  map
 #include <chrono>           //  seconds
+#include <functional>       //  function
 
 #include "netflow.hpp"      //  Netflow
+#include "appRegistry.hpp"  //  AppId
 
 using clock_type = std::chrono::high_resolution_clock;
 using std::string;
@@ -31,6 +33,34 @@ namespace NAMON
 extern const int VALID_TIME;
 
 
+/*!
+ * @brief       Sets time of validity of cache entries of one protocol or of all protocols
+ * @details     When an entry expires, its socket owner is checked (see #NAMON::SocketOwner)
+ *              and the procfs is searched only if the owner doesn't hold the socket anymore.
+ * @param[in]   spec    [<tcp|udp|udplite>:]<seconds>
+ * @return      -1 if the specification is invalid, 0 otherwise
+ */
+int setValidTime(const string &spec);
+/*!
+ * @return      Time of validity of cache entries of the layer 4 protocol
+ */
+seconds getValidTime(uint8_t proto);
+
+
+/*!
+ * @brief   Process which holds the socket of a cache entry
+ * @details Owner of a socket is checked by reading one file descriptor link and the start
+ *          time of the process, which is much cheaper than searching the whole procfs.
+ *          The start time tells the process apart from a later one with the same PID.
+ */
+struct SocketOwner
+{
+    int pid = 0;                //!< PID of the owner, zero if it isn't known
+    int fd = -1;                //!< File descriptor of the socket in the owner, -1 if it isn't known
+    uint64_t startTime = 0;     //!< Start time of the owner (clock ticks after boot)
+};
+
+
 /*!
  * @brief An enum representing type of node in a tree
  */
@@ -153,9 +183,12 @@ class TEntry : public TEntryOrTTree
 {
     //! @brief  Time of last update
     clock_type::time_point lastUpdate = clock_type::now();
-    string appName ="";             //!< Application name which #NAMON::TEntry::n belongs to
-    int inodeOrPid =0;                   //!< Inode number of #NAMON::TEntry::appName 's socket
+    AppId appId = NO_APP;           //!< Application which #NAMON::TEntry::n belongs to
+    int inodeOrPid =0;                   //!< Inode number of #NAMON::TEntry::appId 's socket
+    SocketOwner owner;              //!< Process which held the socket when it was found
     Netflow *n = nullptr;           //!< Pointer to a netflow record
+    uint64_t exportedEnd = 0;       //!< End time of the last record exported by IPFIX, zero if none was
+    uint64_t recordStart = 0;       //!< Start time of the next exported record, zero for the start of the netflow
 public:
     /*!
      * @brief   Default constructor that sets node type to #NodeType::ENTRY
@@ -177,19 +210,24 @@ public:
     void updateTime()                       { lastUpdate = clock_type::now(); }
     /*!
      * @brief   Returns if this TEntry is still valid
-     * @return  False if the entry is older or equal to #NAMON::VALID_TIME, true otherwise.
+     * @return  False if the entry is older or equal to the time of validity of its protocol
+     *          (see setValidTime()), true otherwise.
      */
-    bool valid()     { return duration_cast<seconds>(clock_type::now()-lastUpdate) < seconds(VALID_TIME); }
+    bool valid()     { return duration_cast<seconds>(clock_type::now()-lastUpdate) < getValidTime(n->getProto()); }
     /*!
-     * @brief       Set method for #NAMON::TEntry::appName
-     * @param[in]   name    New application name
+     * @brief       Set method for #NAMON::TEntry::appId
+     * @param[in]   id      New application, see AppRegistry::intern()
      */
-    void setAppName(const string &name)     { appName = name; }
+    void setAppId(AppId id)                 { appId = id; }
     /*!
-     * @brief   Get method for #NAMON::TEntry::appName
-     * @return  Application name
+     * @brief   Get method for #NAMON::TEntry::appId
+     * @return  Application ID, #NAMON::NO_APP if it isn't known
      */
-    string const & getAppName()             { return appName; }
+    AppId getAppId()                        { return appId; }
+    /*!
+     * @return  Application name from #g_apps
+     */
+    string const & getAppName();
     /*!
      * @brief       Set method for #NAMON::TEntry::inodeOrPid
      * @param[in]   i   New inode (Linux) or PID (Win) number
@@ -200,6 +238,16 @@ public:
      * @return  Inode number (Linux) or PID (Win)
      */
     int getInodeOrPid()                          { return inodeOrPid; }
+    /*!
+     * @brief       Set method for #NAMON::TEntry::owner
+     * @param[in]   o   Process which holds the socket
+     */
+    void setOwner(const SocketOwner &o)     { owner = o; }
+    /*!
+     * @brief   Get method for #NAMON::TEntry::owner
+     * @return  Process which held the socket when it was found
+     */
+    const SocketOwner & getOwner()          { return owner; }
     /*!
      * @brief       Set method for #NAMON::TEntry::n
      * @pre         newNetflow must be a valid Netflow pointer
@@ -213,6 +261,27 @@ public:
      * @return  Pointer to a Netflow class
      */
     Netflow * getNetflowPtr()               { return n; }
+    /*!
+     * @brief   Takes #NAMON::TEntry::n out of the entry, the entry is left without a netflow
+     * @return  Pointer to the Netflow class, the caller has to delete it
+     */
+    Netflow * releaseNetflowPtr()           { Netflow *r = n; n = nullptr; return r; }
+    /*!
+     * @brief   Get method for #NAMON::TEntry::exportedEnd
+     * @return  End time of the last exported record, zero if none was
+     */
+    uint64_t getExportedEnd()               { return exportedEnd; }
+    /*!
+     * @brief   Get method for #NAMON::TEntry::recordStart
+     * @return  Start time of the next exported record, zero for the start of the netflow
+     */
+    uint64_t getRecordStart()               { return recordStart; }
+    /*!
+     * @brief       Marks the netflow as exported up to end
+     * @param[in]   end         End time of the exported record
+     * @param[in]   nextStart   Start time of the next record
+     */
+    void setExported(uint64_t end, uint64_t nextStart)  { exportedEnd = end; recordStart = nextStart; }
     /*!
      * @brief       Compares values important at a specific #NAMON::TreeLevel
      * @param[in]   n1  Pointer to a Netflow class with netflow information
@@ -232,8 +301,11 @@ public:
         if (this != &other)
         {
             lastUpdate = other.lastUpdate;
-            appName = other.appName;
+            appId = other.appId;
             inodeOrPid = other.inodeOrPid;
+            owner = other.owner;
+            exportedEnd = other.exportedEnd;
+            recordStart = other.recordStart;
             if (n == nullptr)
                 n = new Netflow;
             *n = *other.n;
@@ -249,15 +321,20 @@ public:
         if (this != &other)
         {
             lastUpdate = other.lastUpdate;
-            appName = other.appName;
+            appId = other.appId;
             inodeOrPid = other.inodeOrPid;
+            owner = other.owner;
+            exportedEnd = other.exportedEnd;
+            recordStart = other.recordStart;
             delete n;
             n = other.n;
             
             other.lastUpdate = clock_type::now();
-            other.appName = "";
+            other.appId = NO_APP;
             other.inodeOrPid = 0;
+            other.owner = SocketOwner();
             other.n = nullptr;
+            other.exportedEnd = other.recordStart = 0;
         }
         return *this;
     }
@@ -338,6 +415,10 @@ public:
      * @warning After this call, there are zero initialized netflow records in cache
      */
     void saveResults();
+    /*!
+     * @brief       Calls the function for every entry in the subtree
+     */
+    void forEachEntry(const std::function<void(TEntry &)> &f);
     /*!
      * @brief   Function prints content of the class to the standard output
      */
@@ -348,12 +429,13 @@ public:
 
 /*!
  * @class Cache
- * Cache contains map of open local ports
+ * Cache contains map of netflow hashes (Netflow::getHash()). Netflows with colliding
+ * hashes are distinguished by a decision tree.
  */
 class Cache
 {
-    //! @brief  Map of open local ports
-    std::unordered_map<unsigned short,class TEntryOrTTree*> *map = new std::unordered_map<unsigned short,class TEntryOrTTree*>;
+    //! @brief  Map of netflow hashes
+    std::unordered_map<uint32_t,class TEntryOrTTree*> *map = new std::unordered_map<uint32_t,class TEntryOrTTree*>;
 public:
     /*!
      * @brief   Default c'tor that initialises Cache 
@@ -368,9 +450,10 @@ public:
      * @brief       Set method for #NAMON::Cache::map
      * @param[in]   newMap  Pointer to a new actualized map
      */
-    void setCache(std::unordered_map<unsigned short,TEntryOrTTree*> *newMap) { map = newMap; }
+    void setCache(std::unordered_map<uint32_t,TEntryOrTTree*> *newMap) { map = newMap; }
     /*!
      * @brief       Function finds a Netflow record in a cache
+     * @details     The hash carried by the netflow is used, it is computed only if it is missing
      * @param[in]   n   Reference to a Netflow class, it tries to find in the cache.
      * @return      Pointer to a TEntry node in a case of the exact match, 
      *              pointer to a TTree node with the closest match
@@ -387,10 +470,15 @@ public:
     void insert(TEntry *e);
     /*!
      * @brief   Finds expired entries and saves them in #g_finalResults
-     * @warning Cache will contain zero initialized (moved) entries after this call.
-     *          It is supposed to be called at the end of the program runtime.
+     * @warning Netflows are moved into #g_finalResults, not copied, the saved entries are left
+     *          without them. It is supposed to be called at the end of the program runtime.
      */
     void saveResults();
+    /*!
+     * @brief       Calls the function for every entry in the cache
+     * @param[in]   f   Function called with the entry
+     */
+    void forEachEntry(const std::function<void(TEntry &)> &f);
     /*!
      * @brief   Function prints content of the class to the standard output
      */
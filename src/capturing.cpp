@@ -4,7 +4,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 18.02.2017 22:45
- *   - Edited:  23.06.2017 12:00
+ *   - Edited:  20.10.2026 05:40
  *   @todo      name: ncap, netcat, ncat, netcap, necai
  *   @todo      determine platform in scripts
  *   @todo      IPv6 implementation tests
@@ -41,8 +41,11 @@
  *   @bug       add check ending '\0' in appname
  */
 
-#include <map>                  //  map
-#include <pcap.h>               //  pcap_lookupdev(), pcap_open_live(), pcap_dispatch(), pcap_close()
+#include <algorithm>            //  min(), max()
+#include <memory>               //  unique_ptr
+#include <sstream>              //  ostringstream
+#include <cstring>              //  strcmp()
+#include <pcap.h>               //  pcap_lookupdev(), pcap_open_live(), pcap_dispatch(), pcap_close(), pcap_compile()
 #include <thread>               //  thread
 #include <atomic>               //  atomic::store()
 
@@ -61,11 +64,15 @@
 
 #include "tcpip_headers.hpp"	//	
 #include "fileHandler.hpp"      //  initOFile()
+#include "streamOutput.hpp"     //  StreamOutput, isStreamOutput()
+#include "compressedOutput.hpp" //  CompressedOutput
 #include "ringBuffer.hpp"       //  RingBuffer
 #include "cache.hpp"            //  TEntryOrTTree
 #include "netflow.hpp"          //  Netflow
 #include "debug.hpp"            //  D(), log()
 #include "utils.hpp"            //  
+#include "packetParser.hpp"     //  PacketParser, ParsedPacket, FragmentTable
+#include "packetBatch.hpp"      //  PacketBatch
 #include "capturing.hpp"
 
 
@@ -81,17 +88,48 @@ using namespace NAMON;
 
 const unsigned int      FILE_RING_BUFFER_SIZE	= 2000;   //!< Size of the ring buffer
 const unsigned int      CACHE_RING_BUFFER_SIZE	= 2000;   //!< Size of the ring buffer
+const chrono::seconds   SNAPSHOT_INTERVAL		{ 60 };   //!< Period of saving the cache snapshot
+const int               FLOW_ONLY_SNAPLEN		= 128;    //!< Snaplen in flow-only mode (Ethernet, IPv4/IPv6 and L4 ports)
 const mac_addr			g_macMcast4				{ { 0x01,0x00,0x5e } };					//!< IPv4 multicast MAC address
 const mac_addr			g_macMcast6				{ { 0x33,0x33 } };						//!< IPv6 multicast MAC address
 const mac_addr			g_macBcast				{ { 0xff,0xff,0xff,0xff,0xff,0xff } };  //!< Broadcast MAC address
 
-map<string, vector<Netflow *>> g_finalResults;			//!< Applications and their netflows
-pcap_t *g_pcapHandle			= nullptr;              //!< Pcap handle
-const char * g_dev				= nullptr;              //!< Capturing device name
+AppRegistry g_apps;										//!< Names of applications and their IDs
+AppResults g_finalResults;								//!< Applications and their netflows
+vector<pcap_t *> g_pcapHandles;							//!< Pcap handles of all capturing devices
+vector<const char *> g_devs;							//!< Names of capturing devices
+const char * g_dev				= nullptr;              //!< Capturing device name (the one being opened)
+bool g_flowOnly					= false;				//!< Packets are not stored, only netflows and their applications
+int g_snaplen					= 0;					//!< Snapshot length, zero means the default one
+const char * g_tstampType		= nullptr;				//!< Requested libpcap time stamp type (host, adapter, ...)
+uint8_t g_tsresol				= 6;					//!< Resolution of time stamps (10^-g_tsresol s), 6 or 9
+StoragePolicy g_storagePolicy;							//!< How much of every packet is stored into the output file
+bool g_prefilter				= false;				//!< Only packets which the parser accepts are passed from the kernel
+bool g_parseIpv6				= true;					//!< IPv6 packets are assigned to applications
+bool g_parseUdplite				= true;					//!< UDP-Lite packets are assigned to applications
+const char * g_filterExpr		= nullptr;				//!< User's libpcap filter expression
+StagePolicy g_filePolicy;								//!< Overload policy of the file writing stage
+StagePolicy g_cachePolicy;								//!< Overload policy of the cache stage
+LocalAddresses g_localAddresses;						//!< Addresses of the host used to determine packet direction
+unsigned int g_batchSize		= 0;					//!< Number of packets classified at once, zero means one by one
+bool g_prescan					= false;				//!< Sockets of all processes are loaded into the cache before capturing
+const char * g_cacheSnapshot	= nullptr;				//!< Cache snapshot file loaded at start and saved periodically and at the end
+bool g_legacyMapping			= false;				//!< The mapping block is written record by record instead of in columns
+bool g_annotate					= false;				//!< Stored packets get an option with the ID of their application
+unsigned int g_annotateDelay	= 0;					//!< How long a stored packet waits for its application (ms)
+bool g_split					= false;				//!< Stored packets are written into files of their applications
+unsigned int g_splitDelay		= DEFAULT_SPLIT_DELAY;	//!< How long a stored packet waits for its file (ms)
+vector<SplitRule> g_splitRules;							//!< Files of --split-app, empty means a file per application
+const char * g_appPattern		= nullptr;				//!< Only packets of applications matching the pattern are stored
+bool g_ipfix					= false;				//!< Netflows are exported to an IPFIX collector
+IpfixCollector g_ipfixCollector;						//!< IPFIX collector of --ipfix
+unsigned int g_ipfixActive		= DEFAULT_IPFIX_ACTIVE;	//!< IPFIX active timeout (s)
+const char * g_shmName			= nullptr;				//!< Shared memory object which gets stored packets live
+unsigned int g_shmSize			= DEFAULT_SHM_SIZE;		//!< Size of the shared memory ring (MiB)
+bool g_compress					= false;				//!< The output file is compressed in frames
 mac_addr g_devMac				{ {0} };				//!< Capturing device MAC address
 ofstream oFile;											//!< Output file stream
 atomic<int> shouldStop			{ false };              //!< Variable which is set if program should stop
-unsigned int rcvdPackets		= 0;					//!< Number of received packets
 unsigned int g_allSockets		= 0;					//!< Number of unique sockets
 unsigned int g_notFoundSockets	= 0;					//!< Number of unsuccessful searches for inode number
 unsigned int g_notFoundApps		= 0;					//!< Number of unsuccessful searches for application
@@ -107,6 +145,9 @@ int startCapture(const char *oFilename)
 	signal(SIGINT, signalHandler);      signal(SIGTERM, signalHandler);
 	signal(SIGABRT, signalHandler);     signal(SIGSEGV, signalHandler);
 #endif
+	// the capture goes to the standard output, messages for the user mustn't get into it
+	const bool toStdout = (strcmp(oFilename, "-") == 0);
+	streambuf *coutBuf = toStdout ? cout.rdbuf(cerr.rdbuf()) : nullptr;
 
 	char errbuf[PCAP_ERRBUF_SIZE];
 
@@ -120,7 +161,7 @@ int startCapture(const char *oFilename)
 		u_int inum, i = 0;
 
 		/* The user didn't provide a packet source: Retrieve the device list */
-		if (g_dev == nullptr)
+		if (g_devs.empty())
 		{
 			if (pcap_findalldevs(&alldevs, errbuf) == -1)
 				throw pcap_ex("Can't open input device.", errbuf);
@@ -144,85 +185,371 @@ int startCapture(const char *oFilename)
 			/* Jump to the selected adapter */
 			for (d = alldevs, i = 0; i < inum-1; d = d->next, i++)
 				;
-			g_dev = d->name;
+			g_devs.push_back(d->name);
 		}
 
-		// get interface MAC address
-		if (setDevMac())
-			throw "Can't get interface MAC address.";
+		// In flow-only mode we need just the headers
+		if (g_snaplen <= 0)
+			g_snaplen = g_flowOnly ? FLOW_ONLY_SNAPLEN : BUFSIZ;
 
-		
-		// Open the output file
-		oFile.open(oFilename, ios::binary);
-		if (!oFile)
-			throw ("Can't open output file: '" + string(oFilename) + "'").c_str();
+		// Open all devices first, because the time stamp resolution is written into the output file.
+		// All devices must use the same resolution, so if some of them doesn't support nanoseconds
+		// the others are opened again with microseconds.
+		vector<CaptureInterface> interfaces(g_devs.size());
+		g_tsresol = 9;
+		for (size_t i = 0; i < interfaces.size(); i++)
+		{
+			CaptureInterface &iface = interfaces[i];
+			iface.name = g_dev = g_devs[i];
+			// get interface MAC address, devices like "any" don't have one
+			iface.hasMac = (setDevMac() == 0);
+			iface.mac = g_devMac;
+
+			const uint8_t tsresol = g_tsresol;
+			iface.handle = openDevice(iface.name);
+			g_pcapHandles.push_back(iface.handle);
+			iface.linkType = pcap_datalink(iface.handle);
+			if (!isSupportedLinkType(iface.linkType))
+				log(LogLevel::WARNING, "Link type '", pcap_datalink_val_to_name(iface.linkType), "' of '", iface.name, "' is not supported, packets are only stored.");
+			if (g_tsresol != tsresol && i > 0)
+			{
+				for (pcap_t *h : g_pcapHandles)
+					pcap_close(h);
+				g_pcapHandles.clear();
+				i = -1;
+				continue;
+			}
+		}
+		for (CaptureInterface &iface : interfaces)
+			log(LogLevel::INFO, "Capturing device '", iface.name, "' was opened (time stamp resolution 10^-", (int)g_tsresol, " s).");
+		//Aif (pcap_setnonblock(g_pcapHandle, 1, errbuf) == -1)
+		//A	throw pcap_ex("pcap_setnonblock() failed.", errbuf);
+
+		// Open the output file, a pipe, a FIFO or the standard output is written in batches
+		StreamOutput streamOut;
+		ostream stream(&streamOut);
+		const bool streaming = isStreamOutput(oFilename);
+		if (streaming)
+		{
+			if (streamOut.open(oFilename))
+				throw "Can't open the output stream.";
+#if defined(SIGPIPE)
+			streamOut.setOnBroken([]() { signalHandler(SIGPIPE); });	// nobody reads the capture anymore
+#else
+			streamOut.setOnBroken([]() { signalHandler(SIGTERM); });
+#endif
+		}
+		else
+		{
+			oFile.open(oFilename, ios::binary);
+			if (!oFile)
+				throw ("Can't open output file: '" + string(oFilename) + "'").c_str();
+		}
+		ostream &file = streaming ? stream : oFile;
+		// blocks are compressed by the writer thread before they go into the file
+		CompressedOutput compressedOut;
+		ostream compressed(&compressedOut);
+		if (g_compress && compressedOut.open(file))
+			throw "Output file error";
+		ostream &output = g_compress ? compressed : file;
 		log(LogLevel::INFO, "Output file '", oFilename, "' was opened.");
 
-		// Write Section Header Block and Interface Description Block to the output file
-		if (initOFile(oFile))
+		// Write Section Header Block and Interface Description Blocks to the output file
+		vector<uint16_t> linkTypes;
+		for (CaptureInterface &iface : interfaces)
+			linkTypes.push_back(toLinkType(iface.linkType));
+		if (initOFile(output, g_devs, linkTypes))
 			throw "Output file initialization error.";
 #if defined(_WIN32)
         if (connectToWmi())
             throw "Connection to WMI failed";
 #endif
 
-		if ((g_pcapHandle = pcap_open_live(g_dev, BUFSIZ, false, 1000, errbuf)) == NULL)
-			throw pcap_ex("pcap_open_live() failed.", errbuf);
-		//Aif (pcap_setnonblock(g_pcapHandle, 1, errbuf) == -1)
-		//A	throw pcap_ex("pcap_setnonblock() failed.", errbuf);
-		log(LogLevel::INFO, "Capturing device '", g_dev, "' was opened.");
+		// Direction of packets is determined by local addresses, which are kept up to date
+		// by a netlink socket. Without them the link layer header is used.
+		thread addrThread;
+#if defined(__linux__)
+		const int addrFd = openAddressMonitor(g_localAddresses);
+		if (addrFd < 0)
+			log(LogLevel::WARNING, "Can't get local addresses, packet direction is determined by the link layer.");
+		else
+			addrThread = thread([addrFd]() { runAddressMonitor(addrFd, g_localAddresses); });
+#endif
+
+		// With --app the kernel passes only ports of sockets of matching processes, they are
+		// searched for again every APP_RESCAN_INTERVAL or added by the cache thread and
+		// capturing threads set the new filter
+		unique_ptr<AppFilter> appFilter;
+		if (g_appPattern != nullptr)
+		{
+			appFilter.reset(new AppFilter(g_appPattern));
+#if defined(__linux__)
+			if (scanAppSockets(*appFilter) < 0)
+				log(LogLevel::WARNING, "Can't find sockets of '", g_appPattern, "', all packets are passed to the writer.");
+#endif
+			appFilter->setOnChange([]() {
+				for (pcap_t *h : g_pcapHandles)
+					pcap_breakloop(h);
+			});
+		}
+
+		// Packets which are not stored don't have to be copied to the userspace at all
+		for (CaptureInterface &iface : interfaces)
+			if (setFilter(iface, appFilter.get()))
+				throw pcap_ex("Can't set capture filter.", pcap_geterr(iface.handle));
 
-		// Create ring buffer and run writing to file in a new thread
-		RingBuffer<EnhancedPacketBlock> fileBuffer(FILE_RING_BUFFER_SIZE);
-		thread t1([&fileBuffer]() { fileBuffer.write(oFile); });
+		// Create ring buffers of every interface. Writing to file (not used in flow-only mode)
+		// and the cache run in their own threads, each of them reads buffers of all interfaces.
+		vector<RingBuffer<EnhancedPacketBlock> *> fileBuffers;
+		vector<RingBuffer<Netflow> *> cacheBuffers;
+		const SimdLevel simd = detectSimdLevel();
+		if (g_batchSize)
+			log(LogLevel::INFO, "Packets are classified in batches of ", g_batchSize, " (", toString(simd), ").");
+		for (uint32_t i = 0; i < interfaces.size(); i++)
+		{
+			CaptureInterface &iface = interfaces[i];
+			if (!g_flowOnly)
+			{
+				iface.fileBuffer.reset(new RingBuffer<EnhancedPacketBlock>(FILE_RING_BUFFER_SIZE));
+				iface.fileBuffer->setPolicy(g_filePolicy);
+				if (i > 0)
+					iface.fileBuffer->shareWakeup(*fileBuffers[0]);
+				fileBuffers.push_back(iface.fileBuffer.get());
+			}
+			iface.cacheBuffer.reset(new RingBuffer<Netflow>(CACHE_RING_BUFFER_SIZE));
+			iface.cacheBuffer->setPolicy(g_cachePolicy);
+			if (i > 0)
+				iface.cacheBuffer->shareWakeup(*cacheBuffers[0]);
+			cacheBuffers.push_back(iface.cacheBuffer.get());
+			iface.storagePolicy = g_storagePolicy;
+			iface.params.reset(new PacketHandlerParams(iface.fileBuffer.get(), iface.cacheBuffer.get(), i, iface.linkType,
+				iface.hasMac ? &iface.mac : nullptr, &iface.storagePolicy));
+			iface.params->batch.setCapacity(g_batchSize);
+			iface.params->batch.setSimdLevel(simd);
+		}
+		// Applications found by the cache are published for the writer, which annotates packets
+		// with them or writes packets into files of their applications
+		FlowApps flowApps;
+		unique_ptr<AppFiles> appFiles;
+		unique_ptr<ShmStream> shm;
+		chrono::milliseconds appDelay(0);
+		if ((g_annotate || g_split || g_shmName) && g_flowOnly)
+			log(LogLevel::WARNING, "Packets are not stored in flow-only mode, they can't be annotated, split nor streamed.");
+		else if (!g_flowOnly && (g_annotate || g_split || appFilter || g_shmName))
+		{
+			flowApps.enable();
+			if (g_annotate)
+				appDelay = chrono::milliseconds(g_annotateDelay);
+			if (g_split)
+			{
+				appFiles.reset(new AppFiles(oFilename, g_devs, linkTypes, g_splitRules));
+				appDelay = max(appDelay, chrono::milliseconds(g_splitDelay));
+			}
+			if (appFilter)
+				appDelay = max(appDelay, chrono::milliseconds(APP_FILTER_DELAY));
+			if (g_shmName != nullptr)
+			{	// readers get the same SHB and IDBs as the output file
+				ostringstream preamble;
+				initOFile(preamble, g_devs, linkTypes);
+				shm.reset(new ShmStream);
+				if (shm->create(g_shmName, g_shmSize, preamble.str()))
+				{
+					log(LogLevel::WARNING, "Packets are not streamed, shared memory can't be used.");
+					shm.reset();
+				}
+				else
+					appDelay = max(appDelay, chrono::milliseconds(SHM_APP_DELAY));
+			}
+		}
+		FlowApps *annotations = flowApps.enabled() ? &flowApps : nullptr;
+		thread t1;
+		if (!g_flowOnly)
+			t1 = thread([&fileBuffers, &output, annotations, appDelay, &appFiles, &appFilter, &shm]() {
+				RingBuffer<EnhancedPacketBlock>::write(fileBuffers, output, annotations, appDelay, g_annotate,
+					appFiles.get(), appFilter.get(), shm.get());
+			});
 		Cache cache;
-		RingBuffer<Netflow> cacheBuffer(CACHE_RING_BUFFER_SIZE);
-		/*X*/thread t2([&cacheBuffer, &cache]() { cacheBuffer.run(&cache); });
+		function<void(Cache *)> saveSnapshot;
+#if defined(__linux__)
+		// the cache is filled before its thread and capturing start, the snapshot is validated so it goes first
+		if (g_cacheSnapshot != nullptr)
+		{
+			if (loadCacheSnapshot(cache, g_cacheSnapshot) < 0)
+				log(LogLevel::WARNING, "Cache snapshot can't be loaded.");
+			saveSnapshot = [](Cache *c) { saveCacheSnapshot(*c, g_cacheSnapshot); };
+		}
+		// sockets of the application are resolved before its first packets come
+		if ((g_prescan || appFilter) && prescanSockets(cache, g_localAddresses) < 0)
+			log(LogLevel::WARNING, "Pre-scan of sockets failed, the cache starts empty.");
+#endif
+		// Netflows are exported while capturing, the cache thread looks for expired ones
+		unique_ptr<IpfixExporter> ipfix;
+		if (g_ipfix)
+		{
+			ipfix.reset(new IpfixExporter(g_ipfixCollector, chrono::seconds(g_ipfixActive), g_tsresol));
+			if (ipfix->start())
+			{
+				log(LogLevel::WARNING, "Netflows are not exported, IPFIX collector can't be used.");
+				ipfix.reset();
+			}
+		}
+		function<void(Cache *)> periodic = saveSnapshot;
+		chrono::seconds period = SNAPSHOT_INTERVAL;
+		if (ipfix)
+		{
+			auto nextSnapshot = chrono::steady_clock::now() + SNAPSHOT_INTERVAL;
+			periodic = [&ipfix, saveSnapshot, nextSnapshot](Cache *c) mutable {
+				ipfix->sweep(*c);
+				if (saveSnapshot && chrono::steady_clock::now() >= nextSnapshot)
+				{
+					saveSnapshot(c);
+					nextSnapshot = chrono::steady_clock::now() + SNAPSHOT_INTERVAL;
+				}
+			};
+			period = IPFIX_SWEEP_INTERVAL;
+		}
+		/*X*/thread t2([&cacheBuffers, &cache, &periodic, period, annotations, &ipfix, &appFilter]() {
+			RingBuffer<Netflow>::run(cacheBuffers, &cache, periodic, period, annotations, ipfix.get(), appFilter.get());
+		});
 
-		PacketHandlerParams ptrs{ &fileBuffer, &cacheBuffer };
-		
-        log(LogLevel::INFO, "Capturing...");
+        log(LogLevel::INFO, g_flowOnly ? "Capturing (flow-only)..." : "Capturing...");
 		//Awhile (!shouldStop)
 		//A    pcap_dispatch(handle, -1, packetHandler, reinterpret_cast<u_char*>(&ptrs));
-		if (pcap_loop(g_pcapHandle, -1, packetHandler, reinterpret_cast<u_char*>(&ptrs)) == -1)
+		for (CaptureInterface &iface : interfaces)
+		{
+			// the parser is specialized for the device's link type and the parsed protocols
+			pcap_handler handler = selectHandler(iface.linkType, g_parseIpv6, g_parseUdplite, !g_flowOnly, g_batchSize != 0);
+			iface.thread = thread([&iface, handler, &appFilter]() {
+				PacketHandlerParams *params = iface.params.get();
+				do
+				{
+					// the loop was broken because sockets of --app changed
+					if (appFilter && appFilter->getVersion() != iface.filterVersion && setFilter(iface, appFilter.get()))
+						log(LogLevel::WARNING, "Can't update capture filter of '", iface.name, "': ", pcap_geterr(iface.handle));
+					if (g_batchSize == 0)
+						iface.loopResult = pcap_loop(iface.handle, -1, handler, reinterpret_cast<u_char*>(params));
+					else
+					{	// pcap_dispatch() hands over packets of a whole buffer (TPACKET_V3 block), the rest of the batch is classified after it
+						do
+						{
+							iface.loopResult = pcap_dispatch(iface.handle, -1, handler, reinterpret_cast<u_char*>(params));
+							flushBatch(params);
+						} while (iface.loopResult >= 0 && !shouldStop);
+					}
+				} while (iface.loopResult == -2 && !shouldStop);
+				if (iface.loopResult == -1)
+					log(LogLevel::ERR, "pcap_loop() failed on '", iface.name, "': ", pcap_geterr(iface.handle));
+			});
+		}
+		thread rescanThread;
+		atomic<bool> capturing{ true };
+#if defined(__linux__)
+		if (appFilter)
+			rescanThread = thread([&appFilter, &capturing]() {
+				auto next = chrono::steady_clock::now() + APP_RESCAN_INTERVAL;
+				while (capturing && !shouldStop)
+				{
+					this_thread::sleep_for(chrono::milliseconds(100));
+					if (chrono::steady_clock::now() < next)
+						continue;
+					next = chrono::steady_clock::now() + APP_RESCAN_INTERVAL;
+					scanAppSockets(*appFilter);
+				}
+			});
+#endif
+		unsigned int failedLoops = 0;
+		for (CaptureInterface &iface : interfaces)
+		{
+			iface.thread.join();
+			if (iface.loopResult == -1)
+				failedLoops++;
+		}
+		capturing = false;
+		if (rescanThread.joinable())
+			rescanThread.join();
+		if (failedLoops == interfaces.size())
 			throw "pcap_loop() failed"; //! @todo what to do with threads
 
-		struct pcap_stat stats;
-		pcap_stats(g_pcapHandle, &stats);
-
-		pcap_close(g_pcapHandle);
+		for (CaptureInterface &iface : interfaces)
+			pcap_stats(iface.handle, &iface.stats);
+		if (appFilter)	// the cache thread still adds sockets, it mustn't break closed loops
+			appFilter->setOnChange(nullptr);
+		for (pcap_t *h : g_pcapHandles)
+			pcap_close(h);
+		g_pcapHandles.clear();
 
 		log(LogLevel::INFO, "Waiting for threads to finish.");
 		this_thread::sleep_for(chrono::seconds(1)); // because of possible deadlock, get some time to return from RingBuffer::receivedPacket() to condVar.wait()
-		fileBuffer.notifyCondVar(); // notify thread, it should end
-		/*X*/cacheBuffer.notifyCondVar(); // notify thread, it should end
+		if (!fileBuffers.empty())
+			fileBuffers[0]->notifyCondVar(); // notify thread, it should end
+		/*X*/cacheBuffers[0]->notifyCondVar(); // notify thread, it should end
 		/*X*/t2.join();
-		t1.join();
+		if (t1.joinable())
+			t1.join();
+		if (shm)
+			shm->close();	// readers see the end of the stream
+		if (addrThread.joinable())
+			addrThread.join();
 
 #if defined(_WIN32)
         cleanWmiConnection();
 #endif
+		if (saveSnapshot)
+			saveSnapshot(&cache);
+		if (ipfix)
+		{	// before the netflows are moved into the results
+			ipfix->finish(cache);
+			ipfix->stop();
+		}
 		/*X*/cache.saveResults();
 		/*X*/CustomBlock cBlock;
-		/*X*/cBlock.write(oFile); //! @todo do not use CustomBlock class
+		/*X*/cBlock.write(output); //! @todo do not use CustomBlock class
+		if (g_compress)
+			compressedOut.close();	// the last frame and the index
+		if (streaming)
+			streamOut.close();
 
 		/******* SUMMARY *******/
-		cout << fileBuffer.getDroppedElem() << "' packets dropped by fileBuffer." << endl;
-		cout << cacheBuffer.getDroppedElem() << "' packets dropped by cacheBuffer." << endl;
-		cout << stats.ps_drop << "' packets dropped by the driver." << endl;
+		unsigned int rcvdPackets = 0;
+		for (CaptureInterface &iface : interfaces)
+		{
+			const bool many = interfaces.size() > 1;
+			if (many)
+				cout << iface.name << ":" << endl;
+			if (iface.fileBuffer)
+				iface.fileBuffer->printStats("fileBuffer", "packets");
+			iface.cacheBuffer->printStats("cacheBuffer", "packets");
+			if (iface.fileBuffer && iface.storagePolicy.enabled())
+				cout << iface.storagePolicy.getSlicedPackets() << "' packets stored with headers only, "
+					<< iface.storagePolicy.getNotStoredBytes() << "' bytes were not stored." << endl;
+			if (iface.params->fragments.getUnmatched())
+				cout << iface.params->fragments.getUnmatched() << "' fragments were not tagged, their first fragment wasn't captured." << endl;
+			cout << iface.stats.ps_drop << "' packets dropped by the driver." << endl;
+			rcvdPackets += iface.params->rcvdPackets;
+		}
+		if (appFiles)
+			appFiles->printStats();
+		if (appFilter && !g_flowOnly)
+			cout << appFilter->getSkipped() << "' packets of other applications were not stored." << endl;
+		if (ipfix)
+			ipfix->printStats();
+		if (shm)
+			shm->printStats();
+		if (g_compress)
+			compressedOut.printStats();
+		if (streaming)
+			streamOut.printStats();
 
 #ifdef DEBUG_BUILD
 		cout << "Total " << rcvdPackets << " packets received.\n" << endl;
-		cout << "Total " << g_finalResults.size() << " records with exactly the same 3-tuple" << endl;
+		cout << "Total " << g_finalResults.flows() << " records with exactly the same 3-tuple" << endl;
 		cout << "Inode not found for " << g_notFoundSockets << " ports from " << g_allSockets << "." << endl;
 		cout << "Application not found for " << g_notFoundApps << " inodes." << endl;
-		cout << g_finalResults.size() << " applications in total:" << endl;
-		for (auto record : g_finalResults)
-		{
-			cout << "  * " << record.first << endl;
-			for (auto entry : record.second)
-				delete entry;
-		}
+		cout << g_finalResults.apps() << " applications in total:" << endl;
+		for (AppId id = 1; id < g_apps.size(); id++)
+			if (!g_finalResults.get(id).empty())
+				cout << "  * " << g_apps.name(id) << endl;
+		g_finalResults.clear();
 		cout << "Cache records: " << endl;
 		cache.print();
 #endif
@@ -236,80 +563,394 @@ int startCapture(const char *oFilename)
 		int x;
 		cin >> x;
 #endif
+		if (coutBuf)
+			cout.rdbuf(coutBuf);
 	}
 	catch (pcap_ex &e)
 	{
 		cerr << "ERROR: " << e.what() << endl;
-		if (g_pcapHandle)
-			pcap_close(g_pcapHandle);
+		for (pcap_t *h : g_pcapHandles)
+			pcap_close(h);
+		g_pcapHandles.clear();
 		return EXIT_FAILURE;
 	}
 	catch (const char *msg)
 	{
 		cerr << "ERROR: " << msg << endl;
-		if (g_pcapHandle)
-			pcap_close(g_pcapHandle);
+		for (pcap_t *h : g_pcapHandles)
+			pcap_close(h);
+		g_pcapHandles.clear();
 		return EXIT_FAILURE;
 	}
 	return shouldStop;
 }
 
-void packetHandler(unsigned char *arg_array, const struct pcap_pkthdr *header, const unsigned char *packet)
+pcap_t *openDevice(const char *dev)
+{
+	char errbuf[PCAP_ERRBUF_SIZE];
+	pcap_t *handle = pcap_create(dev, errbuf);
+	if (handle == nullptr)
+		throw pcap_ex("pcap_create() failed.", errbuf);
+	pcap_set_snaplen(handle, g_snaplen);
+	pcap_set_promisc(handle, false);
+	pcap_set_timeout(handle, 1000);
+
+#if defined(PCAP_TSTAMP_HOST)	// libpcap >= 1.2
+	if (g_tstampType != nullptr)
+	{
+		const int type = pcap_tstamp_type_name_to_val(g_tstampType);
+		if (type < 0 || pcap_set_tstamp_type(handle, type) != 0)
+			log(LogLevel::WARNING, "Time stamp type '", g_tstampType, "' is not supported by '", dev, "', the default one is used.");
+	}
+#endif
+#if defined(PCAP_TSTAMP_PRECISION_NANO)	// libpcap >= 1.5
+	if (g_tsresol == 9 && pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO) != 0)
+		log(LogLevel::INFO, "Nanosecond time stamps are not supported by '", dev, "'.");
+#endif
+
+	const int status = pcap_activate(handle);
+	if (status < 0)
+	{
+		const string msg = (status == PCAP_ERROR) ? pcap_geterr(handle) : pcap_statustostr(status);
+		pcap_close(handle);
+		throw pcap_ex("pcap_activate() failed.", msg.c_str());
+	}
+	if (status > 0)
+		log(LogLevel::WARNING, "pcap_activate(): ", pcap_statustostr(status));
+
+#if defined(PCAP_TSTAMP_PRECISION_NANO)
+	g_tsresol = (pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO) ? 9 : 6;
+#else
+	g_tsresol = 6;
+#endif
+	return handle;
+}
+
+
+string prefilterExpr(bool ipv6, bool udplite)
+{
+	// packets which the parser can assign to an application
+	string l4 = "tcp or udp";
+	if (udplite)
+		l4 += ipv6 ? " or ip proto 136 or ip6 proto 136" : " or ip proto 136";
+	if (!ipv6)
+		l4 = "ip and (" + l4 + ")";
+	// "vlan" moves offsets of the rest of the expression, so the tagged variants are nested
+	// (up to two tags as the parser accepts more only without the prefilter)
+	return l4 + " or (vlan and (" + l4 + " or (vlan and (" + l4 + "))))";
+}
+
+
+int setFilter(pcap_t *handle, bool prefilter, const char *userExpr, const char *appExpr)
+{
+	string expr;
+	// ports of the application are only in packets which the parser accepts
+	if (appExpr != nullptr && *appExpr != '\0')
+		expr = "(" + string(appExpr) + ")";
+	else if (prefilter)
+		expr = "(" + prefilterExpr(g_parseIpv6, g_parseUdplite) + ")";
+	if (userExpr != nullptr && *userExpr != '\0')
+		expr += (expr.empty() ? "(" : " and (") + string(userExpr) + ")";
+	if (expr.empty())
+		return EXIT_SUCCESS;
+
+	// The filter is compiled to a classic BPF program and attached to the capture socket,
+	// so the kernel doesn't copy filtered out packets to the userspace.
+	struct bpf_program program;
+	if (pcap_compile(handle, &program, expr.c_str(), 1, PCAP_NETMASK_UNKNOWN) == -1)
+		return EXIT_FAILURE;
+	int ret = pcap_setfilter(handle, &program);
+	pcap_freecode(&program);
+	if (ret == -1)
+		return EXIT_FAILURE;
+	log(LogLevel::INFO, "Capture filter '", expr, "' was set.");
+	return EXIT_SUCCESS;
+}
+
+
+int setFilter(CaptureInterface &iface, AppFilter *appFilter)
+{
+	string appExpr;
+	if (appFilter != nullptr)
+		iface.filterVersion = appFilter->getKernelExpr(appExpr);
+	return setFilter(iface.handle, g_prefilter || g_flowOnly, g_filterExpr, appExpr.c_str());
+}
+
+
+#if defined(__linux__)
+int scanAppSockets(AppFilter &filter)
+{
+	vector<AppSocket> sockets;
+	vector<string> exeNames;
+	if (findAppSockets(filter.getPattern(), sockets, exeNames) < 0)
+		return -1;
+	filter.addNames(exeNames);
+	if (!filter.setSockets(sockets))
+		return 0;
+	log(LogLevel::INFO, sockets.size(), " sockets of '", filter.getPattern(), "' are captured.");
+	return 1;
+}
+#endif
+
+
+void FileSink::store(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const unsigned char *packet, const PacketLayout &layout)
+{
+	uint32_t caplen = header->caplen;
+	if (ptrs->storagePolicy->enabled())
+		caplen = ptrs->storagePolicy->storeLength(layout.flowHash, layout.proto, header->ts.tv_sec, caplen, layout.headersLen);
+	ptrs->fileBuffer->push(header, packet, caplen, ptrs->interfaceID, (g_annotate || g_split || g_appPattern || g_shmName) ? layout.endpoints : nullptr);
+}
+
+
+template <class Parser, class Sink>
+void captureHandler(unsigned char *arg_array, const struct pcap_pkthdr *header, const unsigned char *packet)
+{
+	PacketHandlerParams *ptrs = reinterpret_cast<PacketHandlerParams*>(arg_array);
+
+	ptrs->rcvdPackets++;
+	// Stages are independent, a packet which is not stored is still used for the flow
+	// processing. Overloads of both stages are counted by their ring buffers.
+	PacketLayout layout;
+	processFlow<Parser>(ptrs, header, packet, Sink::needsLayout ? &layout : nullptr);
+	Sink::store(ptrs, header, packet, layout);
+}
+
+
+/*!
+ * @brief   How the batch of the interface classifies directions, local addresses are preferred
+ */
+static inline Classification batchClassification(const PacketHandlerParams *ptrs)
+{
+	if (!g_localAddresses.empty())
+		return Classification::ADDRESS;
+	return (ptrs->linkType == DLT_EN10MB) ? Classification::MAC : Classification::LINK;
+}
+
+
+template <class Parser, class Sink>
+void batchHandler(unsigned char *arg_array, const struct pcap_pkthdr *header, const unsigned char *packet)
 {
-	static Netflow n;
-	static unsigned int ip_hdrlen;
-	static ether_hdr *eth_hdr;
 	PacketHandlerParams *ptrs = reinterpret_cast<PacketHandlerParams*>(arg_array);
+	PacketBatch &batch = ptrs->batch;
+
+	ptrs->rcvdPackets++;
+	PacketLayout layout;
+	ParsedPacket p;
+	const unsigned char *ports = nullptr;
+	if (!Parser::parse(ptrs->linkType, packet, header->caplen, p) && (ports = flowPorts(ptrs, header, p)) != nullptr)
+	{
+		if (batch.empty())
+			batch.setClassification(batchClassification(ptrs));
+		Directions dir = Directions::UNKNOWN;
+		if (batch.getClassification() == Classification::LINK)
+			dir = getLinkDirection(ptrs, packet);
+		if (dir != Directions::UNKNOWN || batch.getClassification() != Classification::LINK)
+			batch.add(p, ports, toTimestamp(header->ts), packet, dir);
+		if (Sink::needsLayout)
+			setLayout(layout, p, ports, ptrs->simd);
+	}
+	Sink::store(ptrs, header, packet, layout);
+	if (batch.full())
+		flushBatch(ptrs);
+}
 
-	RingBuffer<Netflow> *cb = ptrs->cacheBuffer;
-	RingBuffer<EnhancedPacketBlock> *rb = ptrs->fileBuffer;
-	eth_hdr = (ether_hdr*)packet;
 
-	rcvdPackets++;
-	if (rb->push(header, packet))
+void flushBatch(PacketHandlerParams *ptrs)
+{
+	PacketBatch &batch = ptrs->batch;
+	if (batch.empty())
+		return;
+	const unsigned int flows = batch.classify(g_localAddresses, ptrs->devMac);
+	ptrs->cacheBuffer->push(batch.getFlows(), flows);
+	batch.clear();
+}
+
+
+void packetHandler(unsigned char *arg_array, const struct pcap_pkthdr *header, const unsigned char *packet)
+{
+	captureHandler<PacketParser<RuntimeLink, AllProtocols>, FileSink>(arg_array, header, packet);
+}
+
+
+void flowHandler(unsigned char *arg_array, const struct pcap_pkthdr *header, const unsigned char *packet)
+{
+	captureHandler<PacketParser<RuntimeLink, AllProtocols>, FlowSink>(arg_array, header, packet);
+}
+
+
+/*!
+ * @brief   Selects the handler of the sink
+ */
+template <class Link, class Protocols>
+static pcap_handler selectSink(bool store, bool batch)
+{
+	typedef PacketParser<Link, Protocols> Parser;
+	if (batch)
+		return store ? batchHandler<Parser, FileSink> : batchHandler<Parser, FlowSink>;
+	return store ? captureHandler<Parser, FileSink> : captureHandler<Parser, FlowSink>;
+}
+
+
+/*!
+ * @brief   Selects the handler of the protocol set
+ */
+template <class Link>
+static pcap_handler selectProtocols(bool ipv6, bool udplite, bool store, bool batch)
+{
+	if (ipv6)
+		return udplite ? selectSink<Link, ProtocolSet<true, true>>(store, batch) : selectSink<Link, ProtocolSet<true, false>>(store, batch);
+	return udplite ? selectSink<Link, ProtocolSet<false, true>>(store, batch) : selectSink<Link, ProtocolSet<false, false>>(store, batch);
+}
+
+
+pcap_handler selectHandler(int linkType, bool ipv6, bool udplite, bool store, bool batch)
+{
+	switch (linkType)
 	{
-		log(LogLevel::ERR, "Packet dropped because of slow hard drive.");
-		return; //! @todo  When the packet is not saved into the output file, we don't process this packet. Valid behavior?
+		case DLT_EN10MB:		return selectProtocols<StaticLink<DLT_EN10MB>>(ipv6, udplite, store, batch);
+		case DLT_LINUX_SLL:		return selectProtocols<StaticLink<DLT_LINUX_SLL>>(ipv6, udplite, store, batch);
+#if defined(DLT_LINUX_SLL2)
+		case DLT_LINUX_SLL2:	return selectProtocols<StaticLink<DLT_LINUX_SLL2>>(ipv6, udplite, store, batch);
+#endif
+		case DLT_RAW:			return selectProtocols<StaticLink<DLT_RAW>>(ipv6, udplite, store, batch);
+		default:				return selectProtocols<RuntimeLink>(ipv6, udplite, store, batch);
 	}
+}
+
+
+template <class Parser>
+inline void processFlow(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const unsigned char *packet, PacketLayout *layout)
+{
+	Netflow &n = ptrs->netflow;
+	ParsedPacket p;
+
 	//! @todo What to do with 802.3?
 	// We can't determine app for IGMP, ICMP, etc. https://en.wikipedia.org/wiki/List_of_IP_protocol_numbers
 	//! @todo check 4480
-	if (eth_hdr->ether_type != PROTO_IPv4 && eth_hdr->ether_type != PROTO_IPv6)
+	if (Parser::parse(ptrs->linkType, packet, header->caplen, p))
 		return;
 
-	uint64_t usecUnixTime = header->ts.tv_sec * (uint64_t)1000000 + header->ts.tv_usec;
-	n.setStartTime(usecUnixTime);
-	n.setEndTime(usecUnixTime);
-
-	Directions dir = getPacketDirection(eth_hdr);
+	const unsigned int len = header->caplen - p.l2Len;
+	Directions dir = g_localAddresses.empty() ? getLinkDirection(ptrs, packet) : getPacketDirection(p.ipHdr, p.etherType, len);
 	if (dir == Directions::UNKNOWN)
 		return;
-	// Parse IP header
-	if (parseIp(n, ip_hdrlen, dir, (void*)(packet + ETHER_HDRLEN), eth_hdr->ether_type))
+
+	const unsigned char *ports = flowPorts(ptrs, header, p);
+	if (ports == nullptr)
 		return;
-	// Parse transport layer header
-	if (parsePorts(n, dir, (void*)(packet + ETHER_HDRLEN + ip_hdrlen)))
+
+	const uint64_t timestamp = toTimestamp(header->ts);
+	n.setStartTime(timestamp);
+	n.setEndTime(timestamp);
+	// the packet is hashed once, the local endpoint is the netflow key
+	const unsigned int local = (dir == Directions::INBOUND) ? 1 : 0;
+	uint64_t hash;
+	if (layout != nullptr)
 	{
-	//		if (n.getIpVersion() == 4)
-	//			delete static_cast<ip4_addr*>(n.getLocalIp());
-	//		else
-	//			delete static_cast<ip6_addr*>(n.getLocalIp());
-		return;
+		setLayout(*layout, p, ports, ptrs->simd);
+		hash = layout->endpoints[local];
 	}
+	else
+		hash = packetEndpointHash(p, ports, local, ptrs->simd);
+	setNetflow(n, dir, p, ports, (uint32_t)(hash >> 32));
 	// STD::MOVE Netflow into buffer
-	/*X*/if (cb->push(n))
-	/*X*/{
-	/*X*/	log(LogLevel::ERR, "Packet dropped because cache is too slow.");
-	/*X*/	return;
-	/*X*/}
+	/*X*/ptrs->cacheBuffer->push(n);
 }
 
 
-Directions getPacketDirection(ether_hdr *eth_hdr)
+inline const unsigned char *flowPorts(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const ParsedPacket &p)
 {
-	if (memcmp(&g_devMac, eth_hdr->ether_shost, sizeof(mac_addr)) == 0)
+	// non-first fragment, ports were in the first one
+	if (p.ip.fragOffset != 0)
+		return ptrs->fragments.find(p.ipHdr, p.ipVersion(), p.ip, header->ts.tv_sec);
+	if (p.ip.fragment)
+		ptrs->fragments.insert(p.ipHdr, p.ipVersion(), p.ip, p.l4Hdr, header->ts.tv_sec);
+	return p.l4Hdr;
+}
+
+
+inline uint64_t packetEndpointHash(const ParsedPacket &p, const unsigned char *ports, unsigned int i, SimdLevel simd)
+{
+	const unsigned int offset = (p.etherType == PROTO_IPv4) ? 12 : 8;
+	const unsigned int ipLen = (p.etherType == PROTO_IPv4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
+	return endpointHash(p.ipHdr + offset + i * ipLen, p.ipVersion(), ports + 2 * i, p.ip.proto, simd);
+}
+
+
+inline void setLayout(PacketLayout &layout, const ParsedPacket &p, const unsigned char *ports, SimdLevel simd)
+{
+	layout.headersLen = p.l2Len + p.ip.hdrLen + p.l4Len;
+	layout.proto = p.ip.proto;
+	layout.endpoints[0] = packetEndpointHash(p, ports, 0, simd);
+	layout.endpoints[1] = packetEndpointHash(p, ports, 1, simd);
+	// ordered, so both directions have the same hash, the lower bits index the flow table and depend on both
+	const uint32_t lo = (uint32_t)(std::min(layout.endpoints[0], layout.endpoints[1]) >> 32);
+	const uint32_t hi = (uint32_t)(std::max(layout.endpoints[0], layout.endpoints[1]) >> 32);
+	layout.flowHash = (uint64_t)lo << 32 | (lo ^ hi);
+}
+
+
+Directions getPacketDirection(const unsigned char *ip_hdr, unsigned short ether_type, unsigned int len)
+{
+	if (ether_type == PROTO_IPv4)
+	{
+		if (len < 20)
+			return Directions::UNKNOWN;
+		if (g_localAddresses.contains4(ip_hdr + 12))
+			return Directions::OUTBOUND;
+		// multicast (224.0.0.0/4) and limited broadcast as destination == INBOUND
+		if (g_localAddresses.contains4(ip_hdr + 16) || (ip_hdr[16] & 0xf0) == 0xe0
+			|| (ip_hdr[16] & ip_hdr[17] & ip_hdr[18] & ip_hdr[19]) == 0xff)
+			return Directions::INBOUND;
+	}
+	else
+	{
+		if (len < IPv6_HDRLEN)
+			return Directions::UNKNOWN;
+		if (g_localAddresses.contains6(ip_hdr + 8))
+			return Directions::OUTBOUND;
+		// multicast (ff00::/8) as destination == INBOUND
+		if (g_localAddresses.contains6(ip_hdr + 24) || ip_hdr[24] == 0xff)
+			return Directions::INBOUND;
+	}
+	D("Can't determine packet direction, neither address is local.");
+	return Directions::UNKNOWN;
+}
+
+
+Directions getLinkDirection(const PacketHandlerParams *ptrs, const unsigned char *packet)
+{
+	unsigned int pkttype;
+	switch (ptrs->linkType)
+	{
+		case DLT_EN10MB:
+			if (ptrs->devMac == nullptr)
+				return Directions::UNKNOWN;
+			return getPacketDirection((const ether_hdr *)packet, *ptrs->devMac);
+		case DLT_LINUX_SLL:
+			pkttype = NAMON::ntohs(*(const uint16_t *)(packet + SLL_PKTTYPE));
+			break;
+#if defined(DLT_LINUX_SLL2)
+		case DLT_LINUX_SLL2:
+			pkttype = packet[SLL2_PKTTYPE];
+			break;
+#endif
+		default:
+			return Directions::UNKNOWN;
+	}
+	if (pkttype == SLL_OUTGOING)
 		return Directions::OUTBOUND;
-	else if (memcmp(&g_devMac, eth_hdr->ether_dhost, sizeof(mac_addr)) == 0)
+	if (pkttype == SLL_HOST || pkttype == SLL_BROADCAST || pkttype == SLL_MULTICAST)
+		return Directions::INBOUND;
+	return Directions::UNKNOWN;
+}
+
+
+Directions getPacketDirection(const ether_hdr *eth_hdr, const mac_addr &devMac)
+{
+	if (memcmp(&devMac, eth_hdr->ether_shost, sizeof(mac_addr)) == 0)
+		return Directions::OUTBOUND;
+	else if (memcmp(&devMac, eth_hdr->ether_dhost, sizeof(mac_addr)) == 0)
 		return Directions::INBOUND;
 	// else compare multicast and broadcast address
 	// we don't have have to compare second part of the mac address
@@ -323,104 +964,67 @@ Directions getPacketDirection(ether_hdr *eth_hdr)
 	// multicast/broadcast as source IP is not valid
 
 	D("int vs. src vs. dst");
-	D_ARRAY((const unsigned char*)&g_devMac.bytes, 6);
+	D_ARRAY((const unsigned char*)&devMac.bytes, 6);
 	D_ARRAY(eth_hdr->ether_shost, 6);
 	D_ARRAY(eth_hdr->ether_dhost, 6);
-	log(LogLevel::ERR, "Can't determine packet direction.");
+	D("Can't determine packet direction.");
 	return Directions::UNKNOWN;
 }
 
 
-inline int parseIp(Netflow &n, unsigned int &ip_size, Directions dir, void * const ip_hdr, const unsigned short ether_type)
+inline void setNetflow(Netflow &n, Directions dir, const ParsedPacket &p, const unsigned char *ports, uint32_t hash)
 {
-	if (ether_type == PROTO_IPv4)
+	// The previous packet could have been rejected after its IP address was allocated.
+	// Reuse the allocation if the IP version is the same, otherwise free it.
+	const unsigned char ipVersion = p.ipVersion();
+	void *oldIpPtr = n.getLocalIp();
+	const unsigned char oldIpVersion = n.getIpVersion();
+	if (oldIpPtr != nullptr && oldIpVersion != ipVersion)
 	{
-		const ip4_hdr * const hdr = (ip4_hdr*)ip_hdr;
-		ip_size = hdr->ihl * 4; // the length of the internet header in 32 bit words
-		if (ip_size < 20)
-		{
-			log(LogLevel::WARNING, "Incorrect IPv4 header received.");
-			return EXIT_FAILURE;
-		}
+		if (oldIpVersion == 4)
+			delete static_cast<ip4_addr*>(oldIpPtr);
+		else
+			delete static_cast<ip6_addr*>(oldIpPtr);
+		oldIpPtr = nullptr;
+	}
 
-		ip4_addr* tmpIpPtr = new ip4_addr;
+	if (ipVersion == 4)
+	{
+		const ip4_hdr * const hdr = (const ip4_hdr*)p.ipHdr;
+		ip4_addr* tmpIpPtr = oldIpPtr ? static_cast<ip4_addr*>(oldIpPtr) : new ip4_addr;
 		if (dir == Directions::INBOUND)
 		    tmpIpPtr->addr = hdr->ip_dst.addr;
 		else
 			tmpIpPtr->addr = hdr->ip_src.addr;
-		
 		n.setLocalIp((void*)(tmpIpPtr));
-		n.setIpVersion(4);
-		n.setProto(hdr->ip_p);
 	}
 	else
 	{
-		const ip6_hdr * const hdr = (ip6_hdr*)ip_hdr;
-		ip_size = IPv6_HDRLEN;
-		ip6_addr* tmpIpPtr = new ip6_addr;
-
+		const ip6_hdr * const hdr = (const ip6_hdr*)p.ipHdr;
+		ip6_addr* tmpIpPtr = oldIpPtr ? static_cast<ip6_addr*>(oldIpPtr) : new ip6_addr;
 		if (dir == Directions::INBOUND)
 			memcpy(tmpIpPtr, &hdr->ip6_dst, sizeof(ip6_addr));
 		else
 			memcpy(tmpIpPtr, &hdr->ip6_src, sizeof(ip6_addr));
-
 		n.setLocalIp((void*)(tmpIpPtr));
-		n.setIpVersion(6);
-		n.setProto(hdr->ip6_nxt);
 	}
-	return EXIT_SUCCESS;
-}
-
+	n.setIpVersion(ipVersion);
+	n.setProto(p.ip.proto);
 
-//! @todo proto can be set to 0 -> arp/rarp
-inline int parsePorts(Netflow &n, Directions dir, void *hdr)
-{
-	switch (n.getProto())
-	{
-        case PROTO_TCP:
-        {
-            const struct tcp_hdr *tcp_hdr = (struct tcp_hdr*)hdr;
-            unsigned tcp_size = tcp_hdr->th_off * 4; // number of 32 bit words in the TCP header
-            if (tcp_size < 20)
-            {
-                log(LogLevel::WARNING, "Incorrect TCP header received.");
-                return EXIT_FAILURE;
-            }
-            if (dir == Directions::INBOUND)
-                n.setLocalPort(NAMON::ntohs(tcp_hdr->th_dport));
-            else
-                n.setLocalPort(NAMON::ntohs(tcp_hdr->th_sport));
-            break;
-        }
-        case PROTO_UDP:
-        case PROTO_UDPLITE: // structure of first 4 bytes is the same (srcPort and dstPort)
-        {
-            const struct udp_hdr *udp_hdr = (struct udp_hdr*)hdr;
-            unsigned short udp_size = udp_hdr->uh_ulen; // length in bytes of the UDP header and UDP data
-            if (udp_size < 8)
-            {
-                log(LogLevel::WARNING, "Incorrect UDP packet received with size <", udp_size, ">");
-                return EXIT_FAILURE;
-            }
-            if (dir == Directions::INBOUND)
-                n.setLocalPort(NAMON::ntohs(udp_hdr->uh_dport));
-            else
-                n.setLocalPort(NAMON::ntohs(udp_hdr->uh_sport));
-            break;
-        }
-        default:
-        {
-            log(LogLevel::WARNING, "Unsupported transport layer protocol (", (int)n.getProto(), ")");
-            return EXIT_FAILURE;
-        }
-	}
-	return EXIT_SUCCESS;
+	// source and destination port are the first 4 bytes of TCP, UDP and UDP-Lite headers
+	uint16_t port;
+	memcpy(&port, ports + ((dir == Directions::INBOUND) ? 2 : 0), sizeof(port));
+	n.setLocalPort(NAMON::ntohs(port));
+	// the cache uses the hash computed here
+	n.setHash(hash);
 }
 
 
 void signalHandler(int signum)
 {
 	log(LogLevel::WARNING, "Interrupt signal (", signum, ") received.");
-	if(g_pcapHandle)  pcap_breakloop(g_pcapHandle);
+	// capturing threads enter the loop again after pcap_breakloop() unless they should stop
 	shouldStop.store(signum);
+	for (pcap_t *h : g_pcapHandles)
+		pcap_breakloop(h);
 }
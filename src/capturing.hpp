@@ -4,7 +4,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 18.02.2017 22:48
- *   - Edited:  23.06.2017 12:00
+ *   - Edited:  20.10.2026 05:00
  */
 
 #pragma once
@@ -12,12 +12,26 @@
 #include <iostream>             //  exception, string
 #include <sys/types.h>          //  u_char
 #include <atomic>               //  atomic
+#include <vector>               //  vector
+#include <memory>               //  unique_ptr
+#include <thread>               //  thread
+#include <pcap.h>               //  pcap_t, pcap_stat
 
 #include "tcpip_headers.hpp"	//	ether_hdr
-#include "netflow.hpp"			//	Netflow
+#include "netflow.hpp"			//	Netflow, endpointHash()
 #include "ringBuffer.hpp"		//	RingBuffer
 #include "pcapng_blocks.hpp"	//	EnhancedPackedBlock
 #include "cache.hpp"			//	TEntry
+#include "appRegistry.hpp"		//	AppRegistry, AppResults
+#include "storagePolicy.hpp"		//	StoragePolicy
+#include "localAddresses.hpp"	//	LocalAddresses
+#include "packetParser.hpp"		//	IpLayer, FragmentTable
+#include "packetBatch.hpp"		//	PacketBatch
+#include "flowApps.hpp"			//	FlowApps
+#include "appFiles.hpp"			//	AppFiles, SplitRule
+#include "appFilter.hpp"		//	AppFilter
+#include "ipfixExporter.hpp"	//	IpfixExporter, IpfixCollector
+#include "shmStream.hpp"		//	ShmStream
 #include "debug.hpp"            //  log()
 
 
@@ -27,6 +41,7 @@ using NAMON::Netflow;
 using NAMON::TEntry;
 using NAMON::EnhancedPacketBlock;
 using NAMON::RingBuffer;
+using NAMON::Directions;
 
 
 //! Size of a libpcap error buffer
@@ -35,14 +50,47 @@ using NAMON::RingBuffer;
 #endif
 
 extern std::atomic<int> shouldStop;
+extern bool g_flowOnly;
+extern std::vector<const char *> g_devs;
+extern int g_snaplen;
+extern const char *g_tstampType;
+extern NAMON::StoragePolicy g_storagePolicy;
+extern bool g_prefilter;
+extern bool g_parseIpv6;
+extern bool g_parseUdplite;
+extern const char *g_filterExpr;
+extern NAMON::StagePolicy g_filePolicy;
+extern NAMON::StagePolicy g_cachePolicy;
+extern NAMON::LocalAddresses g_localAddresses;
+extern unsigned int g_batchSize;
+extern bool g_prescan;
+extern const char *g_cacheSnapshot;
+extern bool g_legacyMapping;
+extern bool g_annotate;
+extern unsigned int g_annotateDelay;
+extern bool g_split;
+extern unsigned int g_splitDelay;
+extern std::vector<NAMON::SplitRule> g_splitRules;
+extern const char *g_appPattern;
+extern bool g_ipfix;
+extern NAMON::IpfixCollector g_ipfixCollector;
+extern unsigned int g_ipfixActive;
+extern const char *g_shmName;
+extern unsigned int g_shmSize;
+extern bool g_compress;
+extern NAMON::AppRegistry g_apps;
+extern NAMON::AppResults g_finalResults;
 
 /*!
-* An enum representing packet flow direction
+* @struct  PacketLayout
+* @brief   Information about the packet found by processFlow() and used to decide how it is stored
 */
-enum class Directions {
-	OUTBOUND, //!< Outgoing packets
-	INBOUND,  //!< Incoming packets
-	UNKNOWN,  //!< Direction is not known
+struct PacketLayout
+{
+	unsigned int headersLen = 0;	//!< Length of link, network and transport layer headers, zero if the packet wasn't parsed
+	uint8_t proto = 0;				//!< Layer 4 protocol
+	uint64_t flowHash = 0;			//!< Hash of the flow, the same for both directions, made of the endpoint hashes
+	uint64_t endpoints[2] = { 0, 0 };	//!< Netflow key hashes of the source and destination, see NAMON::endpointHash()
 };
 
 /*!
@@ -52,10 +100,64 @@ enum class Directions {
 struct PacketHandlerParams
 {
 	//! @brief  Default c'tor that sets pointers with parameters
-	PacketHandlerParams(RingBuffer<EnhancedPacketBlock> *fb, RingBuffer<Netflow> *cb)
-		: fileBuffer(fb), cacheBuffer(cb) {}
-	RingBuffer<EnhancedPacketBlock> *fileBuffer = nullptr; //!< Pointer to RingBuffer which will be written to a file
+	PacketHandlerParams(RingBuffer<EnhancedPacketBlock> *fb, RingBuffer<Netflow> *cb, uint32_t id, int lt,
+						const NAMON::mac_addr *mac, NAMON::StoragePolicy *sp)
+		: fileBuffer(fb), cacheBuffer(cb), interfaceID(id), linkType(lt), devMac(mac), storagePolicy(sp) {}
+	RingBuffer<EnhancedPacketBlock> *fileBuffer = nullptr; //!< Pointer to RingBuffer which will be written to a file (nullptr in flow-only mode)
 	RingBuffer<Netflow> *cacheBuffer = nullptr;            //!< Used cache
+	uint32_t interfaceID = 0;                              //!< Index of the interface's IDB in the output file
+	int linkType = DLT_EN10MB;                             //!< Data link type of the capturing device (DLT_*)
+	const NAMON::mac_addr *devMac = nullptr;               //!< MAC address of the capturing device (nullptr if it has none)
+	NAMON::StoragePolicy *storagePolicy = nullptr;         //!< Slicing of the interface's flows
+	unsigned int rcvdPackets = 0;                          //!< Number of received packets
+	Netflow netflow;                                       //!< Netflow filled by processFlow(), it keeps the allocated IP address
+	NAMON::FragmentTable fragments;                        //!< Ports of fragmented packets of the interface
+	NAMON::PacketBatch batch;                              //!< Packets gathered by batchHandler()
+	const NAMON::SimdLevel simd = NAMON::detectSimdLevel(); //!< Instructions used to hash netflow keys
+};
+
+/*!
+* @struct  FileSink
+* @brief   Sink of captureHandler() which stores packets into the output file
+*/
+struct FileSink
+{
+	static const bool needsLayout = true;	//!< PacketLayout is used to slice flows
+	/*!
+	* @brief   Pushes the packet into the file buffer, sliced by the storage policy
+	*/
+	static void store(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const unsigned char *packet, const PacketLayout &layout);
+};
+
+/*!
+* @struct  FlowSink
+* @brief   Sink of captureHandler() in the flow-only mode, packets are not stored
+*/
+struct FlowSink
+{
+	static const bool needsLayout = false;	//!< PacketLayout is not used
+	static void store(PacketHandlerParams *, const struct pcap_pkthdr *, const unsigned char *, const PacketLayout &) {}
+};
+
+/*!
+* @struct  CaptureInterface
+* @brief   Capturing device, its buffers and its capturing thread
+*/
+struct CaptureInterface
+{
+	const char *name = nullptr;                            //!< Device name
+	pcap_t *handle = nullptr;                              //!< Pcap handle
+	NAMON::mac_addr mac;                                   //!< MAC address of the device
+	bool hasMac = false;                                   //!< Whether #CaptureInterface::mac is known
+	int linkType = DLT_EN10MB;                             //!< Data link type of the device (DLT_*)
+	std::unique_ptr<RingBuffer<EnhancedPacketBlock>> fileBuffer;   //!< Packets to store (nullptr in flow-only mode)
+	std::unique_ptr<RingBuffer<Netflow>> cacheBuffer;      //!< Netflows for the cache
+	NAMON::StoragePolicy storagePolicy;                    //!< Copy of #g_storagePolicy, counters are per thread
+	std::unique_ptr<PacketHandlerParams> params;           //!< Parameters of the packet handler
+	std::thread thread;                                    //!< Capturing thread
+	int loopResult = 0;                                    //!< Result of pcap_loop() or of the last pcap_dispatch()
+	unsigned int filterVersion = 0;                        //!< Version of the --app filter set on the handle, see NAMON::AppFilter::getVersion()
+	struct pcap_stat stats;                                //!< Statistics of the device
 };
 
 
@@ -63,9 +165,29 @@ struct PacketHandlerParams
 /*!
 * @brief       Determines packet derection
 * @param[in]   eth_hdr   Ethernet header
+* @param[in]   devMac    MAC address of the capturing device
+* @return      Returns NAMON::Direction
+*/
+Directions getPacketDirection(const NAMON::ether_hdr *eth_hdr, const NAMON::mac_addr &devMac);
+/*!
+* @brief       Determines packet direction using #g_localAddresses
+* @details     A packet from a local address is outbound, a packet to a local
+*              or multicast address is inbound.
+* @param[in]   ip_hdr      IP header
+* @param[in]   ether_type  #PROTO_IPv4 or #PROTO_IPv6
+* @param[in]   len         Number of captured bytes from the beginning of the IP header
+* @return      Returns NAMON::Direction
+*/
+Directions getPacketDirection(const unsigned char *ip_hdr, unsigned short ether_type, unsigned int len);
+/*!
+* @brief       Determines packet direction using the link layer header
+* @details     It is used when local addresses are not known. Ethernet frames are compared
+*              with the MAC address, Linux cooked headers contain the packet type.
+* @param[in]   ptrs    Parameters of the interface (link type, MAC address)
+* @param[in]   packet  Captured packet
 * @return      Returns NAMON::Direction
 */
-Directions getPacketDirection(NAMON::ether_hdr *eth_hdr);
+Directions getLinkDirection(const PacketHandlerParams *ptrs, const unsigned char *packet);
 /*!
 * @brief       Starts network traffic capture
 * @param[in]   oFilename   Output file name
@@ -73,6 +195,41 @@ Directions getPacketDirection(NAMON::ether_hdr *eth_hdr);
 */
 int startCapture(const char *oFilename);
 /*!
+* @brief       Opens the capturing device
+* @details     Nanosecond time stamps are requested and #g_tsresol is set according to
+*              the precision provided by the device.
+* @param[in]   dev     Device name
+* @return      Activated pcap handle
+* @throw       pcap_ex If the device can't be opened
+*/
+pcap_t *openDevice(const char *dev);
+/*!
+* @brief       Attaches a capture filter to the handle
+* @details     Combines the filter of packets which the flow parser accepts
+*              with the user's expression.
+* @param[in]   handle      Pcap handle
+* @param[in]   prefilter   Whether to pass only packets which the parser accepts, see prefilterExpr()
+* @param[in]   userExpr    User's filter expression in the pcap-filter syntax (can be nullptr)
+* @param[in]   appExpr     Filter of sockets of --app used instead of the prefilter (can be nullptr or empty)
+* @return      EXIT_SUCCESS on success, EXIT_FAILURE if the filter can't be compiled or set
+*/
+int setFilter(pcap_t *handle, bool prefilter, const char *userExpr, const char *appExpr = nullptr);
+/*!
+* @brief       Attaches the capture filter of the options to the interface
+* @param[in]   iface       Interface, its #CaptureInterface::filterVersion is updated
+* @param[in]   appFilter   Filter of --app, nullptr if it isn't used
+* @return      EXIT_SUCCESS on success, EXIT_FAILURE if the filter can't be compiled or set
+*/
+int setFilter(CaptureInterface &iface, NAMON::AppFilter *appFilter);
+#if defined(__linux__)
+/*!
+* @brief       Searches for sockets of processes matching --app and updates the kernel filter expression
+* @param[in]   filter  Filter of --app
+* @return      1 if the expression changed, 0 if not, -1 if the processes can't be read
+*/
+int scanAppSockets(NAMON::AppFilter &filter);
+#endif
+/*!
 * @brief       Function that processes every packet
 * @param[in]   args    Array with pointer to RingBuffer and Cache
 * @param[in]   header  Libpcap header
@@ -80,23 +237,105 @@ int startCapture(const char *oFilename);
 */
 void packetHandler(unsigned char *args, const struct pcap_pkthdr *header, const unsigned char *bytes);
 /*!
-* @brief       Parses IP header
-* @param[out]  n           Netflow which will be filled with parsed information
-* @param[out]  ip_size     Size of the IP header
-* @param[in]   dir         Packet direction
-* @param[in]   ip_hdr      Pointer to the IP header
-* @param[in]   ether_type  Ethernet frame type
-* @return      IP header's validity
+* @brief       Function that processes every packet in flow-only mode
+* @details     The packet is not stored, only its netflow is passed to the cache.
+* @param[in]   args    Array with pointer to the cache RingBuffer
+* @param[in]   header  Libpcap header
+* @param[in]   bytes   Captured packet (headers only)
+*/
+void flowHandler(unsigned char *args, const struct pcap_pkthdr *header, const unsigned char *bytes);
+/*!
+* @brief       Generic packet handler specialized by compile-time policies
+* @tparam      Parser  #NAMON::PacketParser instance
+* @tparam      Sink    What is done with the packet after its netflow is processed (#FileSink, #FlowSink)
+* @param[in]   args    Pointer to PacketHandlerParams
+* @param[in]   header  Libpcap header
+* @param[in]   bytes   Captured packet
+*/
+template <class Parser, class Sink>
+void captureHandler(unsigned char *args, const struct pcap_pkthdr *header, const unsigned char *bytes);
+/*!
+* @brief       Packet handler which adds netflow keys into #PacketHandlerParams::batch
+* @details     The packet is stored immediately, because libpcap may reuse its buffer after
+*              the handler returns. The batch is classified by flushBatch() when it is full
+*              and after every pcap_dispatch().
+* @tparam      Parser  #NAMON::PacketParser instance
+* @tparam      Sink    What is done with the packet (#FileSink, #FlowSink)
+* @param[in]   args    Pointer to PacketHandlerParams
+* @param[in]   header  Libpcap header
+* @param[in]   bytes   Captured packet
+*/
+template <class Parser, class Sink>
+void batchHandler(unsigned char *args, const struct pcap_pkthdr *header, const unsigned char *bytes);
+/*!
+* @brief       Classifies packets in #PacketHandlerParams::batch and pushes their netflows
+*              into the cache buffer at once
+* @param[in]   ptrs    Parameters of the interface
+*/
+void flushBatch(PacketHandlerParams *ptrs);
+/*!
+* @brief       Selects the packet handler specialized for the device and the configuration
+* @param[in]   linkType    Data link type of the device (DLT_*)
+* @param[in]   ipv6        Whether IPv6 is parsed
+* @param[in]   udplite     Whether UDP-Lite is parsed
+* @param[in]   store       Whether packets are stored into the output file (not in the flow-only mode)
+* @param[in]   batch       Whether packets are classified in batches
+* @return      Instance of captureHandler() or batchHandler()
+*/
+pcap_handler selectHandler(int linkType, bool ipv6, bool udplite, bool store, bool batch);
+/*!
+* @brief       Parses the packet and pushes its netflow into the cache buffer
+* @tparam      Parser  #NAMON::PacketParser instance
+* @param[in]   ptrs    Parameters of the interface (cache ring buffer, MAC address, fragments)
+* @param[in]   header  Libpcap header
+* @param[in]   packet  Captured packet
+* @param[out]  layout  Headers length and flow hash of the packet (can be nullptr)
+*/
+template <class Parser>
+inline void processFlow(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const unsigned char *packet, PacketLayout *layout = nullptr);
+/*!
+* @brief       Finds ports of the packet
+* @details     Ports of a first fragment are stored in #PacketHandlerParams::fragments,
+*              so they can be found for non-first fragments.
+* @param[in]   ptrs    Parameters of the interface
+* @param[in]   header  Libpcap header
+* @param[in]   p       Parsed packet
+* @return      Source and destination port as they are in the header, nullptr if they are not known
+*/
+inline const unsigned char *flowPorts(PacketHandlerParams *ptrs, const struct pcap_pkthdr *header, const NAMON::ParsedPacket &p);
+/*!
+* @brief       Hash of the netflow key of one endpoint of the packet, see NAMON::endpointHash()
+* @param[in]   p       Parsed packet
+* @param[in]   ports   Source and destination port
+* @param[in]   i       0 for the source, 1 for the destination endpoint
+* @param[in]   simd    Instructions used
+*/
+inline uint64_t packetEndpointHash(const NAMON::ParsedPacket &p, const unsigned char *ports, unsigned int i, NAMON::SimdLevel simd);
+/*!
+* @brief       Fills the layout used by #FileSink
+* @details     Both endpoints are hashed once, the local one is the netflow key the cache knows and
+*              the flow hash used by the storage policy is made of both of them.
+* @param[out]  layout  Headers length, flow hash and endpoint hashes of the packet
+* @param[in]   p       Parsed packet
+* @param[in]   ports   Source and destination port
+* @param[in]   simd    Instructions used to hash the endpoints
+*/
+inline void setLayout(PacketLayout &layout, const NAMON::ParsedPacket &p, const unsigned char *ports, NAMON::SimdLevel simd);
+/*!
+* @brief       Fills the netflow with the local IP address and port of the packet and its hash
+* @param[out]  n       Netflow
+* @param[in]   dir     Packet direction
+* @param[in]   p       Parsed packet
+* @param[in]   ports   Source and destination port (from the first fragment in case of a non-first fragment)
+* @param[in]   hash    Hash of the netflow key, see packetEndpointHash()
 */
-inline int parseIp(Netflow &n, unsigned int &ip_size, Directions dir, void * const ip_hdr, const unsigned short ether_type);
+inline void setNetflow(Netflow &n, Directions dir, const NAMON::ParsedPacket &p, const unsigned char *ports, uint32_t hash);
 /*!
-* @brief       Parses layer 4 header
-* @param[out]  n   Netflow which will be filled with parsed information
-* @param[in]   dir Packet direction
-* @param[in]   hdr Header pointer
-* @return      Layer 4 header validity
+* @brief       Returns pcap-filter expression of packets which the parser can assign to an application
+* @param[in]   ipv6        Whether IPv6 is parsed
+* @param[in]   udplite     Whether UDP-Lite is parsed
 */
-inline int parsePorts(Netflow &n, Directions dir, void *hdr);
+std::string prefilterExpr(bool ipv6, bool udplite);
 /*!
 * @brief       Signal handler function
 * @param[in]   signum  Received interrupt signal
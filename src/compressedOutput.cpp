@@ -0,0 +1,284 @@
+/**
+ *  @file       compressedOutput.cpp
+ *  @brief      Compressed output file in independent frames source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#include <iostream>             //  cout, endl
+#include <iomanip>              //  setprecision()
+#include <sstream>              //  ostringstream
+#include <cstring>              //  memcpy(), memmove(), memcmp()
+
+#include "compressedOutput.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+const uint32_t  EPB_TYPE            = 6;            //!< Type of the enhanced packet block
+const uint32_t  SHB_TYPE            = 0x0A0D0D0A;   //!< Type of the section header block
+const uint32_t  IDB_TYPE            = 1;            //!< Type of the interface description block
+const uint32_t  MAX_RAW_LENGTH      = 1U << 30;     //!< Longer frames are broken
+
+
+CompressedOutput::CompressedOutput() : simd(detectSimdLevel())
+{
+}
+
+
+CompressedOutput::~CompressedOutput()
+{
+    close();
+}
+
+
+int CompressedOutput::open(std::ostream &file)
+{
+    out = &file;
+    frame.resize(COMPRESS_FRAME_SIZE);
+    setp(frame.data(), frame.data() + frame.size());
+    CompressedHeader header;
+    memcpy(header.magic, COMPRESS_MAGIC, sizeof(COMPRESS_MAGIC));
+    header.version = COMPRESS_VERSION;
+    header.frameSize = COMPRESS_FRAME_SIZE;
+    out->write(reinterpret_cast<const char *>(&header), sizeof(header));
+    offset = sizeof(header);
+    frameStart = std::chrono::steady_clock::now();
+    return out->good() ? 0 : -1;
+}
+
+
+void CompressedOutput::close()
+{
+    if (out == nullptr)
+        return;
+    writeFrame(true);
+    CompressedTrailer trailer;
+    trailer.indexOffset = offset;
+    trailer.frames = index.size();
+    memcpy(trailer.magic, COMPRESS_INDEX_MAGIC, sizeof(COMPRESS_INDEX_MAGIC));
+    out->write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(FrameIndex));
+    out->write(reinterpret_cast<const char *>(&trailer), sizeof(trailer));
+    out->flush();
+    offset += index.size() * sizeof(FrameIndex) + sizeof(trailer);
+    out = nullptr;
+}
+
+
+CompressedOutput::int_type CompressedOutput::overflow(int_type c)
+{
+    if (out == nullptr || writeFrame())
+        return traits_type::eof();
+    if (pptr() == epptr())
+    {   // one block is longer than the frame
+        const size_t used = pptr() - pbase();
+        frame.resize(frame.size() * 2);
+        setp(frame.data(), frame.data() + frame.size());
+        pbump(used);
+    }
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+
+int CompressedOutput::sync()
+{
+    if (out == nullptr)
+        return -1;
+    if (pptr() != pbase() && std::chrono::steady_clock::now() - frameStart >= COMPRESS_FLUSH_INTERVAL && writeFrame())
+        return -1;
+    out->flush();
+    return out->bad() ? -1 : 0;
+}
+
+
+int CompressedOutput::writeFrame(bool all)
+{
+    const size_t filled = pptr() - pbase();
+    while (parsed + 2 * sizeof(uint32_t) <= filled)
+    {
+        uint32_t blockLength;
+        memcpy(&blockLength, frame.data() + parsed + sizeof(uint32_t), sizeof(blockLength));
+        if (blockLength < 3 * sizeof(uint32_t) || blockLength % 4)
+        {   // these aren't pcapng blocks, the frame ends anywhere
+            parsed = filled;
+            break;
+        }
+        if (parsed + blockLength > filled)
+            break;
+        parsed += blockLength;
+    }
+    const size_t len = all ? filled : parsed;
+    if (len == 0)
+        return 0;
+
+    FrameIndex entry = { offset, rawOffset, 0 };
+    for (size_t pos = 0; pos + 5 * sizeof(uint32_t) <= len; )
+    {
+        uint32_t block[5];
+        memcpy(block, frame.data() + pos, sizeof(block));
+        if (block[0] == EPB_TYPE)
+        {
+            entry.timestamp = (uint64_t)block[3] << 32 | block[4];
+            break;
+        }
+        if (block[1] < 3 * sizeof(uint32_t) || block[1] % 4)
+            break;
+        pos += block[1];
+    }
+
+    const auto t0 = std::chrono::steady_clock::now();
+    FrameHeader header;
+    header.rawLength = len;
+    header.crc = crc32c(frame.data(), len, simd);
+    if (packed.size() < sizeof(header) + lz4Bound(len))
+        packed.resize(sizeof(header) + lz4Bound(len));
+    size_t packedLen = lz4.compress(frame.data(), len, packed.data() + sizeof(header));
+    if (packedLen >= len)
+    {   // e.g. encrypted payloads
+        memcpy(packed.data() + sizeof(header), frame.data(), len);
+        packedLen = len;
+        header.length = len | FRAME_STORED;
+    }
+    else
+        header.length = packedLen;
+    memcpy(packed.data(), &header, sizeof(header));
+    spent += std::chrono::steady_clock::now() - t0;
+
+    out->write(packed.data(), sizeof(header) + packedLen);
+    index.push_back(entry);
+    offset += sizeof(header) + packedLen;
+    rawOffset += len;
+    memmove(frame.data(), frame.data() + len, filled - len);
+    setp(frame.data(), frame.data() + frame.size());
+    pbump(filled - len);
+    parsed = 0;
+    frameStart = std::chrono::steady_clock::now();
+    return out->bad() ? -1 : 0;
+}
+
+
+void CompressedOutput::printStats() const
+{
+    const double ms = std::chrono::duration<double, std::milli>(spent).count();
+    std::ostringstream ratio;
+    ratio << std::fixed << std::setprecision(2) << (offset ? (double)rawOffset / offset : 0.0) << ", "
+          << ms << " ms, " << (rawOffset ? ms / (rawOffset * 8 / 1e9) : 0.0) << " ms per Gbit";
+    std::cout << rawOffset << "' bytes compressed into " << offset << "' bytes in " << index.size()
+              << "' frames (ratio " << ratio.str() << ")." << std::endl;
+}
+
+
+CompressedReader::CompressedReader() : simd(detectSimdLevel())
+{
+}
+
+
+int CompressedReader::open(const std::string &name)
+{
+    file.open(name, std::ios::binary);
+    CompressedHeader header;
+    if (!file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || memcmp(header.magic, COMPRESS_MAGIC, sizeof(COMPRESS_MAGIC)) || header.version != COMPRESS_VERSION)
+        return -1;
+    file.seekg(0, std::ios::end);
+    const uint64_t size = file.tellg();
+    CompressedTrailer trailer;
+    if (size >= sizeof(header) + sizeof(trailer))
+    {
+        file.seekg(size - sizeof(trailer));
+        if (file.read(reinterpret_cast<char *>(&trailer), sizeof(trailer))
+            && !memcmp(trailer.magic, COMPRESS_INDEX_MAGIC, sizeof(COMPRESS_INDEX_MAGIC))
+            && trailer.indexOffset + trailer.frames * sizeof(FrameIndex) + sizeof(trailer) == size)
+        {
+            index.resize(trailer.frames);
+            file.seekg(trailer.indexOffset);
+            if (file.read(reinterpret_cast<char *>(index.data()), index.size() * sizeof(FrameIndex)))
+            {
+                indexed = true;
+                return 0;
+            }
+        }
+    }
+    file.clear();
+    scan();
+    return 0;
+}
+
+
+void CompressedReader::scan()
+{
+    index.clear();
+    file.seekg(0, std::ios::end);
+    const uint64_t size = file.tellg();
+    FrameIndex entry = { sizeof(CompressedHeader), 0, 0 };
+    FrameHeader header;
+    // the last frame can be cut off
+    while (file.seekg(entry.offset) && file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+    {
+        const uint64_t len = header.length & ~FRAME_STORED;
+        if (header.rawLength > MAX_RAW_LENGTH || entry.offset + sizeof(header) + len > size)
+            break;
+        index.push_back(entry);
+        entry.offset += sizeof(header) + len;
+        entry.rawOffset += header.rawLength;
+    }
+    file.clear();
+}
+
+
+int CompressedReader::readFrame(size_t i, std::string &data)
+{
+    FrameHeader header;
+    file.clear();   // after a broken frame
+    if (i >= index.size() || !file.seekg(index[i].offset) || !file.read(reinterpret_cast<char *>(&header), sizeof(header))
+        || header.rawLength > MAX_RAW_LENGTH)
+        return -1;
+    const uint32_t len = header.length & ~FRAME_STORED;
+    if (len > lz4Bound(header.rawLength))
+        return -1;
+    packed.resize(len);
+    if (!file.read(packed.data(), len))
+        return -1;
+    data.resize(header.rawLength);
+    if (header.length & FRAME_STORED)
+    {
+        if (len != header.rawLength)
+            return -1;
+        memcpy(&data[0], packed.data(), len);
+    }
+    else if (lz4Decompress(packed.data(), len, &data[0], data.size()) != (long)header.rawLength)
+        return -1;
+    return crc32c(data.data(), data.size(), simd) == header.crc ? 0 : -1;
+}
+
+
+int CompressedReader::readPreamble(std::string &data)
+{
+    std::string first;
+    if (readFrame(0, first))
+        return -1;
+    size_t len = 0;
+    while (len + 2 * sizeof(uint32_t) <= first.size())
+    {
+        uint32_t block[2];
+        memcpy(block, first.data() + len, sizeof(block));
+        if ((block[0] != SHB_TYPE && block[0] != IDB_TYPE) || block[1] < 3 * sizeof(uint32_t) || len + block[1] > first.size())
+            break;
+        len += block[1];
+    }
+    data.assign(first, 0, len);
+    return 0;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,212 @@
+/**
+ *  @file       compressedOutput.hpp
+ *  @brief      Compressed output file in independent frames header file
+ *  @details    With --compress the writer gathers written blocks into frames of about
+ *              #NAMON::COMPRESS_FRAME_SIZE bytes and compresses every frame on its own by LZ4
+ *              (see lz4Block.hpp). A frame always ends at the end of a pcapng block, so every
+ *              frame is a sequence of whole blocks once it is decompressed. The file is:
+ *
+ *              | Part      | Content                                                          |
+ *              |-----------|------------------------------------------------------------------|
+ *              | header    | #NAMON::CompressedHeader                                         |
+ *              | frames    | #NAMON::FrameHeader and the compressed (or stored) data, repeated|
+ *              | index     | #NAMON::FrameIndex of every frame                                |
+ *              | trailer   | #NAMON::CompressedTrailer                                        |
+ *
+ *              The index is written when the file is closed. A reader seeks to any frame by it,
+ *              and the first frame starts with the section header and interface description
+ *              blocks, so frames from the middle of the capture make a pcapng file with them.
+ *              A file without the index (e.g. capturing was killed) is read frame by frame.
+ *              Numbers are in host order like in the rest of the pcapng file.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#pragma once
+
+#include <chrono>               //  steady_clock, seconds
+#include <cstdint>              //  uint*_t
+#include <fstream>              //  ifstream
+#include <ostream>              //  ostream
+#include <streambuf>            //  streambuf
+#include <string>               //  string
+#include <vector>               //  vector
+
+#include "lz4Block.hpp"         //  Lz4Compressor
+#include "utils.hpp"            //  SimdLevel
+
+
+
+
+namespace NAMON
+{
+
+
+const size_t        COMPRESS_FRAME_SIZE     = 1 << 20;  //!< Frames are compressed when they have this many bytes
+const uint32_t      COMPRESS_VERSION        = 1;        //!< Version of the format
+const char          COMPRESS_MAGIC[8]       = "NAMONLZ";    //!< The first bytes of the file
+const char          COMPRESS_INDEX_MAGIC[8] = "NAMONIX";    //!< The last bytes of a file with the index
+const uint32_t      FRAME_STORED            = 1U << 31; //!< Flag of FrameHeader::length, the data didn't compress
+//! Written blocks wait at most this long for the rest of their frame
+const std::chrono::seconds  COMPRESS_FLUSH_INTERVAL { 1 };
+
+
+/*!
+ * @struct  CompressedHeader
+ * @brief   The beginning of the file
+ */
+struct CompressedHeader
+{
+    char magic[8];                              //!< #NAMON::COMPRESS_MAGIC
+    uint32_t version;                           //!< #NAMON::COMPRESS_VERSION
+    uint32_t frameSize;                         //!< #NAMON::COMPRESS_FRAME_SIZE of the writer
+};
+
+
+/*!
+ * @struct  FrameHeader
+ * @brief   The beginning of a frame
+ */
+struct FrameHeader
+{
+    uint32_t length;                            //!< Length of the data after the header, #NAMON::FRAME_STORED if it is not compressed
+    uint32_t rawLength;                         //!< Length of the decompressed data
+    uint32_t crc;                               //!< CRC-32C of the decompressed data
+};
+
+
+/*!
+ * @struct  FrameIndex
+ * @brief   Entry of the index
+ */
+struct FrameIndex
+{
+    uint64_t offset;                            //!< Offset of the FrameHeader in the file
+    uint64_t rawOffset;                         //!< Offset of the decompressed data in the pcapng file
+    uint64_t timestamp;                         //!< Time stamp of the first packet in the frame, 0 if there is none
+};
+
+
+/*!
+ * @struct  CompressedTrailer
+ * @brief   The end of a file with the index
+ */
+struct CompressedTrailer
+{
+    uint64_t indexOffset;                       //!< Offset of the index in the file
+    uint64_t frames;                            //!< Entries of the index
+    char magic[8];                              //!< #NAMON::COMPRESS_INDEX_MAGIC
+};
+
+
+/*!
+ * @class   CompressedOutput
+ * @brief   Stream buffer which compresses written blocks in frames into another stream
+ * @details The writer thread compresses the frames, the stream is flushed by it after every
+ *          round, but a frame is finished only when it is full or older than
+ *          #NAMON::COMPRESS_FLUSH_INTERVAL.
+ */
+class CompressedOutput : public std::streambuf
+{
+    std::ostream *out = nullptr;                //!< The file (or a stream)
+    std::vector<char> frame;                    //!< Blocks of the current frame
+    size_t parsed = 0;                          //!< Length of the whole blocks at the beginning of the frame
+    std::vector<char> packed;                   //!< The compressed frame
+    Lz4Compressor lz4;                          //!< The compressor
+    SimdLevel simd;                             //!< Instructions used by crc32c()
+    std::vector<FrameIndex> index;              //!< The index of written frames
+    uint64_t offset = 0;                        //!< Bytes written into the file
+    uint64_t rawOffset = 0;                     //!< Bytes of written frames before compression
+    std::chrono::steady_clock::time_point frameStart;   //!< When the first blocks came into the frame
+    std::chrono::steady_clock::duration spent{ 0 };     //!< Time spent compressing
+public:
+    CompressedOutput();
+    /*!
+     * @brief   Finishes the file
+     */
+    ~CompressedOutput();
+    /*!
+     * @brief       Writes the header into the file
+     * @param[in]   file    The output file or stream
+     * @return      -1 on an output error, 0 otherwise
+     */
+    int open(std::ostream &file);
+    /*!
+     * @brief   Writes the last frame, the index and the trailer, the file stays open
+     */
+    void close();
+    /*!
+     * @brief   Prints the compression ratio and the time it took to the standard output
+     */
+    void printStats() const;
+protected:
+    /*!
+     * @brief   Compresses the full frame and stores the character
+     */
+    int_type overflow(int_type c) override;
+    /*!
+     * @brief   Finishes the frame if it is older than #NAMON::COMPRESS_FLUSH_INTERVAL and flushes the file
+     * @return  -1 on an output error
+     */
+    int sync() override;
+private:
+    /*!
+     * @brief       Compresses and writes whole blocks at the beginning of the frame, the rest stays in it
+     * @param[in]   all     Write the rest too (the end of the file)
+     * @return      -1 on an output error
+     */
+    int writeFrame(bool all = false);
+};
+
+
+/*!
+ * @class   CompressedReader
+ * @brief   Reader of the compressed file
+ */
+class CompressedReader
+{
+    std::ifstream file;                         //!< The file
+    std::vector<FrameIndex> index;              //!< Frames found in the file
+    bool indexed = false;                       //!< The index was in the file
+    std::vector<char> packed;                   //!< The compressed frame
+    SimdLevel simd;                             //!< Instructions used by crc32c()
+public:
+    CompressedReader();
+    /*!
+     * @brief       Opens the file and reads its index, or finds frames if it doesn't have one
+     * @param[in]   name    Name of the file
+     * @return      -1 if it can't be read or it isn't a compressed capture, 0 otherwise
+     */
+    int open(const std::string &name);
+    /*!
+     * @return  Frames in the file
+     */
+    const std::vector<FrameIndex> & getFrames() const   { return index; }
+    /*!
+     * @return  True if the file has the index, false if its frames were found one by one
+     */
+    bool hasIndex() const                       { return indexed; }
+    /*!
+     * @brief       Reads and decompresses the frame
+     * @param[in]   i       Number of the frame
+     * @param[out]  data    Blocks of the frame
+     * @return      -1 if the frame is broken, 0 otherwise
+     */
+    int readFrame(size_t i, std::string &data);
+    /*!
+     * @brief       Reads the section header and interface description blocks at the beginning of the capture
+     * @param[out]  data    The blocks
+     * @return      -1 if the first frame is broken, 0 otherwise
+     */
+    int readPreamble(std::string &data);
+private:
+    /*!
+     * @brief   Finds frames one by one from the beginning of the file
+     */
+    void scan();
+};
+
+
+}	// namespace NAMON
@@ -4,7 +4,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 06.03.2017 14:51
- *   - Edited:  23.06.2017 12:01
+ *   - Edited:  20.10.2026 01:50
  */
 
 #include <string>                   //  string
@@ -38,7 +38,7 @@ namespace NAMON
 {
 
 
-int initOFile(std::ofstream &oFile)
+int initOFile(std::ostream &oFile, const std::vector<const char *> &devs, const std::vector<uint16_t> &linkTypes)
 {
 	std::string os;
 
@@ -165,8 +165,11 @@ int initOFile(std::ofstream &oFile)
 
     SectionHeaderBlock shb(os);
     shb.write(oFile);
-    InterfaceDescriptionBlock idb(os);
-    idb.write(oFile);
+    for (size_t i = 0; i < devs.size(); i++)
+    {
+        InterfaceDescriptionBlock idb(os, devs[i], linkTypes[i]);
+        idb.write(oFile);
+    }
 
     log(LogLevel::INFO, "The output file has been initialized.");
     ///System/Library/CoreServices/SystemVersion.plist
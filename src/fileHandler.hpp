@@ -4,12 +4,14 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 06.03.2017 14:50
- *   - Edited:  23.06.2017 12:01
+ *   - Edited:  20.10.2026 01:50
  */
 
 #pragma once
 
-#include <fstream>              //  ofstream
+#include <ostream>              //  ostream
+#include <vector>               //  vector
+#include <cstdint>              //  uint16_t
 
 
 
@@ -20,10 +22,13 @@ namespace NAMON
 
 /*!
  * @brief       Creates the output file and writes SectionHeaderBlock and InterfaceDescriptionBlock to the file
- * @param[in]   oFile   The output file
+ * @details     One InterfaceDescriptionBlock is written for every device, its index is the interface ID.
+ * @param[in]   oFile   The output file or a stream (e.g. the header of the shared memory stream)
+ * @param[in]   devs    Names of capturing devices
+ * @param[in]   linkTypes   LINKTYPE_* values of the devices
  * @return      Zero if initialization was successful. True otherwise
  */
-int initOFile(std::ofstream & oFile);
+int initOFile(std::ostream & oFile, const std::vector<const char *> &devs, const std::vector<uint16_t> &linkTypes);
 
 
 }	// namespace NAMON
@@ -0,0 +1,45 @@
+/**
+ *  @file       flowApps.cpp
+ *  @brief      Applications of flows shared by the cache with the file writer source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:10
+ *   - Edited:  20.10.2026 05:00
+ */
+
+#include "flowApps.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+void FlowApps::enable(unsigned int bits)
+{
+    const size_t n = (size_t)1 << bits;
+    slots.reset(new Slot[n]);
+    mask = n - 1;
+}
+
+
+void FlowApps::announce(AppId id, const std::string &name)
+{
+    if (id >= announced.size())
+        announced.resize(id + 1);
+    announced[id] = true;
+    std::lock_guard<std::mutex> lock(m_names);
+    names.emplace_back(id, name);
+}
+
+
+void FlowApps::takeNames(std::vector<std::pair<AppId, std::string>> &out)
+{
+    std::lock_guard<std::mutex> lock(m_names);
+    out.swap(names);
+    names.clear();
+}
+
+
+}	// namespace NAMON
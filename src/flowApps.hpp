@@ -0,0 +1,124 @@
+/**
+ *  @file       flowApps.hpp
+ *  @brief      Applications of flows shared by the cache with the file writer header file
+ *  @details    The cache thread publishes the application of every netflow it processes under
+ *              the 64-bit hash of the netflow key (see endpointHash()), the thread writing the
+ *              output file looks them up to annotate, split and filter stored packets. The
+ *              table is direct-mapped and lossy: a flow whose slot was taken by another one is
+ *              simply not found.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:10
+ *   - Edited:  20.10.2026 05:00
+ */
+
+#pragma once
+
+#include <atomic>               //  atomic
+#include <memory>               //  unique_ptr
+#include <mutex>                //  mutex
+#include <string>               //  string
+#include <utility>              //  pair
+#include <vector>               //  vector
+
+#include "appRegistry.hpp"      //  AppId
+
+
+
+
+namespace NAMON
+{
+
+
+/*!
+ * @class   FlowApps
+ * @brief   Table of applications of flows indexed by the hash of their netflow key
+ * @details A slot holds the whole 64-bit hash and the application ID, so flows whose CRC-32C
+ *          collides aren't mistaken. The cache thread is the only writer and the slot has
+ *          a sequence number (a seqlock), the writer finds a slot being written as not
+ *          published yet. A flow which the cache looked up without finding its application
+ *          is published too, with #NAMON::NO_APP.
+ */
+class FlowApps
+{
+    /*!
+     * @brief   Application of one flow
+     */
+    struct Slot
+    {
+        std::atomic<uint32_t> seq{ 0 };     //!< Odd while the cache thread writes the slot
+        std::atomic<AppId> id{ NO_APP };    //!< Application
+        std::atomic<uint64_t> hash{ 0 };    //!< Hash of the netflow key, zero if the slot is empty
+    };
+    std::unique_ptr<Slot[]> slots;                  //!< Slots, nullptr if the table is not used
+    uint32_t mask = 0;                              //!< Number of slots - 1
+    std::vector<bool> announced;                    //!< IDs whose names were queued (cache thread only)
+    std::mutex m_names;                             //!< Mutex used to lock #NAMON::FlowApps::names
+    std::vector<std::pair<AppId, std::string>> names;   //!< Names queued for the writer
+public:
+    /*!
+     * @brief       Allocates the table, it is used from now
+     * @param[in]   bits    log2 of the number of slots
+     */
+    void enable(unsigned int bits = 16);
+    /*!
+     * @return  True if the table is used
+     */
+    bool enabled() const                    { return slots != nullptr; }
+    /*!
+     * @brief       Publishes the application of the flow (cache thread)
+     * @details     The name is queued for the writer before the first flow of the application is visible.
+     * @param[in]   hash    Hash of the netflow key (Netflow::getEndpointHash()), zero is ignored
+     * @param[in]   id      Application or #NAMON::NO_APP if it's not known
+     * @param[in]   name    Name of the application
+     */
+    void publish(uint64_t hash, AppId id, const std::string &name)
+    {
+        if (hash == 0)
+            return;
+        Slot &s = slots[(hash >> 32) & mask];
+        if (s.hash.load(std::memory_order_relaxed) == hash && s.id.load(std::memory_order_relaxed) == id)
+            return;
+        if (id != NO_APP && (id >= announced.size() || !announced[id]))
+            announce(id, name);
+        const uint32_t seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.hash.store(hash, std::memory_order_relaxed);
+        s.id.store(id, std::memory_order_relaxed);
+        s.seq.store(seq + 2, std::memory_order_release);
+    }
+    /*!
+     * @brief       Finds the application of the flow (writer thread)
+     * @param[in]   hash    Hash of the netflow key (endpointHash())
+     * @param[out]  id      Application or #NAMON::NO_APP if the cache doesn't know it
+     * @return      False if the cache hasn't published the flow (yet)
+     */
+    bool find(uint64_t hash, AppId &id) const
+    {
+        if (hash == 0)
+            return false;
+        const Slot &s = slots[(hash >> 32) & mask];
+        const uint32_t seq = s.seq.load(std::memory_order_acquire);
+        const uint64_t h = s.hash.load(std::memory_order_relaxed);
+        const AppId a = s.id.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if ((seq & 1) || h != hash || s.seq.load(std::memory_order_relaxed) != seq)
+            return false;
+        id = a;
+        return true;
+    }
+    /*!
+     * @brief       Takes the names queued since the last call (writer thread)
+     * @param[out]  out     IDs and names, in order of their publishing
+     */
+    void takeNames(std::vector<std::pair<AppId, std::string>> &out);
+private:
+    /*!
+     * @brief   Queues the name of a newly published application
+     */
+    void announce(AppId id, const std::string &name);
+};
+
+
+}	// namespace NAMON
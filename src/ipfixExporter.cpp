@@ -0,0 +1,521 @@
+/**
+ *  @file       ipfixExporter.cpp
+ *  @brief      IPFIX export of netflows and their applications source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:20
+ *   - Edited:  20.10.2026 06:20
+ */
+
+#include <iostream>             //  cout, endl
+#include <cstring>              //  memcpy(), memset()
+#include <cerrno>               //  errno
+#include <ctime>                //  time()
+#if defined(_WIN32)
+#include <winsock2.h>           //  socket(), send()
+#include <ws2tcpip.h>           //  getaddrinfo()
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/types.h>          //  ssize_t
+#include <sys/socket.h>         //  socket(), connect(), send()
+#include <netdb.h>              //  getaddrinfo()
+#include <unistd.h>             //  close()
+#endif
+
+#include "debug.hpp"            //  log()
+#include "cache.hpp"            //  Cache, TEntry
+#include "ipfixExporter.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+const uint16_t IPFIX_VERSION            = 10;       //!< Version in the message header
+const uint16_t IPFIX_TEMPLATE_SET       = 2;        //!< ID of the template set
+const uint16_t IPFIX_TEMPLATE_IPV4      = 256;      //!< ID of the template of IPv4 netflows
+const uint16_t IPFIX_TEMPLATE_IPV6      = 257;      //!< ID of the template of IPv6 netflows
+const uint16_t IPFIX_APP_NAME_ELEMENT   = 96;       //!< applicationName, IANA element with the application name
+const size_t   IPFIX_MAX_NAME           = 254;      //!< Longer names are cut, so their length fits into one byte
+//! Longest message, IPv6 and UDP headers go before it
+const size_t   IPFIX_MAX_MESSAGE        = IPFIX_MTU - 40 - 8;
+
+#if defined(MSG_NOSIGNAL)
+static const int SEND_FLAGS = MSG_NOSIGNAL;         //!< A lost TCP connection doesn't raise SIGPIPE
+#else
+static const int SEND_FLAGS = 0;
+#endif
+
+
+/*!
+ * @brief   Appends the number in network order
+ */
+static void put16(std::string &s, uint16_t v)
+{
+    s.push_back((char)(v >> 8));
+    s.push_back((char)v);
+}
+
+static void put32(std::string &s, uint32_t v)
+{
+    put16(s, v >> 16);
+    put16(s, v);
+}
+
+static void put64(std::string &s, uint64_t v)
+{
+    put32(s, v >> 32);
+    put32(s, v);
+}
+
+/*!
+ * @brief   Overwrites 2 bytes at pos by the number in network order
+ */
+static void set16(std::string &s, size_t pos, uint16_t v)
+{
+    s[pos] = (char)(v >> 8);
+    s[pos + 1] = (char)v;
+}
+
+
+/*!
+ * @brief   Converts the command line to the application name element
+ * @details Arguments delimited by '\0' on Linux are delimited by spaces, long names are cut.
+ */
+static std::string ipfixName(const std::string &cmdline)
+{
+    std::string name = cmdline.substr(0, IPFIX_MAX_NAME);
+    for (char &c : name)
+        if (c == '\0')
+            c = ' ';
+    while (!name.empty() && name.back() == ' ')
+        name.pop_back();
+    return name;
+}
+
+
+static void closeSocket(int sock)
+{
+#if defined(_WIN32)
+    closesocket(sock);
+#else
+    close(sock);
+#endif
+}
+
+
+int parseIpfixCollector(const std::string &str, IpfixCollector &c)
+{
+    std::string s = str;
+    c = IpfixCollector();
+    if (s.compare(0, 4, "udp:") == 0)
+        s.erase(0, 4);
+    else if (s.compare(0, 4, "tcp:") == 0)
+    {
+        c.tcp = true;
+        s.erase(0, 4);
+    }
+
+    std::string port;
+    if (!s.empty() && s[0] == '[')
+    {   // [IPv6]:port
+        const size_t close = s.find(']');
+        if (close == std::string::npos)
+            return -1;
+        c.host = s.substr(1, close - 1);
+        if (close + 1 < s.length())
+        {
+            if (s[close + 1] != ':')
+                return -1;
+            port = s.substr(close + 2);
+            if (port.empty())
+                return -1;
+        }
+    }
+    else
+    {   // an IPv6 address without brackets has more colons
+        const size_t colon = s.find(':');
+        if (colon != std::string::npos && colon == s.rfind(':'))
+        {
+            c.host = s.substr(0, colon);
+            port = s.substr(colon + 1);
+            if (port.empty())
+                return -1;
+        }
+        else
+            c.host = s;
+    }
+    if (c.host.empty())
+        return -1;
+    if (!port.empty())
+    {
+        size_t end = 0;
+        unsigned long p = 0;
+        try { p = std::stoul(port, &end); }
+        catch (std::exception &) { return -1; }
+        if (end != port.length() || p == 0 || p > 0xffff)
+            return -1;
+        c.port = p;
+    }
+    return 0;
+}
+
+
+IpfixExporter::IpfixExporter(const IpfixCollector &collector, std::chrono::seconds active, uint8_t tsresol)
+    : collector(collector), unitsPerMs((tsresol == 9) ? 1000000 : 1000)
+{
+    activeTimeout = active.count() * 1000 * unitsPerMs;
+    queue.reserve(IPFIX_QUEUE_SIZE);
+}
+
+
+IpfixExporter::~IpfixExporter()
+{
+    stop();
+}
+
+
+int IpfixExporter::start()
+{
+#if defined(_WIN32)
+    WSADATA wsa;
+    if (WSAStartup(MAKEWORD(2, 2), &wsa))
+        return -1;
+#endif
+    if (connect())
+        return -1;
+    thread = std::thread(&IpfixExporter::run, this);
+    return 0;
+}
+
+
+void IpfixExporter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queue);
+        stopping = true;
+    }
+    cv_queue.notify_all();
+    if (thread.joinable())
+        thread.join();
+    disconnect();
+}
+
+
+void IpfixExporter::sweep(Cache &cache)
+{
+    cache.forEachEntry([this](TEntry &e) {
+        Netflow *n = e.getNetflowPtr();
+        if (n == nullptr || n->getEndTime() == 0 || n->getEndTime() == e.getExportedEnd())
+            return;
+        const uint64_t start = e.getRecordStart() ? e.getRecordStart() : n->getStartTime();
+        if (!e.valid())
+            exportEntry(e, IpfixEndReason::IDLE, false);
+        else if (n->getEndTime() >= start && n->getEndTime() - start >= activeTimeout)
+            exportEntry(e, IpfixEndReason::ACTIVE, false);
+    });
+    cv_queue.notify_all();
+}
+
+
+void IpfixExporter::expire(TEntry &e, uint64_t nextStart)
+{
+    Netflow *n = e.getNetflowPtr();
+    if (n != nullptr && n->getEndTime() != 0 && n->getEndTime() != e.getExportedEnd())
+    {
+        exportEntry(e, IpfixEndReason::IDLE, false);
+        cv_queue.notify_all();
+    }
+    e.setExported(e.getExportedEnd(), nextStart);
+}
+
+
+void IpfixExporter::finish(Cache &cache)
+{
+    cache.forEachEntry([this](TEntry &e) {
+        Netflow *n = e.getNetflowPtr();
+        if (n != nullptr && n->getEndTime() != 0 && n->getEndTime() != e.getExportedEnd())
+            exportEntry(e, IpfixEndReason::FORCED, true);
+    });
+    cv_queue.notify_all();
+}
+
+
+void IpfixExporter::exportEntry(TEntry &e, IpfixEndReason reason, bool wait)
+{
+    Netflow *n = e.getNetflowPtr();
+    IpfixRecord r;
+    r.start = (e.getRecordStart() ? e.getRecordStart() : n->getStartTime()) / unitsPerMs;
+    r.end = n->getEndTime() / unitsPerMs;
+    memset(&r.ip, 0, sizeof(r.ip));
+    memcpy(&r.ip, n->getLocalIp(), (n->getIpVersion() == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN);
+    r.app = e.getAppId();
+    r.port = n->getLocalPort();
+    r.ipVersion = n->getIpVersion();
+    r.proto = n->getProto();
+    r.reason = reason;
+    e.setExported(n->getEndTime(), n->getEndTime());
+
+    std::unique_lock<std::mutex> lock(m_queue);
+    if (wait && queue.size() >= IPFIX_QUEUE_SIZE)
+    {
+        cv_queue.notify_all();
+        cv_queue.wait(lock, [this]() { return queue.size() < IPFIX_QUEUE_SIZE; });
+    }
+    else if (queue.size() >= IPFIX_QUEUE_SIZE)
+    {
+        dropped++;
+        return;
+    }
+    if (r.app != NO_APP && (r.app >= announced.size() || !announced[r.app]))
+    {   // the name goes to the exporting thread with the first record of the application
+        if (r.app >= announced.size())
+            announced.resize(r.app + 1);
+        announced[r.app] = true;
+        newNames.emplace_back(r.app, ipfixName(e.getAppName()));
+    }
+    queue.push_back(r);
+    if (queue.size() == IPFIX_QUEUE_SIZE / 2)
+        cv_queue.notify_all();
+}
+
+
+void IpfixExporter::run()
+{
+    std::vector<IpfixRecord> records;
+    std::vector<std::string> msgs;
+    std::vector<uint32_t> counts;
+    records.reserve(IPFIX_QUEUE_SIZE);
+    std::unique_lock<std::mutex> lock(m_queue);
+    while (true)
+    {
+        // records are gathered for a while, so messages are full
+        cv_queue.wait_for(lock, IPFIX_FLUSH_INTERVAL, [this]() { return stopping || queue.size() >= IPFIX_QUEUE_SIZE / 2; });
+        if (queue.empty())
+        {
+            if (stopping)
+                break;
+            continue;
+        }
+        records.swap(queue);
+        for (auto &n : newNames)
+        {
+            if (n.first >= names.size())
+                names.resize(n.first + 1);
+            names[n.first].swap(n.second);
+        }
+        newNames.clear();
+        lock.unlock();
+        cv_queue.notify_all();  // finish() waits for space
+
+        // templates are sent over TCP once after connecting, over UDP again and again
+        const auto now = std::chrono::steady_clock::now();
+        if (!collector.tcp && (messages == 0 || now - templatesSent >= IPFIX_TEMPLATE_INTERVAL))
+        {
+            if (send(templateMessage()) == 0)
+                templatesSent = now;
+        }
+        buildMessages(records, msgs, counts);
+        for (size_t i = 0; i < msgs.size(); i++)
+        {
+            if (send(msgs[i]))
+            {
+                failed++;
+                continue;
+            }
+            messages++;
+            exported += counts[i];
+        }
+        records.clear();
+        lock.lock();
+    }
+    log(LogLevel::INFO, "IPFIX export stopped.");
+}
+
+
+void IpfixExporter::beginMessage(std::string &msg)
+{
+    msg.clear();
+    put16(msg, IPFIX_VERSION);
+    put16(msg, 0);                      // length, see endMessage()
+    put32(msg, (uint32_t)time(nullptr));
+    put32(msg, sequence);
+    put32(msg, 0);                      // observation domain
+}
+
+
+void IpfixExporter::endMessage(std::string &msg)
+{
+    set16(msg, 2, msg.size());
+}
+
+
+std::string IpfixExporter::templateMessage()
+{
+    std::string msg;
+    beginMessage(msg);
+    const size_t set = msg.size();
+    put16(msg, IPFIX_TEMPLATE_SET);
+    put16(msg, 0);
+    for (uint16_t id : { IPFIX_TEMPLATE_IPV4, IPFIX_TEMPLATE_IPV6 })
+    {
+        put16(msg, id);
+        put16(msg, 7);                  // number of fields
+        put16(msg, (id == IPFIX_TEMPLATE_IPV4) ? 8 : 27);   // sourceIPv4Address, sourceIPv6Address
+        put16(msg, (id == IPFIX_TEMPLATE_IPV4) ? IPv4_ADDRLEN : IPv6_ADDRLEN);
+        put16(msg, 7);   put16(msg, 2);     // sourceTransportPort
+        put16(msg, 4);   put16(msg, 1);     // protocolIdentifier
+        put16(msg, 152); put16(msg, 8);     // flowStartMilliseconds
+        put16(msg, 153); put16(msg, 8);     // flowEndMilliseconds
+        put16(msg, 136); put16(msg, 1);     // flowEndReason
+        put16(msg, IPFIX_APP_NAME_ELEMENT);
+        put16(msg, 0xffff);             // variable length
+    }
+    set16(msg, set + 2, msg.size() - set);
+    endMessage(msg);
+    return msg;
+}
+
+
+void IpfixExporter::buildMessages(const std::vector<IpfixRecord> &records, std::vector<std::string> &out,
+                                  std::vector<uint32_t> &counts)
+{
+    out.clear();
+    counts.clear();
+    std::string msg;
+    size_t set = 0;         // position of the header of the open data set
+    uint16_t setId = 0;     // template of the open data set, zero if none is open
+    uint32_t count = 0;
+    auto closeSet = [&msg, &set, &setId]() {
+        if (setId != 0)
+            set16(msg, set + 2, msg.size() - set);
+        setId = 0;
+    };
+    auto closeMessage = [&]() {
+        closeSet();
+        endMessage(msg);
+        out.push_back(msg);
+        counts.push_back(count);
+        sequence += count;
+        count = 0;
+        msg.clear();
+    };
+
+    // IPv4 records go first, so there are at most two sets in a message
+    for (uint8_t version : { 4, 6 })
+    {
+        const uint16_t id = (version == 4) ? IPFIX_TEMPLATE_IPV4 : IPFIX_TEMPLATE_IPV6;
+        const size_t addrLen = (version == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
+        for (const IpfixRecord &r : records)
+        {
+            if (r.ipVersion != version)
+                continue;
+            static const std::string noName;
+            const std::string &name = (r.app < names.size()) ? names[r.app] : noName;
+            const size_t len = addrLen + 2 + 1 + 8 + 8 + 1 + 1 + name.size();
+            if (!msg.empty() && msg.size() + len + (setId != id ? 4 : 0) > IPFIX_MAX_MESSAGE)
+                closeMessage();
+            if (msg.empty())
+                beginMessage(msg);
+            if (setId != id)
+            {
+                closeSet();
+                set = msg.size();
+                setId = id;
+                put16(msg, id);
+                put16(msg, 0);
+            }
+            msg.append(reinterpret_cast<const char *>(&r.ip), addrLen);
+            put16(msg, r.port);
+            msg.push_back((char)r.proto);
+            put64(msg, r.start);
+            put64(msg, r.end);
+            msg.push_back((char)r.reason);
+            msg.push_back((char)name.size());
+            msg.append(name);
+            count++;
+        }
+    }
+    if (!msg.empty())
+        closeMessage();
+}
+
+
+int IpfixExporter::send(const std::string &msg)
+{
+    if (sock < 0 && connect())  // the TCP connection was lost
+        return -1;
+    return sendAll(msg);
+}
+
+
+int IpfixExporter::sendAll(const std::string &msg)
+{
+    size_t sent = 0;
+    while (sent < msg.size())
+    {
+        const int r = ::send(sock, msg.data() + sent, msg.size() - sent, SEND_FLAGS);
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            log(LogLevel::WARNING, "Can't send IPFIX message to '", collector.host, "': ", strerror(errno));
+            if (collector.tcp)
+                disconnect();   // the next message connects again
+            return -1;
+        }
+        sent += r;
+    }
+    return 0;
+}
+
+
+int IpfixExporter::connect()
+{
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = collector.tcp ? SOCK_STREAM : SOCK_DGRAM;
+    addrinfo *res = nullptr;
+    if (getaddrinfo(collector.host.c_str(), std::to_string(collector.port).c_str(), &hints, &res) || res == nullptr)
+    {
+        log(LogLevel::ERR, "Can't resolve IPFIX collector '", collector.host, "'.");
+        return -1;
+    }
+    for (addrinfo *a = res; a != nullptr && sock < 0; a = a->ai_next)
+    {
+        sock = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (sock >= 0 && ::connect(sock, a->ai_addr, a->ai_addrlen))
+            disconnect();
+    }
+    freeaddrinfo(res);
+    if (sock < 0)
+    {
+        log(LogLevel::ERR, "Can't connect to IPFIX collector '", collector.host, "': ", strerror(errno));
+        return -1;
+    }
+    if (collector.tcp && sendAll(templateMessage()))
+        return -1;
+    log(LogLevel::INFO, "Exporting IPFIX to '", collector.host, "' port ", collector.port, collector.tcp ? " (TCP)." : " (UDP).");
+    return 0;
+}
+
+
+void IpfixExporter::disconnect()
+{
+    if (sock >= 0)
+        closeSocket(sock);
+    sock = -1;
+}
+
+
+void IpfixExporter::printStats() const
+{
+    std::cout << exported << "' netflow records exported to the IPFIX collector in " << messages << " messages, "
+              << dropped << "' dropped, " << failed << "' messages not sent." << std::endl;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,240 @@
+/**
+ *  @file       ipfixExporter.hpp
+ *  @brief      IPFIX export of netflows and their applications header file
+ *  @details    With --ipfix netflows of the cache are sent to an IPFIX (RFC 7011) collector
+ *              over UDP or TCP while capturing. Every record carries the local endpoint of the
+ *              netflow, its times and the name of its application in the IANA element
+ *              applicationName:
+ *
+ *              | Element                   | ID     | Length                               |
+ *              |---------------------------|--------|--------------------------------------|
+ *              | sourceIPv4Address         | 8      | 4 (template 256)                     |
+ *              | sourceIPv6Address         | 27     | 16 (template 257)                    |
+ *              | sourceTransportPort       | 7      | 2                                    |
+ *              | protocolIdentifier        | 4      | 1                                    |
+ *              | flowStartMilliseconds     | 152    | 8                                    |
+ *              | flowEndMilliseconds       | 153    | 8                                    |
+ *              | flowEndReason             | 136    | 1                                    |
+ *              | applicationName           | 96     | variable, UTF-8 command line         |
+ *
+ *              The source address and port are the local ones, netflows of namon don't have
+ *              a remote endpoint. The cache thread sweeps the cache every
+ *              #NAMON::IPFIX_SWEEP_INTERVAL: a netflow is exported when its entry expires (the
+ *              idle timeout is the cache TTL, see --cache-ttl) or when it has been active for
+ *              the active timeout, the next record of the netflow starts where this one ended.
+ *              The rest is exported at the end. Records go through a bounded queue to the
+ *              exporting thread, which packs them into messages fitting into #NAMON::IPFIX_MTU.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:20
+ *   - Edited:  20.10.2026 06:20
+ */
+
+#pragma once
+
+#include <atomic>               //  atomic
+#include <chrono>               //  seconds, steady_clock
+#include <condition_variable>   //  condition_variable
+#include <mutex>                //  mutex
+#include <string>               //  string
+#include <thread>               //  thread
+#include <vector>               //  vector
+#include <cstdint>              //  uint*_t
+
+#include "tcpip_headers.hpp"    //  ip6_addr
+#include "appRegistry.hpp"      //  AppId
+
+
+
+
+namespace NAMON
+{
+
+
+class Cache;
+class TEntry;
+
+const uint16_t              IPFIX_PORT              = 4739;     //!< Default port of collectors
+const unsigned int          IPFIX_MTU               = 1500;     //!< Messages fit into one packet of this size with IPv6 and UDP headers
+const unsigned int          IPFIX_QUEUE_SIZE        = 20000;    //!< Records waiting for the exporting thread, newer ones are dropped
+const std::chrono::seconds  IPFIX_SWEEP_INTERVAL    { 1 };      //!< How often the cache looks for netflows to export
+const std::chrono::seconds  IPFIX_TEMPLATE_INTERVAL { 60 };     //!< How often templates are sent again over UDP
+const std::chrono::milliseconds IPFIX_FLUSH_INTERVAL{ 100 };    //!< The longest time a record waits for more records to fill a message
+const unsigned int          DEFAULT_IPFIX_ACTIVE    = 60;       //!< Default active timeout (s)
+
+
+/*!
+ * @brief   Reasons of the end of a record, values of flowEndReason
+ */
+enum class IpfixEndReason : uint8_t {
+    IDLE    = 1,    //!< The cache entry expired
+    ACTIVE  = 2,    //!< The netflow was active for the active timeout
+    FORCED  = 4,    //!< Capturing ended
+};
+
+
+/*!
+ * @brief   Collector and the transport
+ */
+struct IpfixCollector
+{
+    bool tcp = false;                   //!< TCP instead of UDP
+    std::string host;                   //!< Address or name of the collector
+    uint16_t port = IPFIX_PORT;         //!< Port of the collector
+};
+
+/*!
+ * @brief       Parses the collector in format [udp:|tcp:]<host>[:<port>], an IPv6 address in brackets
+ * @param[in]   str     Collector description
+ * @param[out]  c       Parsed collector
+ * @return      Zero on success, -1 if the description is invalid
+ */
+int parseIpfixCollector(const std::string &str, IpfixCollector &c);
+
+
+/*!
+ * @brief   Exported record of a netflow
+ */
+struct IpfixRecord
+{
+    uint64_t start = 0;         //!< flowStartMilliseconds
+    uint64_t end = 0;           //!< flowEndMilliseconds
+    ip6_addr ip;                //!< Local address, the first 4 bytes for IPv4
+    AppId app = NO_APP;         //!< Application, its name is sent with the record
+    uint16_t port = 0;          //!< Local port
+    uint8_t ipVersion = 4;      //!< IP version
+    uint8_t proto = 0;          //!< Layer 4 protocol
+    IpfixEndReason reason = IpfixEndReason::IDLE;   //!< flowEndReason
+};
+
+
+/*!
+ * @class   IpfixExporter
+ * @brief   Exporting thread and the queue of records it sends
+ * @details sweep(), expire() and finish() are called by the thread which owns the cache,
+ *          they queue records and mark what was exported in the cache entries.
+ */
+class IpfixExporter
+{
+    IpfixCollector collector;                   //!< Where records are sent
+    uint64_t activeTimeout;                     //!< Active timeout in units of netflow times
+    uint64_t unitsPerMs;                        //!< Units of netflow times in a millisecond
+    int sock = -1;                              //!< Socket connected to the collector, -1 if it isn't
+    std::vector<bool> announced;                //!< IDs whose names were queued (cache thread only)
+    std::mutex m_queue;                         //!< Mutex used to lock the queue and the names
+    std::condition_variable cv_queue;           //!< Notifies the exporting thread and finish() waiting for space
+    std::vector<IpfixRecord> queue;             //!< Records waiting for the exporting thread
+    std::vector<std::pair<AppId, std::string>> newNames;    //!< Names of applications queued with the records
+    std::vector<std::string> names;             //!< Names of applications indexed by their ID (exporting thread)
+    std::thread thread;                         //!< Exporting thread
+    bool stopping = false;                      //!< The thread sends the rest of the queue and ends
+    uint32_t sequence = 0;                      //!< Number of data records sent before the current message
+    std::chrono::steady_clock::time_point templatesSent;    //!< Last time templates were sent over UDP
+    std::atomic<unsigned long> dropped{ 0 };    //!< Records dropped because the queue was full
+    unsigned long exported = 0;                 //!< Records in sent messages
+    unsigned long messages = 0;                 //!< Messages sent
+    unsigned long failed = 0;                   //!< Messages which couldn't be sent
+public:
+    /*!
+     * @param[in]   collector   Where records are sent
+     * @param[in]   active      Active timeout
+     * @param[in]   tsresol     Resolution of netflow times (10^-tsresol s), 6 or 9
+     */
+    IpfixExporter(const IpfixCollector &collector, std::chrono::seconds active, uint8_t tsresol);
+    /*!
+     * @brief   Stops the exporting thread if it runs
+     */
+    ~IpfixExporter();
+    /*!
+     * @brief   Connects to the collector and starts the exporting thread
+     * @return  -1 if the collector can't be resolved or connected, 0 otherwise
+     */
+    int start();
+    /*!
+     * @brief   Sends the rest of the queue, ends the exporting thread and closes the socket
+     */
+    void stop();
+    /*!
+     * @brief       Exports netflows of expired entries and of entries active for the active timeout
+     * @param[in]   cache   The cache
+     */
+    void sweep(Cache &cache);
+    /*!
+     * @brief       Exports the rest of an expired entry before it is checked again
+     * @param[in]   e           The entry
+     * @param[in]   nextStart   Time of the packet which continues the netflow, the next record starts with it
+     */
+    void expire(TEntry &e, uint64_t nextStart);
+    /*!
+     * @brief       Exports the rest of every netflow, it waits for space in the queue
+     * @param[in]   cache   The cache, it isn't used by other threads anymore
+     */
+    void finish(Cache &cache);
+    /*!
+     * @brief   Prints the counters to the standard output
+     */
+    void printStats() const;
+    /*!
+     * @return  Number of dropped records
+     */
+    unsigned long getDropped() const            { return dropped; }
+    /*!
+     * @return  Number of records in sent messages
+     */
+    unsigned long getExported() const           { return exported; }
+    /*!
+     * @return  Number of messages which couldn't be sent
+     */
+    unsigned long getFailed() const             { return failed; }
+private:
+    /*!
+     * @brief       Builds messages with the records (exporting thread)
+     * @param[in]   records     Records, names of their applications are in #NAMON::IpfixExporter::names
+     * @param[out]  out         Messages, each of them fits into #NAMON::IPFIX_MTU
+     * @param[out]  counts      Number of records in every message
+     */
+    void buildMessages(const std::vector<IpfixRecord> &records, std::vector<std::string> &out, std::vector<uint32_t> &counts);
+    /*!
+     * @brief   Queues the record of an entry and marks it as exported
+     * @param[in]   wait    Wait for space instead of dropping the record
+     */
+    void exportEntry(TEntry &e, IpfixEndReason reason, bool wait);
+    /*!
+     * @brief   Body of the exporting thread
+     */
+    void run();
+    /*!
+     * @brief   Appends the message header, its length is set by endMessage()
+     */
+    void beginMessage(std::string &msg);
+    /*!
+     * @brief   Sets the length of the message in its header
+     */
+    void endMessage(std::string &msg);
+    /*!
+     * @brief   Builds a message with both templates
+     */
+    std::string templateMessage();
+    /*!
+     * @brief   Sends the message, TCP connection is opened again if it was lost
+     * @return  -1 if it wasn't sent
+     */
+    int send(const std::string &msg);
+    /*!
+     * @brief   Sends the whole message through the socket
+     * @return  -1 if it wasn't sent
+     */
+    int sendAll(const std::string &msg);
+    /*!
+     * @brief   Opens the socket connected to the collector, templates are sent to a TCP collector
+     * @return  -1 if it can't be opened
+     */
+    int connect();
+    /*!
+     * @brief   Closes the socket
+     */
+    void disconnect();
+};
+
+
+}	// namespace NAMON
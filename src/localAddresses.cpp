@@ -0,0 +1,219 @@
+/** 
+ *  @file       localAddresses.cpp
+ *  @brief      Set of IP addresses of the host source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 15:10
+ *   - Edited:  20.10.2026 06:00
+ */
+
+#include <cstring>              //  memcpy(), memset()
+#include <algorithm>            //  find(), find_if(), min()
+
+#include "localAddresses.hpp"
+
+#if defined(NAMON_X86_SIMD)
+#include <immintrin.h>          //  _mm256_*()
+#endif
+
+
+
+
+namespace NAMON
+{
+
+
+/*!
+ * @brief       Returns number of slots of a table with n addresses, at most half of them is used
+ * @param[out]  shift   32 - log2(size)
+ */
+static size_t tableSize(size_t n, unsigned int &shift)
+{
+    size_t size = 16;
+    shift = 28;
+    while (size < n * 2)
+    {
+        size *= 2;
+        shift--;
+    }
+    return size;
+}
+
+
+#if defined(NAMON_X86_SIMD)
+/*!
+ * @brief   The same as LocalAddresses::hash() for 8 addresses at once, the rest is left for the scalar loop
+ * @return  Number of hashed addresses
+ */
+__attribute__((target("avx2")))
+static unsigned int hash4Avx2(const uint32_t *ips, unsigned int count, unsigned int shift, uint32_t *slots)
+{
+    const __m256i golden = _mm256_set1_epi32((int)0x9e3779b1u);
+    const __m128i s = _mm_cvtsi32_si128((int)shift);
+    unsigned int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(ips + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(slots + i), _mm256_srl_epi32(_mm256_mullo_epi32(a, golden), s));
+    }
+    return i;
+}
+#endif
+
+
+void LocalAddresses::contains4(const uint32_t *ips, unsigned int count, uint8_t *found, SimdLevel simd) const
+{
+    ReadGuard guard(*this);
+    const Table *t = current.load(std::memory_order_seq_cst);
+    if (t == nullptr || t->slots4.empty())
+    {
+        memset(found, 0, count);
+        return;
+    }
+    const uint32_t *table = t->slots4.data();
+    const size_t mask = t->slots4.size() - 1;
+    const unsigned int CHUNK = 64;
+    uint32_t slots[CHUNK];
+    for (unsigned int done = 0; done < count; done += CHUNK, ips += CHUNK, found += CHUNK)
+    {
+        const unsigned int n = std::min(count - done, CHUNK);
+        unsigned int i = 0;
+#if defined(NAMON_X86_SIMD)
+        if (simd == SimdLevel::AVX2)
+            i = hash4Avx2(ips, n, t->shift4, slots);
+#else
+        (void)simd;
+#endif
+        for (; i < n; i++)
+            slots[i] = hash(ips[i], t->shift4);
+
+        for (i = 0; i < n; i++)
+        {
+            const uint32_t a = ips[i];
+            size_t s = slots[i];
+            while (table[s] != a && table[s] != 0)
+                s = (s + 1) & mask;
+            found[i] = (a != 0 && table[s] == a);
+        }
+    }
+}
+
+
+void LocalAddresses::add(const void *ip, unsigned int ipVersion)
+{
+    std::lock_guard<std::mutex> lock(m_update);
+    if (ipVersion == 4)
+    {
+        uint32_t a;
+        memcpy(&a, ip, IPv4_ADDRLEN);
+        if (a != 0 && std::find(addresses4.begin(), addresses4.end(), a) == addresses4.end())
+        {
+            addresses4.push_back(a);
+            changed = true;
+        }
+    }
+    else
+    {
+        ip6_addr a, zero;
+        memcpy(&a, ip, IPv6_ADDRLEN);
+        memset(&zero, 0, sizeof(zero));
+        if (!same(a, zero) && std::find_if(addresses6.begin(), addresses6.end(), [&a](const ip6_addr &i) { return same(i, a); }) == addresses6.end())
+        {
+            addresses6.push_back(a);
+            changed = true;
+        }
+    }
+}
+
+
+void LocalAddresses::remove(const void *ip, unsigned int ipVersion)
+{
+    std::lock_guard<std::mutex> lock(m_update);
+    if (ipVersion == 4)
+    {
+        uint32_t a;
+        memcpy(&a, ip, IPv4_ADDRLEN);
+        auto it = std::find(addresses4.begin(), addresses4.end(), a);
+        if (it != addresses4.end())
+        {
+            addresses4.erase(it);
+            changed = true;
+        }
+    }
+    else
+    {
+        ip6_addr a;
+        memcpy(&a, ip, IPv6_ADDRLEN);
+        auto it = std::find_if(addresses6.begin(), addresses6.end(), [&a](const ip6_addr &i) { return same(i, a); });
+        if (it != addresses6.end())
+        {
+            addresses6.erase(it);
+            changed = true;
+        }
+    }
+}
+
+
+void LocalAddresses::list(std::vector<uint32_t> &ips4, std::vector<ip6_addr> &ips6)
+{
+    std::lock_guard<std::mutex> lock(m_update);
+    ips4 = addresses4;
+    ips6 = addresses6;
+}
+
+
+bool LocalAddresses::publish()
+{
+    std::lock_guard<std::mutex> lock(m_update);
+    // e.g. a netlink notification of an address which is already known
+    if (!changed)
+        return false;
+    std::unique_ptr<Table> t(new Table);
+    if (!addresses4.empty())
+    {
+        t->slots4.assign(tableSize(addresses4.size(), t->shift4), 0);
+        const size_t mask = t->slots4.size() - 1;
+        for (uint32_t a : addresses4)
+        {
+            size_t i = hash(a, t->shift4);
+            while (t->slots4[i] != 0)
+                i = (i + 1) & mask;
+            t->slots4[i] = a;
+        }
+    }
+    if (!addresses6.empty())
+    {
+        ip6_addr zero;
+        memset(&zero, 0, sizeof(zero));
+        t->slots6.assign(tableSize(addresses6.size(), t->shift6), zero);
+        const size_t mask = t->slots6.size() - 1;
+        for (const ip6_addr &a : addresses6)
+        {
+            size_t i = hash(a, t->shift6);
+            while (!same(t->slots6[i], zero))
+                i = (i + 1) & mask;
+            t->slots6[i] = a;
+        }
+    }
+    current.store(t.get(), std::memory_order_seq_cst);
+    changed = false;
+    // readers which see the new epoch see the new tables too
+    const uint64_t e = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+    if (published)
+        retired.push_back(Retired{ std::move(published), e });
+    published = std::move(t);
+
+    uint64_t oldest = e;
+    for (const ReaderSlot &r : readers)
+    {
+        const uint64_t re = r.epoch.load(std::memory_order_seq_cst);
+        if (re != 0 && re < oldest)
+            oldest = re;
+    }
+    while (!retired.empty() && retired.front().epoch <= oldest)
+        retired.pop_front();
+    return true;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,230 @@
+/** 
+ *  @file       localAddresses.hpp
+ *  @brief      Set of IP addresses of the host header file
+ *  @details    The set is used to decide the packet direction. It is read by capturing
+ *              threads without locking and replaced as a whole when addresses change.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 15:10
+ *   - Edited:  20.10.2026 06:00
+ */
+
+#pragma once
+
+#include <vector>               //  vector
+#include <deque>                //  deque
+#include <array>                //  array
+#include <memory>               //  unique_ptr
+#include <atomic>               //  atomic
+#include <mutex>                //  mutex
+#include <cstdint>              //  uint32_t, uint64_t
+#include <cstring>              //  memcpy()
+
+#include "tcpip_headers.hpp"    //  ip4_addr, ip6_addr
+#include "utils.hpp"            //  SimdLevel
+
+
+
+
+namespace NAMON
+{
+
+
+//! Maximum number of threads which look up addresses at the same time
+const unsigned int          ADDRESS_READERS     = 64;
+
+
+/*!
+ * @class   LocalAddresses
+ * @brief   IPv4 and IPv6 addresses of the host with O(1) lookup
+ * @details Writers change the list of addresses and publish() builds new open addressing
+ *          tables which replace the current ones atomically. Every lookup occupies a reader
+ *          slot with the epoch it started in (see ReadGuard). Each replacement starts a new
+ *          epoch and a replaced table is freed by a later publish() once no slot holds an epoch
+ *          older than its replacement.
+ */
+class LocalAddresses
+{
+    /*!
+     * @brief   Open addressing hash tables, zero address marks an empty slot
+     */
+    struct Table
+    {
+        std::vector<uint32_t> slots4;   //!< IPv4 addresses, size is a power of two
+        std::vector<ip6_addr> slots6;   //!< IPv6 addresses, size is a power of two
+        unsigned int shift4 = 32;       //!< 32 - log2(slots4.size())
+        unsigned int shift6 = 32;       //!< 32 - log2(slots6.size())
+    };
+    /*!
+     * @brief   Replaced table and the epoch which started with its replacement
+     */
+    struct Retired
+    {
+        std::unique_ptr<Table> table;   //!< The table
+        uint64_t epoch;                 //!< Readers which started in this epoch or later don't use it
+    };
+    /*!
+     * @brief   Epoch in which a reader started its lookup, zero if the slot is free
+     * @details A slot per cache line, readers don't share lines.
+     */
+    struct alignas(64) ReaderSlot
+    {
+        std::atomic<uint64_t> epoch{ 0 };
+    };
+    /*!
+     * @brief   Occupies a reader slot for one lookup, publish() doesn't free tables the lookup may use
+     * @details The epoch is read before the slot is occupied and the tables after it, so a reader
+     *          either shows up in the slots before publish() checks them or uses the new tables.
+     */
+    class ReadGuard
+    {
+        std::atomic<uint64_t> *slot;    //!< Occupied slot
+    public:
+        explicit ReadGuard(const LocalAddresses &a)
+        {
+            static thread_local unsigned int hint = 0;     // slot this thread got the last time
+            const uint64_t e = a.epoch.load(std::memory_order_seq_cst);
+            for (unsigned int i = hint; ; i = (i + 1) % ADDRESS_READERS)
+            {
+                uint64_t free = 0;
+                if (a.readers[i].epoch.compare_exchange_strong(free, e, std::memory_order_seq_cst))
+                {
+                    slot = &a.readers[i].epoch;
+                    hint = i;
+                    return;
+                }
+            }
+        }
+        ~ReadGuard()                    { slot->store(0, std::memory_order_release); }
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard & operator=(const ReadGuard &) = delete;
+    };
+    //! @brief  Tables used by readers
+    std::atomic<const Table *> current{ nullptr };
+    //! @brief  Owner of the current tables
+    std::unique_ptr<Table> published;
+    //! @brief  Replaced tables which readers may still use, the oldest first
+    std::deque<Retired> retired;
+    //! @brief  Current epoch, incremented when the tables are replaced
+    std::atomic<uint64_t> epoch{ 1 };
+    //! @brief  Epochs of running lookups
+    mutable std::array<ReaderSlot, ADDRESS_READERS> readers;
+    //! @brief  IPv4 addresses which will be in the next table
+    std::vector<uint32_t> addresses4;
+    //! @brief  IPv6 addresses which will be in the next table
+    std::vector<ip6_addr> addresses6;
+    //! @brief  True if the address lists changed since the last publish()
+    bool changed = true;
+    //! @brief  Mutex used to lock the address lists and the tables
+    std::mutex m_update;
+
+    /*!
+     * @brief   Returns index of the first slot where the address can be stored
+     * @details Multiplicative hashing, the upper bits of the product depend on all bits of the address.
+     */
+    static size_t hash(uint32_t a, unsigned int shift)
+    {
+        return (uint32_t)(a * 0x9e3779b1u) >> shift;
+    }
+    static size_t hash(const ip6_addr &a, unsigned int shift)
+    {
+        return hash(a.addr.addr32[0] ^ a.addr.addr32[1] ^ a.addr.addr32[2] ^ a.addr.addr32[3], shift);
+    }
+    /*!
+     * @brief   Compares two IPv6 addresses
+     */
+    static bool same(const ip6_addr &a, const ip6_addr &b)
+    {
+        return ((a.addr.addr32[0] ^ b.addr.addr32[0]) | (a.addr.addr32[1] ^ b.addr.addr32[1])
+            | (a.addr.addr32[2] ^ b.addr.addr32[2]) | (a.addr.addr32[3] ^ b.addr.addr32[3])) == 0;
+    }
+public:
+    /*!
+     * @brief       Adds an address, it is used after publish()
+     * @param[in]   ip          IPv4 or IPv6 address in network order
+     * @param[in]   ipVersion   4 or 6
+     */
+    void add(const void *ip, unsigned int ipVersion);
+    /*!
+     * @brief       Removes an address, it is used after publish()
+     * @param[in]   ip          IPv4 or IPv6 address in network order
+     * @param[in]   ipVersion   4 or 6
+     */
+    void remove(const void *ip, unsigned int ipVersion);
+    /*!
+     * @brief   Builds new tables from added addresses and makes readers use them
+     * @return  False if the addresses didn't change since the last call and nothing was published
+     */
+    bool publish();
+    /*!
+     * @brief       Copies all added addresses
+     * @param[out]  ips4    IPv4 addresses in network order
+     * @param[out]  ips6    IPv6 addresses in network order
+     */
+    void list(std::vector<uint32_t> &ips4, std::vector<ip6_addr> &ips6);
+    /*!
+     * @return  True if no table was published or there are no addresses
+     */
+    bool empty() const
+    {
+        ReadGuard guard(*this);
+        const Table *t = current.load(std::memory_order_seq_cst);
+        return t == nullptr || (t->slots4.empty() && t->slots6.empty());
+    }
+    /*!
+     * @brief       Checks if the IPv4 address is local
+     * @param[in]   ip  IPv4 address in network order
+     */
+    bool contains4(const void *ip) const
+    {
+        ReadGuard guard(*this);
+        const Table *t = current.load(std::memory_order_seq_cst);
+        if (t == nullptr || t->slots4.empty())
+            return false;
+        uint32_t a;
+        memcpy(&a, ip, IPv4_ADDRLEN);
+        const uint32_t *slots = t->slots4.data();
+        const size_t mask = t->slots4.size() - 1;
+        for (size_t i = hash(a, t->shift4); ; i = (i + 1) & mask)
+        {
+            if (slots[i] == a)
+                return a != 0;
+            if (slots[i] == 0)
+                return false;
+        }
+    }
+    /*!
+     * @brief       Checks more IPv4 addresses at once
+     * @details     Slots of all addresses are computed first (8 at once with AVX2), then probed.
+     * @param[in]   ips     IPv4 addresses in network order
+     * @param[in]   count   Number of addresses
+     * @param[out]  found   One for local addresses, zero otherwise
+     * @param[in]   simd    Instructions used to compute the slots
+     */
+    void contains4(const uint32_t *ips, unsigned int count, uint8_t *found, SimdLevel simd) const;
+    /*!
+     * @brief       Checks if the IPv6 address is local
+     * @param[in]   ip  IPv6 address in network order
+     */
+    bool contains6(const void *ip) const
+    {
+        ReadGuard guard(*this);
+        const Table *t = current.load(std::memory_order_seq_cst);
+        if (t == nullptr || t->slots6.empty())
+            return false;
+        ip6_addr a;
+        memcpy(&a, ip, IPv6_ADDRLEN);
+        const ip6_addr *slots = t->slots6.data();
+        const size_t mask = t->slots6.size() - 1;
+        for (size_t i = hash(a, t->shift6); ; i = (i + 1) & mask)
+        {
+            if (same(slots[i], a))
+                return true;
+            if ((slots[i].addr.addr32[0] | slots[i].addr.addr32[1] | slots[i].addr.addr32[2] | slots[i].addr.addr32[3]) == 0)
+                return false;
+        }
+    }
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,233 @@
+/**
+ *  @file       lz4Block.cpp
+ *  @brief      LZ4 block compression source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#include <algorithm>            //  fill()
+#include <cstring>              //  memcpy()
+#if defined(_MSC_VER)
+#include <intrin.h>             //  _BitScanForward64()
+#endif
+
+#include "lz4Block.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+const size_t    MIN_MATCH       = 4;        //!< The shortest match
+const size_t    LAST_LITERALS   = 5;        //!< The last bytes are always literals
+const size_t    MF_LIMIT        = 12;       //!< The last match starts at least this far from the end
+const size_t    MAX_DISTANCE    = 65535;    //!< The farthest match
+const unsigned  SKIP_TRIGGER    = 6;        //!< Without a match for 2^n positions the compressor skips faster
+const size_t    WILD_COPY       = 16;       //!< Literals up to this long are copied at once by the decompressor
+
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+
+static inline uint32_t hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - LZ4_HASH_LOG);
+}
+
+
+/*!
+ * @return  Number of equal bytes at p and ref, p doesn't go past limit
+ */
+static inline size_t matchLength(const uint8_t *p, const uint8_t *ref, const uint8_t *limit)
+{
+    const uint8_t *start = p;
+    while (p + sizeof(uint64_t) <= limit)
+    {
+        uint64_t a, b;
+        memcpy(&a, p, sizeof(a));
+        memcpy(&b, ref, sizeof(b));
+        if (a != b)
+        {   // little endian, the first different byte is the lowest one
+#if defined(_MSC_VER)
+            unsigned long bit;
+            _BitScanForward64(&bit, a ^ b);
+            return p - start + bit / 8;
+#else
+            return p - start + __builtin_ctzll(a ^ b) / 8;
+#endif
+        }
+        p += sizeof(uint64_t);
+        ref += sizeof(uint64_t);
+    }
+    while (p < limit && *p == *ref)
+    {
+        p++;
+        ref++;
+    }
+    return p - start;
+}
+
+
+/*!
+ * @brief   Writes a length which doesn't fit into the token
+ */
+static inline uint8_t *writeLength(uint8_t *op, size_t len)
+{
+    while (len >= 255)
+    {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+
+/*!
+ * @brief   Writes the literals and the match (if offset isn't 0)
+ */
+static inline uint8_t *writeSequence(uint8_t *op, const uint8_t *literals, size_t litLen, size_t offset, size_t matchLen)
+{
+    uint8_t *token = op++;
+    if (litLen >= 15)
+    {
+        *token = 15 << 4;
+        op = writeLength(op, litLen - 15);
+    }
+    else
+        *token = (uint8_t)(litLen << 4);
+    memcpy(op, literals, litLen);
+    op += litLen;
+    if (offset == 0)
+        return op;
+    op[0] = (uint8_t)offset;
+    op[1] = (uint8_t)(offset >> 8);
+    op += 2;
+    matchLen -= MIN_MATCH;
+    if (matchLen >= 15)
+    {
+        *token |= 15;
+        op = writeLength(op, matchLen - 15);
+    }
+    else
+        *token |= (uint8_t)matchLen;
+    return op;
+}
+
+
+size_t Lz4Compressor::compress(const char *source, size_t len, char *dest)
+{
+    const uint8_t *src = reinterpret_cast<const uint8_t *>(source);
+    uint8_t *op = reinterpret_cast<uint8_t *>(dest);
+    const uint8_t *anchor = src;
+    if (len > MF_LIMIT)
+    {
+        std::fill(table.begin(), table.end(), 0);
+        const uint8_t *ip = src + 1;
+        const uint8_t *mfLimit = src + len - MF_LIMIT;
+        const uint8_t *matchLimit = src + len - LAST_LITERALS;
+        unsigned int misses = 1 << SKIP_TRIGGER;
+        while (ip < mfLimit)
+        {
+            const uint32_t sequence = read32(ip);
+            uint32_t &slot = table[hash(sequence)];
+            const uint8_t *ref = src + slot;
+            slot = (uint32_t)(ip - src);
+            if (ip - ref > (ptrdiff_t)MAX_DISTANCE || ref >= ip || read32(ref) != sequence)
+            {
+                ip += misses++ >> SKIP_TRIGGER;
+                continue;
+            }
+            misses = 1 << SKIP_TRIGGER;
+            while (ip > anchor && ref > src && ip[-1] == ref[-1])
+            {
+                ip--;
+                ref--;
+            }
+            const size_t matchLen = MIN_MATCH + matchLength(ip + MIN_MATCH, ref + MIN_MATCH, matchLimit);
+            op = writeSequence(op, anchor, ip - anchor, ip - ref, matchLen);
+            ip += matchLen;
+            anchor = ip;
+            if (ip < mfLimit)
+                table[hash(read32(ip - 2))] = (uint32_t)(ip - 2 - src);
+        }
+    }
+    op = writeSequence(op, anchor, src + len - anchor, 0, 0);
+    return op - reinterpret_cast<uint8_t *>(dest);
+}
+
+
+long lz4Decompress(const char *source, size_t len, char *dest, size_t capacity)
+{
+    const uint8_t *ip = reinterpret_cast<const uint8_t *>(source);
+    const uint8_t *iend = ip + len;
+    uint8_t *dst = reinterpret_cast<uint8_t *>(dest);
+    uint8_t *op = dst;
+    uint8_t *oend = dst + capacity;
+    // Reads a length which didn't fit into the token
+    auto readLength = [&ip, iend](size_t &l) {
+        uint8_t b;
+        do
+        {
+            if (ip >= iend)
+                return false;
+            b = *ip++;
+            l += b;
+        } while (b == 255);
+        return true;
+    };
+
+    while (ip < iend)
+    {
+        const uint8_t token = *ip++;
+        size_t litLen = token >> 4;
+        if (litLen == 15 && !readLength(litLen))
+            return -1;
+        if ((size_t)(iend - ip) < litLen || (size_t)(oend - op) < litLen)
+            return -1;
+        if (litLen <= WILD_COPY && iend - ip >= (ptrdiff_t)WILD_COPY && oend - op >= (ptrdiff_t)WILD_COPY)
+            memcpy(op, ip, WILD_COPY);  // short literals, a fixed size copy is faster
+        else
+            memcpy(op, ip, litLen);
+        ip += litLen;
+        op += litLen;
+        if (ip == iend)     // the last sequence has only literals
+            break;
+
+        if (iend - ip < 2)
+            return -1;
+        const size_t offset = ip[0] | (size_t)ip[1] << 8;
+        ip += 2;
+        size_t matchLen = token & 15;
+        if (matchLen == 15 && !readLength(matchLen))
+            return -1;
+        matchLen += MIN_MATCH;
+        if (offset == 0 || offset > (size_t)(op - dst) || (size_t)(oend - op) < matchLen)
+            return -1;
+        const uint8_t *match = op - offset;
+        if (offset >= sizeof(uint64_t) && (size_t)(oend - op) >= matchLen + sizeof(uint64_t))
+        {   // 8 bytes at once, the copy can't overtake the match even if they overlap
+            for (size_t i = 0; i < matchLen; i += sizeof(uint64_t))
+                memcpy(op + i, match + i, sizeof(uint64_t));
+        }
+        else
+        {   // the match repeats the bytes it is copying
+            for (size_t i = 0; i < matchLen; i++)
+                op[i] = match[i];
+        }
+        op += matchLen;
+    }
+    return op - dst;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,67 @@
+/**
+ *  @file       lz4Block.hpp
+ *  @brief      LZ4 block compression header file
+ *  @details    A small implementation of the LZ4 block format (sequences of literals and
+ *              matches within the last 64 KiB), which any LZ4 block decoder reads. The
+ *              compressor is the greedy one with a single hash table of 4-byte sequences and
+ *              it skips faster through data which doesn't compress, as the reference one does.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#pragma once
+
+#include <cstddef>              //  size_t
+#include <cstdint>              //  uint32_t
+#include <vector>               //  vector
+
+
+
+
+namespace NAMON
+{
+
+
+const unsigned int  LZ4_HASH_LOG    = 14;   //!< Bits of the hash of 4-byte sequences
+
+
+/*!
+ * @return  The largest compressed size of n bytes
+ */
+inline size_t lz4Bound(size_t n)            { return n + n / 255 + 16; }
+
+
+/*!
+ * @class   Lz4Compressor
+ * @brief   Compressor of independent blocks, it keeps its table between them
+ */
+class Lz4Compressor
+{
+    std::vector<uint32_t> table;                //!< Last positions of hashed sequences
+public:
+    Lz4Compressor() : table(1 << LZ4_HASH_LOG)  { }
+    /*!
+     * @brief       Compresses the data into one block
+     * @param[in]   src     The data, less than 2 GiB
+     * @param[in]   len     Length of the data
+     * @param[out]  dst     The block, at least lz4Bound(len) bytes
+     * @return      Length of the block
+     */
+    size_t compress(const char *src, size_t len, char *dst);
+};
+
+
+/*!
+ * @brief       Decompresses one block
+ * @param[in]   src     The block
+ * @param[in]   len     Length of the block
+ * @param[out]  dst     The data
+ * @param[in]   capacity    Size of dst
+ * @return      Length of the data, -1 if the block is broken or the data doesn't fit
+ */
+long lz4Decompress(const char *src, size_t len, char *dst, size_t capacity);
+
+
+}	// namespace NAMON
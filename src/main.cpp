@@ -6,7 +6,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 18.02.2017 08:03
- *   - Edited:  23.06.2017 12:02
+ *   - Edited:  20.10.2026 06:40
  *  @version:    1.0.0
  */
 
@@ -20,24 +20,85 @@ extern "C" {
 #include <getopt.h>             //  getopt_long()
 #endif
 
+#if defined(__linux__)
+#include "namon_linux.hpp"      //  setProcfsRoot()
+#endif
+
 #include "capturing.hpp"        //  startCapture()
+#include "streamOutput.hpp"     //  isStreamOutput()
+#include "cache.hpp"            //  setValidTime()
 #include "debug.hpp"            //  D(), log(), setLogLevel()
+#include "utils.hpp"            //  chToInt()
 #include "main.hpp"
 
 
 
-extern const char * g_dev;
+extern bool g_flowOnly;
 
 
 extern "C" const char * program_name = nullptr;     //<! Name of the program used in the pcap-ng file
 
+//! @brief  Values returned by getopt_long() for options without a short variant
+enum LongOnlyOpts {
+    OPT_PROCFS_ROOT = 256,  //!< --procfs-root
+    OPT_STORE_POLICY,       //!< --store-policy
+    OPT_FLOW_POLICY,        //!< --flow-policy
+    OPT_PREFILTER,          //!< --prefilter
+    OPT_FILTER,             //!< --filter
+    OPT_APP,                //!< --app
+    OPT_SLICE,              //!< --slice
+    OPT_TSTAMP_TYPE,        //!< --tstamp-type
+    OPT_IPV4_ONLY,          //!< --ipv4-only
+    OPT_NO_UDPLITE,         //!< --no-udplite
+    OPT_BATCH,              //!< --batch
+    OPT_PRESCAN,            //!< --prescan
+    OPT_CACHE_SNAPSHOT,     //!< --cache-snapshot
+    OPT_CACHE_TTL,          //!< --cache-ttl
+    OPT_LEGACY_MAPPING,     //!< --legacy-mapping
+    OPT_ANNOTATE,           //!< --annotate
+    OPT_SPLIT,              //!< --split
+    OPT_SPLIT_APP,          //!< --split-app
+    OPT_IPFIX,              //!< --ipfix
+    OPT_IPFIX_ACTIVE,       //!< --ipfix-active
+    OPT_SHM,                //!< --shm
+    OPT_SHM_SIZE,           //!< --shm-size
+    OPT_COMPRESS,           //!< --compress
+};
+
 //! @brief  Struct with long options
 static const struct option longopts[] = 
 {
     { "interface",   required_argument, nullptr,    'i' },
     { "output-file", required_argument, nullptr,    'w' },
+    { "flow-only",   no_argument,       nullptr,    'f' },
+    { "snaplen",     required_argument, nullptr,    's' },
     { "verbosity",   optional_argument, nullptr,    'v' },
     { "help",        no_argument,       nullptr,    'h' },
+    { "store-policy", required_argument, nullptr,   OPT_STORE_POLICY },
+    { "flow-policy", required_argument, nullptr,    OPT_FLOW_POLICY },
+    { "prefilter",   no_argument,       nullptr,    OPT_PREFILTER },
+    { "filter",      required_argument, nullptr,    OPT_FILTER },
+    { "app",         required_argument, nullptr,    OPT_APP },
+    { "slice",       required_argument, nullptr,    OPT_SLICE },
+    { "tstamp-type", required_argument, nullptr,    OPT_TSTAMP_TYPE },
+    { "ipv4-only",   no_argument,       nullptr,    OPT_IPV4_ONLY },
+    { "no-udplite",  no_argument,       nullptr,    OPT_NO_UDPLITE },
+    { "batch",       required_argument, nullptr,    OPT_BATCH },
+    { "cache-ttl",   required_argument, nullptr,    OPT_CACHE_TTL },
+    { "legacy-mapping", no_argument,    nullptr,    OPT_LEGACY_MAPPING },
+    { "annotate",    required_argument, nullptr,    OPT_ANNOTATE },
+    { "split",       required_argument, nullptr,    OPT_SPLIT },
+    { "split-app",   required_argument, nullptr,    OPT_SPLIT_APP },
+    { "ipfix",       required_argument, nullptr,    OPT_IPFIX },
+    { "ipfix-active", required_argument, nullptr,   OPT_IPFIX_ACTIVE },
+    { "shm",         required_argument, nullptr,    OPT_SHM },
+    { "shm-size",    required_argument, nullptr,    OPT_SHM_SIZE },
+    { "compress",    no_argument,       nullptr,    OPT_COMPRESS },
+#if defined(__linux__)
+    { "procfs-root", required_argument, nullptr,    OPT_PROCFS_ROOT },
+    { "prescan",     no_argument,       nullptr,    OPT_PRESCAN },
+    { "cache-snapshot", required_argument, nullptr, OPT_CACHE_SNAPSHOT },
+#endif
     { nullptr,       0,                 nullptr,     0  }
 };
 
@@ -48,25 +109,172 @@ int main (int argc, char *argv[])
     char const *oFilename = "namon_capturedTraffic.pcapng";
 
     int optionIndex = 0;
-    char opt = 0;
+    int opt = 0;
 	char *cp = nullptr;
 	if ((cp = strrchr(argv[0], '/')) != nullptr)
 		program_name = cp + 1;
 	else
 		program_name = argv[0];
 
-    while((opt = getopt_long(argc, argv, "i:w:v::h", longopts, &optionIndex)) != -1)
+    while((opt = getopt_long(argc, argv, "i:w:fs:v::h", longopts, &optionIndex)) != -1)
     {
         switch (opt)
         {
             case 0:                          break;
-            case 'i':   g_dev = optarg;      break;
+            case 'i':   g_devs.push_back(optarg);   break;
             case 'w':   oFilename = optarg;  break;
+            case 'f':   g_flowOnly = true;   break;
+            case 's':
+                if (NAMON::chToInt(optarg, g_snaplen) || g_snaplen <= 0)
+                {
+                    cerr << "ERROR: Invalid snaplen '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                break;
 			case 'v':   NAMON::setLogLevel(optarg); break;
             case 'h':   printUsage();   return EXIT_SUCCESS;
+            case OPT_PREFILTER: g_prefilter = true;     break;
+            case OPT_FILTER:    g_filterExpr = optarg;  break;
+            case OPT_APP:
+                if (*optarg == '\0')
+                {
+                    cerr << "ERROR: Invalid application pattern '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_appPattern = optarg;
+                break;
+            case OPT_TSTAMP_TYPE:   g_tstampType = optarg;  break;
+            case OPT_IPV4_ONLY:     g_parseIpv6 = false;    break;
+            case OPT_NO_UDPLITE:    g_parseUdplite = false; break;
+            case OPT_BATCH:
+            {
+                int n = 0;
+                if (NAMON::chToInt(optarg, n) || n <= 0 || n > (int)NAMON::MAX_BATCH_SIZE)
+                {
+                    cerr << "ERROR: Invalid batch size '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_batchSize = n;
+                break;
+            }
+            case OPT_SLICE:
+                if (g_storagePolicy.addSlice(optarg))
+                {
+                    cerr << "ERROR: Invalid slice '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_LEGACY_MAPPING:    g_legacyMapping = true;     break;
+            case OPT_COMPRESS:          g_compress = true;          break;
+            case OPT_ANNOTATE:
+            {
+                int ms = 0;
+                if (NAMON::chToInt(optarg, ms) || ms < 0)
+                {
+                    cerr << "ERROR: Invalid annotation delay '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_annotate = true;
+                g_annotateDelay = ms;
+                break;
+            }
+            case OPT_SPLIT:
+            {
+                int ms = 0;
+                if (NAMON::chToInt(optarg, ms) || ms < 0)
+                {
+                    cerr << "ERROR: Invalid split delay '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_split = true;
+                g_splitDelay = ms;
+                break;
+            }
+            case OPT_SPLIT_APP:
+            {
+                NAMON::SplitRule r;
+                if (NAMON::parseSplitRule(optarg, r))
+                {
+                    cerr << "ERROR: Invalid split rule '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_split = true;
+                g_splitRules.push_back(r);
+                break;
+            }
+            case OPT_IPFIX:
+                if (NAMON::parseIpfixCollector(optarg, g_ipfixCollector))
+                {
+                    cerr << "ERROR: Invalid IPFIX collector '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_ipfix = true;
+                break;
+            case OPT_IPFIX_ACTIVE:
+            {
+                int s = 0;
+                if (NAMON::chToInt(optarg, s) || s <= 0)
+                {
+                    cerr << "ERROR: Invalid IPFIX active timeout '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_ipfixActive = s;
+                break;
+            }
+            case OPT_SHM:
+                if (*optarg == '\0' || strchr(optarg, '/') != nullptr)
+                {
+                    cerr << "ERROR: Invalid shared memory name '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_shmName = optarg;
+                break;
+            case OPT_SHM_SIZE:
+            {
+                int mib = 0;
+                if (NAMON::chToInt(optarg, mib) || mib <= 0 || mib > 65536)
+                {
+                    cerr << "ERROR: Invalid shared memory size '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                g_shmSize = mib;
+                break;
+            }
+            case OPT_CACHE_TTL:
+                if (NAMON::setValidTime(optarg))
+                {
+                    cerr << "ERROR: Invalid cache TTL '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_STORE_POLICY:
+                if (NAMON::parseStagePolicy(optarg, g_filePolicy, true))
+                {
+                    cerr << "ERROR: Invalid store policy '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                break;
+            case OPT_FLOW_POLICY:
+                if (NAMON::parseStagePolicy(optarg, g_cachePolicy, false))
+                {
+                    cerr << "ERROR: Invalid flow policy '" << optarg << "'." << endl;
+                    return EXIT_FAILURE;
+                }
+                break;
+#if defined(__linux__)
+            case OPT_PROCFS_ROOT:   NAMON::setProcfsRoot(optarg);   break;
+            case OPT_PRESCAN:       g_prescan = true;               break;
+            case OPT_CACHE_SNAPSHOT: g_cacheSnapshot = optarg;      break;
+#endif
             default:    printUsage();   return EXIT_FAILURE;
         }
     }
+    // names of the split files are made from the output file name
+    if (g_split && NAMON::isStreamOutput(oFilename))
+    {
+        cerr << "ERROR: --split and --split-app need an output file, not a stream." << endl;
+        return EXIT_FAILURE;
+    }
 
     return startCapture(oFilename);
 }
@@ -74,10 +282,41 @@ int main (int argc, char *argv[])
 
 void printUsage()
 {
-    cout << "Usage: namon [-v[<level>]] [-i <interface>] [-w <output_filename>]" << endl;
+    cout << "Usage: namon [-v[<level>]] [-i <interface>]... [-w <output_filename>] [-f] [-s <snaplen>]" << endl;
     cout << "\t-v\tVerbosity level. Possible values are 0-3." << endl;
-    cout << "\t-i\tCapturing interface." << endl;
-    cout << "\t-w\tOutput file." << endl;
+    cout << "\t-i\tCapturing interface. It can be used more times to capture on more interfaces." << endl;
+    cout << "\t-w\tOutput file, - for the standard output. A FIFO or the standard output is written in batches, e.g. -w - | wireshark -k -i -" << endl;
+    cout << "\t-f\tFlow-only mode. Packets are not stored, only netflows and their applications." << endl;
+    cout << "\t-s\tSnapshot length, the number of bytes captured from every packet." << endl;
     cout << "\t-h\tPrints this message." << endl;
+    cout << "\t--prefilter\tOnly packets which can be assigned to an application are captured (always used with -f)." << endl;
+    cout << "\t--ipv4-only\tIPv6 packets are not parsed (nor captured with --prefilter)." << endl;
+    cout << "\t--no-udplite\tUDP-Lite packets are not parsed (nor captured with --prefilter)." << endl;
+    cout << "\t--batch <n>\tPackets are classified in batches of n (1-64, 16-64 recommended), packets of the same flow are merged." << endl;
+    cout << "\t--filter <expr>\tCapture only packets matching the pcap-filter expression." << endl;
+    cout << "\t--app <pattern>\tStore only packets of applications whose command line or executable contains pattern." << endl;
+    cout << "\t--tstamp-type <type>\tTime stamp type, e.g. adapter or host_hiprec (see pcap-tstamp(7))." << endl;
+    cout << "\t--slice [<tcp|udp|udplite>:]<n>[/<k>]\tStore first n packets and k bytes of every flow in full, then headers only." << endl;
+    cout << "\t--annotate <ms>\tStored packets get an option with the ID of their application, they wait for it up to ms milliseconds. Not with a stream output." << endl;
+    cout << "\t--split <ms>\tStored packets are written into a file of their application, they wait for it up to ms milliseconds." << endl;
+    cout << "\t--split-app <file>:<pattern>\tPackets of applications containing pattern go to file, other ones stay in the output file (implies --split " << NAMON::DEFAULT_SPLIT_DELAY << ")." << endl;
+    cout << "\t--ipfix [udp:|tcp:]<host>[:<port>]\tNetflows and their applications are exported to the IPFIX collector (default UDP port " << NAMON::IPFIX_PORT << ")." << endl;
+    cout << "\t--ipfix-active <s>\tNetflows active for s seconds are exported without waiting for their end (default " << NAMON::DEFAULT_IPFIX_ACTIVE << ")." << endl;
+    cout << "\t--shm <name>\tStored packets with their applications are streamed live to the shared memory ring /dev/shm/<name>." << endl;
+    cout << "\t--shm-size <MiB>\tSize of the shared memory ring (default " << NAMON::DEFAULT_SHM_SIZE << ")." << endl;
+    cout << "\t--compress\tThe output file is compressed by LZ4 in independent frames with an index, namon_unpack decompresses it." << endl;
+    cout << "\t--legacy-mapping\tThe block with applications and their netflows is written record by record, as by older versions." << endl;
+    cout << "\t--cache-ttl [<tcp|udp|udplite>:]<s>\tApplications of flows are checked after s seconds without a check (default 3)." << endl;
+    cout << "\t--store-policy <policy>\tWhat to do when the output file can't keep up (default drop):" << endl;
+    cout << "\t\tdrop\t\tPackets are dropped when the buffer is full." << endl;
+    cout << "\t\tsample[:<n>]\tAbove 3/4 of the buffer only every n-th packet is stored (default 10)." << endl;
+    cout << "\t\ttruncate[:<n>]\tAbove 3/4 of the buffer packets are truncated to n bytes (default 128)." << endl;
+    cout << "\t\tspill[:<n>]\tUp to n packets are kept in memory when the buffer is full (default 20000)." << endl;
+    cout << "\t--flow-policy <policy>\tThe same for netflows waiting for the cache, truncate is not supported." << endl;
+#if defined(__linux__)
+    cout << "\t--procfs-root <dir>\tProcfs used to find sockets and applications (default /proc)." << endl;
+    cout << "\t--prescan\tSockets of all processes are loaded into the cache before capturing starts." << endl;
+    cout << "\t--cache-snapshot <file>\tThe cache is loaded from the file at start and saved into it every minute and at the end." << endl;
+#endif
     cout << "Note: 'namon_capturedTraffic.pcapng' is used as default filename" << endl; // TODO zmenit nazov suboru
 }
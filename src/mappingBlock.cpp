@@ -0,0 +1,474 @@
+/**
+ *  @file       mappingBlock.cpp
+ *  @brief      Columnar encoding of netflows and their applications source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 22:40
+ *   - Edited:  20.10.2026 05:20
+ */
+
+#include <cstring>              //  memcpy(), memset()
+#include <unordered_map>        //  unordered_map
+#include <utility>              //  pair
+#include <functional>           //  hash, greater
+#include <queue>                //  priority_queue
+
+#include "netflow.hpp"          //  Netflow
+#include "mappingBlock.hpp"
+
+#if defined(NAMON_X86_SIMD)
+#include <immintrin.h>          //  _mm_shuffle_epi8()
+#endif
+
+
+
+
+namespace NAMON
+{
+
+
+static_assert(sizeof(MappingHeader) == 24, "unexpected padding of MappingHeader");
+
+
+//! Data bytes of a value of the 2-bit class, upper 4 bytes of the last one are after all data bytes
+const unsigned int VARINT_WIDTH[4] = { 1, 2, 4, 4 };
+
+
+/*!
+ * @return  Bytes per index of a dictionary with n values
+ */
+static uint8_t indexWidth(size_t n)
+{
+    return (n <= 0x100) ? 1 : (n <= 0x10000) ? 2 : 4;
+}
+
+
+/*!
+ * @brief   Appends a value of the given width (1, 2, 4 or 8 bytes) in host order
+ */
+static void putValue(std::string &out, uint64_t v, unsigned int width)
+{
+    char buf[8];
+    switch (width)
+    {
+        case 1: { const uint8_t  x = v; memcpy(buf, &x, 1); break; }
+        case 2: { const uint16_t x = v; memcpy(buf, &x, 2); break; }
+        case 4: { const uint32_t x = v; memcpy(buf, &x, 4); break; }
+        default: memcpy(buf, &v, 8); width = 8;
+    }
+    out.append(buf, width);
+}
+
+
+/*!
+ * @brief   Reads a value of the given width (1, 2, 4 or 8 bytes) in host order
+ */
+static uint64_t getValue(const char *p, unsigned int width)
+{
+    switch (width)
+    {
+        case 1: { uint8_t  x; memcpy(&x, p, 1); return x; }
+        case 2: { uint16_t x; memcpy(&x, p, 2); return x; }
+        case 4: { uint32_t x; memcpy(&x, p, 4); return x; }
+        default: { uint64_t x; memcpy(&x, p, 8); return x; }
+    }
+}
+
+
+/*!
+ * @brief   Column of values in the stream VByte layout built value by value
+ * @details Control bytes and data bytes are kept apart until the column is appended.
+ */
+class VarintColumn
+{
+    std::string ctrl;           //!< Control bytes with 2-bit classes of 4 values
+    std::string data;           //!< Data bytes
+    std::string high;           //!< Upper 4 bytes of values over 32 bits
+    size_t n = 0;               //!< Number of values
+public:
+    /*!
+     * @brief   Reserves space for count values of 2 bytes
+     */
+    void reserve(size_t count)
+    {
+        ctrl.reserve((count + 3) / 4);
+        data.reserve(2 * count);
+    }
+    /*!
+     * @brief   Adds the next value
+     */
+    void put(uint64_t v)
+    {
+        const unsigned int code = (v <= 0xff) ? 0 : (v <= 0xffff) ? 1 : (v <= 0xffffffff) ? 2 : 3;
+        if (n % 4 == 0)
+            ctrl.push_back('\0');
+        ctrl.back() = (char)(ctrl.back() | (code << (2 * (n % 4))));
+        putValue(data, v, VARINT_WIDTH[code]);
+        if (code == 3)
+            putValue(high, v >> 32, 4);
+        n++;
+    }
+    /*!
+     * @brief   Appends the control bytes, the data bytes and the upper bytes
+     */
+    void appendTo(std::string &out) const
+    {
+        out.append(ctrl);
+        out.append(data);
+        out.append(high);
+    }
+};
+
+
+/*!
+ * @brief   Shuffles and lengths of groups of 4 values of every control byte
+ */
+struct VarintTable
+{
+    uint8_t shuffle[256][16];   //!< Moves data bytes of the group into 4 32-bit lanes
+    uint8_t length[256];        //!< Data bytes of the group
+    uint8_t wide[256];          //!< Values of the group over 32 bits
+    VarintTable()
+    {
+        for (unsigned int c = 0; c < 256; c++)
+        {
+            unsigned int offset = 0;
+            wide[c] = 0;
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                const unsigned int code = (c >> (2 * j)) & 3;
+                for (unsigned int b = 0; b < 4; b++)
+                    shuffle[c][4 * j + b] = (b < VARINT_WIDTH[code]) ? offset + b : 0x80;
+                offset += VARINT_WIDTH[code];
+                wide[c] += (code == 3);
+            }
+            length[c] = offset;
+        }
+    }
+};
+
+
+#if defined(NAMON_X86_SIMD)
+/*!
+ * @brief       Decodes whole groups of 4 values with a byte shuffle while 16 bytes can be loaded
+ * @details     The load may read bytes after the column, the shuffle drops them.
+ * @param[in]   data    Data bytes of the first group, it is moved after the decoded groups
+ * @param[in]   high    Upper bytes of the first value over 32 bits, it is moved as well
+ * @return      Number of decoded groups
+ */
+__attribute__((target("ssse3")))
+static size_t getVarintsSsse3(const VarintTable &table, const uint8_t *ctrl, size_t groups,
+                              const char *&data, const char *&high, const char *end, uint64_t *values)
+{
+    const __m128i zero = _mm_setzero_si128();
+    size_t g = 0;
+    for (; g < groups && end - data >= 16; g++, values += 4)
+    {
+        const uint8_t c = ctrl[g];
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data));
+        const __m128i lanes = _mm_shuffle_epi8(in, _mm_loadu_si128(reinterpret_cast<const __m128i *>(table.shuffle[c])));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values), _mm_unpacklo_epi32(lanes, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(values + 2), _mm_unpackhi_epi32(lanes, zero));
+        data += table.length[c];
+        if (table.wide[c] != 0)
+            for (unsigned int j = 0; j < 4; j++)
+                if (((c >> (2 * j)) & 3) == 3)
+                {
+                    values[j] |= getValue(high, 4) << 32;
+                    high += 4;
+                }
+    }
+    return g;
+}
+#endif
+
+
+/*!
+ * @brief       Reads n values in the stream VByte layout
+ * @details     Lengths of all values are summed from the control bytes first, so the column is
+ *              checked once and values are decoded without checks, 4 at once with SSSE3.
+ * @param[in]   p       Position of the control bytes, it is moved after the upper bytes
+ * @param[in]   simd    The shuffle is used from #NAMON::SimdLevel::SSE42
+ * @return      False if the values don't fit into the buffer
+ */
+static bool getVarints(const char *&p, const char *end, size_t n, uint64_t *values, SimdLevel simd)
+{
+    static const VarintTable table;
+    const size_t ctrlLen = (n + 3) / 4;
+    if ((size_t)(end - p) < ctrlLen)
+        return false;
+    const uint8_t *ctrl = reinterpret_cast<const uint8_t *>(p);
+    // unused classes of the last control byte are zero, they aren't counted
+    const size_t groups = n / 4;
+    size_t dataLen = 0, wide = 0;
+    for (size_t g = 0; g < groups; g++)
+    {
+        dataLen += table.length[ctrl[g]];
+        wide += table.wide[ctrl[g]];
+    }
+    for (size_t i = groups * 4; i < n; i++)
+    {
+        const unsigned int code = (ctrl[i / 4] >> (2 * (i % 4))) & 3;
+        dataLen += VARINT_WIDTH[code];
+        wide += (code == 3);
+    }
+    const char *data = p + ctrlLen;
+    if ((size_t)(end - data) < dataLen + 4 * wide)
+        return false;
+    const char *high = data + dataLen;
+
+    size_t i = 0;
+#if defined(NAMON_X86_SIMD)
+    if (simd != SimdLevel::SCALAR)
+        i = 4 * getVarintsSsse3(table, ctrl, groups, data, high, end, values);
+#else
+    (void)simd;
+#endif
+    for (; i < n; i++)
+    {
+        const unsigned int code = (ctrl[i / 4] >> (2 * (i % 4))) & 3;
+        values[i] = getValue(data, VARINT_WIDTH[code]);
+        data += VARINT_WIDTH[code];
+        if (code == 3)
+        {
+            values[i] |= getValue(high, 4) << 32;
+            high += 4;
+        }
+    }
+    p = high;
+    return true;
+}
+
+
+/*!
+ * @brief   Hash of an IPv6 address kept in two halves
+ */
+struct Ip6Hash
+{
+    size_t operator()(const std::pair<uint64_t, uint64_t> &a) const
+    {
+        return std::hash<uint64_t>()(a.first ^ (a.second * 0x9e3779b97f4a7c15ULL));
+    }
+};
+
+
+/*!
+ * @brief   Appends a column of n values of the given width (1, 2 or 4 bytes) taken by get
+ */
+template<typename Get>
+static void putColumn(std::string &out, size_t n, unsigned int width, Get get)
+{
+    size_t pos = out.size();
+    out.resize(pos + n * width);
+    char *p = &out[pos];
+    for (size_t i = 0; i < n; i++, p += width)
+    {
+        const uint32_t v = get(i);
+        switch (width)
+        {
+            case 1: { const uint8_t  x = v; memcpy(p, &x, 1); break; }
+            case 2: { const uint16_t x = v; memcpy(p, &x, 2); break; }
+            default: memcpy(p, &v, 4);
+        }
+    }
+}
+
+
+void encodeMapping(const AppRegistry &apps, AppResults &results, std::string &out)
+{
+    results.sort();
+
+    // dictionaries of local addresses, IPv6 indexes are moved after all IPv4 ones later
+    std::unordered_map<uint32_t, uint32_t> index4;
+    std::unordered_map<std::pair<uint64_t, uint64_t>, uint32_t, Ip6Hash> index6;
+    std::vector<uint32_t> ips4;
+    std::vector<std::pair<uint64_t, uint64_t>> ips6;
+    auto ipIndex = [&](Netflow *n) -> uint32_t {
+        if (n->getIpVersion() == 4)
+        {
+            uint32_t a;
+            memcpy(&a, n->getLocalIp(), IPv4_ADDRLEN);
+            auto it = index4.emplace(a, ips4.size()).first;
+            if (it->second == ips4.size())
+                ips4.push_back(a);
+            return it->second;
+        }
+        std::pair<uint64_t, uint64_t> a;
+        memcpy(&a.first, n->getLocalIp(), 8);
+        memcpy(&a.second, static_cast<const char *>(n->getLocalIp()) + 8, 8);
+        auto it = index6.emplace(a, ips6.size()).first;
+        if (it->second == ips6.size())
+            ips6.push_back(a);
+        return it->second | 0x80000000;
+    };
+
+    // application names in order of their ID
+    std::vector<AppId> appIds;
+    size_t flowCount = 0;
+    for (AppId id = 1; id < apps.size(); id++)
+    {
+        const size_t n = results.get(id).size();
+        if (n == 0)
+            continue;
+        appIds.push_back(id);
+        flowCount += n;
+    }
+
+    // Netflows of every application are sorted, so they are merged by a heap of the first
+    // not taken netflow of every application (equal start times are taken in order of the
+    // applications). Every netflow is read once and its values go straight to the columns.
+    typedef std::pair<uint64_t, uint32_t> Head;     // start time, index into appIds
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    std::vector<size_t> taken(appIds.size(), 0);
+    for (uint32_t a = 0; a < appIds.size(); a++)
+        heads.emplace(results.get(appIds[a])[0]->getStartTime(), a);
+    std::vector<uint32_t> appCol, ipCol;
+    std::vector<uint16_t> portCol;
+    std::string protoCol;
+    VarintColumn deltas, durations;
+    appCol.reserve(flowCount);
+    ipCol.reserve(flowCount);
+    portCol.reserve(flowCount);
+    protoCol.reserve(flowCount);
+    deltas.reserve(flowCount);
+    durations.reserve(flowCount);
+    const uint64_t first = heads.empty() ? 0 : heads.top().first;
+    uint64_t prev = first;
+    while (!heads.empty())
+    {
+        const uint64_t start = heads.top().first;
+        const uint32_t a = heads.top().second;
+        heads.pop();
+        const std::vector<Netflow *> &f = results.get(appIds[a]);
+        Netflow *n = f[taken[a]++];
+        if (taken[a] < f.size())
+            heads.emplace(f[taken[a]]->getStartTime(), a);
+
+        const uint64_t end = n->getEndTime();
+        appCol.push_back(a);
+        ipCol.push_back(ipIndex(n));
+        portCol.push_back(n->getLocalPort());
+        protoCol.push_back(n->getProto());
+        deltas.put(start - prev);
+        durations.put((end > start) ? end - start : 0);
+        prev = start;
+    }
+
+    MappingHeader h;
+    memcpy(h.magic, MAPPING_MAGIC, sizeof(h.magic));
+    h.flows = flowCount;
+    h.apps = appIds.size();
+    h.ips4 = ips4.size();
+    h.ips6 = ips6.size();
+    h.appWidth = indexWidth(appIds.size());
+    h.ipWidth = indexWidth(ips4.size() + ips6.size());
+    h.reserved = 0;
+    out.reserve(out.size() + sizeof(h) + flowCount * (h.appWidth + h.ipWidth + 3 + 4));
+    out.append(reinterpret_cast<const char *>(&h), sizeof(h));
+
+    for (AppId id : appIds)
+    {
+        const std::string &name = apps.name(id);
+        const uint16_t len = (name.length() < 0xffff) ? name.length() : 0xffff;
+        putValue(out, len, 2);
+        out.append(name, 0, len);
+    }
+    for (uint32_t a : ips4)
+        out.append(reinterpret_cast<const char *>(&a), IPv4_ADDRLEN);
+    for (const auto &a : ips6)
+    {
+        out.append(reinterpret_cast<const char *>(&a.first), 8);
+        out.append(reinterpret_cast<const char *>(&a.second), 8);
+    }
+
+    const uint32_t ips4Count = h.ips4;
+    putColumn(out, flowCount, h.appWidth, [&appCol](size_t i) { return appCol[i]; });
+    putColumn(out, flowCount, h.ipWidth, [&ipCol, ips4Count](size_t i) {
+        return (ipCol[i] & 0x80000000) ? (ipCol[i] & 0x7fffffff) + ips4Count : ipCol[i];
+    });
+    putColumn(out, flowCount, 2, [&portCol](size_t i) { return portCol[i]; });
+    out.append(protoCol);
+    putValue(out, first, 8);
+    deltas.appendTo(out);
+    durations.appendTo(out);
+}
+
+
+int decodeMapping(const char *data, size_t len, std::vector<std::string> &apps, std::vector<MappedFlow> &flows, SimdLevel simd)
+{
+    const char *p = data;
+    const char *end = data + len;
+    MappingHeader h;
+    if (len < sizeof(h))
+        return -1;
+    memcpy(&h, p, sizeof(h));
+    p += sizeof(h);
+    if (memcmp(h.magic, MAPPING_MAGIC, sizeof(h.magic)) || h.appWidth == 0 || h.ipWidth == 0)
+        return -1;
+
+    apps.clear();
+    apps.reserve(h.apps);
+    for (uint32_t i = 0; i < h.apps; i++)
+    {
+        if (end - p < 2)
+            return -1;
+        const size_t l = getValue(p, 2);
+        if ((size_t)(end - p - 2) < l)
+            return -1;
+        apps.emplace_back(p + 2, l);
+        p += 2 + l;
+    }
+    const size_t dictLen = (size_t)h.ips4 * IPv4_ADDRLEN + (size_t)h.ips6 * IPv6_ADDRLEN;
+    const size_t fixedLen = (size_t)h.flows * (h.appWidth + h.ipWidth + 3) + 8;
+    if ((size_t)(end - p) < dictLen + fixedLen)
+        return -1;
+    const char *dict4 = p;
+    const char *dict6 = p + (size_t)h.ips4 * IPv4_ADDRLEN;
+    p += dictLen;
+
+    // fixed width columns are plain arrays
+    flows.assign(h.flows, MappedFlow());
+    const uint32_t ips = h.ips4 + h.ips6;
+    for (uint32_t i = 0; i < h.flows; i++, p += h.appWidth)
+    {
+        flows[i].app = getValue(p, h.appWidth);
+        if (flows[i].app >= h.apps)
+            return -1;
+    }
+    for (uint32_t i = 0; i < h.flows; i++, p += h.ipWidth)
+    {
+        MappedFlow &f = flows[i];
+        const uint32_t ip = getValue(p, h.ipWidth);
+        if (ip >= ips)
+            return -1;
+        memset(&f.ip, 0, sizeof(f.ip));
+        f.ipVersion = (ip < h.ips4) ? 4 : 6;
+        if (f.ipVersion == 4)
+            memcpy(&f.ip, dict4 + (size_t)ip * IPv4_ADDRLEN, IPv4_ADDRLEN);
+        else
+            memcpy(&f.ip, dict6 + (size_t)(ip - h.ips4) * IPv6_ADDRLEN, IPv6_ADDRLEN);
+    }
+    for (uint32_t i = 0; i < h.flows; i++, p += 2)
+        flows[i].port = getValue(p, 2);
+    for (uint32_t i = 0; i < h.flows; i++, p++)
+        flows[i].proto = *p;
+
+    uint64_t time = getValue(p, 8);
+    p += 8;
+    std::vector<uint64_t> values(h.flows);
+    if (!getVarints(p, end, h.flows, values.data(), simd))
+        return -1;
+    for (uint32_t i = 0; i < h.flows; i++)
+    {
+        time += values[i];
+        flows[i].startTime = time;
+    }
+    if (!getVarints(p, end, h.flows, values.data(), simd))
+        return -1;
+    for (uint32_t i = 0; i < h.flows; i++)
+        flows[i].endTime = flows[i].startTime + values[i];
+    return 0;
+}
+
+
+}	// namespace NAMON
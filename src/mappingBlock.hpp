@@ -0,0 +1,106 @@
+/**
+ *  @file       mappingBlock.hpp
+ *  @brief      Columnar encoding of netflows and their applications header file
+ *  @details    The mapping block (the pcapng custom block written at the end of capturing)
+ *              stores netflows of all applications in columns:
+ *
+ *              | Field                 | Encoding                                          |
+ *              |-----------------------|---------------------------------------------------|
+ *              | header                | #NAMON::MappingHeader                             |
+ *              | application names     | uint16_t length and the name, once per application|
+ *              | IPv4, IPv6 dictionary | 4 and 16 B addresses, once per address            |
+ *              | application column    | index into the names, 1, 2 or 4 B per netflow     |
+ *              | IP column             | index into the dictionary (IPv4 ones first)       |
+ *              | port column           | uint16_t per netflow                              |
+ *              | protocol column       | uint8_t per netflow                               |
+ *              | start time column     | first start time (uint64_t), deltas of the rest   |
+ *              | duration column       | end time - start time                             |
+ *
+ *              Netflows are sorted by their start time, so start time deltas are small.
+ *              Deltas and durations use the stream VByte layout: a control byte with 2-bit
+ *              classes of 4 values, all control bytes go before the data bytes. Classes are
+ *              1, 2 and 4 B, the last one is 4 B too and the upper 4 B of the value follow
+ *              after all data bytes (values over 32 bits are rare). Lengths of all values are
+ *              known from the control bytes only, so a reader decodes 4 values at once with
+ *              a byte shuffle (SSSE3). The fixed width columns are plain arrays. All numbers
+ *              are in host order like in the rest of the file.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 22:40
+ *   - Edited:  20.10.2026 05:20
+ */
+
+#pragma once
+
+#include <cstdint>              //  uint*_t
+#include <string>               //  string
+#include <vector>               //  vector
+
+#include "tcpip_headers.hpp"    //  ip6_addr
+#include "appRegistry.hpp"      //  AppRegistry, AppResults
+#include "utils.hpp"            //  SimdLevel, detectSimdLevel()
+
+
+
+
+namespace NAMON
+{
+
+
+const char MAPPING_MAGIC[4] = { 'N', 'M', 'C', '2' };  //!< Magic and version of the columnar mapping block
+
+
+/*!
+ * @brief   Beginning of the columnar mapping block body
+ */
+struct MappingHeader
+{
+    char magic[4];              //!< #NAMON::MAPPING_MAGIC
+    uint32_t flows;             //!< Number of netflows
+    uint32_t apps;              //!< Number of application names
+    uint32_t ips4;              //!< Number of IPv4 addresses in the dictionary
+    uint32_t ips6;              //!< Number of IPv6 addresses in the dictionary
+    uint8_t appWidth;           //!< Bytes per value of the application column
+    uint8_t ipWidth;            //!< Bytes per value of the IP column
+    uint16_t reserved;          //!< Zero
+};
+
+
+/*!
+ * @brief   Netflow decoded from the mapping block
+ */
+struct MappedFlow
+{
+    uint32_t app;               //!< Index of the application name
+    uint8_t ipVersion;          //!< IP version
+    uint8_t proto;              //!< Layer 4 protocol
+    uint16_t port;              //!< Local port
+    ip6_addr ip;                //!< Local IP address (first 4 bytes for IPv4)
+    uint64_t startTime;         //!< Time of the first packet
+    uint64_t endTime;           //!< Time of the last packet
+};
+
+
+/*!
+ * @brief       Encodes netflows of all applications
+ * @details     Netflows of applications are sorted (see AppResults::sort()) and merged
+ *              straight into the columns, they aren't copied.
+ * @param[in]   apps        Names of applications
+ * @param[in]   results     Netflows of applications
+ * @param[out]  out         Body of the mapping block is appended to it
+ */
+void encodeMapping(const AppRegistry &apps, AppResults &results, std::string &out);
+/*!
+ * @brief       Decodes the body of the mapping block made by encodeMapping()
+ * @param[in]   data    Body of the block
+ * @param[in]   len     Length of the body
+ * @param[out]  apps    Application names
+ * @param[out]  flows   Netflows in order of their start time
+ * @param[in]   simd    Instructions used to decode the times, the result is the same for all levels
+ * @return      -1 if the body is damaged or it isn't the columnar encoding, 0 otherwise
+ */
+int decodeMapping(const char *data, size_t len, std::vector<std::string> &apps, std::vector<MappedFlow> &flows,
+                  SimdLevel simd = detectSimdLevel());
+
+
+}	// namespace NAMON
@@ -4,12 +4,11 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 20.03.2017 16:34
- *   - Edited:  23.06.2017 12:12
+ *   - Edited:  19.10.2026 22:10
  */
 
-#include <map>              //  map
-
 #include "netflow.hpp"      //  Netflow
+#include "appRegistry.hpp"  //  AppRegistry, AppResults
 #include "debug.hpp"        //  log()
 #include "namon.hpp"
 
@@ -34,7 +33,8 @@ int(*getId)(NAMON::Netflow *) = NAMON::getInode;
 int (*getId)(NAMON::Netflow *) = NAMON::getPid;
 #endif
 
-extern std::map<string, std::vector<NAMON::Netflow *>> g_finalResults;
+extern NAMON::AppRegistry g_apps;
+extern NAMON::AppResults g_finalResults;
 extern unsigned int g_notFoundSockets, g_allSockets;
 
 
@@ -44,9 +44,26 @@ namespace NAMON
 {
 
 
+/*!
+ * @brief       Checks the owner of the socket of an expired entry without searching the procfs
+ * @return      True if the owner still holds the socket
+ */
+static bool ownerUnchanged(TEntry &e)
+{
+#if defined(__linux__)
+	return isSocketOwner(e.getInodeOrPid(), e.getOwner());
+#else
+	(void)e;
+	return false;
+#endif
+}
+
+
 int determineApp(Netflow *n, TEntry &e, const char mode)
 {
-	int id = getId(n);
+	// the socket is still open in its owner, so it still has the local address and port
+	const bool owned = (mode == UPDATE && ownerUnchanged(e));
+	int id = owned ? e.getInodeOrPid() : getId(n);
 	if (id == -2)
 		return -1;
 
@@ -55,17 +72,28 @@ int determineApp(Netflow *n, TEntry &e, const char mode)
 	{
 		if (id == e.getInodeOrPid())
 		{ // if nothing changed, update time
+#if defined(__linux__)
+			if (!owned && id != -1)
+			{ // the socket was handed over to another process, the next check will be cheap again
+				string appName;
+				SocketOwner owner;
+				if (!getApp(id, appName, &owner))
+					e.setOwner(owner);
+			}
+#endif
 			e.updateTime();
+			if (e.getNetflowPtr()->getEndTime() == 0) // the first packet of a pre-scanned socket
+				e.getNetflowPtr()->setStartTime(n->getStartTime());
 			e.getNetflowPtr()->setEndTime(n->getEndTime());
 			return 0;
 		}
-		else if (e.getAppName() != "")
+		else if (e.getAppId() != NO_APP && e.getNetflowPtr()->getEndTime() != 0)
 		{ // save expired record to results
 			Netflow *res = new Netflow;
 			*res = *e.getNetflowPtr();
-			g_finalResults[e.getAppName()].push_back(res);
-            e.setAppName("");
+			g_finalResults.add(e.getAppId(), res);
 		}
+		e.setAppId(NO_APP);
 	}
 
 	g_allSockets++;
@@ -76,10 +104,17 @@ int determineApp(Netflow *n, TEntry &e, const char mode)
 	else
 	{
 		string appName;
+#if defined(__linux__)
+		SocketOwner owner;
+		if (getApp(id, appName, &owner))
+			return -1;
+		e.setOwner(owner);
+#else
 		if (getApp(id, appName))
 			return -1;
+#endif
 
-		e.setAppName(appName);
+		e.setAppId(g_apps.intern(appName));
 	}
 
 
@@ -4,7 +4,7 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 20.03.2017 16:56
- *   - Edited:  23.06.2017 12:12
+ *   - Edited:  19.10.2026 22:10
  */
 
 #pragma once
@@ -32,8 +32,8 @@ namespace NAMON
   * @param[out]  e       Set application and socket inode number with netflow structure
   * @param[in]   mode    Update of expired record or inserting new record
   * @return      Value bigger than zero if there wasn't any error.
-  *              -1 is returned if application or inode wasn't found - in this case #NAMON::TEntry::appName
-  *              is set to empty string. If there were any Input/Output error, -2 is returned.
+  *              -1 is returned if application or inode wasn't found - in this case #NAMON::TEntry::appId
+  *              is set to #NAMON::NO_APP. If there were any Input/Output error, -2 is returned.
   */
 int determineApp(Netflow *n, TEntry &e, const char mode);
 
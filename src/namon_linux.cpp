@@ -4,17 +4,33 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 18.02.2017 23:32
- *   - Edited:  23.06.2017 12:12
+ *   - Edited:  20.10.2026 04:40
  */
 
-#include <fstream>              //  ifstream
+#include <fstream>              //  ifstream, ofstream
+#include <vector>               //  vector
+#include <unordered_map>        //  unordered_map
+#include <unordered_set>        //  unordered_set
+#include <climits>              //  PATH_MAX
+#include <chrono>               //  steady_clock
+#include <cstdio>               //  sscanf(), snprintf(), rename()
+#include <cstdlib>              //  strtoul(), strtoull()
 #include <dirent.h>             //  opendir(), readdir()
-#include <unistd.h>             //  getpid()
+#include <unistd.h>             //  getpid(), close()
 #include <cstring>              //  memset(), strchr()
+#include <atomic>               //  atomic
+#include <sys/socket.h>         //  socket(), bind(), send(), recv()
+#include <sys/time.h>           //  timeval
+#include <sys/mman.h>           //  mmap(), munmap()
+#include <sys/stat.h>           //  fstat()
+#include <fcntl.h>              //  open()
+#include <linux/netlink.h>      //  sockaddr_nl, nlmsghdr
+#include <linux/rtnetlink.h>    //  RTM_GETADDR, ifaddrmsg
 
 #include "tcpip_headers.hpp"    //
 #include "netflow.hpp"          //  Netflow
-#include "cache.hpp"            //  Cache, TEntry
+#include "cache.hpp"            //  Cache, TEntry, TTree
+#include "appRegistry.hpp"      //  AppRegistry
 #include "debug.hpp"            //  log()
 #include "utils.hpp"            //  pidToInt()
 #include "namon_linux.hpp"
@@ -24,6 +40,15 @@ using namespace std;
 extern const char *g_dev;
 extern unsigned int g_notFoundApps;
 extern NAMON::mac_addr g_devMac;
+extern std::atomic<int> shouldStop;
+extern NAMON::AppRegistry g_apps;
+
+#ifdef DEBUG_BUILD
+//! Counts an access to the procfs (open, directory entry, readlink)
+#define PROCFS_CALL()   (++g_procfsCalls)
+#else
+#define PROCFS_CALL()
+#endif
 
 
 
@@ -32,6 +57,20 @@ namespace NAMON
 {
 
 
+string g_procfsRoot = "/proc";      //!< Root of the procfs used to resolve sockets and applications
+unsigned long g_procfsCalls = 0;    //!< Number of procfs accesses (counted only in DEBUG_BUILD)
+
+
+
+void setProcfsRoot(const string &root)
+{
+    g_procfsRoot = root;
+    // strip trailing slashes, paths are built as root + "/..."
+    while (g_procfsRoot.length() > 1 && g_procfsRoot.back() == '/')
+        g_procfsRoot.pop_back();
+}
+
+
 int setDevMac()
 {
     string ifname;
@@ -74,17 +113,129 @@ int setDevMac()
 }
 
 
+/*!
+ * @brief       Applies RTM_NEWADDR and RTM_DELADDR messages from the buffer to the address set
+ * @return      1 if the end of a dump was reached, -1 on error, 0 otherwise
+ */
+static int processAddrMessages(const char *buf, int len, LocalAddresses &addrs)
+{
+    for (const nlmsghdr *nh = (const nlmsghdr *)buf; NLMSG_OK(nh, (unsigned)len); nh = NLMSG_NEXT(nh, len))
+    {
+        if (nh->nlmsg_type == NLMSG_DONE)
+            return 1;
+        if (nh->nlmsg_type == NLMSG_ERROR)
+            return -1;
+        if (nh->nlmsg_type != RTM_NEWADDR && nh->nlmsg_type != RTM_DELADDR)
+            continue;
+
+        const ifaddrmsg *ifa = (const ifaddrmsg *)NLMSG_DATA(nh);
+        if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)
+            continue;
+        // IFA_LOCAL is the address of the interface, IFA_ADDRESS is the peer on point-to-point links
+        const void *local = nullptr, *address = nullptr;
+        int rtaLen = IFA_PAYLOAD(nh);
+        for (const rtattr *rta = IFA_RTA(ifa); RTA_OK(rta, rtaLen); rta = RTA_NEXT(rta, rtaLen))
+        {
+            if (rta->rta_type == IFA_LOCAL)
+                local = RTA_DATA(rta);
+            else if (rta->rta_type == IFA_ADDRESS)
+                address = RTA_DATA(rta);
+        }
+        const void *ip = local ? local : address;
+        if (ip == nullptr)
+            continue;
+        const unsigned int ipVersion = (ifa->ifa_family == AF_INET) ? 4 : 6;
+        if (nh->nlmsg_type == RTM_NEWADDR)
+            addrs.add(ip, ipVersion);
+        else
+            addrs.remove(ip, ipVersion);
+    }
+    return 0;
+}
+
+
+int openAddressMonitor(LocalAddresses &addrs)
+{
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0)
+        return -1;
+    sockaddr_nl sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.nl_family = AF_NETLINK;
+    sa.nl_groups = RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+    if (bind(fd, (sockaddr *)&sa, sizeof(sa)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // Notifications are subscribed before the dump, so no change is missed.
+    struct {
+        nlmsghdr nh;
+        ifaddrmsg ifa;
+    } req;
+    memset(&req, 0, sizeof(req));
+    req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(ifaddrmsg));
+    req.nh.nlmsg_type = RTM_GETADDR;
+    req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+    req.nh.nlmsg_seq = 1;
+    req.ifa.ifa_family = AF_UNSPEC;
+    if (send(fd, &req, req.nh.nlmsg_len, 0) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    char buf[16384];
+    int ret = 0;
+    while (ret == 0)
+    {
+        const int len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0)
+            ret = -1;
+        else
+            ret = processAddrMessages(buf, len, addrs);
+    }
+    if (ret < 0)
+    {
+        close(fd);
+        return -1;
+    }
+    addrs.publish();
+    return fd;
+}
+
+
+void runAddressMonitor(int fd, LocalAddresses &addrs)
+{
+    // wake up every second to check shouldStop
+    timeval tv { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    char buf[16384];
+    while (!shouldStop)
+    {
+        const int len = recv(fd, buf, sizeof(buf), 0);
+        if (len <= 0)
+            continue;   // timeout; ENOBUFS means lost notifications, the next ones still come
+        if (processAddrMessages(buf, len, addrs) >= 0 && addrs.publish())
+            log(LogLevel::INFO, "Local addresses changed.");
+    }
+    close(fd);
+    log(LogLevel::INFO, "Local address monitoring stopped.");
+}
+
+
 int getSocketFile(Netflow *n, string &file)
 {
     const unsigned int proto = n->getProto();
     const unsigned char ipVer = n->getIpVersion();
 
     if (proto == PROTO_UDP)
-        file = "/proc/net/udp";
+        file = g_procfsRoot + "/net/udp";
     else if (proto == PROTO_UDPLITE)
-        file = "/proc/net/udplite";
+        file = g_procfsRoot + "/net/udplite";
     else if (proto == PROTO_TCP)
-        file = "/proc/net/tcp";
+        file = g_procfsRoot + "/net/tcp";
     else
     {
         log(LogLevel::ERR, "Unsupported L4 protocol");
@@ -102,23 +253,46 @@ int getSocketFile(Netflow *n, string &file)
 }
 
 
-int getInode(Netflow *n)
+/*!
+ * @brief       Parses one socket line of a /proc/net/{tcp,udp,udplite}[6] file
+ * @details     Columns are delimited by spaces and their widths aren't fixed.
+ * @param[in]   line        The line
+ * @param[in]   ipVersion   4 or 6
+ * @param[out]  ip          Local address (first 4 bytes for IPv4)
+ * @param[out]  port        Local port
+ * @param[out]  inode       Socket inode, zero if no process holds the socket (e.g. TIME_WAIT)
+ * @return      -1 if the line isn't a socket of the IP version, 0 otherwise
+ */
+static int parseSocketLine(const string &line, unsigned char ipVersion, ip6_addr &ip, unsigned int &port, int &inode)
 {
-    // in6_addr will be always bigger than in_addr so we can use it to store both IPv4 and IPv6
-    static ip6_addr foundIp;
-    static size_t ipSize;
+    // sl local_address rem_address st tx_queue:rx_queue tr:tm->when retrnsmt uid timeout inode
+    const size_t ipChars = (ipVersion == 4) ? IPv4_ADDRLEN * 2 : IPv6_ADDRLEN * 2;
+    char ipStr[33];
+    if (sscanf(line.c_str(), "%*d: %32[0-9A-Fa-f]:%x %*s %*s %*s %*s %*s %*s %*s %d", ipStr, &port, &inode) != 3
+        || strlen(ipStr) != ipChars)
+        return -1;
+    // the kernel prints addresses as 32-bit words in host order
+    memset(&ip, 0, sizeof(ip));
+    for (size_t w = 0; w < ipChars / 8; w++)
+    {
+        const char word[9] = { ipStr[w*8], ipStr[w*8+1], ipStr[w*8+2], ipStr[w*8+3],
+                               ipStr[w*8+4], ipStr[w*8+5], ipStr[w*8+6], ipStr[w*8+7], '\0' };
+        const uint32_t v = strtoul(word, nullptr, 16);
+        memcpy(&ip.addr.addr32[w], &v, sizeof(v));
+    }
+    return 0;
+}
+
 
+int getInode(Netflow *n)
+{
     const unsigned char ipVer = n->getIpVersion();
-    if (ipVer == 4)
-       ipSize = IPv4_ADDRLEN;
-    else if (ipVer == 6)
-       ipSize = IPv6_ADDRLEN;
-    else
-    { 
-        log(LogLevel::ERR, "IP protocol ", ipVer, " is not supported."); 
+    if (ipVer != 4 && ipVer != 6)
+    {
+        log(LogLevel::ERR, "Unsupported IP protocol");
         return -2; 
     }
-    memset(&foundIp, 0, sizeof(foundIp));
+    const size_t ipSize = (ipVer == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
 
     try
     {
@@ -129,163 +303,31 @@ int getInode(Netflow *n)
 
         ifstream socketsFile;
         socketsFile.open(filename);
+        PROCFS_CALL();
         if (!socketsFile)
             throw ("Can't open file " + filename);
 
-        static streamoff pos_localIp, pos_localPort, pos_inode;
-        static string dummyStr;
-        static int lineLength, inode;
-        static uint16_t foundPort;
-        static uint16_t wantedPort;
-
-        wantedPort = n->getLocalPort();
-        inode = -1;
-#if 1
-        const char IP_SIZE = (ipVer == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
-
-        getline(socketsFile, dummyStr); // get first line to find out length of the other lines
-        lineLength = dummyStr.length() + 1;
-        getline(socketsFile, dummyStr, ':'); // get rid of the first column
-        pos_localIp = socketsFile.tellg();
-        pos_localIp++; // space after first column ("sl")
-        pos_localPort = pos_localIp + IP_SIZE*2 + 1; // localIP + ':' delimiter
-        // localPort remoteIp:remotePort st tx_queue:rx_queue tr:tm->when retrnsmt
-        pos_inode = pos_localPort+3+ 1 +IP_SIZE*2+1+4+ 1+2+1 +8+1+8+ 1 +2+1+8 +1+8+1;
-        
-        // cycle over remaining lines
-        do {
-            socketsFile.seekg(pos_localPort); // move before localPort
-
-            socketsFile >> hex >> foundPort;
-            //D(wantedPort << " vs. " << foundPort);
-            if (foundPort == wantedPort)
-            {
-                char c{0};
-                // compare localIp
-                socketsFile.seekg(pos_localIp);
-                if (ipVer == 4)
-                {
-                    char i{0};
-                    uint8_t parts[IPv4_ADDRLEN];
-                    const unsigned char CHARS_PER_OCTET = 2;
-
-                    while (socketsFile.get(c), c != ':' && c != 0) //! @todo why 0?
-                    {
-                        if (c >= '0' && c <= '9')
-                            c -= '0';
-                        else if (c >= 'A' && c <= 'F')
-                            c = 10 + c - 'A'; // get from 'A' decimal 10
-                        else
-                        {
-                            log(LogLevel::ERR, "An Unexpected hexadecimal character in IP address in procfs: ", c);
-                            break;
-                        }
-                        // 01 00 00 7F      :c  == 127.0.0.1     (IP address char)
-                        // 01 23 45 67      :i                   (position)
-                        // 0  1  2  3       :i / CHARS_PER_OCTET (corresponding octet)
-                        parts[i / CHARS_PER_OCTET] = parts[i/CHARS_PER_OCTET]*16 + c;
-                        i++;
-                    }
-                    reinterpret_cast<ip4_addr*>(&foundIp)->addr |= (parts[0] << 24) | (parts[1] << 16) | (parts[2] << 8) | parts[3];
-                }
-                else
-                {
-                    static uint8_t indexes[16] = {3,2,1,0,7,6,5,4,11,10,9,8,15,14,13,12};
-                    static ip6_addr* foundIp6;
-                    static uint8_t halfByte;
-                    static uint8_t byte;
-                    foundIp6 = reinterpret_cast<ip6_addr*>(&foundIp);
-                    for (int i=0; i < 16; i++)
-                    {
-                        socketsFile >> halfByte;
-                        if (halfByte >= 'A')
-                            byte = (halfByte - 'A' + 10) * 16;
-                        else
-                            byte = (halfByte - '0') * 16;
-                        
-                        socketsFile >> halfByte;
-                        if (halfByte >= 'A')
-                            byte += (halfByte - 'A' + 10);
-                        else
-                            byte += (halfByte - '0');
-
-                        foundIp6->addr.addr8[indexes[i]] = byte;
-                    }
-                }
-
-                // static variables are automatically initialized to zero unless there is an initializer
-                // ip6_addr is bigger so we can use it to compare for both ip versions
-                // if it is our IP address or broadcast
-                static char zeroBlock [sizeof(ip6_addr)];
-                if (!memcmp(n->getLocalIp(), &foundIp, ipSize) || !memcmp(&foundIp, zeroBlock, ipSize))
-                {
-
-                    socketsFile.seekg(pos_inode);
-                    // other columns (uid, timeout) have variable width
-                    char column = 0;
-                    bool inColumn = false;
-                    while(column != 3 && socketsFile.good())
-                    {
-                        //! @todo getc stucked
-                        //! @warning can stuck (when file is closed? I don't know yet)
-                        // it got the same char all the time (':' when it occured after signal 2 call)
-                        // so column is never equal 3
-                        socketsFile.get(c);
-                        if (c != ' ')
-                        {
-                            if (!inColumn)
-                            {
-                                column++;
-                                inColumn = true;
-                            }
-                        }
-                        else
-                            inColumn = false;
-                    }
-                    if (column != 3)
-                        throw "Inode column not found";
-                    socketsFile.unget();
-
-                    socketsFile >> dec >> inode;
-                    break;
-                }
-            }
-            //! @todo for sure lines have same length?
-            pos_localIp += lineLength; // all lines are the same length
-            pos_localPort += lineLength;
-            pos_inode += lineLength;
-        } while (getline(socketsFile, dummyStr));
-#else
-        socketsFile.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
-        ///
-        //
-        //
-        string nextLine(istream&, string&& = string());
-
-        // calling once, or when allocation cost doesn't matter
-        auto line = nextLine(strm);
-        
-        // calling in a loop
-        string line;
-        for (...)
-            line = nextLine(strm, std::move(line));
-        ///
-        //
-        //https://channel9.msdn.com/Events/GoingNative/2013/Writing-Quick-Code-in-Cpp-Quickly
-        typedef std::istreambuf_iterator<char> iter;
-
-        std::ifstream input_file("textfile.txt");
-        iter file_begin(input_file);
-        iter file_end;
-
-        for (iter i = file_begin; i != file_end; ++i)
-            std::clog << *i;
-#endif
-        if (inode == -1)
-            log(LogLevel::WARNING, "Inode not found for port <",wantedPort,">");
-        return inode;
+        const uint16_t wantedPort = n->getLocalPort();
+        // ip6_addr is bigger so we can use it to compare for both ip versions
+        static const char zeroBlock[sizeof(ip6_addr)] = { 0 };
+        static string line;
+        getline(socketsFile, line);     // header
+        // lines don't have the same length, e.g. inodes and queues have variable width
+        while (getline(socketsFile, line))
+        {
+            ip6_addr foundIp;
+            unsigned int foundPort;
+            int inode;
+            if (parseSocketLine(line, ipVer, foundIp, foundPort, inode) || foundPort != wantedPort || inode == 0)
+                continue;
+            // if it is our IP address or broadcast
+            if (!memcmp(n->getLocalIp(), &foundIp, ipSize) || !memcmp(&foundIp, zeroBlock, ipSize))
+                return inode;
+        }
+        log(LogLevel::WARNING, "Inode not found for port <",wantedPort,">");
+        return -1;
     }
-    catch(char const *msg)
+    catch(const string &msg)
     {
         log(LogLevel::ERR, msg);
         return -2;
@@ -293,7 +335,29 @@ int getInode(Netflow *n)
 }
 
 
-int getApp(const int inode, string &appName)
+/*!
+ * @param[in]   pidDir  PID directory in the procfs root
+ * @return      Start time of the process in clock ticks after boot, 0 if the process doesn't exist
+ */
+static uint64_t processStartTime(const string &pidDir)
+{
+    ifstream statFile(concatenate(g_procfsRoot, "/", pidDir, "/stat"));
+    PROCFS_CALL();
+    string line;
+    if (!getline(statFile, line))
+        return 0;
+    // the name may contain spaces and parentheses, fields are counted after the last ')'
+    size_t pos = line.rfind(')');
+    if (pos == string::npos)
+        return 0;
+    // state is the 3rd field and starttime is the 22nd one
+    for (int field = 2; field < 22 && pos != string::npos; field++)
+        pos = line.find(' ', pos + 1);
+    return (pos == string::npos) ? 0 : strtoull(line.c_str() + pos + 1, nullptr, 10);
+}
+
+
+int getApp(const int inode, string &appName, SocketOwner *owner)
 {
     DIR *procDir{nullptr}, *fdDir{nullptr};
     try
@@ -306,31 +370,36 @@ int getApp(const int inode, string &appName)
         dirent *pidEntry{nullptr}, *fdEntry{nullptr};
         int pid{0}, fd{0};
 
-        if ((procDir = opendir("/proc/")) == nullptr)
-            throw std_ex("Can't open /proc/ directory");
+        if ((procDir = opendir((g_procfsRoot + "/").c_str())) == nullptr)
+            throw std_ex("Can't open " + g_procfsRoot + "/ directory");
+        PROCFS_CALL();
 
         while ((pidEntry = readdir(procDir)))
         {
+            PROCFS_CALL();
             if (chToInt(pidEntry->d_name, pid))
                 continue;
             if (myPid == pid || pid == 0)
                 continue;
 
-            tmpString = "/proc/"; tmpString += pidEntry->d_name; tmpString += "/fd/";
+            tmpString = g_procfsRoot; tmpString += '/'; tmpString += pidEntry->d_name; tmpString += "/fd/";
             if ((fdDir = opendir(tmpString.c_str())) == nullptr)
                 throw std_ex("Can't open " + tmpString);
+            PROCFS_CALL();
 
             while ((fdEntry = readdir(fdDir)))
             {
+                PROCFS_CALL();
                 if (chToInt(fdEntry->d_name, fd))
                     continue;
 
                 if (fd <= 2) // stdin, stdout, stderr
                     continue;
                 // the fastest option
-                tmpString = "/proc/";  tmpString += pidEntry->d_name;
+                tmpString = g_procfsRoot; tmpString += '/'; tmpString += pidEntry->d_name;
                 tmpString += "/fd/";   tmpString += fdEntry->d_name;
                 int ll = readlink(tmpString.c_str(), inodeBuff, sizeof(inodeBuff));
+                PROCFS_CALL();
                 if (ll == -1)
                     log(LogLevel::ERR, "Readlink error: ", tmpString, "\n", strerror(errno));
                 if (inodeBuff[0] != 's' || inodeBuff[6] != ':') // socket:[<inode>]
@@ -344,9 +413,16 @@ int getApp(const int inode, string &appName)
                     throw "Can't convert socket inode to integer";
                 if (foundInode == inode)
                 {
-                    ifstream appNameFile(concatenate("/proc/", pidEntry->d_name, "/cmdline"));
+                    ifstream appNameFile(concatenate(g_procfsRoot, "/", pidEntry->d_name, "/cmdline"));
+                    PROCFS_CALL();
                     // arguments are delimited with '\0'
                     getline(appNameFile,appName);
+                    if (owner != nullptr)
+                    {
+                        owner->pid = pid;
+                        owner->fd = fd;
+                        owner->startTime = processStartTime(pidEntry->d_name);
+                    }
 
                     closedir(fdDir);
                     goto END;
@@ -383,4 +459,485 @@ END:
 }
 
 
+
+
+bool isSocketOwner(const int inode, const SocketOwner &owner)
+{
+    if (owner.pid == 0 || owner.fd < 0)
+        return false;
+    char link[64];
+    const string path = concatenate(g_procfsRoot, "/", to_string(owner.pid), "/fd/", to_string(owner.fd));
+    const ssize_t ll = readlink(path.c_str(), link, sizeof(link) - 1);
+    PROCFS_CALL();
+    if (ll < 10)
+        return false;   // the descriptor was closed or the process has exited
+    link[ll] = '\0';
+    char expected[32];
+    snprintf(expected, sizeof(expected), "socket:[%d]", inode);
+    if (strcmp(link, expected) != 0)
+        return false;
+    // the PID and the descriptor may have been reused by another process
+    return processStartTime(to_string(owner.pid)) == owner.startTime;
+}
+
+
+/*!
+ * @brief   State of prescanSockets()
+ */
+struct Prescan
+{
+    Prescan(Cache &c) : cache(c) {}
+    Cache &cache;                               //!< Filled cache
+    std::unordered_map<int, SocketOwner> owners;    //!< Socket inode and its owner
+    std::unordered_map<int, AppId> apps;        //!< PID and the application of the process
+    std::unordered_map<int, uint64_t> startTimes;   //!< PID and the start time of the process
+    std::vector<uint32_t> ips4;                 //!< Local IPv4 addresses for wildcard sockets
+    std::vector<ip6_addr> ips6;                 //!< Local IPv6 addresses for wildcard sockets
+    int inserted = 0;                           //!< Number of inserted entries
+};
+
+
+/*!
+ * @brief       Reads links of file descriptors of all processes
+ * @param[out]  owners  Socket inode and its owner (without the start time)
+ * @return      -1 if the procfs root can't be opened, 0 otherwise
+ */
+static int readSocketOwners(std::unordered_map<int, SocketOwner> &owners)
+{
+    DIR *procDir = opendir((g_procfsRoot + "/").c_str());
+    PROCFS_CALL();
+    if (procDir == nullptr)
+        return -1;
+
+    const int myPid = ::getpid();
+    char link[64];
+    string path;
+    int pid{0}, fd{0}, inode{0};
+    while (dirent *pidEntry = readdir(procDir))
+    {
+        PROCFS_CALL();
+        if (chToInt(pidEntry->d_name, pid) || myPid == pid || pid == 0)
+            continue;
+        path = g_procfsRoot; path += '/'; path += pidEntry->d_name; path += "/fd/";
+        DIR *fdDir = opendir(path.c_str());
+        PROCFS_CALL();
+        if (fdDir == nullptr)
+            continue;   // the process has exited or it isn't accessible
+        const size_t dirLen = path.length();
+        while (dirent *fdEntry = readdir(fdDir))
+        {
+            PROCFS_CALL();
+            if (chToInt(fdEntry->d_name, fd) || fd <= 2)
+                continue;
+            path.resize(dirLen);
+            path += fdEntry->d_name;
+            const ssize_t ll = readlink(path.c_str(), link, sizeof(link) - 1);
+            PROCFS_CALL();
+            if (ll < 10 || strncmp(link, "socket:[", 8) != 0) // socket:[<inode>]
+                continue;
+            link[ll - 1] = '\0';
+            if (chToInt(&link[8], inode))
+                continue;
+            SocketOwner o;
+            o.pid = pid;
+            o.fd = fd;
+            owners.emplace(inode, o);
+        }
+        closedir(fdDir);
+    }
+    closedir(procDir);
+    return 0;
+}
+
+
+/*!
+ * @brief       Inserts one socket into the cache unless the netflow is already there
+ * @details     The first socket wins, getInode() returns the first matching line too.
+ *              The netflow has zero times until its first packet comes.
+ * @return      True if the entry was inserted
+ */
+static bool insertSocket(Cache &cache, unsigned char ipVersion, unsigned char proto, const void *ip,
+                         uint16_t port, int inode, const SocketOwner &owner, AppId app, uint32_t hash = 0)
+{
+    Netflow *n = new Netflow;
+    n->setIpVersion(ipVersion);
+    if (ipVersion == 4)
+    {
+        ip4_addr *tmpIpPtr = new ip4_addr;
+        memcpy(tmpIpPtr, ip, IPv4_ADDRLEN);
+        n->setLocalIp(tmpIpPtr);
+    }
+    else
+    {
+        ip6_addr *tmpIpPtr = new ip6_addr;
+        memcpy(tmpIpPtr, ip, IPv6_ADDRLEN);
+        n->setLocalIp(tmpIpPtr);
+    }
+    n->setLocalPort(port);
+    n->setProto(proto);
+    n->setHash(hash);
+
+    TEntryOrTTree *found = cache.find(*n);
+    if (found != nullptr && found->isEntry())
+    {
+        delete n;
+        return false;
+    }
+    TEntry *e = new TEntry;
+    e->setAppId(app);
+    e->setInodeOrPid(inode);
+    e->setOwner(owner);
+    e->setNetflowPtr(n);
+    if (found == nullptr)
+        cache.insert(e);
+    else
+        static_cast<TTree *>(found)->insert(e);
+    return true;
+}
+
+
+/*!
+ * @brief       Inserts sockets listed in one /proc/net file
+ * @param[in]   name    File name in /proc/net
+ */
+static void prescanFile(Prescan &s, const char *name, unsigned char ipVersion, unsigned char proto)
+{
+    ifstream socketsFile(g_procfsRoot + "/net/" + name);
+    PROCFS_CALL();
+    if (!socketsFile)
+        return;     // e.g. UDP-Lite or IPv6 is not supported by the kernel
+
+    const size_t ipSize = (ipVersion == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
+    static const char zeroBlock[sizeof(ip6_addr)] = { 0 };
+    string line;
+    getline(socketsFile, line);     // header
+    while (getline(socketsFile, line))
+    {
+        ip6_addr ip;
+        unsigned int port;
+        int inode;
+        if (parseSocketLine(line, ipVersion, ip, port, inode) || inode == 0)
+            continue;
+        auto owner = s.owners.find(inode);
+        if (owner == s.owners.end())
+            continue;   // the owner is not known, determineApp() will try it when a packet comes
+        SocketOwner &o = owner->second;
+        auto app = s.apps.find(o.pid);
+        if (app == s.apps.end())
+        {
+            const string pidDir = to_string(o.pid);
+            string appName;
+            ifstream appNameFile(concatenate(g_procfsRoot, "/", pidDir, "/cmdline"));
+            PROCFS_CALL();
+            // arguments are delimited with '\0'
+            getline(appNameFile, appName);
+            app = s.apps.emplace(o.pid, g_apps.intern(appName)).first;
+            s.startTimes.emplace(o.pid, processStartTime(pidDir));
+        }
+        o.startTime = s.startTimes[o.pid];
+
+        if (memcmp(&ip, zeroBlock, ipSize))
+            s.inserted += insertSocket(s.cache, ipVersion, proto, &ip, port, inode, o, app->second);
+        else if (ipVersion == 4)
+            for (const uint32_t &a : s.ips4)
+                s.inserted += insertSocket(s.cache, ipVersion, proto, &a, port, inode, o, app->second);
+        else
+            for (const ip6_addr &a : s.ips6)
+                s.inserted += insertSocket(s.cache, ipVersion, proto, &a, port, inode, o, app->second);
+    }
+}
+
+
+int prescanSockets(Cache &cache, LocalAddresses &addrs)
+{
+    static const struct {
+        const char *name;
+        unsigned char ipVersion;
+        unsigned char proto;
+    } files[] = {
+        { "tcp", 4, PROTO_TCP }, { "tcp6", 6, PROTO_TCP },
+        { "udp", 4, PROTO_UDP }, { "udp6", 6, PROTO_UDP },
+        { "udplite", 4, PROTO_UDPLITE }, { "udplite6", 6, PROTO_UDPLITE },
+    };
+
+    const auto t0 = chrono::steady_clock::now();
+    Prescan s(cache);
+    if (readSocketOwners(s.owners))
+    {
+        log(LogLevel::ERR, "Can't open ", g_procfsRoot, "/ directory");
+        return -1;
+    }
+    addrs.list(s.ips4, s.ips6);
+    for (const auto &f : files)
+        prescanFile(s, f.name, f.ipVersion, f.proto);
+    log(LogLevel::INFO, "Pre-scan loaded ", s.inserted, " sockets of ", s.apps.size(), " processes into the cache in ",
+        chrono::duration<double>(chrono::steady_clock::now() - t0).count(), " s.");
+    return s.inserted;
+}
+
+
+
+
+int findAppSockets(const string &pattern, vector<AppSocket> &sockets, vector<string> &exeNames)
+{
+    static const struct {
+        const char *name;
+        unsigned char proto;
+    } files[] = {
+        { "tcp", PROTO_TCP }, { "tcp6", PROTO_TCP }, { "udp", PROTO_UDP }, { "udp6", PROTO_UDP },
+        { "udplite", PROTO_UDPLITE }, { "udplite6", PROTO_UDPLITE },
+    };
+
+    std::unordered_map<int, SocketOwner> owners;
+    if (readSocketOwners(owners))
+        return -1;
+    // processes are checked once, most of them have more sockets
+    std::unordered_map<int, bool> processes;
+    std::unordered_set<int> inodes;
+    for (const auto &o : owners)
+    {
+        auto p = processes.find(o.second.pid);
+        if (p == processes.end())
+        {
+            const string pidDir = concatenate(g_procfsRoot, "/", to_string(o.second.pid));
+            string cmdline;
+            ifstream cmdlineFile(pidDir + "/cmdline");
+            PROCFS_CALL();
+            getline(cmdlineFile, cmdline);
+            bool matches = (cmdline.find(pattern) != string::npos);
+            if (!matches)
+            {
+                char exe[PATH_MAX];
+                const ssize_t len = readlink((pidDir + "/exe").c_str(), exe, sizeof(exe));
+                PROCFS_CALL();
+                if (len > 0 && string(exe, len).find(pattern) != string::npos)
+                {
+                    matches = true;
+                    exeNames.push_back(cmdline);
+                }
+            }
+            p = processes.emplace(o.second.pid, matches).first;
+        }
+        if (p->second)
+            inodes.insert(o.first);
+    }
+
+    string line;
+    for (const auto &f : files)
+    {
+        ifstream socketsFile(g_procfsRoot + "/net/" + f.name);
+        PROCFS_CALL();
+        getline(socketsFile, line);     // header
+        while (getline(socketsFile, line))
+        {
+            // sl local_address rem_address st tx_queue:rx_queue tr:tm->when retrnsmt uid timeout inode
+            unsigned int port;
+            int inode;
+            if (sscanf(line.c_str(), "%*d: %*[0-9A-Fa-f]:%x %*s %*s %*s %*s %*s %*s %*s %d", &port, &inode) == 2
+                && inodes.count(inode))
+            {
+                AppSocket s;
+                s.proto = f.proto;
+                s.port = port;
+                sockets.push_back(s);
+            }
+        }
+    }
+    return sockets.size();
+}
+
+
+
+
+const char SNAPSHOT_MAGIC[8] = { 'N', 'A', 'M', 'O', 'N', 'C', 'S', '2' };    //!< Magic and version of snapshot files
+
+
+/*!
+ * @brief   Header of a cache snapshot file
+ * @details The header is followed by SnapshotHeader::count records and a blob of
+ *          application names. Numbers are in host order, the file is read only
+ *          on the same host.
+ */
+struct SnapshotHeader
+{
+    char magic[8];              //!< #NAMON::SNAPSHOT_MAGIC
+    uint32_t recordSize;        //!< sizeof(SnapshotRecord)
+    uint32_t count;             //!< Number of records
+    uint64_t bootTime;          //!< Boot time of the host the snapshot was made on
+};
+
+
+/*!
+ * @brief   One cache entry in a snapshot file
+ */
+struct SnapshotRecord
+{
+    FlowKey key;                //!< Netflow key
+    uint32_t hash;              //!< Netflow::getHash()
+    int32_t inode;              //!< Socket inode
+    int32_t pid;                //!< Owner of the socket when the snapshot was made
+    int32_t fd;                 //!< File descriptor of the socket in the owner
+    uint32_t appOffset;         //!< Offset of the application name in the blob
+    uint32_t appLen;            //!< Length of the application name
+    uint32_t reserved;          //!< Zero
+    uint64_t pidStart;          //!< Start time of the owner (clock ticks after boot)
+};
+static_assert(sizeof(SnapshotHeader) == 24, "unexpected padding of SnapshotHeader");
+static_assert(sizeof(SnapshotRecord) == 56, "unexpected padding of SnapshotRecord");
+
+
+/*!
+ * @return  Boot time of the host in seconds since the epoch, 0 if it's unknown
+ */
+static uint64_t bootTime()
+{
+    ifstream statFile(g_procfsRoot + "/stat");
+    PROCFS_CALL();
+    string line;
+    while (getline(statFile, line))
+        if (line.compare(0, 6, "btime ") == 0)
+            return strtoull(line.c_str() + 6, nullptr, 10);
+    return 0;
+}
+
+
+int saveCacheSnapshot(Cache &cache, const string &file)
+{
+    const auto t0 = chrono::steady_clock::now();
+    std::vector<SnapshotRecord> records;
+    string blob;
+    std::unordered_map<AppId, uint32_t> appOffsets;
+    cache.forEachEntry([&](TEntry &e) {
+        // only entries of existing sockets are worth saving, their owners are checked without searching the procfs
+        const AppId app = e.getAppId();
+        const SocketOwner &owner = e.getOwner();
+        if (app == NO_APP || !isSocketOwner(e.getInodeOrPid(), owner))
+            return;
+        auto offset = appOffsets.find(app);
+        if (offset == appOffsets.end())
+        {
+            offset = appOffsets.emplace(app, blob.length()).first;
+            blob += g_apps.name(app);
+        }
+
+        SnapshotRecord r;
+        memset(&r, 0, sizeof(r));
+        Netflow *n = e.getNetflowPtr();
+        r.key = n->getKey();
+        r.hash = n->getHash();
+        r.inode = e.getInodeOrPid();
+        r.pid = owner.pid;
+        r.fd = owner.fd;
+        r.appOffset = offset->second;
+        r.appLen = g_apps.name(app).length();
+        r.pidStart = owner.startTime;
+        records.push_back(r);
+    });
+
+    SnapshotHeader h;
+    memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.recordSize = sizeof(SnapshotRecord);
+    h.count = records.size();
+    h.bootTime = bootTime();
+    // the old snapshot is replaced at once, a crash while writing doesn't leave a broken file
+    const string tmpFile = file + ".tmp";
+    {
+        ofstream out(tmpFile, ios::binary | ios::trunc);
+        out.write(reinterpret_cast<const char *>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char *>(records.data()), records.size() * sizeof(SnapshotRecord));
+        out.write(blob.data(), blob.length());
+        if (!out)
+        {
+            log(LogLevel::ERR, "Can't write cache snapshot ", tmpFile);
+            ::unlink(tmpFile.c_str());
+            return -1;
+        }
+    }
+    if (::rename(tmpFile.c_str(), file.c_str()))
+    {
+        log(LogLevel::ERR, "Can't replace cache snapshot ", file);
+        ::unlink(tmpFile.c_str());
+        return -1;
+    }
+    log(LogLevel::INFO, "Cache snapshot with ", records.size(), " entries saved in ",
+        chrono::duration<double>(chrono::steady_clock::now() - t0).count(), " s.");
+    return records.size();
+}
+
+
+int loadCacheSnapshot(Cache &cache, const string &file)
+{
+    const auto t0 = chrono::steady_clock::now();
+    const int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd == -1)
+    {
+        log(LogLevel::INFO, "No cache snapshot ", file, " was found.");
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) || (size_t)st.st_size < sizeof(SnapshotHeader))
+    {
+        ::close(fd);
+        log(LogLevel::WARNING, "Cache snapshot ", file, " is damaged.");
+        return 0;
+    }
+    const size_t size = st.st_size;
+    void *data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (data == MAP_FAILED)
+    {
+        log(LogLevel::ERR, "Can't map cache snapshot ", file);
+        return -1;
+    }
+
+    const char *base = static_cast<const char *>(data);
+    SnapshotHeader h;
+    memcpy(&h, base, sizeof(h));
+    const size_t blobOffset = sizeof(h) + (size_t)h.count * sizeof(SnapshotRecord);
+    if (memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) || h.recordSize != sizeof(SnapshotRecord) || blobOffset > size)
+    {
+        munmap(data, size);
+        log(LogLevel::WARNING, "Cache snapshot ", file, " is damaged or made by another version.");
+        return 0;
+    }
+    if (h.bootTime != bootTime())
+    {
+        munmap(data, size);
+        log(LogLevel::INFO, "Cache snapshot ", file, " was made before the last boot.");
+        return 0;
+    }
+
+    // processes which were restarted since the snapshot have another start time
+    std::unordered_map<int32_t, bool> alive;
+    std::unordered_map<uint32_t, AppId> apps;   // offset of the name in the blob and its ID
+    int inserted = 0;
+    const char *blob = base + blobOffset;
+    const size_t blobLen = size - blobOffset;
+    for (uint32_t i = 0; i < h.count; i++)
+    {
+        SnapshotRecord r;
+        memcpy(&r, base + sizeof(h) + i * sizeof(SnapshotRecord), sizeof(r));
+        if ((r.key.ipVersion != 4 && r.key.ipVersion != 6) || (size_t)r.appOffset + r.appLen > blobLen)
+            continue;
+        auto a = alive.find(r.pid);
+        if (a == alive.end())
+            a = alive.emplace(r.pid, processStartTime(to_string(r.pid)) == r.pidStart).first;
+        if (!a->second)
+            continue;
+        SocketOwner o;
+        o.pid = r.pid;
+        o.fd = r.fd;
+        o.startTime = r.pidStart;
+        auto app = apps.find(r.appOffset);
+        if (app == apps.end())
+            app = apps.emplace(r.appOffset, g_apps.intern(string(blob + r.appOffset, r.appLen))).first;
+        inserted += insertSocket(cache, r.key.ipVersion, r.key.proto, &r.key.ip, r.key.port, r.inode, o, app->second, r.hash);
+    }
+    munmap(data, size);
+    log(LogLevel::INFO, "Cache snapshot loaded ", inserted, " of ", h.count, " entries in ",
+        chrono::duration<double>(chrono::steady_clock::now() - t0).count(), " s.");
+    return inserted;
+}
+
+
 }
@@ -4,14 +4,18 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 18.02.2017 22:55
- *   - Edited:  23.06.2017 12:12
+ *   - Edited:  20.10.2026 04:40
  */
 
 #pragma once
 
 #include <string>			//	string
+#include <vector>			//	vector
 
 #include "netflow.hpp"      //  Netflow
+#include "localAddresses.hpp"   //  LocalAddresses
+#include "cache.hpp"            //  Cache
+#include "appFilter.hpp"        //  AppSocket
 
 
 
@@ -20,11 +24,38 @@ namespace NAMON
 {
 
 
+//! Number of procfs accesses made by the resolver (counted only in DEBUG_BUILD)
+extern unsigned long g_procfsCalls;
+
+
+/*!
+ * @brief       Sets root directory of the procfs used to resolve sockets and applications
+ * @details     Default root is "/proc". It allows to run the resolver above
+ *              a procfs of a container or above a synthetic tree.
+ * @param[in]   root    Path to the procfs root
+ */
+void setProcfsRoot(const std::string &root);
 /*!
  * @brief       Sets mac address of #g_dev interface into #g_devMac
  * @return      False in case of I/O error. Otherwise true is returned.
  */
 int setDevMac();
+/*!
+ * @brief       Fills the address set with addresses of all interfaces
+ * @details     Opens a netlink socket subscribed to address changes and dumps current
+ *              addresses (RTM_GETADDR).
+ * @param[out]  addrs   Set of local addresses
+ * @return      Netlink socket for runAddressMonitor() or -1 on error
+ */
+int openAddressMonitor(LocalAddresses &addrs);
+/*!
+ * @brief       Keeps the address set up to date until #shouldStop is set
+ * @details     Applies RTM_NEWADDR and RTM_DELADDR notifications and closes the socket at the end.
+ *              New tables are published only when the notifications change the addresses.
+ * @param[in]   fd      Socket returned by openAddressMonitor()
+ * @param[out]  addrs   Set of local addresses
+ */
+void runAddressMonitor(int fd, LocalAddresses &addrs);
 /*!
  * @brief       Determines right procfs file of sockets using L4 protocol and IP header version
  * @param[in]   n       Netflow class with needed information
@@ -35,6 +66,7 @@ int getSocketFile(Netflow *n, std::string &file);
 
 /*!
  * @brief       Finds socket inode which belongs to Netflow n
+ * @details     The socket file is parsed line by line, sockets without an inode (e.g. TIME_WAIT) are skipped.
  * @param[in]   n           Netflow information
  * @return      False if IP version is not supported or I/O error occured. True otherwise
  */
@@ -43,9 +75,67 @@ int getInode(Netflow *n);
  * @brief       Finds an application with opened socket inode in parameter
  * @param[in]   inode   Socket inode number
  * @param[out]  appName Found application and its arguments
+ * @param[out]  owner   Process and its descriptor which holds the socket, can be nullptr
  * @return      False if I/O error occured. True otherwise
  */
-int getApp(const int inode, std::string &appName);
+int getApp(const int inode, std::string &appName, SocketOwner *owner = nullptr);
+/*!
+ * @brief       Checks if the process still holds the socket
+ * @details     Reads the link of the descriptor and the start time of the process, the rest
+ *              of the procfs isn't searched.
+ * @param[in]   inode   Socket inode number
+ * @param[in]   owner   Process which held the socket, see getApp()
+ * @return      True if the descriptor is still the socket and the process wasn't replaced
+ *              by another one with the same PID
+ */
+bool isSocketOwner(const int inode, const SocketOwner &owner);
+/*!
+ * @brief       Loads sockets of all processes into the cache before capturing starts
+ * @details     File descriptors of all processes are read once, then every socket listed
+ *              in /proc/net/{tcp,udp,udplite}[6] with a known owner is inserted with its
+ *              application, so the first packets of existing connections don't need
+ *              getInode() and getApp(). Sockets bound to the wildcard address are inserted
+ *              for every local address of their IP version. Inserted netflows have zero
+ *              times until their first packet comes.
+ * @param[out]  cache   Cache, it must not be used by other threads yet
+ * @param[in]   addrs   Local addresses used for wildcard sockets
+ * @return      Number of inserted entries or -1 if the process directories can't be read
+ */
+int prescanSockets(Cache &cache, LocalAddresses &addrs);
+/*!
+ * @brief       Finds local ports of sockets of processes matching the pattern
+ * @details     File descriptors of all processes are read once, a process matches if its command
+ *              line or the path of its executable contains the pattern. Then sockets of matching
+ *              processes are looked up in /proc/net/{tcp,udp,udplite}[6].
+ * @param[in]   pattern     Part of the command line or of the executable path
+ * @param[out]  sockets     Local ports of the sockets are appended
+ * @param[out]  exeNames    Command lines of processes matched only by their executable are appended
+ * @return      Number of found sockets or -1 if the process directories can't be read
+ */
+int findAppSockets(const std::string &pattern, std::vector<AppSocket> &sockets, std::vector<std::string> &exeNames);
+/*!
+ * @brief       Saves entries of existing sockets into a cache snapshot file
+ * @details     Every record holds the netflow key, its hash, the socket inode, the application
+ *              and the PID and start time of the socket owner, application names are stored
+ *              once after the records. Only entries whose owners still hold their sockets are saved,
+ *              each one is checked by isSocketOwner(). The file is written next to the target and
+ *              renamed over it.
+ * @param[in]   cache   Cache, it must not be changed by other threads meanwhile
+ * @param[in]   file    Snapshot file
+ * @return      Number of saved entries or -1 on error
+ */
+int saveCacheSnapshot(Cache &cache, const std::string &file);
+/*!
+ * @brief       Loads a cache snapshot made by saveCacheSnapshot() before capturing starts
+ * @details     The file is mapped into memory. Snapshots made before the last boot are ignored
+ *              as well as entries whose owner has exited or was replaced by another process with
+ *              the same PID (its start time differs). Loaded netflows have zero times until their
+ *              first packet comes.
+ * @param[out]  cache   Cache, it must not be used by other threads yet
+ * @param[in]   file    Snapshot file
+ * @return      Number of loaded entries (0 if there is no valid snapshot) or -1 on error
+ */
+int loadCacheSnapshot(Cache &cache, const std::string &file);
 
 
 }	// namespace NAMON
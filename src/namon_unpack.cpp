@@ -0,0 +1,130 @@
+/**
+ *  @file       namon_unpack.cpp
+ *  @brief      Decompressor of captures written with --compress
+ *  @details    Writes the pcapng file back, the whole one or only some frames of it. Frames
+ *              from the middle of the capture get the section header and interface description
+ *              blocks of the first frame, so the output can be opened alone. Built by make as
+ *              bin/namon_unpack, it uses only compressedOutput.cpp and what it needs.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#include <iostream>             //  cout, cerr, endl
+#include <iomanip>              //  setw()
+#include <fstream>              //  ofstream
+#include <string>               //  string, stoul()
+#include <cstdint>              //  SIZE_MAX
+#include <cstdlib>              //  EXIT_SUCCESS, EXIT_FAILURE
+#include <getopt.h>             //  getopt()
+
+#include "compressedOutput.hpp" //  CompressedReader
+
+using namespace std;
+using namespace NAMON;
+
+
+
+void printUsage()
+{
+    cout << "Usage: namon_unpack [-l] [-f <first>[-<last>]] <input> [<output>]" << endl;
+    cout << "\t-l\tLists frames of the file." << endl;
+    cout << "\t-f\tOnly frames first to last (counted from 0) are written, after the section header and interface description blocks." << endl;
+    cout << "\t<output>\tThe pcapng file, the standard output if it is - or missing." << endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    bool list = false;
+    size_t first = 0, last = SIZE_MAX;
+    int opt;
+    while ((opt = getopt(argc, argv, "lf:h")) != -1)
+    {
+        switch (opt)
+        {
+            case 'l':   list = true;    break;
+            case 'f':
+                try
+                {
+                    const string range = optarg;
+                    const size_t dash = range.find('-');
+                    first = stoul(range.substr(0, dash));
+                    last = (dash == string::npos) ? first : stoul(range.substr(dash + 1));
+                }
+                catch (std::exception &)
+                {
+                    printUsage();
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                printUsage();
+                return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+    if (optind >= argc || argc - optind > 2 || first > last)
+    {
+        printUsage();
+        return EXIT_FAILURE;
+    }
+
+    CompressedReader reader;
+    if (reader.open(argv[optind]))
+    {
+        cerr << "ERROR: '" << argv[optind] << "' is not a compressed capture." << endl;
+        return EXIT_FAILURE;
+    }
+    const vector<FrameIndex> &frames = reader.getFrames();
+    if (!reader.hasIndex())
+        cerr << "WARNING: The file has no index, it wasn't closed. Frames were found one by one." << endl;
+    if (list)
+    {
+        cout << setw(8) << "frame" << setw(16) << "offset" << setw(16) << "pcapng offset" << setw(22) << "first time stamp" << endl;
+        for (size_t i = 0; i < frames.size(); i++)
+            cout << setw(8) << i << setw(16) << frames[i].offset << setw(16) << frames[i].rawOffset << setw(22) << frames[i].timestamp << endl;
+        return EXIT_SUCCESS;
+    }
+
+    ofstream oFile;
+    const bool toStdout = (argc - optind < 2 || string(argv[optind + 1]) == "-");
+    if (!toStdout)
+    {
+        oFile.open(argv[optind + 1], ios::binary);
+        if (!oFile)
+        {
+            cerr << "ERROR: Can't open output file: '" << argv[optind + 1] << "'" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ostream &out = toStdout ? cout : oFile;
+    string data;
+    if (first > 0)
+    {
+        if (reader.readPreamble(data))
+        {
+            cerr << "ERROR: The first frame is broken." << endl;
+            return EXIT_FAILURE;
+        }
+        out.write(data.data(), data.size());
+    }
+    int ret = EXIT_SUCCESS;
+    for (size_t i = first; i < frames.size() && i <= last; i++)
+    {
+        if (reader.readFrame(i, data))
+        {   // the other frames are independent
+            cerr << "ERROR: Frame " << i << " is broken, it is skipped." << endl;
+            ret = EXIT_FAILURE;
+            continue;
+        }
+        out.write(data.data(), data.size());
+    }
+    out.flush();
+    if (!out)
+    {
+        cerr << "ERROR: Output file error." << endl;
+        return EXIT_FAILURE;
+    }
+    return ret;
+}
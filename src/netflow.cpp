@@ -4,11 +4,11 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 15.03.2017 23:27
- *   - Edited:  23.06.2017 12:03
+ *   - Edited:  20.10.2026 05:00
  */
 
 #include <iostream>				//  cout, endl
-#include <fstream>              //  ofstream
+#include <ostream>              //  ostream
 
 #if defined(__linux__)
 #include <cstring>              //  memcmp()
@@ -29,6 +29,20 @@ namespace NAMON
 {
 	
 
+uint64_t endpointHash(const void *ip, uint8_t ipVersion, const void *port, uint8_t proto, SimdLevel simd)
+{
+    FlowKey k;
+    memset(&k.ip, 0, sizeof(k.ip));
+    memcpy(&k.ip, ip, (ipVersion == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN);
+    uint16_t p;
+    memcpy(&p, port, sizeof(p));
+    k.port = NAMON::ntohs(p);
+    k.proto = proto;
+    k.ipVersion = ipVersion;
+    return (uint64_t)k.hash(simd) << 32 | k.check();
+}
+
+
 Netflow::~Netflow()                                  
 { 
     if (ipVersion == 4)
@@ -40,6 +54,8 @@ Netflow::~Netflow()
 
 bool Netflow::operator==(const Netflow& other) const
 {
+    if (hash != 0 && other.hash != 0 && hash != other.hash)
+        return false;
     if(localPort == other.localPort && proto == other.proto && ipVersion == other.ipVersion)
     {
         if (ipVersion == 4)
@@ -51,7 +67,7 @@ bool Netflow::operator==(const Netflow& other) const
 }
 
 
-unsigned int Netflow::write(std::ofstream &file)
+unsigned int Netflow::write(std::ostream &file)
 {
     unsigned int writtenBytes = 0;
     size_t size;
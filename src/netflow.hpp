@@ -4,15 +4,18 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 26.02.2017 23:13
- *   - Edited:  23.06.2017 12:03
+ *   - Edited:  20.10.2026 05:00
  */
 
 #pragma once
 
 #include <string>           //  string
+#include <ostream>          //  ostream
 #include <cstring>          //  memcpy()
+#include <utility>          //  swap()
 
 #include "tcpip_headers.hpp"	//	ip4_addr, ip6_addr, IPv4_ADDRLEN, IPv6_ADDRLEN
+#include "utils.hpp"            //  crc32c(), SimdLevel
 
 
 
@@ -24,6 +27,67 @@ namespace NAMON
 class TEntry;
 
 
+/*!
+ * @struct  FlowKey
+ * @brief   Fields which uniquely determine a netflow, packed into 20 bytes without padding
+ *          so the whole structure can be hashed and compared
+ */
+struct FlowKey
+{
+    ip6_addr ip;                //!< Local IP address (first 4 bytes for IPv4, the rest is zero)
+    uint16_t port;              //!< Local port
+    uint8_t proto;              //!< Layer 4 protocol
+    uint8_t ipVersion;          //!< IP header version
+
+    /*!
+     * @brief       Computes CRC-32C of the key, the result is the same for all levels
+     * @param[in]   simd    Instructions used, see crc32c()
+     */
+    uint32_t hash(SimdLevel simd) const     { return crc32c(this, sizeof(FlowKey), simd); }
+    /*!
+     * @brief   Computes the second half of the 64-bit hash of the key (see #NAMON::endpointHash())
+     * @details CRC-32C is linear, so the check is a multiplicative hash which doesn't collide
+     *          together with it.
+     */
+    uint32_t check() const
+    {
+        uint32_t w[5];
+        memcpy(w, this, sizeof(w));
+        const uint64_t x = w[0] * 0x9E3779B97F4A7C15ULL + w[1] * 0xC2B2AE3D27D4EB4FULL + w[2] * 0x165667B19E3779F9ULL
+                         + w[3] * 0xD6E8FEB86659FD93ULL + w[4] * 0xFF51AFD7ED558CCDULL;
+        return (uint32_t)(x >> 32);
+    }
+    /*!
+     * @brief   Compares all fields at once
+     */
+    bool operator==(const FlowKey &other) const { return memcmp(this, &other, sizeof(FlowKey)) == 0; }
+};
+static_assert(sizeof(FlowKey) == 20, "FlowKey must not contain padding");
+
+
+/*!
+ * @struct  FlowKeyHash
+ * @brief   Hash function of unordered containers keyed by #NAMON::FlowKey
+ */
+struct FlowKeyHash
+{
+    size_t operator()(const FlowKey &k) const   { return k.hash(detectSimdLevel()); }
+};
+
+
+/*!
+ * @brief       64-bit hash of the netflow key of a packet's endpoint
+ * @details     The upper half is #NAMON::FlowKey::hash() (Netflow::getHash()), the lower one is
+ *              #NAMON::FlowKey::check(). It tells keys of flows apart where CRC-32C alone may collide.
+ * @param[in]   ip          Address of the endpoint
+ * @param[in]   ipVersion   4 or 6
+ * @param[in]   port        Port of the endpoint as it is in the header (network order)
+ * @param[in]   proto       Layer 4 protocol
+ * @param[in]   simd        Instructions used, see crc32c()
+ */
+uint64_t endpointHash(const void *ip, uint8_t ipVersion, const void *port, uint8_t proto, SimdLevel simd);
+
+
 /*!
  * @class Netflow
  * @brief Netflow class contains information about packet needed to uniquely determine
@@ -39,8 +103,14 @@ class Netflow
     void *localIp           = nullptr;
     uint16_t localPort      =0;         //!< Local port
     uint8_t proto           =0;         //!< Layer 4 protocol
-    uint64_t startTime      =0;         //!< Time of the first packet which belongs to this netflow
-    uint64_t endTime        =0;         //!< Time of the last packet which belongs to this netflow
+    uint64_t startTime      =0;         //!< Time of the first packet which belongs to this netflow (units of if_tsresol)
+    uint64_t endTime        =0;         //!< Time of the last packet which belongs to this netflow (units of if_tsresol)
+    /*!
+     * @brief   CRC-32C of the netflow key, zero if it wasn't computed yet
+     * @details It is computed once by the capturing thread and moved with the netflow
+     *          through the ring buffer into the cache. Setters of key fields clear it.
+     */
+    uint32_t hash           =0;
 public:
     /*!
      * @brief Defalut constructor
@@ -59,7 +129,7 @@ public:
      * @brief       Set method for #NAMON::Netflow::ipVersion
      * @param[in]   ipV       IP header version
      */
-    void setIpVersion(uint8_t ipV)          { ipVersion = ipV; }
+    void setIpVersion(uint8_t ipV)          { ipVersion = ipV; hash = 0; }
     /*! 
      * @brief   Get method for #NAMON::Netflow::localIp
      * @return  Pointer to local IP structure
@@ -72,7 +142,7 @@ public:
      *              Then it will be freed in destructor.
      * @param[in]   newIp     Local IP structure pointer
      */
-    void setLocalIp(void *newIp)            { localIp = newIp; }
+    void setLocalIp(void *newIp)            { localIp = newIp; hash = 0; }
     /*! 
      * @brief   Get method for #NAMON::Netflow::localPort
      * @return  Local port
@@ -82,7 +152,7 @@ public:
      * @brief       Set method for #NAMON::Netflow::localPort
      * @param[in]   newPort   Local port
      */
-    void setLocalPort(uint16_t newPort)     { localPort = newPort; }
+    void setLocalPort(uint16_t newPort)     { localPort = newPort; hash = 0; }
     /*! 
      * @brief   Get method for #NAMON::Netflow::proto
      * @return  Layer 4 protocol
@@ -92,7 +162,7 @@ public:
      * @brief       Set method for #NAMON::Netflow::proto
      * @param[in]   newProto  Layer 4 protocol
      */
-    void setProto(uint8_t newProto)         { proto = newProto; }
+    void setProto(uint8_t newProto)         { proto = newProto; hash = 0; }
     /*! 
      * @brief   Get method for #NAMON::Netflow::startTime
      * @return  Time of the first packet which belongs to this netflow
@@ -113,13 +183,48 @@ public:
      * @param[in]   newTime   Time of the last packet which belongs to this netflow
      */
     void setEndTime(uint64_t newTime)       { endTime = newTime; }
+    /*!
+     * @brief   Returns the key of the netflow
+     * @pre     The local IP address is set
+     */
+    FlowKey getKey() const
+    {
+        FlowKey k;
+        memset(&k.ip, 0, sizeof(k.ip));
+        memcpy(&k.ip, localIp, (ipVersion == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN);
+        k.port = localPort;
+        k.proto = proto;
+        k.ipVersion = ipVersion;
+        return k;
+    }
+    /*!
+     * @brief   Get method for #NAMON::Netflow::hash, it is computed if it wasn't yet
+     * @return  CRC-32C of the netflow key
+     */
+    uint32_t getHash()
+    {
+        if (hash == 0)
+            hash = getKey().hash(detectSimdLevel());
+        return hash;
+    }
+    /*!
+     * @return  64-bit hash of the netflow key, the same as endpointHash() of the local endpoint
+     */
+    uint64_t getEndpointHash()              { return (uint64_t)getHash() << 32 | getKey().check(); }
+    /*!
+     * @brief       Set method for #NAMON::Netflow::hash
+     * @pre         Key fields are already set, their setters clear the hash
+     * @param[in]   h   CRC-32C of the netflow key (FlowKey::hash())
+     */
+    void setHash(uint32_t h)                { hash = h; }
     /*!
      * @brief   Function prints content of the Netflow structure to the standard output
      */
     void print();
     /*!
      * @brief   Overloaded equality operator
-     * @details Compares only netflow relevant variables
+     * @details Compares only netflow relevant variables, netflows with different
+     *          known hashes are not compared any further
      */
     bool operator==(const Netflow& other) const;
     /*!
@@ -160,6 +265,7 @@ public:
 			proto = other.proto;
 			startTime = other.startTime;
 			endTime = other.endTime;
+			hash = other.hash;
 		}
 		return *this;
 	}
@@ -184,6 +290,7 @@ public:
 			proto = other.proto;
 			startTime = other.startTime;
 			endTime = other.endTime;
+			hash = other.hash;
 
 			other.ipVersion = 0;
 			other.localIp = nullptr;
@@ -191,17 +298,36 @@ public:
 			other.proto = 0;
 			other.startTime = 0;
 			other.endTime = 0;
+			other.hash = 0;
 		}
 		return *this;
 	}
+    /*!
+     * @brief   Exchanges contents (and IP address allocations) of two netflows
+     */
+    void swap(Netflow &other)
+    {
+        std::swap(ipVersion, other.ipVersion);
+        std::swap(localIp, other.localIp);
+        std::swap(localPort, other.localPort);
+        std::swap(proto, other.proto);
+        std::swap(startTime, other.startTime);
+        std::swap(endTime, other.endTime);
+        std::swap(hash, other.hash);
+    }
     /*!
      * @brief       Writes structure into the output file
-     * @param[in]   file    The output file
+     * @param[in]   file    The output file or stream
      * @return      Amount of written data to the output file in bytes
      */
-    unsigned int write(std::ofstream & file);
+    unsigned int write(std::ostream & file);
     friend class TEntry;
 };
 
+/*!
+ * @brief   Exchanges two netflows, see Netflow::swap()
+ */
+inline void swap(Netflow &a, Netflow &b) { a.swap(b); }
+
 
 }	// namespace NAMON
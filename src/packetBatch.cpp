@@ -0,0 +1,285 @@
+/**
+ *  @file       packetBatch.cpp
+ *  @brief      Batch classification of parsed packets
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 17:50
+ *   - Edited:  19.10.2026 19:05
+ */
+
+#include <cstring>              //  memcpy(), memset()
+
+#include "packetBatch.hpp"
+
+#if defined(NAMON_X86_SIMD)
+#include <immintrin.h>          //  _mm_*(), _mm256_*()
+#endif
+
+
+
+
+namespace NAMON
+{
+
+
+//! Ethernet destination address prefixes which mean an inbound packet
+static const uint8_t MAC_MCAST4[LINK_GATHER_LEN] = { 0x01, 0x00, 0x5e };
+static const uint8_t MAC_MCAST6[LINK_GATHER_LEN] = { 0x33, 0x33 };
+static const uint8_t MAC_BCAST[LINK_GATHER_LEN]  = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+
+
+/*!
+ * @brief   Direction of an Ethernet frame from byte masks of its first 16 bytes
+ * @details Bit i of a mask is set if the i-th byte equals the i-th byte of the pattern
+ *          (devMac twice, multicast and broadcast prefixes). The same rules as
+ *          getPacketDirection(const ether_hdr *, const mac_addr &).
+ */
+static inline Directions macDirection(unsigned int dev, unsigned int mcast4, unsigned int mcast6, unsigned int bcast)
+{
+    if ((dev & 0xfc0) == 0xfc0)
+        return Directions::OUTBOUND;
+    if ((dev & 0x3f) == 0x3f || (mcast4 & 0x7) == 0x7 || (mcast6 & 0x3) == 0x3 || (bcast & 0x3f) == 0x3f)
+        return Directions::INBOUND;
+    return Directions::UNKNOWN;
+}
+
+
+/*!
+ * @brief   Byte mask of equal bytes (see macDirection())
+ */
+static inline unsigned int byteMask(const uint8_t *a, const uint8_t *b, unsigned int n)
+{
+    unsigned int m = 0;
+    for (unsigned int i = 0; i < n; i++)
+        m |= (unsigned int)(a[i] == b[i]) << i;
+    return m;
+}
+
+
+#if defined(NAMON_X86_SIMD)
+/*!
+ * @brief   MAC classification of one frame per 128-bit compare
+ */
+__attribute__((target("sse4.2")))
+static void classifyMacSse(const uint8_t (*link)[LINK_GATHER_LEN], unsigned int count, const uint8_t *pattern, Directions *dir)
+{
+    const __m128i dev = _mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern));
+    const __m128i mc4 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_MCAST4));
+    const __m128i mc6 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_MCAST6));
+    const __m128i bc = _mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_BCAST));
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(link[i]));
+        dir[i] = macDirection(_mm_movemask_epi8(_mm_cmpeq_epi8(l, dev)), _mm_movemask_epi8(_mm_cmpeq_epi8(l, mc4)),
+            _mm_movemask_epi8(_mm_cmpeq_epi8(l, mc6)), _mm_movemask_epi8(_mm_cmpeq_epi8(l, bc)));
+    }
+}
+
+
+/*!
+ * @brief   MAC classification of two frames per 256-bit compare
+ */
+__attribute__((target("avx2")))
+static void classifyMacAvx2(const uint8_t (*link)[LINK_GATHER_LEN], unsigned int count, const uint8_t *pattern, Directions *dir)
+{
+    const __m256i dev = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(pattern)));
+    const __m256i mc4 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_MCAST4)));
+    const __m256i mc6 = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_MCAST6)));
+    const __m256i bc = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(MAC_BCAST)));
+    unsigned int i = 0;
+    for (; i + 2 <= count; i += 2)
+    {
+        const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(link[i]));
+        const unsigned int d = _mm256_movemask_epi8(_mm256_cmpeq_epi8(l, dev));
+        const unsigned int m4 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(l, mc4));
+        const unsigned int m6 = _mm256_movemask_epi8(_mm256_cmpeq_epi8(l, mc6));
+        const unsigned int b = _mm256_movemask_epi8(_mm256_cmpeq_epi8(l, bc));
+        dir[i] = macDirection(d & 0xffff, m4 & 0xffff, m6 & 0xffff, b & 0xffff);
+        dir[i + 1] = macDirection(d >> 16, m4 >> 16, m6 >> 16, b >> 16);
+    }
+    if (i < count)
+        classifyMacSse(link + i, count - i, pattern, dir + i);
+}
+
+
+/*!
+ * @brief   CRC-32C of keys with the CRC32 instruction, chains of more keys overlap
+ *          in the pipeline (the same value as FlowKey::hash())
+ */
+__attribute__((target("sse4.2")))
+static void hashKeysSse42(const FlowKey *keys, unsigned int count, const Directions *dir, uint32_t *hashes)
+{
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint32_t w[5];
+        memcpy(w, &keys[i], sizeof(w));
+        uint32_t c = 0xffffffff;
+        for (int k = 0; k < 5; k++)
+            c = _mm_crc32_u32(c, w[k]);
+        hashes[i] = (dir[i] == Directions::UNKNOWN) ? 0 : ~c;
+    }
+}
+#endif
+
+
+void PacketBatch::classifyByMac(const mac_addr &devMac)
+{
+    uint8_t pattern[LINK_GATHER_LEN] = { 0 };
+    memcpy(pattern, devMac.bytes, ETHER_ADDRLEN);
+    memcpy(pattern + ETHER_ADDRLEN, devMac.bytes, ETHER_ADDRLEN);
+#if defined(NAMON_X86_SIMD)
+    if (simd == SimdLevel::AVX2)
+        return classifyMacAvx2(link, count, pattern, dir);
+    if (simd == SimdLevel::SSE42)
+        return classifyMacSse(link, count, pattern, dir);
+#endif
+    for (unsigned int i = 0; i < count; i++)
+        dir[i] = macDirection(byteMask(link[i], pattern, 12), byteMask(link[i], MAC_MCAST4, 3),
+            byteMask(link[i], MAC_MCAST6, 2), byteMask(link[i], MAC_BCAST, 6));
+}
+
+
+void PacketBatch::classifyByAddress(const LocalAddresses &local)
+{
+    if (count4)
+    {
+        uint8_t srcLocal[MAX_BATCH_SIZE], dstLocal[MAX_BATCH_SIZE];
+        local.contains4(src4, count4, srcLocal, simd);
+        local.contains4(dst4, count4, dstLocal, simd);
+        for (unsigned int j = 0; j < count4; j++)
+        {
+            // multicast (224.0.0.0/4) and limited broadcast as destination == INBOUND
+            const uint8_t *d = reinterpret_cast<const uint8_t *>(&dst4[j]);
+            const bool group = (d[0] & 0xf0) == 0xe0 || dst4[j] == 0xffffffff;
+            dir[pos4[j]] = srcLocal[j] ? Directions::OUTBOUND : (dstLocal[j] || group) ? Directions::INBOUND : Directions::UNKNOWN;
+        }
+    }
+    if (count4 == count)
+        return;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (ipVersion[i] != 6)
+            continue;
+        // multicast (ff00::/8) as destination == INBOUND
+        if (local.contains6(&src6[i]))
+            dir[i] = Directions::OUTBOUND;
+        else if (local.contains6(&dst6[i]) || dst6[i].addr.addr8[0] == 0xff)
+            dir[i] = Directions::INBOUND;
+        else
+            dir[i] = Directions::UNKNOWN;
+    }
+}
+
+
+void PacketBatch::hashKeys()
+{
+    for (unsigned int j = 0; j < count4; j++)
+    {
+        const unsigned int i = pos4[j];
+        memset(&keys[i].ip, 0, sizeof(keys[i].ip));
+        keys[i].ip.addr.addr32[0] = (dir[i] == Directions::INBOUND) ? dst4[j] : src4[j];
+    }
+    for (unsigned int i = 0; i < count; i++)
+    {
+        FlowKey &k = keys[i];
+        const bool inbound = (dir[i] == Directions::INBOUND);
+        if (ipVersion[i] == 6)
+            k.ip = inbound ? dst6[i] : src6[i];
+        uint16_t port;
+        memcpy(&port, ports[i] + (inbound ? 2 : 0), sizeof(port));
+        k.port = NAMON::ntohs(port);
+        k.proto = proto[i];
+        k.ipVersion = ipVersion[i];
+    }
+#if defined(NAMON_X86_SIMD)
+    if (simd != SimdLevel::SCALAR)
+        return hashKeysSse42(keys, count, dir, hashes);
+#endif
+    for (unsigned int i = 0; i < count; i++)
+        hashes[i] = (dir[i] == Directions::UNKNOWN) ? 0 : keys[i].hash(simd);
+}
+
+
+void PacketBatch::merge()
+{
+    uint8_t slots[MERGE_SLOTS];     // index of the netflow + 1, zero if the slot is empty
+    memset(slots, 0, sizeof(slots));
+    flowCount = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (dir[i] == Directions::UNKNOWN)
+            continue;
+        unsigned int s = hashes[i] % MERGE_SLOTS;
+        while (slots[s] && !(keys[slots[s] - 1] == keys[i]))
+            s = (s + 1) % MERGE_SLOTS;
+        if (slots[s])
+        {   // the same netflow, keys[] of merged netflows are moved to their index in flows[]
+            Netflow &n = flows[slots[s] - 1];
+            if (time[i] < n.getStartTime())
+                n.setStartTime(time[i]);
+            if (time[i] > n.getEndTime())
+                n.setEndTime(time[i]);
+            continue;
+        }
+
+        const unsigned int f = flowCount++;
+        keys[f] = keys[i];
+        slots[s] = f + 1;
+        Netflow &n = flows[f];
+        // the netflow keeps its IP address allocation if it wasn't moved into the ring buffer
+        void *ip = n.getLocalIp();
+        if (ip != nullptr && n.getIpVersion() != keys[f].ipVersion)
+        {
+            if (n.getIpVersion() == 4)
+                delete static_cast<ip4_addr*>(ip);
+            else
+                delete static_cast<ip6_addr*>(ip);
+            ip = nullptr;
+        }
+        if (keys[f].ipVersion == 4)
+        {
+            if (ip == nullptr)
+                ip = new ip4_addr;
+            memcpy(ip, &keys[f].ip, IPv4_ADDRLEN);
+        }
+        else
+        {
+            if (ip == nullptr)
+                ip = new ip6_addr;
+            memcpy(ip, &keys[f].ip, IPv6_ADDRLEN);
+        }
+        n.setLocalIp(ip);
+        n.setIpVersion(keys[f].ipVersion);
+        n.setProto(keys[f].proto);
+        n.setLocalPort(keys[f].port);
+        n.setHash(hashes[i]);
+        n.setStartTime(time[i]);
+        n.setEndTime(time[i]);
+    }
+}
+
+
+unsigned int PacketBatch::classify(const LocalAddresses &local, const mac_addr *devMac)
+{
+    switch (classification)
+    {
+        case Classification::ADDRESS:
+            classifyByAddress(local);
+            break;
+        case Classification::MAC:
+            if (devMac != nullptr)
+                classifyByMac(*devMac);
+            else
+                for (unsigned int i = 0; i < count; i++)
+                    dir[i] = Directions::UNKNOWN;
+            break;
+        case Classification::LINK:
+            break;
+    }
+    hashKeys();
+    merge();
+    return flowCount;
+}
+
+
+}	// namespace NAMON
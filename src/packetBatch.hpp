@@ -0,0 +1,183 @@
+/**
+ *  @file       packetBatch.hpp
+ *  @brief      Batch classification of parsed packets header file
+ *  @details    The capturing thread adds keys of parsed packets of one pcap_dispatch() call
+ *              into the batch and classifies them together: packet direction against
+ *              the local addresses or the device MAC address, hashes of netflow keys and
+ *              merging of packets of the same netflow. Vector instructions are used when
+ *              the CPU supports them (see #NAMON::SimdLevel).
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 17:50
+ *   - Edited:  19.10.2026 19:05
+ */
+
+#pragma once
+
+#include <cstdint>              //  uint*_t
+#include <cstring>              //  memcpy()
+
+#include "utils.hpp"            //  SimdLevel
+#include "tcpip_headers.hpp"    //  ip6_addr, mac_addr
+#include "netflow.hpp"          //  Netflow, FlowKey
+#include "localAddresses.hpp"   //  LocalAddresses
+#include "packetParser.hpp"     //  ParsedPacket, Directions
+
+
+
+
+namespace NAMON
+{
+
+
+const unsigned int      MAX_BATCH_SIZE      = 64;   //!< Maximal number of packets in a batch
+const unsigned int      LINK_GATHER_LEN     = 16;   //!< Bytes of the Ethernet header gathered for the MAC classification
+
+
+/*!
+ * @brief   An enum representing how the direction of packets in the batch is determined
+ */
+enum class Classification : uint8_t {
+    ADDRESS,    //!< By local IP addresses (see #NAMON::LocalAddresses)
+    MAC,        //!< By the device MAC address in Ethernet headers
+    LINK,       //!< The direction is known when the packet is added (Linux cooked capture)
+};
+
+
+/*!
+ * @class   PacketBatch
+ * @brief   Keys of up to #NAMON::MAX_BATCH_SIZE packets stored as arrays, so every step
+ *          of the classification runs over all packets at once
+ */
+class PacketBatch
+{
+    static const unsigned int MERGE_SLOTS = 2 * MAX_BATCH_SIZE;    //!< Size of the merging hash table
+
+    unsigned int capacity = MAX_BATCH_SIZE;                 //!< Number of packets which make the batch full
+    unsigned int count = 0;                                 //!< Number of added packets
+    unsigned int count4 = 0;                                //!< Number of added IPv4 packets
+    Classification classification = Classification::ADDRESS;   //!< How directions are determined
+    SimdLevel simd = SimdLevel::SCALAR;                     //!< Instructions used by the classification
+
+    uint8_t ipVersion[MAX_BATCH_SIZE];                      //!< IP version
+    uint8_t proto[MAX_BATCH_SIZE];                          //!< Layer 4 protocol
+    uint8_t ports[MAX_BATCH_SIZE][4];                       //!< Source and destination port as they are in the header
+    uint64_t time[MAX_BATCH_SIZE];                          //!< Time stamp (units of if_tsresol)
+    Directions dir[MAX_BATCH_SIZE];                         //!< Packet direction
+    uint8_t link[MAX_BATCH_SIZE][LINK_GATHER_LEN];          //!< Destination and source MAC address (#NAMON::Classification::MAC)
+    uint32_t src4[MAX_BATCH_SIZE];                          //!< Source addresses of IPv4 packets
+    uint32_t dst4[MAX_BATCH_SIZE];                          //!< Destination addresses of IPv4 packets
+    uint8_t pos4[MAX_BATCH_SIZE];                           //!< Index of the IPv4 packet in the batch
+    ip6_addr src6[MAX_BATCH_SIZE];                          //!< Source address of an IPv6 packet
+    ip6_addr dst6[MAX_BATCH_SIZE];                          //!< Destination address of an IPv6 packet
+    FlowKey keys[MAX_BATCH_SIZE];                           //!< Netflow keys, packets with the same key are merged
+    uint32_t hashes[MAX_BATCH_SIZE];                        //!< CRC-32C of the keys (FlowKey::hash())
+    Netflow flows[MAX_BATCH_SIZE];                          //!< Merged netflows, they keep allocated IP addresses
+    unsigned int flowCount = 0;                             //!< Number of merged netflows
+
+    /*!
+     * @brief   Determines directions of IPv4 and IPv6 packets by local addresses
+     */
+    void classifyByAddress(const LocalAddresses &local);
+    /*!
+     * @brief   Determines directions of Ethernet frames by the device MAC address
+     */
+    void classifyByMac(const mac_addr &devMac);
+    /*!
+     * @brief   Computes netflow keys and their hashes
+     */
+    void hashKeys();
+    /*!
+     * @brief   Merges packets with the same key into #NAMON::PacketBatch::flows
+     */
+    void merge();
+public:
+    /*!
+     * @brief       Sets the number of packets which make the batch full
+     * @param[in]   n   Batch size, at most #NAMON::MAX_BATCH_SIZE
+     */
+    void setCapacity(unsigned int n) { capacity = (n < MAX_BATCH_SIZE) ? n : MAX_BATCH_SIZE; }
+    /*!
+     * @brief       Sets instructions used by the classification
+     */
+    void setSimdLevel(SimdLevel level) { simd = level; }
+    /*!
+     * @brief       Sets how directions are determined
+     * @pre         The batch is empty
+     */
+    void setClassification(Classification c) { classification = c; }
+    /*!
+     * @return  How directions are determined
+     */
+    Classification getClassification() const { return classification; }
+    /*!
+     * @return  True if no packet was added since the last clear()
+     */
+    bool empty() const { return count == 0; }
+    /*!
+     * @return  True if no more packets can be added
+     */
+    bool full() const { return count >= capacity; }
+    /*!
+     * @return  Number of added packets
+     */
+    unsigned int size() const { return count; }
+    /*!
+     * @brief       Adds a parsed packet
+     * @pre         The batch is not full
+     * @param[in]   p           Parsed packet
+     * @param[in]   l4Ports     Source and destination port as they are in the header
+     * @param[in]   timestamp   Time stamp of the packet (units of if_tsresol)
+     * @param[in]   frame       Captured frame, its Ethernet header is used by #NAMON::Classification::MAC
+     * @param[in]   linkDir     Direction used by #NAMON::Classification::LINK
+     */
+    void add(const ParsedPacket &p, const unsigned char *l4Ports, uint64_t timestamp, const unsigned char *frame, Directions linkDir)
+    {
+        const unsigned int i = count++;
+        ipVersion[i] = p.ipVersion();
+        proto[i] = p.ip.proto;
+        memcpy(ports[i], l4Ports, 4);
+        time[i] = timestamp;
+        dir[i] = linkDir;
+        if (classification == Classification::MAC)
+            memcpy(link[i], frame, LINK_GATHER_LEN);
+        if (ipVersion[i] == 4)
+        {
+            memcpy(&src4[count4], p.ipHdr + 12, IPv4_ADDRLEN);
+            memcpy(&dst4[count4], p.ipHdr + 16, IPv4_ADDRLEN);
+            pos4[count4++] = i;
+        }
+        else
+        {
+            memcpy(&src6[i], p.ipHdr + 8, IPv6_ADDRLEN);
+            memcpy(&dst6[i], p.ipHdr + 24, IPv6_ADDRLEN);
+        }
+    }
+    /*!
+     * @brief       Determines directions of all packets and merges them into netflows
+     * @param[in]   local   Local addresses (#NAMON::Classification::ADDRESS)
+     * @param[in]   devMac  MAC address of the device (#NAMON::Classification::MAC), can be nullptr
+     * @return      Number of netflows, see getFlows()
+     */
+    unsigned int classify(const LocalAddresses &local, const mac_addr *devMac);
+    /*!
+     * @return  Direction of the i-th packet after classify()
+     */
+    Directions getDirection(unsigned int i) const { return dir[i]; }
+    /*!
+     * @return  Hash of the netflow key of the i-th packet after classify() (zero if its direction is unknown),
+     *          the same as Netflow::getHash() of its netflow
+     */
+    uint32_t getHash(unsigned int i) const { return hashes[i]; }
+    /*!
+     * @return  Netflows made by classify(), they may be moved away
+     */
+    Netflow *getFlows() { return flows; }
+    /*!
+     * @brief   Removes all packets, allocations of netflows are kept
+     */
+    void clear() { count = count4 = flowCount = 0; }
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,95 @@
+/** 
+ *  @file       packetParser.cpp
+ *  @brief      Link layer and IP header walkers source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 16:05
+ *   - Edited:  20.10.2026 03:40
+ */
+
+#include <cstring>              //  memcpy(), memcmp(), memset()
+
+#include "packetParser.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+bool isSupportedLinkType(int dlt)
+{
+    switch (dlt)
+    {
+        case DLT_EN10MB:
+        case DLT_LINUX_SLL:
+#if defined(DLT_LINUX_SLL2)
+        case DLT_LINUX_SLL2:
+#endif
+        case DLT_RAW:
+#if defined(DLT_IPV4)
+        case DLT_IPV4:
+        case DLT_IPV6:
+#endif
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+uint16_t toLinkType(int dlt)
+{
+    // DLT_RAW differs across platforms (12 or 14), LINKTYPE_RAW is 101
+    return (dlt == DLT_RAW) ? 101 : (uint16_t)dlt;
+}
+
+
+FragmentTable::Entry *FragmentTable::slot(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, bool &same)
+{
+    // fragments of one packet have the same addresses, identification and protocol
+    const unsigned int ipLen = (ipVersion == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
+    const unsigned char *src = ip_hdr + ((ipVersion == 4) ? 12 : 8);
+    const unsigned char *dst = src + ipLen;
+    uint32_t h = crc32c(src, 2 * ipLen, simd);
+    h = crc32c(&ip.fragId, sizeof(ip.fragId), simd, h);
+    Entry &e = entries[crc32c(&ip.proto, sizeof(ip.proto), simd, h) % SIZE];
+    same = e.proto == ip.proto && e.id == ip.fragId && e.ipVersion == ipVersion
+        && memcmp(&e.src, src, ipLen) == 0 && memcmp(&e.dst, dst, ipLen) == 0;
+    return &e;
+}
+
+
+void FragmentTable::insert(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, const unsigned char *l4_hdr, uint64_t time)
+{
+    if (entries.empty())
+        entries.resize(SIZE);
+    bool same;
+    Entry *e = slot(ip_hdr, ipVersion, ip, same);
+    const unsigned int ipLen = (ipVersion == 4) ? IPv4_ADDRLEN : IPv6_ADDRLEN;
+    const unsigned char *src = ip_hdr + ((ipVersion == 4) ? 12 : 8);
+    memcpy(&e->src, src, ipLen);
+    memcpy(&e->dst, src + ipLen, ipLen);
+    e->id = ip.fragId;
+    e->ipVersion = ipVersion;
+    e->proto = ip.proto;
+    memcpy(e->ports, l4_hdr, sizeof(e->ports));
+    e->time = time;
+}
+
+
+const uint8_t *FragmentTable::find(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, uint64_t time)
+{
+    bool same = false;
+    Entry *e = entries.empty() ? nullptr : slot(ip_hdr, ipVersion, ip, same);
+    if (!same || time > e->time + TIMEOUT)
+    {
+        unmatched++;
+        return nullptr;
+    }
+    return e->ports;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,275 @@
+/** 
+ *  @file       packetParser.hpp
+ *  @brief      Link layer and IP header walkers header file
+ *  @details    Walkers skip stacked VLAN tags and IPv6 extension headers, both with
+ *              a bounded number of steps, and find fragments. Non-first fragments
+ *              don't contain the transport layer header, their ports are found
+ *              in #NAMON::FragmentTable. #NAMON::PacketParser (packetParser.tpp) puts
+ *              the walkers together with compile-time policies.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 16:05
+ *   - Edited:  20.10.2026 03:40
+ */
+
+#pragma once
+
+#include <vector>               //  vector
+#include <cstdint>              //  uint*_t
+#include <cstring>              //  memcpy()
+#include <cstdlib>              //  EXIT_SUCCESS, EXIT_FAILURE
+#include <pcap.h>               //  DLT_*
+
+#include "tcpip_headers.hpp"    //  ether_hdr, ip4_hdr, ip6_hdr, PROTO_*
+#include "utils.hpp"            //  ntohs(), crc32c(), detectSimdLevel()
+
+
+
+
+namespace NAMON
+{
+
+
+/*!
+ * An enum representing packet flow direction
+ */
+enum class Directions : uint8_t {
+    OUTBOUND, //!< Outgoing packets
+    INBOUND,  //!< Incoming packets
+    UNKNOWN,  //!< Direction is not known
+};
+
+
+/*!
+ * @struct  IpLayer
+ * @brief   Information found by walking the IP header (and IPv6 extension headers)
+ */
+struct IpLayer
+{
+    unsigned int hdrLen = 0;    //!< Length of the IP header including extension headers
+    uint8_t proto = 0;          //!< Upper layer protocol
+    bool fragment = false;      //!< The packet is a fragment
+    uint16_t fragOffset = 0;    //!< Offset of the fragment in bytes, non-zero if it doesn't contain the L4 header
+    uint32_t fragId = 0;        //!< Identification of the fragmented packet (as it is in the header)
+};
+
+
+/*!
+ * @brief       Finds the network layer in the packet
+ * @details     Up to #MAX_VLAN_TAGS 802.1Q/802.1ad tags are skipped.
+ * @param[in]   linkType    Data link type of the capturing device (DLT_*)
+ * @param[in]   packet      Captured packet
+ * @param[in]   caplen      Number of captured bytes
+ * @param[out]  l2_size     Length of the link layer header including VLAN tags
+ * @param[out]  ether_type  #PROTO_IPv4 or #PROTO_IPv6
+ * @return      EXIT_SUCCESS if the packet contains IPv4 or IPv6, EXIT_FAILURE otherwise
+ */
+inline int parseLinkLayer(int linkType, const unsigned char *packet, unsigned int caplen, unsigned int &l2_size, unsigned short &ether_type)
+{
+    unsigned int typeOffset;
+    switch (linkType)
+    {
+        case DLT_EN10MB:
+            l2_size = ETHER_HDRLEN;
+            typeOffset = 12;
+            break;
+        case DLT_LINUX_SLL:
+            l2_size = SLL_HDRLEN;
+            typeOffset = SLL_PROTOCOL;
+            break;
+#if defined(DLT_LINUX_SLL2)
+        case DLT_LINUX_SLL2:
+            l2_size = SLL2_HDRLEN;
+            typeOffset = SLL2_PROTOCOL;
+            break;
+#endif
+        case DLT_RAW:
+#if defined(DLT_IPV4)
+        case DLT_IPV4:
+        case DLT_IPV6:
+#endif
+            // no link layer header, the IP version is in the first nibble
+            l2_size = 0;
+            if (caplen == 0)
+                return EXIT_FAILURE;
+            ether_type = ((packet[0] >> 4) == 4) ? PROTO_IPv4 : (((packet[0] >> 4) == 6) ? PROTO_IPv6 : 0);
+            return (ether_type == 0) ? EXIT_FAILURE : EXIT_SUCCESS;
+        default:
+            return EXIT_FAILURE;
+    }
+    if (caplen < l2_size)
+        return EXIT_FAILURE;
+    memcpy(&ether_type, packet + typeOffset, sizeof(ether_type));
+    if (ether_type == PROTO_IPv4 || ether_type == PROTO_IPv6)   // untagged
+        return EXIT_SUCCESS;
+    // The type of a tagged frame is followed by TCI and the next type
+    for (unsigned int tags = 0; ether_type == PROTO_VLAN || ether_type == PROTO_QINQ || ether_type == PROTO_QINQ_OLD; tags++)
+    {
+        if (tags == MAX_VLAN_TAGS || caplen < l2_size + VLAN_HDRLEN)
+            return EXIT_FAILURE;
+        memcpy(&ether_type, packet + l2_size + 2, sizeof(ether_type));
+        l2_size += VLAN_HDRLEN;
+    }
+    return (ether_type == PROTO_IPv4 || ether_type == PROTO_IPv6) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+/*!
+ * @brief       Checks if parseLinkLayer() supports the data link type
+ * @param[in]   dlt     Data link type (DLT_*)
+ */
+bool isSupportedLinkType(int dlt);
+/*!
+ * @brief       Converts libpcap data link type to the link type written into the output file
+ * @details     Most of DLT_* values are the same as LINKTYPE_* values, DLT_RAW is not.
+ * @param[in]   dlt     Data link type (DLT_*)
+ * @return      LINKTYPE_* value
+ */
+uint16_t toLinkType(int dlt);
+
+
+/*!
+ * @brief       Walks IPv4 header
+ * @param[in]   hdr     IPv4 header
+ * @param[in]   len     Number of captured bytes from the beginning of the header
+ * @param[out]  ip      Found information
+ * @return      EXIT_SUCCESS if the header is valid, EXIT_FAILURE otherwise
+ */
+inline int walkIp4(const unsigned char *hdr, unsigned int len, IpLayer &ip)
+{
+    if (len < 20)
+        return EXIT_FAILURE;
+    const ip4_hdr *h = (const ip4_hdr *)hdr;
+    ip.hdrLen = h->ihl * 4; // the length of the internet header in 32 bit words
+    if (ip.hdrLen < 20 || ip.hdrLen > len)
+        return EXIT_FAILURE;
+    ip.proto = h->ip_p;
+    const uint16_t off = NAMON::ntohs(h->ip_off);
+    ip.fragment = (off & (IPv4_MF | IPv4_OFFMASK)) != 0;
+    ip.fragOffset = (off & IPv4_OFFMASK) * 8;
+    ip.fragId = h->ip_id;
+    return EXIT_SUCCESS;
+}
+
+
+/*!
+ * @brief       Walks IPv6 header and its extension headers
+ * @details     At most #MAX_IPv6_EXT_HDRS extension headers are skipped. The walk stops
+ *              at the first header which is not an extension header (e.g. TCP, UDP, ESP).
+ * @param[in]   hdr     IPv6 header
+ * @param[in]   len     Number of captured bytes from the beginning of the header
+ * @param[out]  ip      Found information
+ * @return      EXIT_SUCCESS if the headers are valid, EXIT_FAILURE otherwise
+ */
+inline int walkIp6(const unsigned char *hdr, unsigned int len, IpLayer &ip)
+{
+    if (len < IPv6_HDRLEN)
+        return EXIT_FAILURE;
+    uint8_t nxt = ((const ip6_hdr *)hdr)->ip6_nxt;
+    unsigned int off = IPv6_HDRLEN;
+    ip.fragment = false;
+    ip.fragOffset = 0;
+    for (unsigned int i = 0; i <= MAX_IPv6_EXT_HDRS; i++)
+    {
+        unsigned int extLen;
+        switch (nxt)
+        {
+            case PROTO_HOPOPTS:
+            case PROTO_ROUTING:
+            case PROTO_DSTOPTS:
+                if (off + 2 > len)
+                    return EXIT_FAILURE;
+                extLen = (hdr[off + 1] + 1) * 8;
+                break;
+            case PROTO_FRAGMENT:
+            {
+                if (off + IPv6_FRAG_HDRLEN > len)
+                    return EXIT_FAILURE;
+                uint16_t fragOff;
+                memcpy(&fragOff, hdr + off + 2, sizeof(fragOff));
+                ip.fragment = true;
+                ip.fragOffset = NAMON::ntohs(fragOff) & IPv6_OFFMASK;
+                memcpy(&ip.fragId, hdr + off + 4, sizeof(ip.fragId));
+                extLen = IPv6_FRAG_HDRLEN;
+                break;
+            }
+            case PROTO_AH:
+                if (off + 2 > len)
+                    return EXIT_FAILURE;
+                extLen = (hdr[off + 1] + 2) * 4;
+                break;
+            case PROTO_NONXT:
+                return EXIT_FAILURE;
+            default:
+                if (off > len)
+                    return EXIT_FAILURE;
+                ip.hdrLen = off;
+                ip.proto = nxt;
+                return EXIT_SUCCESS;
+        }
+        nxt = hdr[off];
+        off += extLen;
+    }
+    return EXIT_FAILURE;
+}
+
+
+/*!
+ * @class   FragmentTable
+ * @brief   Ports of fragmented packets found in their first fragments
+ * @details Direct-mapped table indexed by the hash of addresses, identification and protocol.
+ *          A newer packet takes the slot of an older one, entries expire after
+ *          #NAMON::FragmentTable::TIMEOUT. Every capturing thread has its own table.
+ */
+class FragmentTable
+{
+    /*!
+     * @brief   Ports of one fragmented packet
+     */
+    struct Entry
+    {
+        ip6_addr src;               //!< Source address (first 4 bytes for IPv4)
+        ip6_addr dst;               //!< Destination address (first 4 bytes for IPv4)
+        uint32_t id = 0;            //!< Identification
+        uint8_t ipVersion = 0;      //!< IP version
+        uint8_t proto = 0;          //!< Layer 4 protocol, zero if the slot is empty
+        uint8_t ports[4];           //!< Source and destination port as they are in the header
+        uint64_t time = 0;          //!< Time of the first fragment [s]
+    };
+    static const unsigned int SIZE = 1024;      //!< Number of slots
+    static const unsigned int TIMEOUT = 60;     //!< Entry lifetime [s] (reassembly timeout)
+    std::vector<Entry> entries;                 //!< Table, it is allocated by the first insert()
+    unsigned long unmatched = 0;                //!< Number of non-first fragments without the first fragment
+    const SimdLevel simd = detectSimdLevel();   //!< Instructions used to hash slots
+
+    /*!
+     * @brief   Finds the slot of the packet and checks if it contains the packet
+     */
+    Entry *slot(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, bool &same);
+public:
+    /*!
+     * @brief       Stores ports of the first fragment
+     * @param[in]   ip_hdr      IP header of the fragment
+     * @param[in]   ipVersion   4 or 6
+     * @param[in]   ip          Walked IP header
+     * @param[in]   l4_hdr      Transport layer header (its first 4 bytes are ports)
+     * @param[in]   time        Time of the packet [s]
+     */
+    void insert(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, const unsigned char *l4_hdr, uint64_t time);
+    /*!
+     * @brief       Finds ports of a non-first fragment
+     * @param[in]   ip_hdr      IP header of the fragment
+     * @param[in]   ipVersion   4 or 6
+     * @param[in]   ip          Walked IP header
+     * @param[in]   time        Time of the packet [s]
+     * @return      Source and destination port as they are in the header, nullptr if the first fragment wasn't seen
+     */
+    const uint8_t *find(const unsigned char *ip_hdr, unsigned int ipVersion, const IpLayer &ip, uint64_t time);
+    /*!
+     * @return  Number of non-first fragments whose first fragment wasn't seen
+     */
+    unsigned long getUnmatched() const { return unmatched; }
+};
+
+#include "packetParser.tpp"   //  PacketParser
+
+
+}	// namespace NAMON
@@ -0,0 +1,142 @@
+/** 
+ *  @file       packetParser.tpp
+ *  @brief      Packet parser with compile-time policies
+ *  @details    The link layer and the enabled protocols are template parameters, so branches
+ *              of disabled protocols and other link types are removed from the instantiated
+ *              parser. Instances are selected once for every capturing device.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 17:20
+ *   - Edited:  19.10.2026 17:20
+ */
+
+
+/*!
+ * @brief   Link layer policy of a data link type known at compile time
+ */
+template <int DLT>
+struct StaticLink
+{
+    static int type(int) { return DLT; }    //!< Data link type, the runtime one is ignored
+};
+
+/*!
+ * @brief   Link layer policy of a data link type known at run time (the device's one)
+ */
+struct RuntimeLink
+{
+    static int type(int linkType) { return linkType; }  //!< Data link type
+};
+
+/*!
+ * @brief   Policy with network and transport protocols which are parsed
+ * @details IPv4, TCP and UDP are always parsed.
+ */
+template <bool IPv6, bool UDPLite>
+struct ProtocolSet
+{
+    static const bool ipv6 = IPv6;          //!< IPv6 is parsed
+    static const bool udplite = UDPLite;    //!< UDP-Lite is parsed
+};
+
+//! All supported protocols
+typedef ProtocolSet<true, true> AllProtocols;
+
+
+/*!
+ * @struct  ParsedPacket
+ * @brief   Headers found by #NAMON::PacketParser
+ */
+struct ParsedPacket
+{
+    unsigned int l2Len = 0;                 //!< Length of the link layer header
+    unsigned short etherType = 0;           //!< #PROTO_IPv4 or #PROTO_IPv6
+    const unsigned char *ipHdr = nullptr;   //!< IP header
+    IpLayer ip;                             //!< Walked IP header
+    const unsigned char *l4Hdr = nullptr;   //!< Transport layer header (payload of a non-first fragment)
+    unsigned int l4Len = 0;                 //!< Length of the transport layer header, zero in a non-first fragment
+
+    /*!
+     * @return  IP version of the packet
+     */
+    unsigned char ipVersion() const { return (etherType == PROTO_IPv4) ? 4 : 6; }
+};
+
+
+/*!
+ * @class   PacketParser
+ * @brief   Finds headers of packets which can be assigned to an application
+ * @tparam  Link        Link layer policy (#NAMON::StaticLink or #NAMON::RuntimeLink)
+ * @tparam  Protocols   Parsed protocols (#NAMON::ProtocolSet)
+ */
+template <class Link, class Protocols>
+struct PacketParser
+{
+    /*!
+     * @brief       Checks if the transport protocol is parsed
+     */
+    static bool accepts(uint8_t proto)
+    {
+        return proto == PROTO_TCP || proto == PROTO_UDP || (Protocols::udplite && proto == PROTO_UDPLITE);
+    }
+    /*!
+     * @brief       Checks the transport layer header
+     * @param[in]   hdr     Transport layer header
+     * @param[in]   len     Number of captured bytes from the beginning of the header
+     * @param[in]   proto   Transport protocol accepted by accepts()
+     * @param[out]  l4Len   Length of the header
+     * @return      EXIT_SUCCESS if the header is valid, EXIT_FAILURE otherwise
+     */
+    static int parseL4(const unsigned char *hdr, unsigned int len, uint8_t proto, unsigned int &l4Len)
+    {
+        if (proto == PROTO_TCP)
+        {
+            if (len < 13) // ports and data offset
+                return EXIT_FAILURE;
+            l4Len = ((const tcp_hdr *)hdr)->th_off * 4; // number of 32 bit words in the TCP header
+            return (l4Len < 20) ? EXIT_FAILURE : EXIT_SUCCESS;
+        }
+        // structure of first 4 bytes of UDP and UDP-Lite is the same (srcPort and dstPort)
+        if (len < 6) // ports and length
+            return EXIT_FAILURE;
+        // length in bytes of the UDP header and UDP data, UDP-Lite checksum coverage (0 is the whole datagram)
+        uint16_t udpLen;
+        memcpy(&udpLen, hdr + 4, sizeof(udpLen));
+        if (proto == PROTO_UDP && NAMON::ntohs(udpLen) < 8)
+            return EXIT_FAILURE;
+        l4Len = 8;
+        return EXIT_SUCCESS;
+    }
+    /*!
+     * @brief       Parses link, network and transport layer headers
+     * @param[in]   linkType    Data link type of the device (used only with #NAMON::RuntimeLink)
+     * @param[in]   packet      Captured packet
+     * @param[in]   caplen      Number of captured bytes
+     * @param[out]  p           Found headers
+     * @return      EXIT_SUCCESS if the packet can be assigned to an application, EXIT_FAILURE otherwise
+     */
+    static int parse(int linkType, const unsigned char *packet, unsigned int caplen, ParsedPacket &p)
+    {
+        if (parseLinkLayer(Link::type(linkType), packet, caplen, p.l2Len, p.etherType))
+            return EXIT_FAILURE;
+        p.ipHdr = packet + p.l2Len;
+        const unsigned int len = caplen - p.l2Len;
+        if (p.etherType == PROTO_IPv4)
+        {
+            if (walkIp4(p.ipHdr, len, p.ip))
+                return EXIT_FAILURE;
+        }
+        else if (!Protocols::ipv6 || walkIp6(p.ipHdr, len, p.ip))
+            return EXIT_FAILURE;
+        if (!accepts(p.ip.proto))
+            return EXIT_FAILURE;
+
+        p.l4Hdr = p.ipHdr + p.ip.hdrLen;
+        if (p.ip.fragOffset != 0)
+        {   // ports are in the first fragment
+            p.l4Len = 0;
+            return EXIT_SUCCESS;
+        }
+        return parseL4(p.l4Hdr, len - p.ip.hdrLen, p.ip.proto, p.l4Len);
+    }
+};
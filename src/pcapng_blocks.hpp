@@ -4,23 +4,24 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 06.03.2017 13:33
- *   - Edited:  23.06.2017 12:04
+ *   - Edited:  20.10.2026 05:00
  */
 
 #pragma once
 
 #include <cstdint>              //  uint32_t, uint16_t, uint64_t, int8_t
-#include <fstream>              //  ofstream
+#include <ostream>              //  ostream
+#include <sstream>              //  ostringstream
 #include <string>               //  string
 #include <vector>               //  vector
-#include <map>                  //  map
+#include <utility>              //  pair
 
-#if defined(__linux__)
-#include <cstring>              //  strlen()
-#endif
+#include <cstring>              //  strlen(), memcpy()
 
 #include "tcpip_headers.hpp"    //  ETHER_MAX_LEN
 #include "cache.hpp"            //  TEntry
+#include "appRegistry.hpp"      //  AppRegistry, AppResults
+#include "mappingBlock.hpp"     //  encodeMapping()
 #include "debug.hpp"            //  D()
 
 
@@ -43,8 +44,23 @@
 
 using namespace std;
 
-extern const char * g_dev;
-extern map<string, vector<NAMON::Netflow *>> g_finalResults;
+extern int g_snaplen;
+extern uint8_t g_tsresol;
+extern NAMON::AppRegistry g_apps;
+extern NAMON::AppResults g_finalResults;
+extern bool g_legacyMapping;
+
+
+/*!
+ * @brief       Converts libpcap timestamp to units of the if_tsresol option (see #g_tsresol)
+ * @details     With nanosecond precision libpcap stores nanoseconds in tv_usec.
+ * @param[in]   ts  Timestamp from pcap_pkthdr
+ * @return      Number of 10^-g_tsresol seconds since 1970-01-01 00:00:00 UTC
+ */
+inline uint64_t toTimestamp(const struct timeval &ts)
+{
+    return ts.tv_sec * (g_tsresol == 9 ? (uint64_t)1000000000 : (uint64_t)1000000) + ts.tv_usec;
+}
 
 
 
@@ -92,8 +108,7 @@ class SectionHeaderBlock {
         struct {
             UNUSED(uint16_t optionCode)     = 4;
             UNUSED(uint16_t optionLength)   = 5;
-            UNUSED(char optionValue[6])     = "namon";
-            UNUSED(uint8_t padding[3])      = {0};
+            UNUSED(char optionValue[8])     = { 'n', 'a', 'm', 'o', 'n' };  // padded to 32 bits
         } shb_userappl;
         struct endOfOption {
             UNUSED(uint16_t optionCode)     = 0;
@@ -128,9 +143,9 @@ public:
     }
     /*!
      * @brief       Writes whole block into the file
-     * @param[in]   file    The output file
+     * @param[in]   file    The output file or stream
      */
-    void write(ofstream & file)
+    void write(ostream & file)
     { 
         char * tmpPtr = reinterpret_cast<char*>(this);
         size_t partToWrite = 4+4+4+2+2+8+2+2;
@@ -143,7 +158,7 @@ public:
             file.write(&padding, sizeof(padding));
 
         tmpPtr += partToWrite + sizeof(options.shb_os.optionValue);
-        partToWrite = 2+2+5+3+2+2+4;
+        partToWrite = 2+2+8+2+2+4;
         file.write(tmpPtr, partToWrite); 
     }
 };
@@ -161,19 +176,19 @@ class InterfaceDescriptionBlock {
     UNUSED(uint32_t blockTotalLength)       = sizeof(*this) 
                                     - sizeof(options.if_name.optionValue) 
                                     - sizeof(options.if_os.optionValue);   // *** will be updated in constructor
-    UNUSED(uint16_t linkType)               = 1;        // LINKTYPE_ETHERNET(1) / LINKTYPE_IPV4(22) / LINKTYPE_IPV6(229)
+    UNUSED(uint16_t linkType)               = 1;        // *** will be updated in constructor, LINKTYPE_ETHERNET(1) / LINKTYPE_RAW(101) / LINKTYPE_LINUX_SLL(113) / ...
     UNUSED(uint16_t reserved)               = 0;        // must be filled with 0, and ignored by file readers
-    UNUSED(uint32_t snapLen)                = BUFSIZ;
+    UNUSED(uint32_t snapLen)                = g_snaplen;
     struct {
         struct {
             UNUSED(uint16_t optionCode)     = 2;
-            UNUSED(uint16_t optionLength)   = strlen(g_dev);
-            UNUSED(const char *optionValue) = g_dev;
+            UNUSED(uint16_t optionLength)   = 0;        // *** will be updated in constructor
+            UNUSED(const char *optionValue) = nullptr;  // *** will be updated in constructor
         } if_name;
         struct {
             UNUSED(uint16_t optionCode)     = 9;
-            UNUSED(uint16_t optionLength)   = 1;        //! @todo   Find out what value to assign
-            UNUSED(uint32_t optionValue)    = 6;        //! @todo   Find out what value to assign
+            UNUSED(uint16_t optionLength)   = 1;
+            UNUSED(uint32_t optionValue)    = g_tsresol;    // 1 byte + padding, 10^-g_tsresol s
         } if_tsresol;
         struct {
             UNUSED(uint16_t optionCode)     = 12;
@@ -192,9 +207,14 @@ public:
      * @brief       Class constructor that sets options lengths and block total length
      * @todo        performed on vs performed at
      * @param[in]   os  Platform and version of the OS, the capturing was performed on
+     * @param[in]   dev Name of the capturing device
+     * @param[in]   lt  LINKTYPE_* value of the device
      */
-    InterfaceDescriptionBlock(string & os) 
+    InterfaceDescriptionBlock(string & os, const char *dev, uint16_t lt = 1) 
     { 
+        linkType = lt;
+        options.if_name.optionLength = strlen(dev);
+        options.if_name.optionValue = dev;
         int len = os.length();
         options.if_os.optionLength = len;
         options.if_os.optionValue = new char[len];
@@ -212,9 +232,9 @@ public:
     }
     /*!
      * @brief       Writes the whole block into the file
-     * @param[in]   file    The output file
+     * @param[in]   file    The output file or stream
      */
-    void write(ofstream & file)
+    void write(ostream & file)
     { 
         char * tmpPtr = reinterpret_cast<char*>(this);
         size_t partToWrite = 4+4+2+2+4+2+2;
@@ -249,7 +269,7 @@ public:
  */
 class EnhancedPacketBlock {
     UNUSED(uint32_t blockType)              = 0x00000006;
-    UNUSED(uint32_t blockTotalLength)       = sizeof(*this)-sizeof(allocatedBytes)-sizeof(packetData);    // will be updated in write()
+    UNUSED(uint32_t blockTotalLength)       = 8 * sizeof(uint32_t);   // will be updated in write()
     UNUSED(uint32_t interfaceID)            = 0;
     UNUSED(uint32_t timestampHi)            = 0;
     UNUSED(uint32_t timestampLo)            = 0;
@@ -258,6 +278,22 @@ class EnhancedPacketBlock {
     UNUSED(size_t allocatedBytes)           = ETHERMTU; // not in EnhancedPacketBlock
     UNUSED(uint8_t *packetData)              = nullptr;
     UNUSED(uint32_t blockTotalLength2)      = blockTotalLength;
+    UNUSED(uint64_t endpointHashes[2])      = { 0, 0 };  // not in EnhancedPacketBlock, see setEndpoints()
+    UNUSED(uint64_t arrival)                = 0;         // not in EnhancedPacketBlock, see setEndpoints()
+
+    //! Option with the application ID: custom binary option (2989) with the PEN, end of options
+    struct AppOption {
+        UNUSED(uint16_t optionCode)         = 2989;
+        UNUSED(uint16_t optionLength)       = 8;
+        UNUSED(uint32_t pen)                = 0x1234;   //! @todo PEN, the same as in CustomBlock
+        UNUSED(uint32_t appId)              = 0;
+        UNUSED(uint16_t endCode)            = 0;
+        UNUSED(uint16_t endLength)          = 0;
+    };
+    /*!
+     * @return  Length of the fixed part of the block which is written at once
+     */
+    size_t headerLength() const { return reinterpret_cast<const char*>(&allocatedBytes) - reinterpret_cast<const char*>(this); }
 public:
     /*!
      * @brief   Default c'tor that preallocates memory for packet
@@ -276,6 +312,17 @@ public:
      * @param[in]   timestamp   Packet timestamp
      */
     void setTimestamp(uint64_t timestamp) { timestampLo = timestamp & 0xffffffff; timestampHi = timestamp >> 32; }
+    /*!
+     * @brief   Get method for #NAMON::EnhancedPacketBlock::timestampHi 
+     *           and #NAMON::EnhancedPacketBlock::timestampLo
+     * @return  Packet timestamp
+     */
+    uint64_t getTimestamp() const { return (uint64_t)timestampHi << 32 | timestampLo; }
+    /*!
+     * @brief       Set method for #NAMON::EnhancedPacketBlock::interfaceID
+     * @param[in]   id  Index of the Interface Description Block of the capturing interface
+     */
+    void setInterfaceID(uint32_t id) { interfaceID = id; }
     /*!
      * @brief       Set method for #NAMON::EnhancedPacketBlock::capturedPacketLength
      * @param[in]   len Captured length
@@ -286,6 +333,23 @@ public:
      * @param[in]   len Length of the packet as it was on the wire
      */
     void setOriginalPacketLength(uint32_t len) { originalPacketLength = len; }
+    /*!
+     * @brief       Sets hashes of netflow keys of both endpoints, one of them is local
+     * @details     They are used to find the application of the packet (see #NAMON::FlowApps).
+     * @param[in]   src     Hash of the source endpoint (see #NAMON::endpointHash()), zero if it isn't known
+     * @param[in]   dst     Hash of the destination endpoint
+     * @param[in]   time    When the packet was stored (steady clock, in nanoseconds)
+     */
+    void setEndpoints(uint64_t src, uint64_t dst, uint64_t time) { endpointHashes[0] = src; endpointHashes[1] = dst; arrival = time; }
+    /*!
+     * @param[in]   i   0 for the source, 1 for the destination endpoint
+     * @return      Hash of the endpoint, zero if it isn't known
+     */
+    uint64_t getEndpoint(unsigned int i) const { return endpointHashes[i]; }
+    /*!
+     * @return  When the packet was stored (steady clock, in nanoseconds)
+     */
+    uint64_t getArrival() const { return arrival; }
     /*!
      * @brief       Set method for #NAMON::EnhancedPacketBlock::packetData
      * @details     Copies a memory pointed by ptr into the preallocated space.
@@ -308,23 +372,114 @@ public:
         memcpy((void*)packetData, ptr, len); 
         capturedPacketLength = len; 
     }
+    /*!
+     * @param[in]   app     Application of the packet, #NAMON::NO_APP means no option
+     * @return      Length of the block written by write()
+     */
+    uint32_t getBlockLength(NAMON::AppId app = NAMON::NO_APP) const
+    {
+        return headerLength() + sizeof(blockTotalLength2) + capturedPacketLength + computePaddingLen(capturedPacketLength, 4)
+               + (app != NAMON::NO_APP ? sizeof(AppOption) : 0);
+    }
+    /*!
+     * @brief       Copies the same bytes as write() into the memory
+     * @param[out]  dst     Memory of getBlockLength() bytes
+     * @param[in]   app     Application of the packet written in an option, #NAMON::NO_APP means no option
+     */
+    void copyTo(uint8_t *dst, NAMON::AppId app = NAMON::NO_APP) const
+    {
+        const uint32_t len = getBlockLength(app);
+        const size_t header = headerLength();
+        const int paddingLen = computePaddingLen(capturedPacketLength, 4);
+        memcpy(dst, this, header);
+        memcpy(dst + sizeof(blockType), &len, sizeof(len));
+        dst += header;
+        memcpy(dst, packetData, capturedPacketLength);
+        dst += capturedPacketLength;
+        memset(dst, 0, paddingLen);
+        dst += paddingLen;
+        if (app != NAMON::NO_APP)
+        {
+            AppOption option;
+            option.appId = app;
+            memcpy(dst, &option, sizeof(option));
+            dst += sizeof(option);
+        }
+        memcpy(dst, &len, sizeof(len));
+    }
     /*!
      * @brief       Writes whole block into the output file
-     * @param[in]   file    The output file
+     * @param[in]   file    The output file or stream
+     * @param[in]   app     Application of the packet written in an option, #NAMON::NO_APP means no option
      */
-    void write(ofstream & file)
+    void write(ostream & file, NAMON::AppId app = NAMON::NO_APP)
     { 
         const char padding = 0;
         int paddingLen = computePaddingLen(capturedPacketLength, 4);
-        blockTotalLength += capturedPacketLength + paddingLen;  // because of += everytime when write() is called, we have to restore default length before the function returns
+        AppOption option;
+        option.appId = app;
+        const uint32_t emptyLength = headerLength() + sizeof(blockTotalLength2);
+        blockTotalLength = emptyLength + capturedPacketLength + paddingLen + (app != NAMON::NO_APP ? sizeof(option) : 0);
         blockTotalLength2 = blockTotalLength;
 
-        file.write(reinterpret_cast<char*>(this), sizeof(*this)-sizeof(blockTotalLength2)-sizeof(packetData)-sizeof(allocatedBytes));
+        file.write(reinterpret_cast<char*>(this), headerLength());
         file.write(reinterpret_cast<const char*>(packetData), capturedPacketLength);
         while(paddingLen--)
             file.write(&padding, sizeof(padding));
+        if (app != NAMON::NO_APP)
+            file.write(reinterpret_cast<char*>(&option), sizeof(option));
         file.write(reinterpret_cast<char*>(&blockTotalLength2), sizeof(blockTotalLength2));
-        blockTotalLength = sizeof(*this)-sizeof(allocatedBytes)-sizeof(packetData);    // restore default size of empty block
+        blockTotalLength = emptyLength;    // restore default size of empty block
+    }
+};
+
+
+
+/*!
+ * @class   AppNameBlock
+ * @brief   Custom block with names of applications whose IDs are in options of packets
+ * @details The block can be copied with the packets (type 0x00000BAD). It is written before
+ *          the first packet with any of its IDs, so every name is in the file once. Body:
+ *          "NMA1" and for every application its ID (uint32_t), length of its name (uint16_t)
+ *          and the name.
+ */
+class AppNameBlock {
+    UNUSED(uint32_t blockType)              = 0x00000BAD;
+    UNUSED(uint32_t PrivateEnterpriseNumber)= 0x1234;   //! @todo PEN
+public:
+    /*!
+     * @brief       Builds the whole block with the names in memory
+     * @param[in]   names   IDs and names of applications
+     * @return      The block
+     */
+    string build(const vector<pair<NAMON::AppId, string>> & names) const
+    {
+        string block(3 * sizeof(uint32_t), '\0');   // type, length and PEN are set below
+        block.append("NMA1", 4);
+        for (const auto & n : names)
+        {
+            const uint16_t len = (n.second.length() < 0xffff) ? n.second.length() : 0xffff;
+            block.append(reinterpret_cast<const char*>(&n.first), sizeof(n.first));
+            block.append(reinterpret_cast<const char*>(&len), sizeof(len));
+            block.append(n.second, 0, len);
+        }
+        block.append(computePaddingLen(block.size(), 4), '\0');
+        const uint32_t blockTotalLength = block.size() + sizeof(blockTotalLength);
+        memcpy(&block[0], &blockType, sizeof(blockType));
+        memcpy(&block[4], &blockTotalLength, sizeof(blockTotalLength));
+        memcpy(&block[8], &PrivateEnterpriseNumber, sizeof(PrivateEnterpriseNumber));
+        block.append(reinterpret_cast<const char*>(&blockTotalLength), sizeof(blockTotalLength));
+        return block;
+    }
+    /*!
+     * @brief       Writes the block with the names into the file at once
+     * @param[in]   file    The output file or stream
+     * @param[in]   names   IDs and names of applications
+     */
+    void write(ostream & file, const vector<pair<NAMON::AppId, string>> & names)
+    {
+        const string block = build(names);
+        file.write(block.data(), block.size());
     }
 };
 
@@ -348,22 +503,57 @@ public:
         { }
     /*!
      * @brief       Writes the whole block into the file
-     * @param[in]   file    The output file
+     * @details     The columnar encoding (see mappingBlock.hpp) is used unless #g_legacyMapping is set.
+                    Both are built in memory, so the output doesn't have to be seekable (e.g. a pipe).
+     * @param[in]   file    The output file or stream
+     */
+    void write(ostream & file)
+    {
+        if (g_legacyMapping)
+            writeLegacy(file);
+        else
+            writeColumnar(file);
+    }
+    /*!
+     * @brief       Builds the block with netflows in columns in memory and writes it at once
+     * @param[in]   file    The output file or stream
+     */
+    void writeColumnar(ostream & file)
+    {
+        string block(3 * sizeof(uint32_t), '\0');   // type, length and PEN are set below
+        NAMON::encodeMapping(g_apps, g_finalResults, block);
+        block.append(computePaddingLen(block.size(), 4), '\0');
+        blockTotalLength = block.size() + sizeof(blockTotalLength2);
+        blockTotalLength2 = blockTotalLength;
+        memcpy(&block[0], &blockType, sizeof(blockType));
+        memcpy(&block[4], &blockTotalLength, sizeof(blockTotalLength));
+        memcpy(&block[8], &PrivateEnterpriseNumber, sizeof(PrivateEnterpriseNumber));
+        block.append(reinterpret_cast<char*>(&blockTotalLength2), sizeof(blockTotalLength2));
+        file.write(block.data(), block.size());
+    }
+    /*!
+     * @brief       Builds the block with a name and netflows of every application record by record and writes it at once
+     * @param[in]   file    The output file or stream
      * @todo        dat do dokumentacie, ze in_addr velkost sa moze menit (je tam long) takze musi sediet pocet netflow zaznameov a velkost tam niekam doplnit
      */
-    void write(ofstream & file)
+    void writeLegacy(ostream & file)
     { 
-        file.write(reinterpret_cast<char*>(&blockType), sizeof(blockType));
-        streamoff pos_blockTotalLength = file.tellp();
-        file.write(reinterpret_cast<char*>(&blockTotalLength), sizeof(blockTotalLength));
-        file.write(reinterpret_cast<char*>(&PrivateEnterpriseNumber), sizeof(PrivateEnterpriseNumber));
+        ostringstream block;    // the length is known at the end, it is set before the block is written
+        block.write(reinterpret_cast<char*>(&blockType), sizeof(blockType));
+        block.write(reinterpret_cast<char*>(&blockTotalLength), sizeof(blockTotalLength));
+        block.write(reinterpret_cast<char*>(&PrivateEnterpriseNumber), sizeof(PrivateEnterpriseNumber));
         
         unsigned int writtenBytes = 0;
         string appname;
-        for (auto app : g_finalResults)
+        g_finalResults.sort();
+        // every name is written once, followed by all netflows of the application in order of their start time
+        for (NAMON::AppId id = 1; id < g_apps.size(); id++)
         {
-            uint8_t size = app.first.length();
-            appname = app.first;
+            const vector<NAMON::Netflow *> &flows = g_finalResults.get(id);
+            if (flows.empty())
+                continue;
+            uint8_t size = g_apps.name(id).length();
+            appname = g_apps.name(id);
 #ifdef _WIN32 // windows appname is in quotes
 /*
             if (appname[0] == '"')
@@ -377,38 +567,38 @@ public:
                 log(LogLevel::ERR, "Should not happen");
 */
 #else // linux sometimes does not have terminating \0 in /proc/pid/fd/cmdline
-            if (app.first[size - 1] != '\0')
+            if (appname[size - 1] != '\0')
             {
                 size++;
                 appname.append(1,'\0');           // append terminating \0
             }
 #endif
 
-            file.write(reinterpret_cast<char*>(&size), sizeof(size));
+            block.write(reinterpret_cast<char*>(&size), sizeof(size));
             writtenBytes += sizeof(size);
 
-            file.write(appname.c_str(), size);
+            block.write(appname.c_str(), size);
             writtenBytes += size;
 
-            //! @todo app.second->sort()
-            uint32_t records = app.second.size();
-            file.write(reinterpret_cast<char*>(&records), sizeof(records));
+            uint32_t records = flows.size();
+            block.write(reinterpret_cast<char*>(&records), sizeof(records));
             writtenBytes += sizeof(records);
-            for (auto v : app.second)
-                writtenBytes += v->write(file);
+            for (auto v : flows)
+                writtenBytes += v->write(block);
         }
 
         const char padding = 0;
         int paddingLen = computePaddingLen(writtenBytes, 4);
         blockTotalLength += writtenBytes + paddingLen;
         while(paddingLen--)
-            file.write(&padding, sizeof(padding));
+            block.write(&padding, sizeof(padding));
 
         blockTotalLength2 = blockTotalLength;
-        file.write(reinterpret_cast<char*>(&blockTotalLength2), sizeof(blockTotalLength2)); 
+        block.write(reinterpret_cast<char*>(&blockTotalLength2), sizeof(blockTotalLength2)); 
 
-        file.seekp(pos_blockTotalLength);
-        file.write(reinterpret_cast<char*>(&blockTotalLength), sizeof(blockTotalLength)); 
+        string data = block.str();
+        memcpy(&data[sizeof(blockType)], &blockTotalLength, sizeof(blockTotalLength));
+        file.write(data.data(), data.size());
     }
 };
 
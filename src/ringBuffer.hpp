@@ -4,19 +4,30 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 22.03.2017 17:04
- *   - Edited:  23.06.2017 12:04
+ *   - Edited:  20.10.2026 05:00
  */
 
 #pragma once
 
 #include <vector>               //  vector
+#include <map>                  //  map
+#include <deque>                //  deque
+#include <string>               //  string, stoul()
 #include <atomic>               //  atomic
 #include <mutex>                //  mutex
 #include <thread>               //  thread()
 #include <condition_variable>   //  condition_variable
+#include <functional>           //  bind(), function
+#include <memory>               //  shared_ptr
+#include <chrono>               //  steady_clock
 #include <pcap.h>               //  pcap_pkthdr
 
-#include "pcapng_blocks.hpp"    //  EnhancedPacketBlock
+#include "pcapng_blocks.hpp"    //  EnhancedPacketBlock, AppNameBlock
+#include "flowApps.hpp"         //  FlowApps
+#include "appFiles.hpp"         //  AppFiles
+#include "appFilter.hpp"        //  AppFilter
+#include "ipfixExporter.hpp"    //  IpfixExporter
+#include "shmStream.hpp"        //  ShmStream
 #include "namon.hpp"             //  determineApp()
 
 extern std::atomic<int> shouldStop;
@@ -28,6 +39,72 @@ namespace NAMON
 {
 
 
+/*!
+ * @brief   An enum representing what a pipeline stage does when its buffer can't keep up
+ */
+enum class OverloadPolicy : uint8_t {
+    DROP,       //!< New elements are dropped when the buffer is full
+    SAMPLE,     //!< Above the high watermark only every n-th element is accepted
+    TRUNCATE,   //!< Above the high watermark packets are stored truncated to n bytes (headers)
+    SPILL,      //!< When the buffer is full, up to n elements are kept in an overflow queue
+};
+
+/*!
+ * @struct  StagePolicy
+ * @brief   Overload policy of one pipeline stage and its parameter
+ */
+struct StagePolicy
+{
+    OverloadPolicy policy = OverloadPolicy::DROP;   //!< Policy
+    unsigned int param = 0;                         //!< Sampling rate, truncation length or spill capacity
+};
+
+//! How long the merging writer waits for a packet from an empty buffer before it writes newer packets
+const std::chrono::milliseconds MERGE_WAIT{ 100 };
+//! How often the writer checks whether the cache found the application of a held packet
+const std::chrono::milliseconds ANNOTATE_POLL{ 1 };
+
+//! Default parameters of #NAMON::OverloadPolicy policies
+const unsigned int      DEFAULT_SAMPLE_RATE     = 10;
+const unsigned int      DEFAULT_TRUNCATE_LEN    = 128;
+const unsigned int      DEFAULT_SPILL_CAPACITY  = 20000;
+
+/*!
+ * @brief       Parses overload policy in format <drop|sample|truncate|spill>[:<n>]
+ * @param[in]   str             Policy description
+ * @param[out]  p               Parsed policy
+ * @param[in]   allowTruncate   Whether the stage stores packets which can be truncated
+ * @return      Zero on success, -1 if the description is invalid
+ */
+inline int parseStagePolicy(const std::string &str, StagePolicy &p, bool allowTruncate)
+{
+    const size_t colon = str.find(':');
+    const std::string name = str.substr(0, colon);
+    if (name == "drop")
+        p = { OverloadPolicy::DROP, 0 };
+    else if (name == "sample")
+        p = { OverloadPolicy::SAMPLE, DEFAULT_SAMPLE_RATE };
+    else if (name == "truncate" && allowTruncate)
+        p = { OverloadPolicy::TRUNCATE, DEFAULT_TRUNCATE_LEN };
+    else if (name == "spill")
+        p = { OverloadPolicy::SPILL, DEFAULT_SPILL_CAPACITY };
+    else
+        return -1;
+
+    if (colon != std::string::npos)
+    {
+        if (p.policy == OverloadPolicy::DROP || colon + 1 >= str.length())
+            return -1;
+        size_t end = 0;
+        try { p.param = std::stoul(str.substr(colon + 1), &end); }
+        catch (std::exception &) { return -1; }
+        if (end != str.length() - colon - 1 || p.param == 0)
+            return -1;
+    }
+    return 0;
+}
+
+
 /*!
  * @class   RingBuffer
  * @brief   Class used to mask speed difference between network interface and hard drive
@@ -46,11 +123,69 @@ class RingBuffer
 	std::atomic_size_t size{ 0 };    // zero initialized by default (not on Linux !!!)
 	//! @brief  Number of dropped elements
 	unsigned int droppedElem = 0;
+	//! @brief  What to do when the buffer can't keep up
+	StagePolicy policy;
+	//! @brief  Number of elements skipped by sampling
+	unsigned int sampledOutElem = 0;
+	//! @brief  Number of truncated packets
+	unsigned int truncatedElem = 0;
+	//! @brief  Number of elements which went through the overflow queue
+	unsigned int spilledElem = 0;
+	//! @brief  Counter used to pick every n-th element during sampling
+	unsigned int sampleCounter = 0;
+	//! @brief  Overflow queue used by #NAMON::OverloadPolicy::SPILL
+	std::deque<T> spill;
+	//! @brief  Number of elements in #NAMON::RingBuffer::spill
+	std::atomic_size_t spillSize{ 0 };
+	//! @brief  Mutex used to lock #NAMON::RingBuffer::spill
+	std::mutex m_spill;
+
+	//! @brief  Overflow queue taken by the consumer, it is older than anything in the buffer
+	std::deque<T> spilled;
 
-	//! @brief  Mutex used to lock #NAMON::RingBuffer::m_condVar
-	std::mutex m_condVar;
-	//! @brief  Condition variable used to notify thread when a new packet is stored in the buffer
-	std::condition_variable cv_condVar;
+	/*!
+	 * @brief   Condition variable used to notify thread when a new packet is stored in the buffer
+	 *          and the mutex used to lock it
+	 */
+	struct Wakeup
+	{
+		std::mutex m_condVar;                   //!< Mutex used to lock cv_condVar
+		std::condition_variable cv_condVar;     //!< Condition variable
+	};
+	//! @brief  Wakeup of the consumer, buffers read by one thread share it
+	std::shared_ptr<Wakeup> wakeup = std::make_shared<Wakeup>();
+
+	/*!
+	 * @brief   An enum representing how a new element is admitted to the buffer
+	 */
+	enum class Admission { STORE, TRUNCATE, SPILL, REJECT };
+	/*!
+	 * @brief       Decides what to do with a new element according to #NAMON::RingBuffer::policy
+	 *              and updates the policy counters
+	 * @param[in]   pending Number of elements stored by the producer but not yet counted in #NAMON::RingBuffer::size
+	 */
+	Admission admit(size_t pending = 0);
+	/*!
+	 * @brief       Processes all elements in the buffer and then in the overflow queue
+	 * @param[in]   process  Function called for every element
+	 */
+	template <class F>
+	void consume(F process);
+	/*!
+	 * @brief   Returns the oldest element in the buffer or in the overflow queue (consumer only)
+	 * @return  Pointer to the element or nullptr if there is none
+	 */
+	T * front();
+	/*!
+	 * @brief   Removes the element returned by #NAMON::RingBuffer::front()
+	 */
+	void popFront();
+	/*!
+	 * @brief   Processes a netflow in the cache and publishes its application (if apps is not nullptr)
+	 * @details The rest of an expired entry is exported before the entry is checked (if ipfix is not nullptr).
+	 *          The socket of a newly resolved flow is added to the kernel filter of --app (if filter is not nullptr).
+	 */
+	static void processNetflow(T &n, Cache *cache, FlowApps *apps, IpfixExporter *ipfix, AppFilter *filter);
 public:
     /*!
      * @brief       Constructor with size as parameter
@@ -58,6 +193,18 @@ public:
      */
 	RingBuffer(size_t cap) : buffer(cap) {}
 	/*!
+     * @brief       Sets the overload policy of the stage
+     * @param[in]   p   New policy
+     */
+	void setPolicy(const StagePolicy &p) { policy = p; }
+	/*!
+     * @brief       Makes the buffer notify the same condition variable as the other one,
+     *              so one thread can wait for more buffers
+     * @pre         No thread uses any of the buffers yet
+     * @param[in]   other   Buffer read by the same thread
+     */
+	void shareWakeup(const RingBuffer &other) { wakeup = other.wakeup; }
+	/*!
      * @return  True if the buffer is empty
      */
 	bool empty() const { return size == 0; }
@@ -66,24 +213,60 @@ public:
      */
 	bool full() const { return size == buffer.size(); }
 	/*!
+     * @return  True if the buffer is above the high watermark (3/4 of the capacity) or it spilled
+     */
+	bool overloaded() const { return size >= buffer.size() - buffer.size() / 4 || spillSize || !spilled.empty(); }
+	/*!
      * @brief   Get method for #NAMON::RingBuffer::droppedElem
      * @return  Number of dropped elements
      */
 	unsigned int getDroppedElem() { return droppedElem; }
 	/*!
+     * @return  Number of elements skipped by sampling
+     */
+	unsigned int getSampledOutElem() { return sampledOutElem; }
+	/*!
+     * @return  Number of packets stored truncated
+     */
+	unsigned int getTruncatedElem() { return truncatedElem; }
+	/*!
+     * @return  Number of elements which went through the overflow queue
+     */
+	unsigned int getSpilledElem() { return spilledElem; }
+	/*!
+     * @brief       Prints the stage's counters to the standard output
+     * @param[in]   name    Name of the stage
+     * @param[in]   unit    What the stage stores (packets, netflows)
+     */
+	void printStats(const char *name, const char *unit);
+	/*!
      * @brief       Saves new structure into the buffer
      * @details     Function moves object.
      * @param[in]   elem     Pointer to new element to push
-     * @return      False if packet was dropped. True otherwise.
+     * @return      Zero if the element was accepted (stored or spilled), one otherwise.
      */
 	int push(T &elem);
 	/*!
+     * @brief       Saves more elements into the buffer at once
+     * @details     Elements are swapped with free slots of the buffer, so the producer gets back
+     *              elements which the consumer has finished with and can reuse their allocations.
+     *              The consumer is notified once after all of them are stored.
+     * @param[in,out]   elems   Elements to push
+     * @param[in]       count   Number of elements
+     * @return      Number of rejected elements (they are not changed)
+     */
+	size_t push(T *elems, size_t count);
+	/*!
      * @brief       Saves new packet into the buffer as EnhancedPacketBlock
      * @param[in]   header  libpcap header
      * @param[in]   packet  pointer to packet data
-     * @return      False if packet was dropped. True otherwise.
+     * @param[in]   caplen  Number of bytes to store (at most header->caplen)
+     * @param[in]   interfaceID Index of the interface's IDB in the output file
+     * @param[in]   endpoints   Hashes of the source and destination endpoint used to annotate
+     *                          the packet (see #NAMON::EnhancedPacketBlock::setEndpoints()), can be nullptr
+     * @return      Zero if the packet was accepted (stored, truncated or spilled), one otherwise.
      */
-	int push(const pcap_pkthdr *header, const u_char *packet);
+	int push(const pcap_pkthdr *header, const u_char *packet, uint32_t caplen, uint32_t interfaceID, const uint64_t *endpoints = nullptr);
 	/*!
      * @brief   Moves #NAMON::RingBuffer::first to the next element
      */
@@ -97,22 +280,62 @@ public:
      * @details Because #NAMON::RingBuffer::m_condVar is private member of this class this method
      *           is used to notify threads from main.
      */
-	void notifyCondVar() { cv_condVar.notify_all(); }
+	void notifyCondVar() { wakeup->cv_condVar.notify_all(); }
 	/*!
      * @brief   Callback function that is called when m_condVar.notify_*() is called
      * @return  True if the thread should stop or a new packet is saved into the buffer
      */
-	bool newItemOrStop() { return !empty() || shouldStop; }
+	bool newItemOrStop() { return hasItems() || shouldStop; }
+	/*!
+     * @return  True if the buffer or the overflow queue contain some element
+     */
+	bool hasItems() { return !empty() || spillSize || !spilled.empty(); }
 	/*!
      * @brief       Writes whole buffer into the #oFile
-     * @param[in]   file    The output file
+     * @param[in]   file    The output file or stream
+     */
+	void write(ostream &file);
+	/*!
+     * @brief       Writes packets from more buffers into the file ordered by their timestamps
+     * @details     When some buffer is empty, packets from the other ones are written after
+     *              #NAMON::MERGE_WAIT at latest. When packets are annotated, a packet whose flow
+     *              the cache hasn't processed yet is held up to delay after it was stored, unless
+     *              its buffer is overloaded. Names of applications are written before their first packet
+     *              in every file. When packets are split, they are written into the file of their application.
+     *              When packets are filtered, only packets of matching applications are written.
+     *              Written packets are copied into the shared memory stream too, always with their application.
+     * @pre         All buffers share the wakeup (see #NAMON::RingBuffer::shareWakeup())
+     * @param[in]   rings   Buffers to merge
+     * @param[in]   file    The output file or stream, a stream which doesn't keep up only holds up this thread
+     * @param[in]   apps    Applications published by the cache, nullptr if packets are not annotated, split nor filtered
+     * @param[in]   delay   The longest time a packet is held
+     * @param[in]   annotate    Packets get an option with the ID of their application
+     * @param[in]   split   Files of applications, nullptr if packets are not split
+     * @param[in]   filter  Applications whose packets are written, nullptr if all of them are
+     * @param[in]   shm     Shared memory stream which gets the written packets with their applications, can be nullptr
      */
-	void write(ofstream &file);
+	static void write(const std::vector<RingBuffer *> &rings, ostream &file,
+					  FlowApps *apps = nullptr, std::chrono::milliseconds delay = std::chrono::milliseconds(0),
+					  bool annotate = true, AppFiles *split = nullptr, AppFilter *filter = nullptr, ShmStream *shm = nullptr);
 	/*!
      * @brief       Runs searching received packets in cache and determining applications for them
      * @param[out]  c Cache which will be fileld
      */
 	void run(Cache *c);
+	/*!
+     * @brief       Runs the cache above netflows from more buffers
+     * @pre         All buffers share the wakeup (see #NAMON::RingBuffer::shareWakeup())
+     * @param[in]   rings       Buffers with netflows
+     * @param[out]  c           Cache which will be filled
+     * @param[in]   periodic    Function called by the cache thread every period (e.g. saving a snapshot), can be empty
+     * @param[in]   period      Period of the function
+     * @param[out]  apps        Applications of processed netflows are published here, can be nullptr
+     * @param[in]   ipfix       Exporter of netflows of expired entries, can be nullptr
+     * @param[out]  filter      Filter of --app which gets sockets of newly resolved flows, can be nullptr
+     */
+	static void run(const std::vector<RingBuffer *> &rings, Cache *c,
+					const std::function<void(Cache *)> &periodic = nullptr, std::chrono::seconds period = std::chrono::seconds(0),
+					FlowApps *apps = nullptr, IpfixExporter *ipfix = nullptr, AppFilter *filter = nullptr);
 };
 
 #include "ringBuffer.tpp"   //  class members
@@ -4,30 +4,101 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 22.03.2017 17:04
- *   - Edited:  21.05.2017 15:33
+ *   - Edited:  20.10.2026 05:00
  */
 
 
-template <class EnhancedPacketBlock>
-int RingBuffer<EnhancedPacketBlock>::push(const pcap_pkthdr *header, const u_char *packet)
+template <class T>
+typename RingBuffer<T>::Admission RingBuffer<T>::admit(size_t pending)
 {
-    if (full()) 
+    const size_t s = size + pending;
+    const bool isFull = (s == buffer.size());
+    // high watermark is at 3/4 of the capacity
+    const bool overloaded = (s >= buffer.size() - buffer.size() / 4);
+
+    switch (policy.policy)
+    {
+        case OverloadPolicy::SAMPLE:
+            if (overloaded && ++sampleCounter % policy.param)
+            {
+                sampledOutElem++;
+                return Admission::REJECT;
+            }
+            break;
+        case OverloadPolicy::TRUNCATE:
+            if (overloaded && !isFull)
+            {
+                truncatedElem++;
+                return Admission::TRUNCATE;
+            }
+            break;
+        case OverloadPolicy::SPILL:
+            // Once spilling started, new elements go to the overflow queue until the consumer
+            // takes it, so the order of elements is kept.
+            if (isFull || spillSize)
+            {
+                if (spillSize >= policy.param)
+                    break;
+                spilledElem++;
+                return Admission::SPILL;
+            }
+            break;
+        case OverloadPolicy::DROP:
+            break;
+    }
+
+    if (isFull || (policy.policy == OverloadPolicy::SPILL && spillSize))
     {
         droppedElem++;
+        return Admission::REJECT;
+    }
+    return Admission::STORE;
+}
+
+
+template <class EnhancedPacketBlock>
+int RingBuffer<EnhancedPacketBlock>::push(const pcap_pkthdr *header, const u_char *packet, uint32_t caplen, uint32_t interfaceID, const uint64_t *endpoints)
+{
+    const Admission a = admit();
+    if (a == Admission::REJECT)
         return 1;
+
+    EnhancedPacketBlock *epb;
+    std::unique_lock<std::mutex> spillLock(m_spill, std::defer_lock);
+    if (a == Admission::SPILL)
+    {
+        spillLock.lock();
+        spill.emplace_back();
+        epb = &spill.back();
+    }
+    else
+    {
+        if (last >= buffer.size()) 
+            last = 0;
+        epb = &buffer[last];
     }
 
-    if (last >= buffer.size()) 
-        last = 0;
+    epb->setInterfaceID(interfaceID);
+    epb->setOriginalPacketLength(header->len);
+    epb->setTimestamp(toTimestamp(header->ts));
+    if (a == Admission::TRUNCATE && caplen > policy.param)
+        caplen = policy.param;
+    epb->setPacketData(packet, caplen);
+    if (endpoints != nullptr)
+        epb->setEndpoints(endpoints[0], endpoints[1], std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    else
+        epb->setEndpoints(0, 0, 0);
 
-    buffer[last].setOriginalPacketLength(header->len);
-	uint64_t usecUnixTime = header->ts.tv_sec * (uint64_t)1000000 + header->ts.tv_usec;
-    buffer[last].setTimestamp(usecUnixTime);
-    buffer[last].setPacketData(packet, header->caplen);
-    ++last;
-    ++size;
+    if (a == Admission::SPILL)
+        ++spillSize;
+    else
+    {
+        ++last;
+        ++size;
+    }
 
-    cv_condVar.notify_all();
+    wakeup->cv_condVar.notify_all();
     return 0;
 }
 
@@ -35,10 +106,21 @@ int RingBuffer<EnhancedPacketBlock>::push(const pcap_pkthdr *header, const u_cha
 template <class T>
 int RingBuffer<T>::push(T &elem)
 {
-    if (full()) 
+    switch (admit())
     {
-        droppedElem++;
-        return 1;
+        case Admission::REJECT:
+            return 1;
+        case Admission::SPILL:
+        {
+            std::lock_guard<std::mutex> spillLock(m_spill);
+            spill.emplace_back();
+            spill.back() = move(elem);
+            ++spillSize;
+            wakeup->cv_condVar.notify_all();
+            return 0;
+        }
+        default:    // truncation has no meaning for other types than packets
+            break;
     }
 
     //! @todo ked prepisujeme novy prvok tak dealokovat alokovanu pamat v starom prvku (ip v netflow)
@@ -48,11 +130,52 @@ int RingBuffer<T>::push(T &elem)
     ++last;
     ++size;
 
-    cv_condVar.notify_all();
+    wakeup->cv_condVar.notify_all();
     return 0;
 }
 
 
+template <class T>
+size_t RingBuffer<T>::push(T *elems, size_t count)
+{
+    size_t stored = 0;
+    size_t rejected = 0;
+    for (size_t i = 0; i < count; i++)
+    {
+        switch (admit(stored))
+        {
+            case Admission::REJECT:
+                rejected++;
+                continue;
+            case Admission::SPILL:
+            {
+                // elements stored before are older, the consumer must see them before the overflow queue
+                size += stored;
+                stored = 0;
+                std::lock_guard<std::mutex> spillLock(m_spill);
+                spill.emplace_back();
+                spill.back() = move(elems[i]);
+                ++spillSize;
+                continue;
+            }
+            default:    // truncation has no meaning for other types than packets
+                break;
+        }
+        if (last >= buffer.size())
+            last = 0;
+        using std::swap;
+        swap(buffer[last], elems[i]);
+        ++last;
+        ++stored;
+    }
+    size += stored;
+
+    if (rejected < count)
+        wakeup->cv_condVar.notify_all();
+    return rejected;
+}
+
+
 template<class T>
 void RingBuffer<T>::pop()
 {
@@ -61,22 +184,192 @@ void RingBuffer<T>::pop()
 }
 
 
+template <class T>
+T * RingBuffer<T>::front()
+{
+    if (!spilled.empty())
+        return &spilled.front();
+    if (!empty())
+        return &buffer[first];
+    // The producer doesn't use the buffer while the overflow queue is not empty,
+    // so the queue is taken only when the buffer is empty and it is older than
+    // anything the producer stores into the buffer later.
+    if (spillSize)
+    {
+        std::lock_guard<std::mutex> spillLock(m_spill);
+        spilled.swap(spill);
+        spillSize = 0;
+        return &spilled.front();
+    }
+    return nullptr;
+}
+
+
+template <class T>
+void RingBuffer<T>::popFront()
+{
+    if (!spilled.empty())
+        spilled.pop_front();
+    else
+        pop();
+}
+
+
+template <class T>
+template <class F>
+void RingBuffer<T>::consume(F process)
+{
+    while (T *elem = front())
+    {
+        process(*elem);
+        popFront();
+    }
+}
+
+
+template <class T>
+void RingBuffer<T>::printStats(const char *name, const char *unit)
+{
+    cout << droppedElem << "' " << unit << " dropped by " << name << "." << endl;
+    if (policy.policy == OverloadPolicy::SAMPLE)
+        cout << sampledOutElem << "' " << unit << " skipped by sampling in " << name << "." << endl;
+    if (policy.policy == OverloadPolicy::TRUNCATE)
+        cout << truncatedElem << "' " << unit << " truncated by " << name << "." << endl;
+    if (policy.policy == OverloadPolicy::SPILL)
+        cout << spilledElem << "' " << unit << " spilled by " << name << "." << endl;
+}
+
+
+template<class EnhancedPacketBlock>
+void RingBuffer<EnhancedPacketBlock>::write(ostream &file)
+{
+    write({ this }, file);
+}
+
+
 template<class EnhancedPacketBlock>
-void RingBuffer<EnhancedPacketBlock>::write(ofstream &file)
+void RingBuffer<EnhancedPacketBlock>::write(const std::vector<RingBuffer *> &rings, ostream &file,
+                                           FlowApps *apps, std::chrono::milliseconds delay,
+                                           bool annotate, AppFiles *split, AppFilter *filter, ShmStream *shm)
 {
+    using merge_clock = std::chrono::steady_clock;
+    Wakeup &w = *rings[0]->wakeup;
+    merge_clock::time_point waitingSince;
+    bool waiting = false;   // some buffer is empty and the others wait for it
+    bool holding = false;   // the oldest packet waits for its application
+    std::vector<std::string> appNames(1);               // names taken from apps by their IDs
+    std::vector<std::pair<AppId, std::string>> names;
+    std::map<std::ostream *, std::vector<bool>> named; // IDs whose names are in the files
+    // Finds the application of the packet, returns false if the cache hasn't processed its flow yet
+    auto findApp = [apps](const EnhancedPacketBlock &epb, AppId &app) {
+        bool known = (epb.getEndpoint(0) == 0 && epb.getEndpoint(1) == 0);
+        for (unsigned int i = 0; i < 2 && app == NO_APP; i++)
+            known |= apps->find(epb.getEndpoint(i), app);
+        return known;
+    };
+    // Packets can be written if every buffer has one, or nothing came into the empty buffers for MERGE_WAIT
+    auto ready = [&rings, &waiting, &waitingSince]() {
+        if (shouldStop)
+            return true;
+        bool any = false, all = true;
+        for (RingBuffer *r : rings)
+        {
+            if (r->hasItems())
+                any = true;
+            else
+                all = false;
+        }
+        return any && (all || (waiting && merge_clock::now() - waitingSince >= MERGE_WAIT));
+    };
+
     log(LogLevel::INFO, "Writing to the output file started.");
     while (!shouldStop)
     {
-        std::unique_lock<std::mutex> mlock(m_condVar);
-        cv_condVar.wait(mlock, std::bind(&RingBuffer::newItemOrStop, this));
+        std::unique_lock<std::mutex> mlock(w.m_condVar);
+        if (holding)
+            w.cv_condVar.wait_for(mlock, ANNOTATE_POLL, []() { return shouldStop != 0; });
+        else
+            w.cv_condVar.wait_for(mlock, MERGE_WAIT, ready);
         mlock.unlock();
-        while(!empty())
+        holding = false;
+
+        while (true)
         {
-            buffer[first].write(file);
-            pop();
+            RingBuffer *oldest = nullptr;
+            bool someEmpty = false;
+            for (RingBuffer *r : rings)
+            {
+                EnhancedPacketBlock *epb = r->front();
+                if (epb == nullptr)
+                    someEmpty = true;
+                else if (oldest == nullptr || epb->getTimestamp() < oldest->front()->getTimestamp())
+                    oldest = r;
+            }
+            if (oldest == nullptr)
+            {
+                waiting = false;
+                break;
+            }
+            if (!someEmpty)
+                waiting = false;
+            else if (!waiting)
+            {   // an older packet can still come into the empty buffer
+                waiting = true;
+                waitingSince = merge_clock::now();
+                break;
+            }
+            else if (merge_clock::now() - waitingSince < MERGE_WAIT)
+                break;
+
+            EnhancedPacketBlock *epb = oldest->front();
+            AppId app = NO_APP;
+            std::ostream *out = &file;
+            if (apps != nullptr)
+            {
+                if (!findApp(*epb, app) && !oldest->overloaded()
+                    && merge_clock::now().time_since_epoch() < std::chrono::nanoseconds(epb->getArrival()) + delay)
+                {
+                    holding = true;
+                    break;
+                }
+                if (app >= appNames.size() || (app != NO_APP && appNames[app].empty()))
+                {   // the name is queued before the application is published
+                    apps->takeNames(names);
+                    for (auto &n : names)
+                    {
+                        if (n.first >= appNames.size())
+                            appNames.resize(n.first + 1);
+                        appNames[n.first].swap(n.second);
+                    }
+                }
+                const std::string &name = (app < appNames.size()) ? appNames[app] : appNames[NO_APP];
+                if (filter != nullptr && !filter->matches(app, name))
+                {
+                    filter->skip();
+                    oldest->popFront();
+                    continue;
+                }
+                if (split != nullptr && (out = split->get(app, name)) == nullptr)
+                    out = &file;
+                if (annotate && app != NO_APP)
+                {
+                    std::vector<bool> &outNamed = named[out];
+                    if (app >= outNamed.size())
+                        outNamed.resize(app + 1);
+                    if (!outNamed[app])
+                    {
+                        outNamed[app] = true;
+                        AppNameBlock().write(*out, { { app, name } });
+                    }
+                }
+            }
+            if (shm != nullptr)
+                shm->write(*epb, app, (app < appNames.size()) ? appNames[app] : appNames[NO_APP]);
+            epb->write(*out, annotate ? app : NO_APP);
+            oldest->popFront();
         }
         file.flush();
-        if (file.bad()) // e.g. out of space
+        if (file.bad() || (split != nullptr && split->flush())) // e.g. out of space
         {
             log(LogLevel::ERR, "Output error.");
             throw "Output file error"; //! @todo catch it
@@ -86,45 +379,107 @@ void RingBuffer<EnhancedPacketBlock>::write(ofstream &file)
 }
 
 
+template<class Netflow>
+void RingBuffer<Netflow>::processNetflow(Netflow &n, Cache *cache, FlowApps *apps, IpfixExporter *ipfix, AppFilter *filter)
+{
+    // determineApp() moves the netflow into a new entry
+    const uint64_t hash = (apps != nullptr) ? n.getEndpointHash() : 0;
+    TEntry *entry = nullptr;
+    bool resolved = false;      // the first packet of the flow the cache knows
+    TEntryOrTTree *cacheRecord = cache->find(n);
+    // if we found some TEntry, check if it still valid
+    if (cacheRecord != nullptr && cacheRecord->isEntry())
+    {
+        TEntry *foundEntry = static_cast<TEntry *>(cacheRecord);
+        entry = foundEntry;
+        // If the record exists but is invalid, run determineApp() in update mode
+        // to find new application, else update endTime.
+        if (!foundEntry->valid())
+        {
+            if (ipfix != nullptr)   // idle timeout, the next record starts with this packet
+                ipfix->expire(*foundEntry, n.getStartTime());
+            resolved = !determineApp(&n, *foundEntry, UPDATE);
+        }
+        else
+        {
+            Netflow *cached = foundEntry->getNetflowPtr();
+            if (cached->getEndTime() == 0) // the first packet of a pre-scanned socket
+            {
+                cached->setStartTime(n.getStartTime());
+                resolved = true;
+            }
+            cached->setEndTime(n.getEndTime());
+        }
+    }
+    else 
+    { // else it is either TTree or it is not in the whole map (nullptr)
+      // (both means it's not in the cache at all)
+        TEntry *e = new TEntry;
+        // If an error occured (can't open procfs file, etc.)
+        if (!determineApp(&n, *e, FIND))
+        {
+            // insert new record into map
+            if (cacheRecord == nullptr)
+                cache->insert(e);
+            else // else insert it into subtree
+                static_cast<TTree *>(cacheRecord)->insert(e);
+            entry = e;
+            resolved = true;
+        }
+        else
+            delete e;
+    }
+    if (apps != nullptr)
+    {
+        const AppId id = (entry != nullptr) ? entry->getAppId() : NO_APP;
+        apps->publish(hash, id, (id != NO_APP) ? entry->getAppName() : std::string());
+    }
+    // sockets opened after the last scan of --app
+    if (filter != nullptr && resolved && entry->getAppId() != NO_APP)
+    {
+        AppSocket s;
+        s.proto = entry->getNetflowPtr()->getProto();
+        s.port = entry->getNetflowPtr()->getLocalPort();
+        filter->addSocket(s, entry->getAppName());
+    }
+}
+
+
 template<class Netflow>
 void RingBuffer<Netflow>::run(Cache *cache)
 {
+    run({ this }, cache);
+}
+
+
+template<class Netflow>
+void RingBuffer<Netflow>::run(const std::vector<RingBuffer *> &rings, Cache *cache,
+                              const std::function<void(Cache *)> &periodic, std::chrono::seconds period,
+                              FlowApps *apps, IpfixExporter *ipfix, AppFilter *filter)
+{
+    Wakeup &w = *rings[0]->wakeup;
+    auto ready = [&rings]() {
+        for (RingBuffer *r : rings)
+            if (r->hasItems())
+                return true;
+        return shouldStop != 0;
+    };
+
+    auto next = std::chrono::steady_clock::now() + period;
     while (!shouldStop)
     {
-        std::unique_lock<std::mutex> mlock(m_condVar);
-        cv_condVar.wait(mlock, std::bind(&RingBuffer::newItemOrStop, this));
+        std::unique_lock<std::mutex> mlock(w.m_condVar);
+        if (periodic)
+            w.cv_condVar.wait_until(mlock, next, ready);
+        else
+            w.cv_condVar.wait(mlock, ready);
         mlock.unlock();
-        while(!empty())
+        for (RingBuffer *r : rings)
+            r->consume([cache, apps, ipfix, filter](Netflow &n) { processNetflow(n, cache, apps, ipfix, filter); });
+        if (periodic && std::chrono::steady_clock::now() >= next)
         {
-            TEntryOrTTree *cacheRecord = cache->find(buffer[first]);
-            // if we found some TEntry, check if it still valid
-            if (cacheRecord != nullptr && cacheRecord->isEntry())
-            {
-                TEntry *foundEntry = static_cast<TEntry *>(cacheRecord);
-                // If the record exists but is invalid, run determineApp() in update mode
-                // to find new application, else update endTime.
-                if (!foundEntry->valid())
-                    determineApp(&buffer[first], *foundEntry, UPDATE);
-                else
-                    foundEntry->getNetflowPtr()->setEndTime(buffer[first].getEndTime());
-            }
-            else 
-            { // else it is either TTree or it is not in the whole map (nullptr)
-              // (both means it's not in the cache at all)
-                TEntry *e = new TEntry;
-                // If an error occured (can't open procfs file, etc.)
-                if (!determineApp(&buffer[first], *e, FIND))
-                {
-                    // insert new record into map
-                    if (cacheRecord == nullptr)
-                        cache->insert(e);
-                    else // else insert it into subtree
-                        static_cast<TTree *>(cacheRecord)->insert(e);
-                }
-                else
-                    delete e;
-            }
-            pop();
+            periodic(cache);
+            next = std::chrono::steady_clock::now() + period;
         }
     }
     log(LogLevel::INFO, "Caching stopped.");
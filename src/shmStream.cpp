@@ -0,0 +1,316 @@
+/**
+ *  @file       shmStream.cpp
+ *  @brief      Live stream of stored packets in shared memory source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:50
+ *   - Edited:  20.10.2026 01:50
+ */
+
+#include <iostream>             //  cout, endl
+#include <cstring>              //  memcpy(), memcmp(), strerror()
+#include <cerrno>               //  errno
+#include <new>                  //  placement new
+#if !defined(_WIN32)
+#include <sys/mman.h>           //  shm_open(), mmap(), munmap()
+#include <sys/stat.h>           //  fstat()
+#include <fcntl.h>              //  O_* constants
+#include <unistd.h>             //  ftruncate(), close(), sysconf()
+#endif
+
+#include "debug.hpp"            //  log()
+#include "pcapng_blocks.hpp"    //  EnhancedPacketBlock, AppNameBlock
+#include "shmStream.hpp"
+
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2, "Atomics in shared memory have to be lock-free");
+
+
+
+
+namespace NAMON
+{
+
+
+ShmStream::~ShmStream()
+{
+    close();
+}
+
+
+int ShmStream::create(const std::string &objName, unsigned int size, const std::string &preamble)
+{
+#if defined(_WIN32)
+    (void)objName; (void)size; (void)preamble;
+    log(LogLevel::ERR, "Shared memory stream is not supported on Windows.");
+    return -1;
+#else
+    close();
+    name = "/" + objName;
+    capacity = (uint64_t)size << 20;
+    const size_t page = sysconf(_SC_PAGESIZE);
+    auto roundUp = [page](size_t n) { return (n + page - 1) / page * page; };
+    const size_t namesOffset = roundUp(sizeof(ShmHeader) + preamble.size());
+    const size_t dataOffset = namesOffset + roundUp(SHM_NAMES_SIZE);
+    mapped = dataOffset + capacity;
+
+    // readers of an old object keep their mapping, new ones open this one
+    shm_unlink(name.c_str());
+    fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0 || ftruncate(fd, mapped))
+    {
+        log(LogLevel::ERR, "Can't create shared memory '", name, "': ", strerror(errno));
+        if (fd >= 0)
+        {
+            ::close(fd);
+            shm_unlink(name.c_str());
+        }
+        fd = -1;
+        return -1;
+    }
+    int flags = MAP_SHARED;
+#if defined(MAP_POPULATE)
+    flags |= MAP_POPULATE;  // the writer doesn't fault the pages in during the first lap
+#endif
+    void *p = mmap(nullptr, mapped, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        log(LogLevel::ERR, "Can't map shared memory '", name, "': ", strerror(errno));
+        ::close(fd);
+        shm_unlink(name.c_str());
+        fd = -1;
+        return -1;
+    }
+    base = static_cast<uint8_t *>(p);
+    header = new (base) ShmHeader();
+    header->version = SHM_VERSION;
+    header->preambleLength = preamble.size();
+    header->preambleOffset = sizeof(ShmHeader);
+    header->namesOffset = namesOffset;
+    header->namesCapacity = SHM_NAMES_SIZE;
+    header->dataOffset = dataOffset;
+    header->dataCapacity = capacity;
+    memcpy(base + header->preambleOffset, preamble.data(), preamble.size());
+    names = base + namesOffset;
+    data = base + dataOffset;
+    head = tail = 0;
+    named.clear();
+    // readers check the magic, everything else has to be visible before it
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC));
+    log(LogLevel::INFO, "Stored packets are streamed to shared memory '", name, "' (", size, " MiB).");
+    return 0;
+#endif
+}
+
+
+void ShmStream::write(const EnhancedPacketBlock &epb, AppId app, const std::string &appName)
+{
+    if (header == nullptr)
+        return;
+    if (app != NO_APP && (app >= named.size() || !named[app]))
+        addName(app, appName);
+    const uint64_t len = epb.getBlockLength(app);
+    if (len > capacity / 4)
+    {
+        tooLong++;
+        return;
+    }
+    // a record doesn't wrap, it starts at the beginning of the ring instead
+    const uint64_t room = capacity - head % capacity;
+    const uint64_t start = (len > room) ? head + room : head;
+    const uint64_t end = start + len;
+    if (end - tail > capacity)
+    {   // readers see the new tail before the oldest records change
+        while (end - tail > capacity)
+            tail += recordLength(tail);
+        header->tail.store(tail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+    if (start != head && room >= 2 * sizeof(uint32_t))
+    {
+        const uint32_t pad[2] = { SHM_PAD_BLOCK, (uint32_t)room };
+        memcpy(data + head % capacity, pad, sizeof(pad));
+    }
+    epb.copyTo(data + start % capacity, app);
+    head = end;
+    header->head.store(head, std::memory_order_release);
+    records++;
+}
+
+
+uint64_t ShmStream::recordLength(uint64_t pos) const
+{
+    const uint64_t room = capacity - pos % capacity;
+    if (room < 2 * sizeof(uint32_t))
+        return room;
+    uint32_t block[2];
+    memcpy(block, data + pos % capacity, sizeof(block));
+    return (block[0] == SHM_PAD_BLOCK) ? room : block[1];
+}
+
+
+void ShmStream::addName(AppId app, const std::string &appName)
+{
+    if (app >= named.size())
+        named.resize(app + 1);
+    named[app] = true;
+    const std::string block = AppNameBlock().build({ { app, appName } });
+    const uint64_t len = header->namesLength.load(std::memory_order_relaxed);
+    if (len + block.size() > header->namesCapacity)
+    {
+        namesDropped++;
+        return;
+    }
+    memcpy(names + len, block.data(), block.size());
+    header->namesLength.store(len + block.size(), std::memory_order_release);
+}
+
+
+void ShmStream::close()
+{
+    if (header == nullptr)
+        return;
+    header->closed.store(1, std::memory_order_release);
+#if !defined(_WIN32)
+    munmap(base, mapped);
+    ::close(fd);
+    shm_unlink(name.c_str());
+#endif
+    header = nullptr;
+    base = names = data = nullptr;
+    fd = -1;
+}
+
+
+void ShmStream::printStats() const
+{
+    std::cout << records << "' packets streamed to shared memory '" << name << "', " << tooLong << "' were too long, "
+              << namesDropped << "' application names didn't fit." << std::endl;
+}
+
+
+ShmStreamReader::~ShmStreamReader()
+{
+#if !defined(_WIN32)
+    if (base != nullptr)
+        munmap(const_cast<uint8_t *>(base), mapped);
+    if (fd >= 0)
+        ::close(fd);
+#endif
+}
+
+
+int ShmStreamReader::open(const std::string &objName, bool oldest)
+{
+#if defined(_WIN32)
+    (void)objName; (void)oldest;
+    return -1;
+#else
+    if (base != nullptr)
+        return -1;
+    fd = shm_open(("/" + objName).c_str(), O_RDONLY, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) || (size_t)st.st_size < sizeof(ShmHeader))
+        return -1;
+    mapped = st.st_size;
+    void *p = mmap(nullptr, mapped, PROT_READ, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED)
+        return -1;
+    base = static_cast<const uint8_t *>(p);
+    header = reinterpret_cast<const ShmHeader *>(base);
+    if (memcmp(header->magic, SHM_MAGIC, sizeof(SHM_MAGIC)) || header->version != SHM_VERSION)
+        return -1;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (header->dataOffset + header->dataCapacity > mapped || header->namesOffset + header->namesCapacity > header->dataOffset
+        || header->preambleOffset + header->preambleLength > header->namesOffset || header->dataCapacity % 4)
+        return -1;
+    pos = oldest ? header->tail.load(std::memory_order_acquire) : header->head.load(std::memory_order_acquire);
+    return 0;
+#endif
+}
+
+
+ShmRead ShmStreamReader::next(std::string &block)
+{
+    const uint64_t capacity = header->dataCapacity;
+    const uint8_t *data = base + header->dataOffset;
+    while (true)
+    {
+        // the producer closes the stream after its last record
+        const bool closed = header->closed.load(std::memory_order_acquire);
+        if (pos == header->head.load(std::memory_order_acquire))
+            return closed ? ShmRead::CLOSED : ShmRead::EMPTY;
+        if (pos < header->tail.load(std::memory_order_acquire))
+            return overrun();
+
+        const uint64_t room = capacity - pos % capacity;
+        uint32_t hdr[2] = { SHM_PAD_BLOCK, 0 };
+        if (room >= sizeof(hdr))
+            memcpy(hdr, data + pos % capacity, sizeof(hdr));
+        const bool pad = (hdr[0] == SHM_PAD_BLOCK);
+        const uint64_t len = pad ? room : hdr[1];
+        const bool valid = pad || (len >= 3 * sizeof(uint32_t) && len <= room && len % 4 == 0);
+        if (!pad && valid)
+            block.assign(reinterpret_cast<const char *>(data + pos % capacity), len);
+        // the record could have changed while it was copied if the tail moved behind it
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (pos < header->tail.load(std::memory_order_relaxed) || !valid)
+            return overrun();
+        pos += len;
+        if (!pad)
+            return ShmRead::RECORD;
+    }
+}
+
+
+ShmRead ShmStreamReader::overrun()
+{
+    const uint64_t t = header->tail.load(std::memory_order_acquire);
+    overruns++;
+    if (t > pos)
+    {
+        lostBytes += t - pos;
+        pos = t;
+    }
+    return ShmRead::OVERRUN;
+}
+
+
+std::string ShmStreamReader::getPreamble() const
+{
+    return std::string(reinterpret_cast<const char *>(base + header->preambleOffset), header->preambleLength);
+}
+
+
+void ShmStreamReader::takeNames(std::vector<std::pair<AppId, std::string>> &out)
+{
+    out.clear();
+    const uint64_t len = header->namesLength.load(std::memory_order_acquire);
+    const uint8_t *names = base + header->namesOffset;
+    // type, length, PEN, "NMA1", names and the length again
+    while (namesPos + 5 * sizeof(uint32_t) <= len)
+    {
+        uint32_t blockLen = 0;
+        memcpy(&blockLen, names + namesPos + 4, sizeof(blockLen));
+        if (blockLen < 5 * sizeof(uint32_t) || namesPos + blockLen > len)
+            break;
+        const uint64_t end = namesPos + blockLen - sizeof(uint32_t);
+        for (uint64_t p = namesPos + 4 * sizeof(uint32_t); p + sizeof(AppId) + sizeof(uint16_t) <= end; )
+        {
+            AppId id = NO_APP;
+            uint16_t nameLen = 0;
+            memcpy(&id, names + p, sizeof(id));
+            memcpy(&nameLen, names + p + sizeof(id), sizeof(nameLen));
+            p += sizeof(id) + sizeof(nameLen);
+            if (p + nameLen > end)
+                break;
+            out.emplace_back(id, std::string(reinterpret_cast<const char *>(names + p), nameLen));
+            p += nameLen;
+        }
+        namesPos += blockLen;
+    }
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,213 @@
+/**
+ *  @file       shmStream.hpp
+ *  @brief      Live stream of stored packets in shared memory header file
+ *  @details    With --shm the writer copies every stored packet into a ring in a POSIX shared
+ *              memory object (/dev/shm/<name> on Linux), so other tools on the host read packets
+ *              and their applications as they are captured, without the output file. The object
+ *              starts with #NAMON::ShmHeader, then there are the section header and interface
+ *              description blocks of the capture, application names and the ring:
+ *
+ *              | Part      | Offset                    | Content                                    |
+ *              |-----------|---------------------------|--------------------------------------------|
+ *              | header    | 0                         | #NAMON::ShmHeader                          |
+ *              | preamble  | ShmHeader::preambleOffset | SHB and IDBs, they go before the records   |
+ *              | names     | ShmHeader::namesOffset    | AppNameBlocks, appended                    |
+ *              | ring      | ShmHeader::dataOffset     | EPBs with the application option          |
+ *
+ *              There is one producer and any number of readers, each of them with its own
+ *              position, nobody waits for anybody. Positions are byte offsets since the start
+ *              of the stream, a record is at position % dataCapacity. A record which doesn't fit
+ *              before the end of the ring starts at its beginning, the rest of the ring is
+ *              skipped by a block of type #NAMON::SHM_PAD_BLOCK (or without any block if it is
+ *              shorter than 8 bytes). Before the producer overwrites the oldest records, it moves
+ *              the tail behind them, so a reader checks the tail after it copied a record: when
+ *              the record is older than the tail, it could have been overwritten and the reader
+ *              was overrun. It continues with the oldest record which is still there.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:50
+ *   - Edited:  20.10.2026 01:50
+ */
+
+#pragma once
+
+#include <atomic>               //  atomic
+#include <string>               //  string
+#include <utility>              //  pair
+#include <vector>               //  vector
+#include <cstddef>              //  size_t
+#include <cstdint>              //  uint*_t
+
+#include "appRegistry.hpp"      //  AppId
+
+
+
+
+namespace NAMON
+{
+
+
+class EnhancedPacketBlock;
+
+const unsigned int  DEFAULT_SHM_SIZE    = 64;               //!< Default size of the ring (MiB)
+const size_t        SHM_NAMES_SIZE      = 1 << 20;          //!< Space for application names, names which don't fit aren't shared
+const uint32_t      SHM_VERSION         = 1;                //!< Version of the layout
+const uint32_t      SHM_PAD_BLOCK       = 0;                //!< Type of the block which skips the rest of the ring
+const char          SHM_MAGIC[8]        = "NAMONSH";        //!< The first bytes of the object, written when it is ready
+//! How long a stored packet waits for its application with --shm (ms)
+const unsigned int  SHM_APP_DELAY       = 100;
+
+
+/*!
+ * @struct  ShmHeader
+ * @brief   The beginning of the shared memory object
+ * @details Positions are counted in bytes since the start of the stream, they never wrap.
+ */
+struct ShmHeader
+{
+    char magic[8];                              //!< #NAMON::SHM_MAGIC
+    uint32_t version;                           //!< #NAMON::SHM_VERSION
+    uint32_t preambleLength;                    //!< Length of the SHB and IDBs
+    uint64_t preambleOffset;                    //!< Where the SHB and IDBs are
+    uint64_t namesOffset;                       //!< Where the names are
+    uint64_t namesCapacity;                     //!< Space for the names
+    uint64_t dataOffset;                        //!< Where the ring is
+    uint64_t dataCapacity;                      //!< Size of the ring, a multiple of 4
+    std::atomic<uint64_t> namesLength;          //!< Length of the names written so far
+    std::atomic<uint32_t> closed;               //!< Set when capturing ended, after the last record
+    alignas(64) std::atomic<uint64_t> tail;     //!< Position of the oldest record which wasn't overwritten
+    alignas(64) std::atomic<uint64_t> head;     //!< Position after the newest record
+};
+
+
+/*!
+ * @class   ShmStream
+ * @brief   Producer of the stream (writer thread)
+ */
+class ShmStream
+{
+    std::string name;                           //!< Name of the object
+    int fd = -1;                                //!< Descriptor of the object
+    uint8_t *base = nullptr;                    //!< The mapped object
+    size_t mapped = 0;                          //!< Size of the object
+    ShmHeader *header = nullptr;                //!< The header at base
+    uint8_t *names = nullptr;                   //!< The names
+    uint8_t *data = nullptr;                    //!< The ring
+    uint64_t capacity = 0;                      //!< Size of the ring
+    uint64_t head = 0;                          //!< Position after the newest record
+    uint64_t tail = 0;                          //!< Position of the oldest record
+    std::vector<bool> named;                    //!< IDs whose names were handled
+    unsigned long records = 0;                  //!< Written records
+    unsigned long tooLong = 0;                  //!< Records longer than a quarter of the ring, they aren't written
+    unsigned long namesDropped = 0;             //!< Names which didn't fit
+public:
+    /*!
+     * @brief   Closes the stream if it is open
+     */
+    ~ShmStream();
+    /*!
+     * @brief       Creates the object, an old one of the same name is replaced
+     * @param[in]   name        Name of the object, without the leading slash
+     * @param[in]   size        Size of the ring (MiB)
+     * @param[in]   preamble    SHB and IDBs of the capture (see initOFile())
+     * @return      -1 if it can't be created, 0 otherwise
+     */
+    int create(const std::string &name, unsigned int size, const std::string &preamble);
+    /*!
+     * @brief       Writes the packet into the ring, the oldest records are overwritten
+     * @details     The name of the application is shared before its first packet.
+     * @param[in]   epb     The packet
+     * @param[in]   app     Application of the packet, #NAMON::NO_APP if it's not known
+     * @param[in]   appName Name of the application
+     */
+    void write(const EnhancedPacketBlock &epb, AppId app, const std::string &appName);
+    /*!
+     * @brief   Marks the stream as closed and removes the object, mapped objects stay readable
+     */
+    void close();
+    /*!
+     * @brief   Prints the counters to the standard output
+     */
+    void printStats() const;
+private:
+    /*!
+     * @return  Length of the record at the position or of the skipped rest of the ring
+     */
+    uint64_t recordLength(uint64_t pos) const;
+    /*!
+     * @brief   Appends the AppNameBlock of the application to the names
+     */
+    void addName(AppId app, const std::string &appName);
+};
+
+
+/*!
+ * @brief   Result of #NAMON::ShmStreamReader::next()
+ */
+enum class ShmRead : uint8_t {
+    RECORD,     //!< A record was read
+    EMPTY,      //!< There is no newer record yet
+    OVERRUN,    //!< Records were overwritten before they were read, the reader skipped to the oldest one
+    CLOSED,     //!< There is no newer record and capturing ended
+};
+
+
+/*!
+ * @class   ShmStreamReader
+ * @brief   Reader of the stream, it can be used by other processes
+ * @details Readers don't change the shared memory, they map it read only.
+ */
+class ShmStreamReader
+{
+    int fd = -1;                                //!< Descriptor of the object
+    const uint8_t *base = nullptr;              //!< The mapped object
+    size_t mapped = 0;                          //!< Size of the object
+    const ShmHeader *header = nullptr;          //!< The header at base
+    uint64_t pos = 0;                           //!< Position of the next record
+    uint64_t namesPos = 0;                      //!< Length of the names which were taken
+    unsigned long overruns = 0;                 //!< How many times the reader was overrun
+    uint64_t lostBytes = 0;                     //!< Bytes of records which were overwritten before they were read
+public:
+    /*!
+     * @brief   Unmaps the object
+     */
+    ~ShmStreamReader();
+    /*!
+     * @brief       Maps the object
+     * @param[in]   name    Name of the object, without the leading slash
+     * @param[in]   oldest  Start with the oldest record in the ring instead of the next one
+     * @return      -1 if it doesn't exist or it isn't a stream of this version, 0 otherwise
+     */
+    int open(const std::string &name, bool oldest = false);
+    /*!
+     * @brief       Reads the next record
+     * @param[out]  block   The record, an EnhancedPacketBlock
+     * @return      What was read
+     */
+    ShmRead next(std::string &block);
+    /*!
+     * @return  SHB and IDBs of the capture
+     */
+    std::string getPreamble() const;
+    /*!
+     * @brief       Takes the names shared since the last call, a packet's name is shared before the packet
+     * @param[out]  out     IDs and names
+     */
+    void takeNames(std::vector<std::pair<AppId, std::string>> &out);
+    /*!
+     * @return  How many times the reader was overrun
+     */
+    unsigned long getOverruns() const           { return overruns; }
+    /*!
+     * @return  Bytes of records which were overwritten before they were read
+     */
+    uint64_t getLostBytes() const               { return lostBytes; }
+private:
+    /*!
+     * @brief   Moves the reader to the oldest record after an overrun
+     */
+    ShmRead overrun();
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,103 @@
+/** 
+ *  @file       storagePolicy.cpp
+ *  @brief      Per-flow packet slicing source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 13:05
+ *   - Edited:  20.10.2026 03:40
+ */
+
+#include <algorithm>        //  min()
+#include <cstring>          //  memcpy()
+
+#include "tcpip_headers.hpp"    //  PROTO_TCP, PROTO_UDP, PROTO_UDPLITE
+#include "storagePolicy.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+const unsigned int  FLOW_TABLE_SIZE     = 65536;                //!< Number of flow counters (power of two)
+const uint64_t      FLOW_IDLE_TIMEOUT   = 60;       //!< A flow idle for longer is counted from zero [s]
+
+
+int StoragePolicy::addSlice(const std::string &spec)
+{
+    SliceLimits *l = &defaultLimits;
+    std::string limits = spec;
+    const size_t colon = spec.find(':');
+    if (colon != std::string::npos)
+    {
+        const std::string proto = spec.substr(0, colon);
+        if (proto == "tcp")
+            l = &protoLimits[PROTO_TCP];
+        else if (proto == "udp")
+            l = &protoLimits[PROTO_UDP];
+        else if (proto == "udplite")
+            l = &protoLimits[PROTO_UDPLITE];
+        else
+            return -1;
+        limits = spec.substr(colon + 1);
+    }
+
+    SliceLimits res;
+    const size_t slash = limits.find('/');
+    size_t end = 0;
+    try
+    {
+        const std::string packets = limits.substr(0, slash);
+        res.packets = std::stoul(packets, &end);
+        if (end != packets.length())
+            return -1;
+        if (slash != std::string::npos)
+        {
+            const std::string bytes = limits.substr(slash + 1);
+            res.bytes = std::stoull(bytes, &end);
+            if (end != bytes.length())
+                return -1;
+        }
+    }
+    catch (std::exception &)
+    {
+        return -1;
+    }
+    res.set = true;
+    *l = res;
+
+    if (flows.empty())
+        flows.resize(FLOW_TABLE_SIZE);
+    return 0;
+}
+
+
+uint32_t StoragePolicy::storeLength(uint64_t flowHash, uint8_t proto, uint64_t time, uint32_t caplen, uint32_t headersLen)
+{
+    const SliceLimits &l = protoLimits[proto].set ? protoLimits[proto] : defaultLimits;
+    if (!l.set || headersLen == 0)
+        return caplen;
+
+    FlowCounter &c = flows[flowHash & (FLOW_TABLE_SIZE - 1)];
+    if (c.hash != flowHash || time - c.lastSeen > FLOW_IDLE_TIMEOUT)
+    {   // new flow
+        c.hash = flowHash;
+        c.packets = 0;
+        c.bytes = 0;
+    }
+    c.lastSeen = time;
+    const bool inFull = (c.packets < l.packets && c.bytes < l.bytes);
+    c.packets++;
+    c.bytes += caplen;
+    if (inFull)
+        return caplen;
+
+    const uint32_t len = std::min(caplen, headersLen);
+    slicedPackets++;
+    notStoredBytes += caplen - len;
+    return len;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,98 @@
+/** 
+ *  @file       storagePolicy.hpp
+ *  @brief      Per-flow packet slicing header file
+ *  @details    Decides how many bytes of a packet are stored into the output file.
+ *              The first packets/bytes of every flow are stored in full, the rest
+ *              of the flow only with its headers.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 13:05
+ *   - Edited:  20.10.2026 03:40
+ */
+
+#pragma once
+
+#include <string>           //  string
+#include <vector>           //  vector
+#include <cstdint>          //  uint*_t
+
+
+
+
+namespace NAMON
+{
+
+
+/*!
+ * @struct  SliceLimits
+ * @brief   How much of a flow is stored in full
+ */
+struct SliceLimits
+{
+    bool set = false;           //!< Limits were set by the user
+    uint32_t packets = 0;       //!< Number of packets stored in full
+    uint64_t bytes = UINT64_MAX;//!< Number of bytes stored in full
+};
+
+
+/*!
+ * @class   StoragePolicy
+ * @brief   Counts packets and bytes of flows and decides how much of a packet is stored
+ * @details Flows are counted in a direct-mapped table indexed by the flow hash. When two
+ *          flows map to the same slot the newer one takes it and the older one is
+ *          counted from zero again if it returns, so it can be stored in full once more.
+ */
+class StoragePolicy
+{
+    /*!
+     * @brief   Counters of one flow
+     */
+    struct FlowCounter
+    {
+        uint64_t hash = 0;          //!< Hash of the flow's 5-tuple
+        uint64_t lastSeen = 0;      //!< Time of the last packet [s]
+        uint32_t packets = 0;       //!< Number of packets seen
+        uint64_t bytes = 0;         //!< Number of captured bytes seen
+    };
+    SliceLimits defaultLimits;          //!< Limits used for protocols without their own limits
+    SliceLimits protoLimits[256];       //!< Limits of layer 4 protocols
+    std::vector<FlowCounter> flows;     //!< Counters table, it is allocated by the first addSlice()
+    unsigned long slicedPackets = 0;    //!< Number of packets stored with headers only
+    uint64_t notStoredBytes = 0;        //!< Number of captured bytes which were not stored
+public:
+    /*!
+     * @brief       Adds slicing limits in format [<tcp|udp|udplite>:]<packets>[/<bytes>]
+     * @details     Limits without the protocol are used for all protocols without their own limits.
+     * @param[in]   spec    Limits description
+     * @return      Zero on success, -1 if the description is invalid
+     */
+    int addSlice(const std::string &spec);
+    /*!
+     * @return  True if any slicing limits were set
+     */
+    bool enabled() const { return !flows.empty(); }
+    /*!
+     * @brief       Counts the packet and returns the number of its bytes which should be stored
+     * @param[in]   flowHash    Hash of the flow, the same for both directions (see PacketLayout::flowHash)
+     * @param[in]   proto       Layer 4 protocol
+     * @param[in]   time        Packet timestamp [s]
+     * @param[in]   caplen      Number of captured bytes
+     * @param[in]   headersLen  Length of link, network and transport layer headers,
+     *                          zero if the packet does not belong to any flow
+     * @return      Number of bytes to store
+     */
+    uint32_t storeLength(uint64_t flowHash, uint8_t proto, uint64_t time, uint32_t caplen, uint32_t headersLen);
+    /*!
+     * @brief   Get method for #NAMON::StoragePolicy::slicedPackets
+     * @return  Number of packets stored with headers only
+     */
+    unsigned long getSlicedPackets() const { return slicedPackets; }
+    /*!
+     * @brief   Get method for #NAMON::StoragePolicy::notStoredBytes
+     * @return  Number of captured bytes which were not stored
+     */
+    uint64_t getNotStoredBytes() const { return notStoredBytes; }
+};
+
+
+}	// namespace NAMON
@@ -0,0 +1,215 @@
+/**
+ *  @file       streamOutput.cpp
+ *  @brief      Output into a pipe, FIFO or the standard output source file
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:20
+ *   - Edited:  20.10.2026 02:20
+ */
+
+#include <iostream>             //  cout, endl
+#include <cstring>              //  memcpy(), strcmp(), strerror()
+#include <cerrno>               //  errno
+#include <fcntl.h>              //  open(), O_* constants
+#if defined(_WIN32)
+#include <io.h>                 //  _write(), _open(), _close(), _setmode()
+#include <cstdio>               //  _fileno()
+#else
+#include <csignal>              //  signal(), SIGPIPE
+#include <poll.h>               //  poll()
+#include <sys/stat.h>           //  stat()
+#include <unistd.h>             //  write(), close()
+#endif
+
+#include "debug.hpp"            //  log()
+#include "streamOutput.hpp"
+
+
+
+
+namespace NAMON
+{
+
+
+bool isStreamOutput(const char *name)
+{
+    if (strcmp(name, "-") == 0)
+        return true;
+#if defined(_WIN32)
+    return false;
+#else
+    struct stat st;
+    return stat(name, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode) || S_ISSOCK(st.st_mode));
+#endif
+}
+
+
+StreamOutput::StreamOutput() : batch(STREAM_BATCH_SIZE)
+{
+    setp(batch.data(), batch.data() + batch.size());
+}
+
+
+StreamOutput::~StreamOutput()
+{
+    close();
+}
+
+
+int StreamOutput::open(const char *path)
+{
+    if (strcmp(path, "-") == 0)
+    {
+        name = "the standard output";
+#if defined(_WIN32)
+        fd = _fileno(stdout);
+        _setmode(fd, _O_BINARY);
+#else
+        fd = STDOUT_FILENO;
+#endif
+        ownFd = false;
+    }
+    else
+    {
+        name = path;
+        log(LogLevel::INFO, "Waiting for a reader of '", name, "'.");
+#if defined(_WIN32)
+        fd = _open(path, _O_WRONLY | _O_BINARY);
+#else
+        fd = ::open(path, O_WRONLY);
+#endif
+        ownFd = true;
+    }
+    if (fd < 0)
+    {
+        log(LogLevel::ERR, "Can't open '", name, "': ", strerror(errno));
+        return -1;
+    }
+#if !defined(_WIN32)
+    // the closed stream is reported by write(), it doesn't kill the process
+    signal(SIGPIPE, SIG_IGN);
+#endif
+    lastWrite = std::chrono::steady_clock::now();
+    return 0;
+}
+
+
+void StreamOutput::close()
+{
+    if (fd < 0)
+        return;
+    writeBatch();
+    if (ownFd)
+    {
+#if defined(_WIN32)
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+    fd = -1;
+}
+
+
+StreamOutput::int_type StreamOutput::overflow(int_type c)
+{
+    if (writeBatch())
+        return traits_type::eof();
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+        return traits_type::not_eof(c);
+    *pptr() = traits_type::to_char_type(c);
+    pbump(1);
+    return c;
+}
+
+
+std::streamsize StreamOutput::xsputn(const char *s, std::streamsize n)
+{
+    if (n > epptr() - pptr())
+    {
+        if (writeBatch())
+            return 0;
+        if ((size_t)n >= batch.size())  // e.g. the mapping block
+            return writeAll(s, n) ? 0 : n;
+    }
+    memcpy(pptr(), s, n);
+    pbump(n);
+    return n;
+}
+
+
+int StreamOutput::sync()
+{
+    if (pptr() == pbase() || std::chrono::steady_clock::now() - lastWrite < STREAM_FLUSH_INTERVAL)
+        return 0;
+    return writeBatch();
+}
+
+
+int StreamOutput::writeBatch()
+{
+    const size_t len = pptr() - pbase();
+    const int r = len ? writeAll(pbase(), len) : 0;
+    setp(batch.data(), batch.data() + batch.size());
+    lastWrite = std::chrono::steady_clock::now();
+    return r;
+}
+
+
+int StreamOutput::writeAll(const char *data, size_t len)
+{
+    if (broken || fd < 0)
+        return broken ? 0 : -1;
+    const auto t0 = std::chrono::steady_clock::now();
+#if defined(_WIN32)
+    const bool stall = false;
+#else
+    // the reader hasn't emptied the pipe, the writer waits for it
+    pollfd p { fd, POLLOUT, 0 };
+    const bool stall = (poll(&p, 1, 0) == 0);
+#endif
+    const size_t total = len;
+    while (len)
+    {
+#if defined(_WIN32)
+        const int r = _write(fd, data, (unsigned int)len);
+#else
+        const ssize_t r = ::write(fd, data, len);
+#endif
+        if (r < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EPIPE)
+            {   // the rest is discarded, capturing is stopped by the owner
+                log(LogLevel::ERR, "Reader of '", name, "' closed it.");
+                broken = true;
+                if (onBroken)
+                    onBroken();
+                return 0;
+            }
+            log(LogLevel::ERR, "Can't write to '", name, "': ", strerror(errno));
+            return -1;
+        }
+        data += r;
+        len -= r;
+    }
+    bytes += total;
+    writes++;
+    if (stall)
+    {
+        stalls++;
+        stalled += std::chrono::steady_clock::now() - t0;
+    }
+    return 0;
+}
+
+
+void StreamOutput::printStats() const
+{
+    std::cout << bytes << "' bytes written to " << name << " in " << writes << " batches, the writer waited for the reader "
+              << stalls << "' times (" << std::chrono::duration_cast<std::chrono::milliseconds>(stalled).count() << " ms)." << std::endl;
+}
+
+
+}	// namespace NAMON
@@ -0,0 +1,115 @@
+/**
+ *  @file       streamOutput.hpp
+ *  @brief      Output into a pipe, FIFO or the standard output header file
+ *  @details    With -w - (or a FIFO as the output file) namon writes the capture into a stream
+ *              which can't seek, so blocks are always built in memory before they are written.
+ *              Written blocks are gathered into batches of #NAMON::STREAM_BATCH_SIZE, a batch
+ *              goes out when it is full or when it is older than #NAMON::STREAM_FLUSH_INTERVAL.
+ *              When the reader doesn't keep up, only the writer thread waits: the file buffers
+ *              fill and their store policy (see --store-policy) decides what happens to new
+ *              packets, capturing threads never wait for the reader.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:20
+ *   - Edited:  20.10.2026 02:20
+ */
+
+#pragma once
+
+#include <chrono>               //  steady_clock, milliseconds
+#include <functional>           //  function
+#include <streambuf>            //  streambuf
+#include <string>               //  string
+#include <vector>               //  vector
+
+
+
+
+namespace NAMON
+{
+
+
+const size_t                    STREAM_BATCH_SIZE       = 1 << 20;  //!< Bytes gathered before they are written
+const std::chrono::milliseconds STREAM_FLUSH_INTERVAL   { 100 };    //!< The longest time written blocks wait for their batch
+
+
+/*!
+ * @brief       Checks whether the output is a stream
+ * @param[in]   name    Name of the output file
+ * @return      True for "-" (the standard output), a FIFO, a character device or a socket
+ */
+bool isStreamOutput(const char *name);
+
+
+/*!
+ * @class   StreamOutput
+ * @brief   Stream buffer which writes into a file descriptor in large batches
+ * @details The stream is flushed by the writer after every round, but a batch goes out only
+ *          when it is full or old enough. close() writes the rest.
+ */
+class StreamOutput : public std::streambuf
+{
+    int fd = -1;                                //!< Descriptor of the stream
+    bool ownFd = false;                         //!< The descriptor is closed by close()
+    std::string name;                           //!< Name of the stream used in messages
+    std::vector<char> batch;                    //!< Blocks waiting for the write
+    std::chrono::steady_clock::time_point lastWrite;    //!< When the last batch was written
+    bool broken = false;                        //!< The reader closed the stream, the rest is discarded
+    std::function<void()> onBroken;             //!< Called once when the reader closes the stream
+    unsigned long long bytes = 0;               //!< Written bytes
+    unsigned long writes = 0;                   //!< Written batches
+    unsigned long stalls = 0;                   //!< Writes which had to wait for the reader
+    std::chrono::steady_clock::duration stalled{ 0 };   //!< Time spent waiting for the reader
+public:
+    StreamOutput();
+    /*!
+     * @brief   Writes the rest and closes the stream
+     */
+    ~StreamOutput();
+    /*!
+     * @brief       Opens the stream, a FIFO waits for its reader
+     * @param[in]   name    "-" for the standard output or a path
+     * @return      -1 if it can't be opened, 0 otherwise
+     */
+    int open(const char *name);
+    /*!
+     * @brief   Writes the rest and closes the stream (the standard output stays open)
+     */
+    void close();
+    /*!
+     * @brief       Sets the function called when the reader closes the stream (e.g. to stop capturing)
+     */
+    void setOnBroken(const std::function<void()> &f)    { onBroken = f; }
+    /*!
+     * @brief   Prints the counters to the standard output
+     */
+    void printStats() const;
+protected:
+    /*!
+     * @brief   Writes the full batch and stores the character
+     */
+    int_type overflow(int_type c) override;
+    /*!
+     * @brief   Appends the bytes, blocks larger than the batch are written at once
+     */
+    std::streamsize xsputn(const char *s, std::streamsize n) override;
+    /*!
+     * @brief   Writes the batch if it is older than #NAMON::STREAM_FLUSH_INTERVAL
+     * @return  -1 on an output error
+     */
+    int sync() override;
+private:
+    /*!
+     * @brief   Writes the batch
+     * @return  -1 on an output error
+     */
+    int writeBatch();
+    /*!
+     * @brief   Writes the whole memory, waits for the reader
+     * @return  -1 on an output error
+     */
+    int writeAll(const char *data, size_t len);
+};
+
+
+}	// namespace NAMON
@@ -4,7 +4,7 @@
  * @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  * @date
  *  - Created: 12.04.2017 23:21
- *  - Edited:  23.06.2017 12:05
+ *  - Edited:  19.10.2026 15:10
  * @todo       rename namespace
 */
 
@@ -48,6 +48,47 @@ struct	ether_hdr {
 	uint16_t	ether_type;					//!< Ethernet frame type
 };
 
+#pragma pack(pop)
+
+
+
+
+/*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*
+*                                                                            *
+*                               802.1Q/802.1ad                               *
+*                                                                            *
+*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
+
+#define VLAN_HDRLEN			4			//!< Size of VLAN tag (TCI and the next type)
+#define MAX_VLAN_TAGS		4			//!< Maximum number of stacked VLAN tags which are skipped
+#define PROTO_VLAN			0x0081		//!< ID of 802.1Q tag (in network order)
+#define PROTO_QINQ			0xA888		//!< ID of 802.1ad service tag (in network order)
+#define PROTO_QINQ_OLD		0x0091		//!< ID of pre-standard QinQ tag 0x9100 (in network order)
+
+
+
+
+/*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*
+*                                                                            *
+*                             LINUX COOKED CAPTURE                           *
+*                                                                            *
+*++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++*/
+// https://www.tcpdump.org/linktypes/LINKTYPE_LINUX_SLL.html
+// https://www.tcpdump.org/linktypes/LINKTYPE_LINUX_SLL2.html
+
+#define SLL_HDRLEN			16			//!< Size of Linux cooked header (v1)
+#define SLL_PKTTYPE			0			//!< Offset of the packet type in the v1 header (2 B)
+#define SLL_PROTOCOL		14			//!< Offset of the protocol type in the v1 header (2 B)
+#define SLL2_HDRLEN			20			//!< Size of Linux cooked header (v2)
+#define SLL2_PKTTYPE		10			//!< Offset of the packet type in the v2 header (1 B)
+#define SLL2_PROTOCOL		0			//!< Offset of the protocol type in the v2 header (2 B)
+#define SLL_HOST			0			//!< Packet type: sent to us
+#define SLL_BROADCAST		1			//!< Packet type: broadcast
+#define SLL_MULTICAST		2			//!< Packet type: multicast
+#define SLL_OUTGOING		4			//!< Packet type: sent by us
+
+#pragma pack(push, 1)
+
 
 
 
@@ -59,7 +100,9 @@ struct	ether_hdr {
 #define	IPv4_MAXPACKET		65535		//!< maximum packet size
 #define IPv4_ADDRSTRLEN		16			//!< Length of IPv4 address string
 #define IPv4_ADDRLEN		4			//!< Length of IPv4 address
+#ifndef AF_INET
 #define AF_INET			2 //! @todo check other platforms
+#endif
 
 //! IPv4 address
 struct ip4_addr {
@@ -93,6 +136,9 @@ struct ip4_hdr {
 	ip4_addr  ip_src, ip_dst;	/* source and dest address */
 };
 
+#define IPv4_MF				0x2000		//!< More fragments flag (in host order)
+#define IPv4_OFFMASK		0x1fff		//!< Mask of the fragment offset in 8 B units (in host order)
+
 
 
 
@@ -104,7 +150,9 @@ struct ip4_hdr {
 #define IPv6_ADDRSTRLEN	46			//!< Length of IPv6 address string
 #define IPv6_ADDRLEN	16			//!< Length of IPv6 address
 #define IPv6_HDRLEN		40			//!< Size of IPv6 header
+#ifndef AF_INET6
 #define AF_INET6	10 //! @todo check other platforms
+#endif
 //! @bug 23 on windows, include Ws2def.h
 
 //! IPv6 address
@@ -141,6 +189,16 @@ struct ip6_hdr {
 
 //! @todo ipv6 - flow labels
 
+#define MAX_IPv6_EXT_HDRS	8			//!< Maximum number of extension headers which are skipped
+#define PROTO_HOPOPTS		0			//!< IPv6 Hop-by-Hop Options
+#define PROTO_ROUTING		43			//!< IPv6 Routing Header
+#define PROTO_FRAGMENT		44			//!< IPv6 Fragment Header
+#define PROTO_AH			51			//!< Authentication Header
+#define PROTO_NONXT			59			//!< IPv6 No Next Header
+#define PROTO_DSTOPTS		60			//!< IPv6 Destination Options
+#define IPv6_FRAG_HDRLEN	8			//!< Size of IPv6 Fragment Header
+#define IPv6_OFFMASK		0xfff8		//!< Mask of the fragment offset in the Fragment Header (in host order)
+
 
 
 
@@ -4,10 +4,11 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 28.03.2017 14:14
- *   - Edited:  23.06.2017 12:08
+ *   - Edited:  19.10.2026 19:05
  */
 
 #include <cctype>				//  isdigit()
+#include <cstring>				//  memcpy()
 
 #if defined(__APPLE__) || defined(__linux__)
 #include <cstring>		// memset(), strlen() #linux
@@ -20,6 +21,12 @@
 #include "debug.hpp"			//	log()
 #include "utils.hpp"
 
+#if defined(NAMON_X86_SIMD)
+#include <immintrin.h>			//	_mm_crc32_*()
+#elif defined(NAMON_ARM_CRC)
+#include <arm_acle.h>			//	__crc32c*()
+#endif
+
 
 
 
@@ -196,6 +203,140 @@ int inet_ntop(const int af, const void *src, char *dst, size_t size)
 }
 
 
+SimdLevel detectSimdLevel()
+{
+	static const SimdLevel level = []() {
+#if defined(NAMON_X86_SIMD)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("sse4.2"))
+			return SimdLevel::AVX2;
+		if (__builtin_cpu_supports("sse4.2"))
+			return SimdLevel::SSE42;
+#elif defined(NAMON_ARM_CRC)
+		return SimdLevel::ARMV8_CRC;
+#endif
+		return SimdLevel::SCALAR;
+	}();
+	return level;
+}
+
+
+const char *toString(SimdLevel level)
+{
+	switch (level)
+	{
+		case SimdLevel::SSE42:	return "sse4.2";
+		case SimdLevel::AVX2:	return "avx2";
+		case SimdLevel::ARMV8_CRC:	return "armv8-crc";
+		default:				return "scalar";
+	}
+}
+
+
+/*!
+ * @brief   Tables of the reflected CRC-32C polynomial for four bytes at a time (slicing-by-4)
+ */
+struct Crc32cTable
+{
+	uint32_t t[4][256];
+	Crc32cTable()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			uint32_t c = i;
+			for (int k = 0; k < 8; k++)
+				c = (c >> 1) ^ ((c & 1) ? 0x82f63b78 : 0);
+			t[0][i] = c;
+		}
+		for (uint32_t i = 0; i < 256; i++)
+			for (int s = 1; s < 4; s++)
+				t[s][i] = t[0][t[s - 1][i] & 0xff] ^ (t[s - 1][i] >> 8);
+	}
+};
+
+
+/*!
+ * @brief   CRC-32C update without the initial and final inversion
+ */
+static uint32_t crc32cScalar(uint32_t crc, const uint8_t *p, size_t len)
+{
+	static const Crc32cTable table;
+	for (; len >= 4; len -= 4, p += 4)
+	{
+		crc ^= (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+		crc = table.t[3][crc & 0xff] ^ table.t[2][(crc >> 8) & 0xff] ^ table.t[1][(crc >> 16) & 0xff] ^ table.t[0][crc >> 24];
+	}
+	while (len--)
+		crc = table.t[0][(crc ^ *p++) & 0xff] ^ (crc >> 8);
+	return crc;
+}
+
+
+#if defined(NAMON_X86_SIMD)
+__attribute__((target("sse4.2")))
+static uint32_t crc32cSse42(uint32_t crc, const uint8_t *p, size_t len)
+{
+#if defined(__x86_64__)
+	uint64_t c = crc;
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		c = _mm_crc32_u64(c, v);
+	}
+	crc = (uint32_t)c;
+#endif
+	for (; len >= 4; len -= 4, p += 4)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		crc = _mm_crc32_u32(crc, v);
+	}
+	while (len--)
+		crc = _mm_crc32_u8(crc, *p++);
+	return crc;
+}
+#endif
+
+
+#if defined(NAMON_ARM_CRC)
+static uint32_t crc32cArm(uint32_t crc, const uint8_t *p, size_t len)
+{
+	for (; len >= 8; len -= 8, p += 8)
+	{
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		crc = __crc32cd(crc, v);
+	}
+	for (; len >= 4; len -= 4, p += 4)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		crc = __crc32cw(crc, v);
+	}
+	while (len--)
+		crc = __crc32cb(crc, *p++);
+	return crc;
+}
+#endif
+
+
+uint32_t crc32c(const void *data, size_t len, SimdLevel simd, uint32_t crc)
+{
+	const uint8_t *p = static_cast<const uint8_t *>(data);
+#if defined(NAMON_X86_SIMD)
+	if (simd != SimdLevel::SCALAR)
+		return ~crc32cSse42(~crc, p, len);
+#elif defined(NAMON_ARM_CRC)
+	if (simd != SimdLevel::SCALAR)
+		return ~crc32cArm(~crc, p, len);
+#else
+	(void)simd;
+#endif
+	return ~crc32cScalar(~crc, p, len);
+}
+
+
 }	// namespace NAMON
 
 
@@ -4,13 +4,16 @@
  *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
  *  @date
  *   - Created: 28.03.2017 14:09
- *   - Edited:  23.06.2017 12:08
+ *   - Edited:  20.10.2026 02:50
  */
 
 #pragma once
 #include <exception>        //  exception
 #include <string>           //  string
 #include <cerrno>           //  errno
+#include <cstring>          //  strerror(), strlen()
+#include <cstdint>          //  uint*_t
+#include <cstddef>          //  size_t
 
 #if defined(_WIN32)
 #include <WTypes.h>
@@ -18,6 +21,15 @@
 
 using std::string;
 
+//! Functions with x86 vector instructions are compiled for their target and selected at runtime
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NAMON_X86_SIMD
+#endif
+//! ARMv8 CRC32 instructions are enabled by the compiler (e.g. -march=armv8-a+crc)
+#if defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define NAMON_ARM_CRC
+#endif
+
 
 
 
@@ -59,6 +71,41 @@ namespace NAMON
 	}
 
 
+	/*!
+	 * @brief   Instruction set extensions used by vectorized functions
+	 */
+	enum class SimdLevel : uint8_t {
+		SCALAR,     //!< Portable code only
+		SSE42,      //!< SSE4.2 (including the CRC32 instruction)
+		AVX2,       //!< AVX2 and SSE4.2
+		ARMV8_CRC,  //!< ARMv8 CRC32 instructions (no vector kernels)
+	};
+
+	/*!
+	 * @brief   Returns the best level supported by the CPU, it is detected only once
+	 * @details #NAMON::SimdLevel::ARMV8_CRC on ARMv8 built with the CRC extension,
+	 *          #NAMON::SimdLevel::SCALAR on other architectures than x86
+	 *          and with compilers without target attributes (MSVC).
+	 */
+	SimdLevel detectSimdLevel();
+
+	/*!
+	 * @return  Name of the level
+	 */
+	const char *toString(SimdLevel level);
+
+	/*!
+	 * @brief       Computes CRC-32C (Castagnoli) of the data
+	 * @param[in]   data    Data
+	 * @param[in]   len     Length of the data
+	 * @param[in]   simd    CRC32 instructions are used from #NAMON::SimdLevel::SSE42 (or with
+	 *                      #NAMON::SimdLevel::ARMV8_CRC), a table otherwise
+	 * @param[in]   crc     CRC of the preceding data to continue with
+	 * @return      CRC-32C, the same for all levels
+	 */
+	uint32_t crc32c(const void *data, size_t len, SimdLevel simd, uint32_t crc = 0);
+
+
 #include "utils.tpp"
 
 
@@ -0,0 +1,197 @@
+/**
+ *  @file       annotate_bench.cpp
+ *  @brief      Share of packets annotated with their application and the cost of annotating
+ *  @details    Offers frames of sockets of a procfs tree to packetHandler() at a fixed rate
+ *              (see writerHarness.hpp), so the first packets of every flow come before the
+ *              cache knows the flow. The writer writes into a temporary file. The run is repeated
+ *              without annotations and with the given delays. The file is read back: every
+ *              annotated packet must have the ID of the application of its socket and every
+ *              ID must be named before its first packet. The work added to the capturing
+ *              thread (hashes of both endpoints) is measured alone, because the threads
+ *              share cores with the spinning producer. Flows whose CRC-32C collides must not
+ *              get the application of each other.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:10
+ *   - Edited:  20.10.2026 05:00
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <fstream>          //  ofstream
+#include <map>              //  map
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_annotate, g_annotateDelay
+#include "fileHandler.hpp"  //  initOFile()
+#include "writerHarness.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./annotate_bench <packets> <sockets> [<pps> [<delays>]]" << endl;
+    cout << "\t<pps>\tOffered load in packets per second (default 200000)" << endl;
+    cout << "\t<delays>\tComma delimited list of --annotate delays in ms (default 0,20,200)" << endl;
+}
+
+
+/*!
+ * @brief   Results of one run
+ */
+struct Result
+{
+    unsigned dropped = 0;       //!< Packets dropped by the file buffer
+    unsigned written = 0;       //!< Packets in the file
+    unsigned annotated = 0;     //!< Packets with the application option
+    unsigned wrong = 0;         //!< Packets with another application or an unnamed ID
+    unsigned nameBlocks = 0;    //!< Blocks with application names
+    size_t bytes = 0;           //!< Size of the file
+};
+
+
+/*!
+ * @brief   Reads the capture back and checks annotations against the sockets
+ */
+void check(const string &file, const map<uint16_t, string> &appOfPort, Result &r)
+{
+    map<uint32_t, string> names;
+    r.bytes = writerHarness::forEachBlock(file, [&](uint32_t type, const char *block, uint32_t len) {
+        if (type == 0x00000BAD && memcmp(block + 12, "NMA1", 4) == 0)
+        {
+            r.nameBlocks++;
+            for (size_t p = 16; p + 6 <= len - 4; )
+            {
+                uint32_t id;
+                uint16_t l;
+                memcpy(&id, block + p, 4);
+                memcpy(&l, block + p + 4, 2);
+                if (l == 0)
+                    break;  // padding
+                names[id] = string(block + p + 6, l);
+                p += 6 + l;
+            }
+        }
+        else if (type == writerHarness::EPB_TYPE)
+        {
+            r.written++;
+            uint32_t caplen;
+            memcpy(&caplen, block + 20, 4);
+            const size_t options = 28 + caplen + (4 - caplen % 4) % 4;
+            uint16_t code = 0;
+            if (options + 4 <= len - 4)
+                memcpy(&code, block + options, 2);
+            if (code == 2989)
+            {
+                r.annotated++;
+                uint32_t id;
+                memcpy(&id, block + options + 8, 4);
+                auto app = appOfPort.find(writerHarness::localPort(block));
+                auto name = names.find(id);
+                if (app == appOfPort.end() || name == names.end() || name->second != app->second)
+                    r.wrong++;
+            }
+        }
+    });
+}
+
+
+Result run(const writerHarness::Flows &flows, unsigned long packets, double pps, bool annotate, unsigned delay)
+{
+    Result r;
+    g_annotate = annotate;
+    g_annotateDelay = delay;
+    const string file = "/tmp/namon_annotate_bench.pcapng";
+    ofstream out(file, ios::binary | ios::trunc);
+    initOFile(out, { "bench" }, { 1 });
+    FlowApps flowApps;
+    if (annotate)
+        flowApps.enable();
+    r.dropped = writerHarness::offer(flows, packets, pps, out, annotate ? &flowApps : nullptr, chrono::milliseconds(delay));
+    out.close();
+    check(file, flows.appOfPort, r);
+    remove(file.c_str());
+    return r;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = strtoul(argv[1], nullptr, 10);
+    const unsigned socketCount = strtoul(argv[2], nullptr, 10);
+    const double pps = (argc > 3) ? strtod(argv[3], nullptr) : 200000;
+    vector<unsigned> delays;
+    const string list = (argc > 4) ? argv[4] : "0,20,200";
+    for (size_t pos = 0; pos < list.size(); )
+    {
+        size_t end = list.find(',', pos);
+        if (end == string::npos)
+            end = list.size();
+        delays.push_back(strtoul(list.substr(pos, end - pos).c_str(), nullptr, 10));
+        pos = end + 1;
+    }
+    if (packets == 0 || socketCount == 0 || pps <= 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    writerHarness::Flows flows;
+    if (writerHarness::setUp(socketCount, flows))
+        return 1;
+    const vector<vector<uint8_t>> &frames = flows.frames;
+
+    // hashes of both endpoints, the netflow key is one of them and the storage policy uses both
+    const unsigned HASH_ROUNDS = 1000000;
+    const SimdLevel simd = detectSimdLevel();
+    uint64_t sum = 0;
+    const auto t0 = bench_clock::now();
+    for (unsigned i = 0; i < HASH_ROUNDS; i++)
+    {
+        const uint8_t *ip = frames[i % frames.size()].data() + ETHER_HDRLEN;
+        sum += endpointHash(ip + 12, 4, ip + 20, ip[9], simd) ^ endpointHash(ip + 16, 4, ip + 22, ip[9], simd);
+    }
+    const double hashNs = chrono::duration<double>(bench_clock::now() - t0).count() / HASH_ROUNDS * 1e9;
+
+    // the same CRC-32C, different keys
+    FlowApps collisions;
+    collisions.enable();
+    collisions.publish((uint64_t)0x12345678 << 32 | 1, 1, "a");
+    AppId collided = NO_APP;
+    const bool told = !collisions.find((uint64_t)0x12345678 << 32 | 2, collided);
+
+    cout << packets << " packets of " << frames.size() << " flows offered at " << (long)pps << " pps" << endl;
+    cout << "Endpoint hashes: " << fixed << setprecision(1) << hashNs << " ns/packet (" << toString(simd)
+         << ", checksum " << sum << "), colliding flows " << (told ? "told apart" : "mistaken") << endl << endl;
+    cout << left << setw(14) << "annotate" << right << setw(10) << "dropped"
+         << setw(10) << "written" << setw(12) << "annotated" << setw(8) << "%" << setw(8) << "wrong"
+         << setw(8) << "names" << setw(12) << "bytes" << endl;
+    auto print = [](const string &name, const Result &r) {
+        cout << left << setw(14) << name << right << fixed << setprecision(1) << setw(10) << r.dropped << setw(10) << r.written << setw(12) << r.annotated
+             << setw(8) << (r.written ? 100.0 * r.annotated / r.written : 0) << setw(8) << r.wrong
+             << setw(8) << r.nameBlocks << setw(12) << r.bytes << endl;
+    };
+    unsigned wrong = 0;
+    print("off", run(flows, packets, pps, false, 0));
+    for (unsigned d : delays)
+    {
+        const Result r = run(flows, packets, pps, true, d);
+        print(to_string(d) + " ms", r);
+        wrong += r.wrong;
+    }
+
+    procfsFixture::remove(flows.root);
+    return (wrong || !told) ? 1 : 0;
+}
@@ -0,0 +1,215 @@
+/**
+ *  @file       appfilter_bench.cpp
+ *  @brief      Cost of searching for sockets of --app and the share of its packets which are stored
+ *  @details    Builds a procfs tree with N processes x M sockets (see procfsFixture.hpp), two
+ *              of the processes get an executable matching the pattern while their command
+ *              lines don't. findAppSockets() is timed as it runs every APP_RESCAN_INTERVAL and
+ *              the length of the kernel filter expression is reported. Then frames of all
+ *              sockets are offered to packetHandler() at a fixed rate (as if the kernel didn't
+ *              filter), the cache is pre-scanned as with --app and the writer stores only
+ *              packets of matching applications. The file is read back: every stored packet
+ *              must belong to a matching process. Sockets of the last process are left out of
+ *              the scan, as if they were opened after it, so the cache thread must add them
+ *              to the kernel filter.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 00:20
+ *   - Edited:  20.10.2026 04:40
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+#include <fstream>          //  ofstream, ifstream
+#include <iterator>         //  istreambuf_iterator
+#include <set>              //  set
+#include <pcap.h>           //  pcap_pkthdr
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  packetHandler(), g_appPattern
+#include "fileHandler.hpp"  //  initOFile()
+#include "namon_linux.hpp"  //  findAppSockets(), prescanSockets()
+#include "procfsFixture.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+extern mac_addr g_devMac;
+
+const unsigned int      FILE_RING_SIZE      = 2000;     //!< Same as in capturing.cpp
+const unsigned int      CACHE_RING_SIZE     = 2000;     //!< Same as in capturing.cpp
+const unsigned int      FRAME_SIZE          = 128;      //!< Length of the frames
+const unsigned int      ROUNDS              = 10;       //!< Scans are repeated and the average time is used
+const char * const      PATTERN             = "matchd"; //!< Pattern of --app, only in the executable path
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./appfilter_bench <processes> <socketsPerProcess> [<packets> [<pps>]]" << endl;
+    cout << "\t<packets>\tPackets offered to the writer (default 100000)" << endl;
+    cout << "\t<pps>\tOffered load in packets per second (default 200000)" << endl;
+}
+
+
+/*!
+ * @brief   Returns local ports of packets in the capture file
+ */
+vector<uint16_t> readPorts(const string &file)
+{
+    ifstream in(file, ios::binary);
+    const string data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    vector<uint16_t> ports;
+    for (size_t pos = 0; pos + 12 <= data.size(); )
+    {
+        uint32_t type, len;
+        memcpy(&type, &data[pos], 4);
+        memcpy(&len, &data[pos + 4], 4);
+        if (len < 12 || pos + len > data.size())
+            break;
+        if (type == 6)
+        {   // source port of the outbound frame is the local one
+            const uint8_t *l4 = reinterpret_cast<const uint8_t *>(&data[pos + 28]) + ETHER_HDRLEN + 20;
+            ports.push_back(l4[0] << 8 | l4[1]);
+        }
+        pos += len;
+    }
+    return ports;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned processes = strtoul(argv[1], nullptr, 10);
+    const unsigned perProcess = strtoul(argv[2], nullptr, 10);
+    const unsigned long packets = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 100000;
+    const double pps = (argc > 4) ? strtod(argv[4], nullptr) : 200000;
+    if (processes < 2 || perProcess == 0 || packets == 0 || pps <= 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    string root;
+    vector<FixtureSocket> sockets;
+    if (procfsFixture::setUp(root, processes, perProcess, "tcp4:3,udp4:1", sockets))
+        return 1;
+    // the first and the last process match by their executable
+    const set<int> matching { sockets.front().pid, sockets.back().pid };
+    for (int pid : matching)
+        symlink("/usr/sbin/matchd", (root + "/" + to_string(pid) + "/exe").c_str());
+
+    const mac_addr devMac { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+    g_devMac = devMac;
+    vector<vector<uint8_t>> frames;
+    set<uint16_t> matchingPorts;
+    for (const FixtureSocket &s : sockets)
+    {
+        frames.push_back(procfsFixture::buildFrame(s, FRAME_SIZE, g_devMac));
+        if (matching.count(s.pid))
+            matchingPorts.insert(s.port);
+        g_localAddresses.add(&s.ip, s.ipVersion);
+    }
+    g_localAddresses.publish();
+
+    // the search runs every APP_RESCAN_INTERVAL
+    AppFilter filter(PATTERN);
+    vector<AppSocket> found;
+    vector<string> exeNames;
+    double scanSec = 0;
+    for (unsigned r = 0; r < ROUNDS; r++)
+    {
+        found.clear();
+        exeNames.clear();
+        const auto t0 = bench_clock::now();
+        findAppSockets(PATTERN, found, exeNames);
+        scanSec += chrono::duration<double>(bench_clock::now() - t0).count();
+    }
+    scanSec /= ROUNDS;
+    filter.addNames(exeNames);
+    const string expr = AppFilter::buildKernelExpr(found);
+    set<uint16_t> lastPorts;
+    for (const FixtureSocket &s : sockets)
+        if (s.pid == sockets.back().pid)
+            lastPorts.insert(s.port);
+    vector<AppSocket> scanned;
+    for (const AppSocket &s : found)
+        if (!lastPorts.count(s.port))
+            scanned.push_back(s);
+    filter.setSockets(scanned);
+    const unsigned int scannedVersion = filter.getVersion();
+    cout << processes << " processes x " << perProcess << " sockets, " << matching.size() << " processes match '" << PATTERN << "'" << endl;
+    cout << "Search: " << found.size() << " sockets in " << fixed << setprecision(3) << scanSec * 1000 << " ms ("
+         << setprecision(2) << 100 * scanSec / chrono::duration<double>(APP_RESCAN_INTERVAL).count()
+         << " % of the interval), kernel filter " << expr.size() << " characters" << endl;
+
+    // the writer stores only packets of matching applications
+    shouldStop = 0;
+    g_appPattern = PATTERN;
+    const string file = "/tmp/namon_appfilter_bench.pcapng";
+    ofstream out(file, ios::binary | ios::trunc);
+    vector<const char *> devs { "bench" };
+    initOFile(out, devs, { 1 });
+    FlowApps flowApps;
+    flowApps.enable();
+    Cache cache;
+    prescanSockets(cache, g_localAddresses);
+    RingBuffer<EnhancedPacketBlock> fileBuffer(FILE_RING_SIZE);
+    thread writer([&fileBuffer, &out, &flowApps, &filter]() {
+        RingBuffer<EnhancedPacketBlock>::write({ &fileBuffer }, out, &flowApps, chrono::milliseconds(APP_FILTER_DELAY),
+                                               false, nullptr, &filter);
+    });
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    thread cacheThread([&cacheBuffer, &cache, &flowApps, &filter]() {
+        RingBuffer<Netflow>::run({ &cacheBuffer }, &cache, nullptr, chrono::seconds(0), &flowApps, nullptr, &filter);
+    });
+
+    PacketHandlerParams ptrs{ &fileBuffer, &cacheBuffer, 0, DLT_EN10MB, &g_devMac, &g_storagePolicy };
+    pcap_pkthdr header;
+    header.len = header.caplen = frames[0].size();
+    header.ts.tv_sec = 1500000000;
+    unsigned long offered = 0;
+    const auto t0 = bench_clock::now();
+    for (unsigned long i = 0; i < packets; i++)
+    {
+        while (chrono::duration<double>(bench_clock::now() - t0).count() * pps < i)
+            ;
+        header.ts.tv_usec = i % 1000000;
+        const FixtureSocket &s = sockets[i % sockets.size()];
+        offered += matching.count(s.pid);
+        packetHandler(reinterpret_cast<u_char*>(&ptrs), &header, frames[i % frames.size()].data());
+    }
+    while (cacheBuffer.newItemOrStop() || fileBuffer.newItemOrStop())
+        this_thread::sleep_for(chrono::milliseconds(1));
+    shouldStop = 1;
+    cacheBuffer.notifyCondVar();
+    fileBuffer.notifyCondVar();
+    cacheThread.join();
+    writer.join();
+    out.close();
+
+    const vector<uint16_t> ports = readPorts(file);
+    remove(file.c_str());
+    unsigned wrong = 0;
+    for (uint16_t p : ports)
+        wrong += !matchingPorts.count(p);
+    cout << "Writer: " << packets << " packets offered, " << offered << " of matching processes, " << ports.size()
+         << " stored (" << setprecision(1) << (offered ? 100.0 * ports.size() / offered : 0) << " %), "
+         << filter.getSkipped() << " skipped, " << fileBuffer.getDroppedElem() << " dropped, " << wrong << " wrong" << endl;
+    string cacheExpr;
+    const unsigned int updates = filter.getKernelExpr(cacheExpr) - scannedVersion;
+    cout << "Cache: " << updates << " kernel filter updates, " << (cacheExpr == expr ? "all" : "not all")
+         << " sockets left out of the scan were added" << endl;
+
+    procfsFixture::remove(root);
+    return (wrong == 0 && found.size() == matching.size() * perProcess && cacheExpr == expr) ? 0 : 1;
+}
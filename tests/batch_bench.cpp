@@ -0,0 +1,304 @@
+/**
+ *  @file       batch_bench.cpp
+ *  @brief      Cost of the batch classification against the per-packet handler
+ *  @details    Checks that all instruction sets classify a batch the same way (directions,
+ *              CRC-32C of netflow keys carried by netflows) and measures cycles/packet of the flow-only handler
+ *              one packet at a time and in batches with scalar, SSE4.2 and AVX2 code.
+ *              Directions are determined by local addresses and then by the device MAC address.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 17:50
+ *   - Edited:  19.10.2026 19:05
+ */
+
+#include <iostream>         //  cout, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <vector>           //  vector
+#include <string>           //  string
+#include <pcap.h>           //  pcap_pkthdr, DLT_*
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>      //  __rdtsc()
+#endif
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  selectHandler(), flushBatch(), PacketHandlerParams
+#include "packetBatch.hpp"  //  PacketBatch
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      CACHE_RING_SIZE = 2000;     //!< Same as in capturing.cpp
+const unsigned int      DRAIN_PERIOD    = 1024;     //!< The cache buffer is emptied after this number of packets
+const uint8_t           LOCAL_IP4[4]    = { 10, 0, 0, 1 };
+const uint8_t           LOCAL_IP6[16]   = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+const mac_addr          DEV_MAC         { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./batch_bench [<packets> [<flows> [<batch>]]]" << endl;
+    cout << "\t<flows>\tNumber of netflows, packets go round-robin over them (default 16)" << endl;
+    cout << "\t<batch>\tBatch size, see --batch (default 32)" << endl;
+}
+
+
+void put16(vector<uint8_t> &f, uint16_t v) { f.push_back(v >> 8); f.push_back(v & 0xff); }
+
+
+/*!
+ * @brief   Builds an Ethernet frame of the k-th flow, every fourth flow is IPv6,
+ *          odd flows are UDP and every other pair of flows is inbound
+ */
+vector<uint8_t> buildFrame(unsigned int k, Directions &dir)
+{
+    const bool v6 = (k % 4 == 3);
+    const uint8_t proto = (k % 2) ? PROTO_UDP : PROTO_TCP;
+    dir = ((k / 2) % 2) ? Directions::INBOUND : Directions::OUTBOUND;
+    const uint8_t remoteMac[6] = { 0x02, 0xaa, 0, 0, 0, 2 };
+    vector<uint8_t> f;
+    const uint8_t *dst = (dir == Directions::INBOUND) ? DEV_MAC.bytes : remoteMac;
+    const uint8_t *src = (dir == Directions::INBOUND) ? remoteMac : DEV_MAC.bytes;
+    f.insert(f.end(), dst, dst + 6);
+    f.insert(f.end(), src, src + 6);
+    put16(f, v6 ? 0x86dd : 0x0800);
+
+    const unsigned int l4Len = (proto == PROTO_TCP) ? 20 : 8;
+    const uint8_t remote4[4] = { 192, 0, (uint8_t)(k >> 8), (uint8_t)k };
+    uint8_t remote6[16] = { 0x20, 0x01, 0x0d, 0xb8, 0xff };
+    remote6[14] = k >> 8; remote6[15] = k;
+    const uint8_t *local = v6 ? LOCAL_IP6 : LOCAL_IP4;
+    const uint8_t *remote = v6 ? remote6 : remote4;
+    const unsigned int ipLen = v6 ? 16 : 4;
+    if (v6)
+    {
+        f.push_back(0x60); f.insert(f.end(), 3, 0);
+        put16(f, l4Len);
+        f.push_back(proto); f.push_back(64);
+    }
+    else
+    {
+        f.push_back(0x45); f.push_back(0);
+        put16(f, 20 + l4Len);
+        put16(f, 0); put16(f, 0);
+        f.push_back(64); f.push_back(proto);
+        put16(f, 0);
+    }
+    const uint8_t *s = (dir == Directions::INBOUND) ? remote : local;
+    const uint8_t *d = (dir == Directions::INBOUND) ? local : remote;
+    f.insert(f.end(), s, s + ipLen);
+    f.insert(f.end(), d, d + ipLen);
+
+    const uint16_t localPort = 10000 + k;
+    put16(f, (dir == Directions::INBOUND) ? 443 : localPort);
+    put16(f, (dir == Directions::INBOUND) ? localPort : 443);
+    if (proto == PROTO_TCP)
+    {
+        f.insert(f.end(), 8, 0);
+        f.push_back(5 << 4); f.push_back(0x10);
+        f.insert(f.end(), 6, 0);
+    }
+    else
+    {
+        put16(f, l4Len);
+        put16(f, 0);
+    }
+    return f;
+}
+
+
+/*!
+ * @return  Time stamp counter (nanoseconds on other architectures than x86)
+ */
+inline uint64_t ticks()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return chrono::duration_cast<chrono::nanoseconds>(bench_clock::now().time_since_epoch()).count();
+#endif
+}
+
+
+/*!
+ * @brief   Fills the batch with the frames and classifies it
+ * @return  Number of netflows
+ */
+unsigned int classifyFrames(PacketBatch &batch, const vector<vector<uint8_t>> &frames, Classification c, SimdLevel simd)
+{
+    batch.clear();
+    batch.setSimdLevel(simd);
+    batch.setClassification(c);
+    for (unsigned int i = 0; i < frames.size() && i < MAX_BATCH_SIZE; i++)
+    {
+        ParsedPacket p;
+        if (PacketParser<StaticLink<DLT_EN10MB>, AllProtocols>::parse(DLT_EN10MB, frames[i].data(), frames[i].size(), p))
+            return 0;
+        batch.add(p, p.l4Hdr, i, frames[i].data(), Directions::UNKNOWN);
+    }
+    return batch.classify(g_localAddresses, &DEV_MAC);
+}
+
+
+/*!
+ * @brief   Runs the handler over the frames
+ * @return  Ticks and nanoseconds per packet
+ */
+pair<double, double> run(pcap_handler handler, PacketHandlerParams &ptrs, const vector<vector<uint8_t>> &frames, unsigned long packets)
+{
+    pcap_pkthdr header;
+    header.ts.tv_sec = 1500000000;
+    header.ts.tv_usec = 0;
+    const auto t0 = bench_clock::now();
+    const uint64_t c0 = ticks();
+    for (unsigned long i = 0; i < packets; i++)
+    {
+        const vector<uint8_t> &f = frames[i % frames.size()];
+        header.caplen = header.len = f.size();
+        handler(reinterpret_cast<u_char*>(&ptrs), &header, f.data());
+        if (i % DRAIN_PERIOD == DRAIN_PERIOD - 1)
+            while (!ptrs.cacheBuffer->empty())
+                ptrs.cacheBuffer->pop();
+    }
+    flushBatch(&ptrs);
+    const uint64_t c1 = ticks();
+    const double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    while (!ptrs.cacheBuffer->empty())
+        ptrs.cacheBuffer->pop();
+    return make_pair((double)(c1 - c0) / packets, sec / packets * 1e9);
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc > 4)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 5000000;
+    const unsigned int flowCount = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 16;
+    const unsigned int batchSize = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 32;
+    if (packets == 0 || flowCount == 0 || batchSize == 0 || batchSize > MAX_BATCH_SIZE)
+    {
+        printHelp();
+        return 1;
+    }
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    vector<vector<uint8_t>> frames;
+    vector<Directions> expected;
+    for (unsigned int k = 0; k < flowCount; k++)
+    {
+        Directions d;
+        frames.push_back(buildFrame(k, d));
+        expected.push_back(d);
+    }
+    const SimdLevel best = detectSimdLevel();
+    vector<SimdLevel> levels = { SimdLevel::SCALAR };
+    if (best != SimdLevel::SCALAR)
+        levels.push_back(SimdLevel::SSE42);
+    if (best == SimdLevel::AVX2)
+        levels.push_back(SimdLevel::AVX2);
+
+    // all levels compute the same results
+    int failed = 0;
+    const char check[] = "123456789";
+    for (SimdLevel l : levels)
+        if (crc32c(check, 9, l) != 0xe3069283)
+        {
+            cout << "crc32c(\"123456789\") is wrong with " << toString(l) << endl;
+            failed++;
+        }
+    PacketBatch reference, batch;
+    for (int c = 0; c < 2; c++)
+    {
+        const Classification cl = c ? Classification::MAC : Classification::ADDRESS;
+        if (cl == Classification::ADDRESS)
+        {
+            g_localAddresses.add(LOCAL_IP4, 4);
+            g_localAddresses.add(LOCAL_IP6, 6);
+        }
+        else
+        {
+            g_localAddresses.remove(LOCAL_IP4, 4);
+            g_localAddresses.remove(LOCAL_IP6, 6);
+        }
+        g_localAddresses.publish();
+        const unsigned int refFlows = classifyFrames(reference, frames, cl, SimdLevel::SCALAR);
+        for (unsigned int i = 0; i < frames.size() && i < MAX_BATCH_SIZE; i++)
+            if (reference.getDirection(i) != expected[i])
+            {
+                cout << "Wrong direction of flow " << i << (c ? " by MAC" : " by address") << endl;
+                failed++;
+            }
+        for (SimdLevel l : levels)
+        {
+            const unsigned int flows = classifyFrames(batch, frames, cl, l);
+            bool same = (flows == refFlows);
+            for (unsigned int i = 0; i < frames.size() && i < MAX_BATCH_SIZE; i++)
+                same = same && batch.getDirection(i) == reference.getDirection(i) && batch.getHash(i) == reference.getHash(i);
+            // netflows carry the hash of their key into the cache
+            for (unsigned int f = 0; f < flows; f++)
+                same = same && batch.getFlows()[f].getHash() == batch.getFlows()[f].getKey().hash(SimdLevel::SCALAR);
+            if (!same)
+            {
+                cout << toString(l) << " classification differs from the scalar one" << (c ? " (MAC)" : " (address)") << endl;
+                failed++;
+            }
+        }
+    }
+
+    cout << "flows=" << flowCount << " batch=" << batchSize << " cpu=" << toString(best)
+#if defined(__x86_64__) || defined(__i386__)
+         << " (ticks are TSC cycles)" << endl;
+#else
+         << " (ticks are nanoseconds)" << endl;
+#endif
+    cout << left << setw(14) << "direction" << setw(20) << "handler" << right << setw(14) << "ticks/pkt" << setw(12) << "ns/pkt" << endl;
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    for (int c = 0; c < 2; c++)
+    {
+        const bool byAddress = (c == 0);
+        if (byAddress)
+        {
+            g_localAddresses.add(LOCAL_IP4, 4);
+            g_localAddresses.add(LOCAL_IP6, 6);
+        }
+        else
+        {
+            g_localAddresses.remove(LOCAL_IP4, 4);
+            g_localAddresses.remove(LOCAL_IP6, 6);
+        }
+        g_localAddresses.publish();
+
+        double scalarTicks = 0;
+        for (int v = -1; v < (int)levels.size(); v++)
+        {
+            PacketHandlerParams ptrs{ nullptr, &cacheBuffer, 0, DLT_EN10MB, &DEV_MAC, nullptr };
+            const bool isBatch = (v >= 0);
+            if (isBatch)
+            {
+                ptrs.batch.setCapacity(batchSize);
+                ptrs.batch.setSimdLevel(levels[v]);
+            }
+            const pcap_handler handler = selectHandler(DLT_EN10MB, true, true, false, isBatch);
+            run(handler, ptrs, frames, packets / 10 + 1);     // warm up
+            const pair<double, double> r = run(handler, ptrs, frames, packets);
+            if (!isBatch)
+                scalarTicks = r.first;
+            cout << left << setw(14) << (byAddress ? "address" : "MAC")
+                 << setw(20) << (isBatch ? string("batch ") + toString(levels[v]) : string("per-packet")) << right
+                 << fixed << setprecision(2) << setw(14) << r.first << setw(12) << r.second;
+            if (isBatch)
+                cout << "  (" << setprecision(2) << scalarTicks / r.first << "x)";
+            cout << endl;
+        }
+    }
+    cout << endl << (failed ? to_string(failed) + " checks failed." : string("All instruction sets give the same results.")) << endl;
+    return failed ? 1 : 0;
+}
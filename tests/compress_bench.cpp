@@ -0,0 +1,251 @@
+/**
+ *  @file       compress_bench.cpp
+ *  @brief      Compression ratio and CPU cost of --compress and reading of the compressed file
+ *  @details    Writes the SHB, IDB and N packets of a few TCP flows (40 % bare ACKs, text payloads
+ *              and the given share of random, i.e. encrypted, payloads) with a flush every round
+ *              of packets as the writer thread does it, and a 3 MiB custom block at the end,
+ *              once into memory as they are and once through #NAMON::CompressedOutput. The
+ *              difference of the times is the cost of compression. The compressed file is then
+ *              read back by #NAMON::CompressedReader: it must give the same bytes, every frame
+ *              must be whole blocks with its first time stamp in the index, the preamble must be
+ *              the SHB and IDB, and a file cut off before the index must still be readable
+ *              frame by frame.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:50
+ *   - Edited:  20.10.2026 02:50
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <fstream>          //  ofstream
+#include <sstream>          //  ostringstream
+#include <string>           //  string
+#include <cstring>          //  memcpy()
+#include <unistd.h>         //  getpid(), unlink()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "fileHandler.hpp"  //  initOFile()
+#include "pcapng_blocks.hpp"//  EnhancedPacketBlock
+#include "compressedOutput.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      ROUND           = 64;           //!< Packets written between flushes
+const unsigned int      FLOWS           = 32;           //!< TCP flows of the packets
+const size_t            BIG_BLOCK       = 3 << 20;      //!< Length of the custom block at the end
+const uint32_t          EPB_TYPE        = 6;            //!< Type of the enhanced packet block
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./compress_bench <packets> [<encrypted%>]" << endl;
+    cout << "\t<encrypted%>\tShare of packets with random payloads (default 30)" << endl;
+}
+
+
+/*!
+ * @brief   Generator of packets of a few TCP flows
+ */
+class Traffic
+{
+    uint64_t state = 88172645463325252ULL;
+    unsigned encrypted;
+    vector<uint32_t> seqs;
+    uint16_t ipId = 0;
+public:
+    explicit Traffic(unsigned enc) : encrypted(enc), seqs(FLOWS, 1000) { }
+    uint32_t random()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (uint32_t)state;
+    }
+    /*!
+     * @brief   Builds the next packet of a random flow
+     */
+    void next(vector<uint8_t> &p)
+    {
+        static const uint8_t header[54] = {
+            0x00,0x1b,0x21,0x3a,0x4c,0x5e, 0x3c,0x97,0x0e,0x11,0x22,0x33, 0x08,0x00,
+            0x45,0x00,0x00,0x00, 0x00,0x00,0x40,0x00, 0x40,0x06,0x00,0x00, 10,0,0,2, 93,184,216,0,
+            0xc0,0x00,0x01,0xbb, 0,0,0,0, 0,0,0,0, 0x50,0x10,0x01,0xf5, 0x00,0x00,0x00,0x00 };
+        const unsigned flow = random() % FLOWS;
+        const unsigned kind = random() % 100;
+        p.assign(header, header + sizeof(header));
+        p[33] = flow;
+        p[35] = flow;
+        p[18] = ipId >> 8;
+        p[19] = ipId++;
+        memcpy(&p[38], &seqs[flow], sizeof(uint32_t));
+        if (kind < 40)
+            return;     // ACK
+        size_t len = 200 + random() % 1261;
+        if (kind < 40 + encrypted * 60 / 100)
+            for (size_t i = 0; i < len; i += 4)
+            {
+                const uint32_t r = random();
+                p.insert(p.end(), reinterpret_cast<const uint8_t *>(&r), reinterpret_cast<const uint8_t *>(&r) + min<size_t>(4, len - i));
+            }
+        else
+        {
+            ostringstream text;
+            text << "HTTP/1.1 200 OK\r\nServer: nginx/1.18.0\r\nDate: Mon, 19 Oct 2026 " << random() % 24 << ":" << random() % 60
+                 << "\r\nContent-Type: application/json\r\nContent-Length: " << len << "\r\n\r\n";
+            while (text.tellp() < (streamoff)len)
+                text << "{\"id\":" << random() % 100000 << ",\"name\":\"item" << random() % 1000 << "\",\"price\":" << random() % 500 << "},";
+            const string s = text.str().substr(0, len);
+            p.insert(p.end(), s.begin(), s.end());
+        }
+        seqs[flow] += len;
+    }
+};
+
+
+/*!
+ * @brief   Writes the capture into the stream
+ */
+void writeCapture(ostream &out, unsigned long packets, unsigned encrypted)
+{
+    initOFile(out, { "bench0" }, { 1 });
+    Traffic traffic(encrypted);
+    EnhancedPacketBlock epb;
+    vector<uint8_t> p;
+    for (uint64_t i = 0; i < packets; i++)
+    {
+        traffic.next(p);
+        epb.setTimestamp(1000000 + i * 10);
+        epb.setOriginalPacketLength(p.size());
+        epb.setPacketData(p.data(), p.size());
+        epb.write(out, i % 3 ? (AppId)(i % 7 + 1) : NO_APP);
+        if (i % ROUND == ROUND - 1)
+            out.flush();
+    }
+    string big(BIG_BLOCK, 'x');
+    const uint32_t hdr[2] = { 0x40000BAD, (uint32_t)BIG_BLOCK };
+    memcpy(&big[0], hdr, sizeof(hdr));
+    memcpy(&big[BIG_BLOCK - sizeof(uint32_t)], &hdr[1], sizeof(uint32_t));
+    out.write(big.data(), big.size());
+}
+
+
+/*!
+ * @return  Empty string if the frame is whole blocks and its time stamp is in the index
+ */
+string checkFrame(const string &data, const FrameIndex &entry)
+{
+    size_t pos = 0;
+    uint64_t ts = 0;
+    while (pos + 3 * sizeof(uint32_t) <= data.size())
+    {
+        uint32_t w[5] = { 0 };
+        memcpy(w, data.data() + pos, min(sizeof(w), data.size() - pos));
+        if (w[1] < 3 * sizeof(uint32_t) || w[1] % 4 || pos + w[1] > data.size())
+            return "a block is cut";
+        if (w[0] == EPB_TYPE && ts == 0)
+            ts = (uint64_t)w[3] << 32 | w[4];
+        pos += w[1];
+    }
+    if (pos != data.size())
+        return "a block is cut";
+    return (ts == entry.timestamp) ? "" : "wrong time stamp";
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 3)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = strtoul(argv[1], nullptr, 10);
+    const unsigned encrypted = (argc > 2) ? strtoul(argv[2], nullptr, 10) : 30;
+    if (packets == 0 || encrypted > 100)
+    {
+        printHelp();
+        return 1;
+    }
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    ostringstream plain;
+    auto t0 = bench_clock::now();
+    writeCapture(plain, packets, encrypted);
+    const double plainSec = chrono::duration<double>(bench_clock::now() - t0).count();
+
+    ostringstream packedFile;
+    CompressedOutput compressedOut;
+    ostream compressed(&compressedOut);
+    t0 = bench_clock::now();
+    compressedOut.open(packedFile);
+    writeCapture(compressed, packets, encrypted);
+    compressedOut.close();
+    const double packedSec = chrono::duration<double>(bench_clock::now() - t0).count();
+
+    const string raw = plain.str();
+    const string packed = packedFile.str();
+    const string name = "/tmp/namon_compress_bench_" + to_string(getpid()) + ".pcapng.lz";
+    ofstream(name, ios::binary).write(packed.data(), packed.size());
+
+    int ret = 0;
+    CompressedReader reader;
+    string all, frame;
+    string err = reader.open(name) ? "can't open" : (reader.hasIndex() ? "" : "no index");
+    t0 = bench_clock::now();
+    for (size_t i = 0; err.empty() && i < reader.getFrames().size(); i++)
+    {
+        if (reader.readFrame(i, frame))
+            err = "frame " + to_string(i) + " is broken";
+        else if (!(err = checkFrame(frame, reader.getFrames()[i])).empty())
+            err = "frame " + to_string(i) + ": " + err;
+        all += frame;
+    }
+    const double readSec = chrono::duration<double>(bench_clock::now() - t0).count();
+    if (err.empty() && all != raw)
+        err = "different data";
+    string preamble;
+    ostringstream expected;
+    initOFile(expected, { "bench0" }, { 1 });
+    if (err.empty() && (reader.readPreamble(preamble) || preamble != expected.str()))
+        err = "wrong preamble";
+
+    // capturing was killed: the index and a part of the last frame are missing
+    const size_t frames = reader.getFrames().size();
+    size_t recovered = 0;
+    if (frames > 1)
+    {
+        CompressedTrailer trailer;
+        memcpy(&trailer, packed.data() + packed.size() - sizeof(trailer), sizeof(trailer));
+        ofstream(name, ios::binary | ios::trunc).write(packed.data(), trailer.indexOffset - 100);
+        CompressedReader cut;
+        if (cut.open(name) || cut.hasIndex() || cut.getFrames().size() != frames - 1)
+            err += " recovery failed";
+        for (size_t i = 0; i < cut.getFrames().size(); i++)
+            recovered += !cut.readFrame(i, frame);
+    }
+    unlink(name.c_str());
+
+    const double gbit = raw.size() * 8 / 1e9;
+    compressedOut.printStats();
+    cout << packets << " packets, " << encrypted << " % encrypted, " << fixed << setprecision(1)
+         << raw.size() / double(1 << 20) << " MiB -> " << packed.size() / double(1 << 20) << " MiB in "
+         << frames << " frames, ratio " << setprecision(2) << (double)raw.size() / packed.size() << endl;
+    cout << "Writing: " << setprecision(1) << plainSec * 1000 << " ms plain, " << packedSec * 1000 << " ms compressed, "
+         << (packedSec - plainSec) * 1000 / gbit << " ms of CPU per Gbit (" << gbit / (packedSec - plainSec) << " Gbit/s per core)" << endl;
+    cout << "Reading: " << readSec * 1000 << " ms, " << gbit / readSec << " Gbit/s, " << recovered << "/" << (frames ? frames - 1 : 0)
+         << " frames read without the index" << endl;
+    if (!err.empty())
+    {
+        cout << "INVALID: " << err << endl;
+        ret = 1;
+    }
+    else
+        cout << "valid" << endl;
+    return ret;
+}
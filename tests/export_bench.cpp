@@ -0,0 +1,183 @@
+/**
+ *  @file       export_bench.cpp
+ *  @brief      Duration and memory of the export of netflows at shutdown
+ *  @details    Fills the cache with N netflows of A applications whose start times are not in
+ *              order of the cache, then runs the shutdown path: Cache::saveResults() moves the
+ *              netflows into the results, AppResults::sort() sorts them and the mapping block
+ *              is written by both layouts. Every step is timed and the growth of the resident
+ *              memory is reported. The columnar block is decoded and every netflow has to be
+ *              there once, in order of its start time.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 00:50
+ *   - Edited:  20.10.2026 00:50
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <fstream>          //  ofstream, ifstream
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread::hardware_concurrency()
+#include <cstdio>           //  remove()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_apps, g_finalResults, g_legacyMapping
+#include "pcapng_blocks.hpp"//  CustomBlock
+#include "mappingBlock.hpp" //  decodeMapping()
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./export_bench <netflows> <applications> [<threads>]" << endl;
+    cout << "\t<threads>\tThreads sorting the netflows (default 0, the number of CPUs)" << endl;
+}
+
+
+/*!
+ * @return  Resident memory of the process in kB
+ */
+long residentKb()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            return strtol(line.c_str() + 6, nullptr, 10);
+    return 0;
+}
+
+
+/*!
+ * @brief   Fills the cache with netflows of applications, every netflow has its own local address and port
+ */
+void fillCache(Cache &cache, unsigned flows, unsigned apps)
+{
+    vector<AppId> ids;
+    for (unsigned a = 0; a < apps; a++)
+        ids.push_back(g_apps.intern("/usr/lib/app" + to_string(a) + "/bin/app" + to_string(a) + " --config /etc/app" + to_string(a)));
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < flows; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        Netflow *n = new Netflow;
+        ip4_addr *ip = new ip4_addr;
+        const uint32_t v = 0x0a000000 + i / 28000;
+        memcpy(ip, &v, IPv4_ADDRLEN);
+        n->setIpVersion(4);
+        n->setLocalIp(ip);
+        n->setProto((seed & 0x10000) ? PROTO_UDP : PROTO_TCP);
+        n->setLocalPort(32768 + i % 28000);
+        // netflows start during an hour
+        const uint64_t start = 1500000000ULL * 1000000 + (seed >> 4) % 3600000000ULL;
+        n->setStartTime(start);
+        n->setEndTime(start + (seed >> 16) % 5000000);
+        TEntry *e = new TEntry;
+        e->setNetflowPtr(n);
+        e->setAppId(ids[(seed >> 20) % apps]);
+        cache.insert(e);
+    }
+}
+
+
+/*!
+ * @brief   Writes the mapping block into the file by the given layout
+ * @return  Time in seconds
+ */
+double writeBlock(const string &file, bool legacy, size_t &size)
+{
+    g_legacyMapping = legacy;
+    ofstream out(file, ios::binary | ios::trunc);
+    CustomBlock cb;
+    const auto t0 = bench_clock::now();
+    cb.write(out);
+    out.flush();
+    const double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    size = out.seekp(0, ios::end).tellp();
+    return sec;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 4)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned flows = strtoul(argv[1], nullptr, 10);
+    const unsigned apps = strtoul(argv[2], nullptr, 10);
+    const unsigned threads = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 0;
+    if (flows == 0 || apps == 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    const string file = "/tmp/namon_export_bench.pcapng";
+    Cache *cache = new Cache;
+    fillCache(*cache, flows, apps);
+    cout << "Cache: " << flows << " netflows of " << apps << " applications, sorted by "
+         << (threads ? threads : thread::hardware_concurrency()) << " threads at most" << endl << endl;
+    cout << left << setw(18) << "step" << right << setw(12) << "ms" << setw(14) << "memory kB" << setw(12) << "bytes" << endl;
+    auto print = [](const char *name, double sec, long kb, size_t bytes) {
+        cout << left << setw(18) << name << right << fixed << setprecision(3) << setw(12) << sec * 1000
+             << setw(14) << kb << setw(12) << bytes << endl;
+    };
+
+    long kb = residentKb();
+    auto t0 = bench_clock::now();
+    cache->saveResults();
+    double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    print("save results", sec, residentKb() - kb, 0);
+    double total = sec;
+
+    kb = residentKb();
+    t0 = bench_clock::now();
+    g_finalResults.sort(threads);
+    sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    print("sort", sec, residentKb() - kb, 0);
+    total += sec;
+
+    size_t legacySize = 0, columnarSize = 0;
+    kb = residentKb();
+    sec = writeBlock(file, true, legacySize);
+    print("legacy write", sec, residentKb() - kb, legacySize);
+    kb = residentKb();
+    sec = writeBlock(file, false, columnarSize);
+    print("columnar write", sec, residentKb() - kb, columnarSize);
+    total += sec;
+    cout << "Shutdown with the columnar block took " << setprecision(3) << total * 1000 << " ms" << endl;
+
+    // the columnar body goes after the block type, length and PEN
+    string block(columnarSize, '\0');
+    ifstream(file, ios::binary).read(&block[0], block.size());
+    remove(file.c_str());
+    vector<string> names;
+    vector<MappedFlow> decoded;
+    if (decodeMapping(block.data() + 12, block.size() - 16, names, decoded))
+    {
+        cerr << "Can't decode the mapping block" << endl;
+        return 1;
+    }
+    unsigned wrong = 0;
+    for (size_t i = 1; i < decoded.size(); i++)
+        wrong += decoded[i].startTime < decoded[i - 1].startTime;
+    for (AppId id = 1; id < g_apps.size(); id++)
+    {
+        const vector<Netflow *> &f = g_finalResults.get(id);
+        for (size_t i = 1; i < f.size(); i++)
+            wrong += f[i]->getStartTime() < f[i - 1]->getStartTime();
+    }
+    cout << "Decoded " << decoded.size() << " netflows, " << wrong << " out of order" << endl;
+
+    g_finalResults.clear();
+    delete cache;   // entries without netflows
+    return (wrong == 0 && decoded.size() == flows) ? 0 : 1;
+}
@@ -0,0 +1,348 @@
+/**
+ *  @file       ipfix_bench.cpp
+ *  @brief      Throughput and correctness of the IPFIX export
+ *  @details    Fills the cache with N netflows of A applications, a quarter of them is active
+ *              longer than the active timeout and every eighth one is IPv6. For both transports
+ *              a collector listens on the loopback, the cache is swept once (long netflows go
+ *              out as active records) and the rest is exported by finish(). The collector checks
+ *              that every message fits into IPFIX_MTU, templates end with applicationName, follows
+ *              the sequence numbers and decodes every record against the netflow with the same
+ *              local endpoint: times, protocol, end reason and the application name have to
+ *              match. UDP datagrams lost by the loopback are reported, records of the TCP
+ *              collector have to be complete.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:20
+ *   - Edited:  20.10.2026 06:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+#include <map>              //  map
+#include <cstring>          //  memcpy(), memcmp()
+#include <sys/socket.h>     //  socket(), bind(), recv()
+#include <netinet/in.h>     //  sockaddr_in
+#include <arpa/inet.h>      //  htonl()
+#include <unistd.h>         //  close()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_apps
+#include "ipfixExporter.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      ACTIVE_TIMEOUT  = 60;       //!< Active timeout of the exporter (s)
+const unsigned int      LONG_FLOW       = 90;       //!< Duration of netflows exported by the sweep (s)
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./ipfix_bench <netflows> <applications>" << endl;
+}
+
+
+/*!
+ * @brief   Netflow as the collector should see it
+ */
+struct Expected
+{
+    uint64_t start;         //!< Start time (ms)
+    uint64_t end;           //!< End time (ms)
+    uint8_t proto;          //!< Layer 4 protocol
+    uint8_t reason;         //!< flowEndReason
+    string name;            //!< Name of the application
+    bool seen = false;      //!< A record of it was received
+};
+
+
+/*!
+ * @brief   What the collector received
+ */
+struct Received
+{
+    unsigned long messages = 0;     //!< Data messages
+    unsigned long templates = 0;    //!< Template messages
+    unsigned long records = 0;      //!< Matching data records
+    unsigned long gaps = 0;         //!< Records missing by sequence numbers
+    unsigned long wrong = 0;        //!< Oversized or malformed messages, records which don't match or repeat
+};
+
+
+/*!
+ * @brief   Key of the local endpoint, the address is zero-padded for IPv4
+ */
+string endpointKey(const uint8_t *ip, size_t len, uint16_t port)
+{
+    string key(16, '\0');
+    memcpy(&key[0], ip, len);
+    key.push_back((char)(port >> 8));
+    key.push_back((char)port);
+    return key;
+}
+
+
+uint16_t get16(const uint8_t *p)    { return p[0] << 8 | p[1]; }
+uint32_t get32(const uint8_t *p)    { return (uint32_t)get16(p) << 16 | get16(p + 2); }
+uint64_t get64(const uint8_t *p)    { return (uint64_t)get32(p) << 32 | get32(p + 4); }
+
+
+/*!
+ * @brief   Decodes one message and checks its records
+ */
+void decodeMessage(const uint8_t *msg, size_t len, map<string, Expected> &flows, uint32_t &sequence, Received &r)
+{
+    if (len < 16 || len > IPFIX_MTU - 48 || get16(msg) != 10 || get16(msg + 2) != len)
+    {
+        r.wrong++;
+        return;
+    }
+    const uint32_t seq = get32(msg + 8);
+    if (seq < sequence)
+        r.wrong++;
+    else
+        r.gaps += seq - sequence;
+    sequence = seq;
+    bool data = false;
+    for (size_t pos = 16; pos + 4 <= len; )
+    {
+        const uint16_t id = get16(msg + pos), setLen = get16(msg + pos + 2);
+        if (setLen < 4 || pos + setLen > len)
+        {
+            r.wrong++;
+            return;
+        }
+        if (id == 256 || id == 257)
+        {
+            data = true;
+            const size_t addrLen = (id == 256) ? 4 : 16;
+            for (size_t p = pos + 4; p < pos + setLen; )
+            {
+                const uint8_t *rec = msg + p;
+                const size_t nameAt = addrLen + 2 + 1 + 8 + 8 + 1;
+                if (p + nameAt + 1 > pos + setLen || p + nameAt + 1 + rec[nameAt] > pos + setLen)
+                {
+                    r.wrong++;
+                    return;
+                }
+                const string name(reinterpret_cast<const char *>(rec + nameAt + 1), rec[nameAt]);
+                auto it = flows.find(endpointKey(rec, addrLen, get16(rec + addrLen)));
+                sequence++;
+                if (it == flows.end() || it->second.seen)
+                {
+                    r.wrong++;
+                    p += nameAt + 1 + name.size();
+                    continue;
+                }
+                const Expected &e = it->second;
+                const uint8_t *f = rec + addrLen + 2;
+                if (f[0] != e.proto || get64(f + 1) != e.start || get64(f + 9) != e.end || f[17] != e.reason || name != e.name)
+                    r.wrong++;
+                else
+                    r.records++;
+                it->second.seen = true;
+                p += nameAt + 1 + name.size();
+            }
+        }
+        else if (id == 2)
+        {
+            // two templates of 7 fields, the last one is applicationName (96) of variable length
+            for (size_t p = pos + 4; p < pos + setLen; p += 4 + 7 * 4)
+                if (p + 4 + 7 * 4 > pos + setLen || get16(msg + p + 2) != 7
+                    || get16(msg + p + 4 + 6 * 4) != 96 || get16(msg + p + 4 + 6 * 4 + 2) != 0xffff)
+                {
+                    r.wrong++;
+                    return;
+                }
+            r.templates++;
+        }
+        pos += setLen;
+    }
+    r.messages += data;
+}
+
+
+/*!
+ * @brief   Fills the cache, every netflow has its own local endpoint
+ */
+void fillCache(Cache &cache, unsigned flows, unsigned apps, map<string, Expected> &expected)
+{
+    vector<AppId> ids;
+    for (unsigned a = 0; a < apps; a++)
+        ids.push_back(g_apps.intern("/usr/lib/app" + to_string(a) + "/bin/app" + to_string(a) + " --config /etc/app" + to_string(a)));
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < flows; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        Netflow *n = new Netflow;
+        uint8_t addr[16] = { 0x0a, 0, 0, 0 };
+        const uint32_t v = htonl(0x0a000000 + i / 28000);
+        memcpy(addr, &v, 4);
+        if (i % 8 == 7)
+        {
+            addr[0] = 0xfd;
+            ip6_addr *ip = new ip6_addr;
+            memcpy(ip, addr, IPv6_ADDRLEN);
+            n->setIpVersion(6);
+            n->setLocalIp(ip);
+        }
+        else
+        {
+            ip4_addr *ip = new ip4_addr;
+            memcpy(ip, addr, IPv4_ADDRLEN);
+            n->setIpVersion(4);
+            n->setLocalIp(ip);
+        }
+        n->setProto((seed & 0x10000) ? PROTO_UDP : PROTO_TCP);
+        n->setLocalPort(32768 + i % 28000);
+        const uint64_t start = 1500000000ULL * 1000000 + (seed >> 4) % 3600000000ULL;
+        const bool longFlow = (i % 4 == 0);
+        const uint64_t end = start + (longFlow ? LONG_FLOW * 1000000ULL : (seed >> 16) % 5000000);
+        n->setStartTime(start);
+        n->setEndTime(end);
+        TEntry *e = new TEntry;
+        e->setNetflowPtr(n);
+        const AppId app = ids[(seed >> 20) % apps];
+        e->setAppId(app);
+        cache.insert(e);
+
+        Expected &x = expected[endpointKey(addr, (i % 8 == 7) ? 16 : 4, n->getLocalPort())];
+        x.start = start / 1000;
+        x.end = end / 1000;
+        x.proto = n->getProto();
+        x.reason = (uint8_t)(longFlow ? IpfixEndReason::ACTIVE : IpfixEndReason::FORCED);
+        x.name = g_apps.name(app);
+    }
+}
+
+
+/*!
+ * @brief   Exports the cache to a collector on the loopback
+ * @return  Zero if the records are complete (TCP) and none of them is wrong
+ */
+int runTransport(bool tcp, unsigned flows, unsigned apps)
+{
+    const int listener = socket(AF_INET, tcp ? SOCK_STREAM : SOCK_DGRAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrLen = sizeof(addr);
+    const int rcvbuf = 16 * 1024 * 1024;
+    setsockopt(listener, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) || getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &addrLen)
+        || (tcp && listen(listener, 1)))
+    {
+        cerr << "Can't open the collector" << endl;
+        return 1;
+    }
+
+    Cache *cache = new Cache;
+    map<string, Expected> expected;
+    fillCache(*cache, flows, apps, expected);
+    Received r;
+    volatile bool done = false;
+    thread collector([tcp, listener, &expected, &r, &done]() {
+        const timeval timeout { 0, 200000 };
+        uint32_t sequence = 0;
+        vector<uint8_t> buf(65536);
+        if (!tcp)
+        {
+            setsockopt(listener, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+            while (true)
+            {
+                const ssize_t len = recv(listener, buf.data(), buf.size(), 0);
+                if (len > 0)
+                    decodeMessage(buf.data(), len, expected, sequence, r);
+                else if (done)
+                    break;
+            }
+            return;
+        }
+        const int conn = accept(listener, nullptr, nullptr);
+        string stream;
+        ssize_t len;
+        while ((len = recv(conn, buf.data(), buf.size(), 0)) > 0)
+        {
+            stream.append(reinterpret_cast<char *>(buf.data()), len);
+            size_t pos = 0;
+            while (stream.size() - pos >= 4 && stream.size() - pos >= get16(reinterpret_cast<const uint8_t *>(&stream[pos + 2])))
+            {
+                const size_t msgLen = get16(reinterpret_cast<const uint8_t *>(&stream[pos + 2]));
+                if (msgLen < 16)
+                {
+                    r.wrong++;
+                    break;
+                }
+                decodeMessage(reinterpret_cast<const uint8_t *>(&stream[pos]), msgLen, expected, sequence, r);
+                pos += msgLen;
+            }
+            stream.erase(0, pos);
+        }
+        close(conn);
+    });
+
+    IpfixCollector c;
+    c.tcp = tcp;
+    c.host = "127.0.0.1";
+    c.port = get16(reinterpret_cast<const uint8_t *>(&addr.sin_port));
+    IpfixExporter exporter(c, chrono::seconds(ACTIVE_TIMEOUT), 6);
+    if (exporter.start())
+    {
+        cerr << "Can't connect to the collector" << endl;
+        close(listener);
+        collector.detach();
+        return 1;
+    }
+    const auto t0 = bench_clock::now();
+    exporter.sweep(*cache);
+    const double sweepSec = chrono::duration<double>(bench_clock::now() - t0).count();
+    exporter.finish(*cache);
+    exporter.stop();
+    const double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    done = true;
+    collector.join();
+    close(listener);
+    delete cache;
+
+    const unsigned long queued = flows - exporter.getDropped();
+    cout << left << setw(6) << (tcp ? "tcp" : "udp") << right << fixed << setprecision(3) << setw(10) << sweepSec * 1000
+         << setw(10) << sec * 1000 << setw(12) << (unsigned long)(exporter.getExported() / sec) << setw(10) << r.messages
+         << setw(10) << r.templates << setw(10) << r.records << setw(10) << exporter.getDropped() << setw(8) << exporter.getFailed()
+         << setw(8) << (queued - r.records) << setw(8) << r.wrong << endl;
+    if (r.wrong || exporter.getFailed())
+        return 1;
+    return (tcp && (r.records != queued || r.gaps)) ? 1 : 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned flows = strtoul(argv[1], nullptr, 10);
+    const unsigned apps = strtoul(argv[2], nullptr, 10);
+    if (flows == 0 || flows > 28000 * 256 || apps == 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    cout << flows << " netflows of " << apps << " applications, " << (flows + 3) / 4 << " active longer than "
+         << ACTIVE_TIMEOUT << " s" << endl << endl;
+    cout << left << setw(6) << "" << right << setw(10) << "sweep ms" << setw(10) << "total ms" << setw(12) << "records/s"
+         << setw(10) << "messages" << setw(10) << "templates" << setw(10) << "records" << setw(10) << "dropped"
+         << setw(8) << "failed" << setw(8) << "lost" << setw(8) << "wrong" << endl;
+    int ret = runTransport(false, flows, apps);
+    ret |= runTransport(true, flows, apps);
+    return ret;
+}
@@ -0,0 +1,207 @@
+/**
+ *  @file       mapping_bench.cpp
+ *  @brief      Size and speed of the columnar mapping block compared with the legacy one
+ *  @details    Fills the results with N netflows of A applications on a host with a few local
+ *              addresses (netflows start in order with small gaps, as they do in a capture).
+ *              The mapping block is written by both layouts into a file, the columnar body
+ *              is also encoded into memory only. Then the body is decoded by every instruction
+ *              set and every netflow is checked against the results. A few netflows last
+ *              hours, so their durations don't fit into 32 bits.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 22:40
+ *   - Edited:  20.10.2026 05:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <fstream>          //  ofstream, ifstream
+#include <chrono>           //  steady_clock
+#include <map>              //  map
+#include <tuple>            //  tuple
+#include <cstdio>           //  remove()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_apps, g_finalResults, g_legacyMapping
+#include "pcapng_blocks.hpp"//  CustomBlock
+#include "mappingBlock.hpp" //  encodeMapping(), decodeMapping()
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      ROUNDS      = 5;        //!< Every step is repeated and the best time is used
+const unsigned int      IPS4        = 4;        //!< Local IPv4 addresses
+const unsigned int      IPS6        = 2;        //!< Local IPv6 addresses
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./mapping_bench <netflows> <applications>" << endl;
+}
+
+
+/*!
+ * @brief   Fills g_apps and g_finalResults with netflows
+ */
+void fillResults(unsigned flows, unsigned apps)
+{
+    vector<AppId> ids;
+    for (unsigned a = 0; a < apps; a++)
+        ids.push_back(g_apps.intern("/usr/lib/app" + to_string(a) + "/bin/app" + to_string(a) + " --config /etc/app" + to_string(a)));
+    uint64_t time = 1500000000ULL * 1000000;
+    uint32_t seed = 1;
+    for (unsigned i = 0; i < flows; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        Netflow *n = new Netflow;
+        const unsigned ip = (seed >> 8) % (IPS4 + IPS6);
+        if (ip < IPS4)
+        {
+            ip4_addr *a = new ip4_addr;
+            const uint32_t v = 0x0a000001 + ip;
+            memcpy(a, &v, IPv4_ADDRLEN);
+            n->setIpVersion(4);
+            n->setLocalIp(a);
+        }
+        else
+        {
+            ip6_addr *a = new ip6_addr;
+            memset(a, 0, IPv6_ADDRLEN);
+            reinterpret_cast<uint8_t *>(a)[0] = 0x20;
+            reinterpret_cast<uint8_t *>(a)[15] = ip;
+            n->setIpVersion(6);
+            n->setLocalIp(a);
+        }
+        n->setProto((seed & 0x10000) ? PROTO_UDP : PROTO_TCP);
+        n->setLocalPort(32768 + (seed >> 4) % 28000);
+        time += (seed >> 12) % 2000;                    // microseconds between netflows
+        n->setStartTime(time);
+        n->setEndTime(time + (seed >> 16) % 5000000 + (i % 1024 ? 0 : 1ULL << 33));  // up to 5 s long, a few 2.4 h
+        g_finalResults.add(ids[(seed >> 20) % apps], n);
+    }
+}
+
+
+/*!
+ * @brief   Writes the mapping block into the file by the given layout
+ * @return  Best time in seconds
+ */
+double writeBlock(const string &file, bool legacy, size_t &size)
+{
+    g_legacyMapping = legacy;
+    double best = 1e9;
+    for (unsigned r = 0; r < ROUNDS; r++)
+    {
+        ofstream out(file, ios::binary | ios::trunc);
+        CustomBlock cb;
+        const auto t0 = bench_clock::now();
+        cb.write(out);
+        out.flush();
+        best = min(best, chrono::duration<double>(bench_clock::now() - t0).count());
+        size = out.seekp(0, ios::end).tellp();    // the legacy layout goes back to the block length
+    }
+    return best;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned flows = strtoul(argv[1], nullptr, 10);
+    const unsigned apps = strtoul(argv[2], nullptr, 10);
+    if (flows == 0 || apps == 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    fillResults(flows, apps);
+    const string file = "/tmp/namon_mapping_bench.pcapng";
+
+    cout << "Results: " << flows << " netflows of " << apps << " applications, "
+         << IPS4 << " IPv4 and " << IPS6 << " IPv6 local addresses" << endl << endl;
+    cout << left << setw(24) << "step" << right << setw(12) << "bytes" << setw(12) << "B/netflow"
+         << setw(12) << "ms" << setw(14) << "Mnetflows/s" << endl;
+    auto print = [flows](const char *name, size_t bytes, double sec) {
+        cout << left << setw(24) << name << right << fixed << setw(12) << bytes << setprecision(1) << setw(12) << (double)bytes / flows
+             << setprecision(3) << setw(12) << sec * 1000 << setprecision(2) << setw(14) << flows / sec / 1e6 << endl;
+    };
+
+    size_t legacySize = 0, columnarSize = 0;
+    const double legacySec = writeBlock(file, true, legacySize);
+    const double columnarSec = writeBlock(file, false, columnarSize);
+    print("legacy write", legacySize, legacySec);
+    print("columnar write", columnarSize, columnarSec);
+    double best = 1e9;
+    string body;
+    for (unsigned r = 0; r < ROUNDS; r++)
+    {
+        body.clear();
+        const auto t0 = bench_clock::now();
+        encodeMapping(g_apps, g_finalResults, body);
+        best = min(best, chrono::duration<double>(bench_clock::now() - t0).count());
+    }
+    print("columnar encode", body.size(), best);
+
+    // the columnar body goes after the block type, length and PEN
+    string block(columnarSize, '\0');
+    ifstream(file, ios::binary).read(&block[0], block.size());
+    remove(file.c_str());
+    vector<string> names;
+    vector<MappedFlow> decoded, reference;
+    vector<SimdLevel> levels { SimdLevel::SCALAR };
+    if (detectSimdLevel() != SimdLevel::SCALAR)
+        levels.push_back(detectSimdLevel());
+    bool same = true;
+    for (SimdLevel simd : levels)
+    {
+        best = 1e9;
+        for (unsigned r = 0; r < ROUNDS; r++)
+        {
+            const auto t0 = bench_clock::now();
+            if (decodeMapping(block.data() + 12, block.size() - 16, names, decoded, simd))
+            {
+                cerr << "Can't decode the mapping block" << endl;
+                return 1;
+            }
+            best = min(best, chrono::duration<double>(bench_clock::now() - t0).count());
+        }
+        print((string("columnar decode ") + toString(simd)).c_str(), columnarSize, best);
+        if (simd == SimdLevel::SCALAR)
+            reference = decoded;
+        else
+            for (size_t i = 0; i < decoded.size(); i++)
+                same = same && decoded[i].startTime == reference[i].startTime && decoded[i].endTime == reference[i].endTime;
+    }
+
+    // every netflow of the results must be decoded once
+    map<tuple<string, uint64_t, uint64_t, uint16_t>, unsigned> expected;
+    for (AppId id = 1; id < g_apps.size(); id++)
+        for (Netflow *n : g_finalResults.get(id))
+            expected[make_tuple(g_apps.name(id), n->getStartTime(), n->getEndTime(), n->getLocalPort())]++;
+    unsigned wrong = 0;
+    uint64_t prevStart = 0;
+    for (const MappedFlow &f : decoded)
+    {
+        auto it = expected.find(make_tuple(names[f.app], f.startTime, f.endTime, f.port));
+        if (it == expected.end() || it->second == 0 || f.startTime < prevStart)
+            wrong++;
+        else
+            it->second--;
+        prevStart = f.startTime;
+    }
+    cout << endl << "Decoded " << decoded.size() << " netflows, " << wrong << " wrong, size "
+         << setprecision(1) << 100.0 * columnarSize / legacySize << " % of the legacy block" << endl;
+    cout << (same ? "All instruction sets give the same results." : "INVALID: instruction sets give different results.") << endl;
+
+    g_finalResults.clear();
+    return (wrong == 0 && same && decoded.size() == flows) ? 0 : 1;
+}
@@ -0,0 +1,302 @@
+/**
+ *  @file       parser_bench.cpp
+ *  @brief      Cost of the link layer and IP header walkers for various encapsulations
+ *  @details    Builds frames with VLAN tags, IPv6 extension headers and fragments, checks
+ *              that the walkers find the transport layer and measures ns/packet of the walkers
+ *              and of the whole flowHandler() and of the handler which selectHandler() specializes
+ *              for the link type of the frame. The fixed-offset row is the parsing which was used
+ *              before the walkers (Ethernet type at offset 12 and IHL only).
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 16:40
+ *   - Edited:  19.10.2026 17:50
+ */
+
+#include <iostream>         //  cout, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <vector>           //  vector
+#include <string>           //  string
+#include <pcap.h>           //  pcap_pkthdr, DLT_*
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  flowHandler(), selectHandler(), PacketHandlerParams
+#include "packetParser.hpp" //  parseLinkLayer(), walkIp4(), walkIp6()
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      CACHE_RING_SIZE = 2000;     //!< Same as in capturing.cpp
+const uint8_t           LOCAL_IP4[4]    = { 10, 0, 0, 1 };
+const uint8_t           LOCAL_IP6[16]   = { 0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 };
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./parser_bench [<packets>]" << endl;
+}
+
+
+/*!
+ * @brief   Test frame and its expected parsing
+ */
+struct Frame
+{
+    string name;                //!< Description
+    int linkType;               //!< DLT_*
+    vector<uint8_t> data;       //!< Frame
+    unsigned int l2Len;         //!< Expected link layer length
+    unsigned int ipLen;         //!< Expected IP header length including extension headers
+    uint8_t proto;              //!< Expected upper layer protocol
+    bool nonFirstFragment;      //!< The frame doesn't contain the transport layer header
+};
+
+
+void put16(vector<uint8_t> &f, uint16_t v) { f.push_back(v >> 8); f.push_back(v & 0xff); }
+
+
+/*!
+ * @brief       Appends link layer header
+ * @param[in]   tags    Types of VLAN tags in host order (0x8100, 0x88a8)
+ */
+void link(vector<uint8_t> &f, int linkType, const vector<uint16_t> &tags, uint16_t type)
+{
+    if (linkType == DLT_EN10MB)
+    {
+        static const uint8_t macs[12] = { 2, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 1 };
+        f.insert(f.end(), macs, macs + 12);
+    }
+    else if (linkType == DLT_LINUX_SLL)
+    {
+        put16(f, SLL_OUTGOING); put16(f, 1); put16(f, 6);
+        f.insert(f.end(), 8, 0);
+    }
+    else
+        return;     // DLT_RAW
+    for (uint16_t t : tags)
+    {
+        put16(f, t);
+        put16(f, 100);  // TCI, VLAN 100
+    }
+    put16(f, type);
+}
+
+
+void ip4(vector<uint8_t> &f, uint8_t proto, uint16_t payload, uint16_t fragOff = 0, bool mf = false)
+{
+    f.push_back(0x45); f.push_back(0);
+    put16(f, 20 + payload);
+    put16(f, 0x1234);
+    put16(f, (mf ? IPv4_MF : 0) | (fragOff / 8));
+    f.push_back(64); f.push_back(proto);
+    put16(f, 0);
+    f.insert(f.end(), LOCAL_IP4, LOCAL_IP4 + 4);
+    f.push_back(192); f.push_back(0); f.push_back(2); f.push_back(1);
+}
+
+
+void ip6(vector<uint8_t> &f, uint8_t nxt, uint16_t payload)
+{
+    f.push_back(0x60); f.insert(f.end(), 3, 0);
+    put16(f, payload);
+    f.push_back(nxt); f.push_back(64);
+    f.insert(f.end(), LOCAL_IP6, LOCAL_IP6 + 16);
+    f.insert(f.end(), 15, 0x20); f.push_back(2);
+}
+
+
+/*!
+ * @brief   Appends IPv6 extension header of 8 bytes (options or fragment)
+ */
+void ext6(vector<uint8_t> &f, uint8_t nxt, uint8_t type, uint16_t fragOff = 0, bool mf = false)
+{
+    f.push_back(nxt);
+    f.push_back(0);
+    if (type == PROTO_FRAGMENT)
+    {
+        put16(f, fragOff | (mf ? 1 : 0));
+        f.push_back(0xca); f.push_back(0xfe); f.push_back(0xba); f.push_back(0xbe);
+    }
+    else
+    {   // PadN option
+        f.push_back(1); f.push_back(4); f.insert(f.end(), 4, 0);
+    }
+}
+
+
+void l4(vector<uint8_t> &f, uint8_t proto, uint16_t len)
+{
+    put16(f, 40000);
+    put16(f, 443);
+    if (proto == PROTO_TCP)
+    {
+        f.insert(f.end(), 8, 0);
+        f.push_back(5 << 4); f.push_back(0x10);
+        f.insert(f.end(), 6, 0);
+    }
+    else
+    {
+        put16(f, len);
+        put16(f, 0);
+    }
+}
+
+
+vector<Frame> buildFrames()
+{
+    vector<Frame> frames;
+    auto add = [&frames](const string &name, int lt, const vector<uint16_t> &tags, bool v6,
+                         unsigned ipLen, uint8_t proto, bool nonFirst, const function<void(vector<uint8_t>&)> &body) {
+        Frame fr { name, lt, {}, 0, ipLen, proto, nonFirst };
+        link(fr.data, lt, tags, v6 ? 0x86dd : 0x0800);
+        fr.l2Len = fr.data.size();
+        body(fr.data);
+        fr.data.resize(max<size_t>(fr.data.size(), 64), 0);
+        frames.push_back(fr);
+    };
+    add("eth/ip4/tcp", DLT_EN10MB, {}, false, 20, PROTO_TCP, false,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_TCP, 20); l4(f, PROTO_TCP, 20); });
+    add("eth/vlan/ip4/tcp", DLT_EN10MB, { 0x8100 }, false, 20, PROTO_TCP, false,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_TCP, 20); l4(f, PROTO_TCP, 20); });
+    add("eth/qinq/ip4/udp", DLT_EN10MB, { 0x88a8, 0x8100 }, false, 20, PROTO_UDP, false,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_UDP, 8); l4(f, PROTO_UDP, 8); });
+    add("eth/ip6/tcp", DLT_EN10MB, {}, true, 40, PROTO_TCP, false,
+        [](vector<uint8_t> &f) { ip6(f, PROTO_TCP, 20); l4(f, PROTO_TCP, 20); });
+    add("eth/ip6/hbh/dst/tcp", DLT_EN10MB, {}, true, 56, PROTO_TCP, false,
+        [](vector<uint8_t> &f) { ip6(f, PROTO_HOPOPTS, 36); ext6(f, PROTO_DSTOPTS, PROTO_HOPOPTS); ext6(f, PROTO_TCP, PROTO_DSTOPTS); l4(f, PROTO_TCP, 20); });
+    add("eth/ip6/frag0/udp", DLT_EN10MB, {}, true, 48, PROTO_UDP, false,
+        [](vector<uint8_t> &f) { ip6(f, PROTO_FRAGMENT, 16); ext6(f, PROTO_UDP, PROTO_FRAGMENT, 0, true); l4(f, PROTO_UDP, 3000); });
+    add("eth/ip6/frag1448/udp", DLT_EN10MB, {}, true, 48, PROTO_UDP, true,
+        [](vector<uint8_t> &f) { ip6(f, PROTO_FRAGMENT, 16); ext6(f, PROTO_UDP, PROTO_FRAGMENT, 1448, false); f.insert(f.end(), 8, 0xaa); });
+    add("eth/ip4/frag0/udp", DLT_EN10MB, {}, false, 20, PROTO_UDP, false,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_UDP, 8, 0, true); l4(f, PROTO_UDP, 3000); });
+    add("eth/ip4/frag1480/udp", DLT_EN10MB, {}, false, 20, PROTO_UDP, true,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_UDP, 8, 1480, false); f.insert(f.end(), 8, 0xaa); });
+    add("sll/vlan/ip4/tcp", DLT_LINUX_SLL, { 0x8100 }, false, 20, PROTO_TCP, false,
+        [](vector<uint8_t> &f) { ip4(f, PROTO_TCP, 20); l4(f, PROTO_TCP, 20); });
+    add("raw/ip6/udp", DLT_RAW, {}, true, 40, PROTO_UDP, false,
+        [](vector<uint8_t> &f) { ip6(f, PROTO_UDP, 8); l4(f, PROTO_UDP, 8); });
+    return frames;
+}
+
+
+/*!
+ * @brief   Walks the frame as processFlow() does
+ * @return  Upper layer protocol or zero if the frame was rejected
+ */
+inline uint8_t walk(const Frame &fr, unsigned int &l2Len, IpLayer &ip)
+{
+    unsigned short type;
+    if (parseLinkLayer(fr.linkType, fr.data.data(), fr.data.size(), l2Len, type))
+        return 0;
+    const unsigned char *hdr = fr.data.data() + l2Len;
+    const unsigned int len = fr.data.size() - l2Len;
+    if ((type == PROTO_IPv4) ? walkIp4(hdr, len, ip) : walkIp6(hdr, len, ip))
+        return 0;
+    return ip.proto;
+}
+
+
+/*!
+ * @brief   Parsing used before the walkers (Ethernet only, IPv6 next header as the protocol)
+ */
+inline uint8_t walkFixed(const Frame &fr)
+{
+    const ether_hdr *eth = (const ether_hdr *)fr.data.data();
+    if (fr.data.size() < ETHER_HDRLEN || (eth->ether_type != PROTO_IPv4 && eth->ether_type != PROTO_IPv6))
+        return 0;
+    const unsigned char *hdr = fr.data.data() + ETHER_HDRLEN;
+    if (eth->ether_type == PROTO_IPv4)
+        return (((const ip4_hdr *)hdr)->ihl * 4 >= 20) ? ((const ip4_hdr *)hdr)->ip_p : 0;
+    return ((const ip6_hdr *)hdr)->ip6_nxt;
+}
+
+
+template <class F>
+double nsPerPacket(unsigned long packets, F f)
+{
+    auto t0 = bench_clock::now();
+    for (unsigned long i = 0; i < packets; i++)
+        f(i);
+    return chrono::duration<double>(bench_clock::now() - t0).count() / packets * 1e9;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc > 2)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = (argc > 1) ? strtoul(argv[1], nullptr, 10) : 10000000;
+    if (packets == 0)
+    {
+        printHelp();
+        return 1;
+    }
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    g_localAddresses.add(LOCAL_IP4, 4);
+    g_localAddresses.add(LOCAL_IP6, 6);
+    g_localAddresses.publish();
+
+    // nobody reads the buffer, so netflows are dropped when it is full
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    const mac_addr devMac { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+
+    cout << left << setw(24) << "frame" << right << setw(8) << "ok" << setw(14) << "walk ns/pkt"
+         << setw(16) << "handler ns/pkt" << setw(17) << "selected ns/pkt" << endl;
+    vector<Frame> frames = buildFrames();
+    int failed = 0;
+    volatile unsigned sink = 0;
+    for (const Frame &fr : frames)
+    {
+        PacketHandlerParams ptrs{ nullptr, &cacheBuffer, 0, fr.linkType, &devMac, nullptr };
+        pcap_pkthdr header;
+        header.caplen = header.len = fr.data.size();
+        header.ts.tv_sec = 1500000000;
+        header.ts.tv_usec = 0;
+        // the first fragment comes before the others
+        for (const Frame &first : frames)
+            if (first.name == fr.name.substr(0, 8) + "frag0/udp")
+                flowHandler(reinterpret_cast<u_char*>(&ptrs), &header, first.data.data());
+
+        unsigned int l2Len = 0;
+        IpLayer ip;
+        const bool ok = walk(fr, l2Len, ip) == fr.proto && l2Len == fr.l2Len && ip.hdrLen == fr.ipLen
+            && (ip.fragOffset != 0) == fr.nonFirstFragment;
+        const unsigned long rcvd = ptrs.rcvdPackets;
+        const unsigned dropped = cacheBuffer.getDroppedElem();
+        flowHandler(reinterpret_cast<u_char*>(&ptrs), &header, fr.data.data());
+        // the netflow was pushed (stored or dropped), so the packet was tagged
+        const bool tagged = (cacheBuffer.getDroppedElem() != dropped || !cacheBuffer.empty()) && ptrs.rcvdPackets == rcvd + 1;
+        const pcap_handler selected = selectHandler(fr.linkType, true, true, false, false);
+        const unsigned long selectedRcvd = ptrs.rcvdPackets;
+        const unsigned selectedDropped = cacheBuffer.getDroppedElem();
+        selected(reinterpret_cast<u_char*>(&ptrs), &header, fr.data.data());
+        const bool selectedTagged = (cacheBuffer.getDroppedElem() != selectedDropped || !cacheBuffer.empty())
+            && ptrs.rcvdPackets == selectedRcvd + 1;
+        if (!ok || !tagged || !selectedTagged)
+            failed++;
+
+        const double walkNs = nsPerPacket(packets, [&fr, &sink](unsigned long) {
+            unsigned int l2; IpLayer i; sink += walk(fr, l2, i); });
+        const double handlerNs = nsPerPacket(packets, [&ptrs, &header, &fr](unsigned long) {
+            flowHandler(reinterpret_cast<u_char*>(&ptrs), &header, fr.data.data()); });
+        const double selectedNs = nsPerPacket(packets, [&ptrs, &header, &fr, selected](unsigned long) {
+            selected(reinterpret_cast<u_char*>(&ptrs), &header, fr.data.data()); });
+        cout << left << setw(24) << fr.name << right << setw(8) << ((ok && tagged && selectedTagged) ? "yes" : "NO")
+             << fixed << setprecision(2) << setw(14) << walkNs << setw(16) << handlerNs << setw(17) << selectedNs << endl;
+    }
+    const Frame &plain = frames[0];
+    const double fixedNs = nsPerPacket(packets, [&plain, &sink](unsigned long) { sink += walkFixed(plain); });
+    cout << left << setw(24) << "eth/ip4/tcp fixed-offset" << right << setw(8) << "-"
+         << fixed << setprecision(2) << setw(14) << fixedNs << setw(16) << "-" << setw(17) << "-" << endl;
+
+    cout << endl << (failed ? to_string(failed) + " frames were not parsed correctly." : string("All frames were parsed correctly.")) << endl;
+    return failed ? 1 : 0;
+}
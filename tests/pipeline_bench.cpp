@@ -0,0 +1,162 @@
+/**
+ *  @file       pipeline_bench.cpp
+ *  @brief      Throughput of the capture thread with synthetic frames
+ *  @details    Calls packetHandler() or flowHandler() directly (as pcap_loop() would)
+ *              with Ethernet frames of sockets from a synthetic procfs tree (see
+ *              procfsFixture.hpp), while the writer and cache threads run as usual.
+ *              Addresses of the sockets are local, so the direction is determined by #g_localAddresses.
+ *              Reports packets per second of the capturing thread and drops of each stage.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 11:20
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+#include <fstream>          //  ofstream
+#include <memory>           //  unique_ptr
+#include <pcap.h>           //  pcap_pkthdr
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  packetHandler(), flowHandler()
+#include "procfsFixture.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+extern mac_addr g_devMac;
+
+const unsigned int      FILE_RING_SIZE      = 2000;     //!< Same as in capturing.cpp
+const unsigned int      CACHE_RING_SIZE     = 2000;     //!< Same as in capturing.cpp
+const unsigned int      HEADERS_SNAPLEN     = 128;      //!< Same as FLOW_ONLY_SNAPLEN
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./pipeline_bench <store|flow> <packets> [<frameSize> [<sockets> [<pps> [<storePolicy> [<flowPolicy> [<slice>]]]]]]" << endl;
+    cout << "\tstore\tpacketHandler(), packets are stored into /dev/null" << endl;
+    cout << "\tflow\tflowHandler() with headers-only snaplen" << endl;
+    cout << "\t<pps>\tOffered load in packets per second, 0 (default) means as fast as possible" << endl;
+    cout << "\t<storePolicy>, <flowPolicy>\tOverload policies of the stages, see --store-policy and --flow-policy" << endl;
+    cout << "\t<slice>\tPer-flow slicing, see --slice" << endl;
+    cout << "Note: drops of the stages are meaningful only with a free core for each thread." << endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 9)
+    {
+        printHelp();
+        return 1;
+    }
+    const string mode = argv[1];
+    const unsigned long packets = strtoul(argv[2], nullptr, 10);
+    const unsigned frameSize = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 64;
+    const unsigned socketCount = (argc > 4) ? strtoul(argv[4], nullptr, 10) : 64;
+    const double pps = (argc > 5) ? strtod(argv[5], nullptr) : 0;
+    StagePolicy storePolicy, flowPolicy;
+    if ((mode != "store" && mode != "flow") || packets == 0 || socketCount == 0
+        || (argc > 6 && parseStagePolicy(argv[6], storePolicy, true))
+        || (argc > 7 && parseStagePolicy(argv[7], flowPolicy, false))
+        || (argc > 8 && g_storagePolicy.addSlice(argv[8])))
+    {
+        printHelp();
+        return 1;
+    }
+    const bool flowOnly = (mode == "flow");
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    // sockets which the cache thread will resolve
+    string root;
+    vector<FixtureSocket> sockets;
+    if (procfsFixture::setUp(root, (socketCount + 7) / 8, 8, "tcp4:3,udp4:1", sockets))
+        return 1;
+
+    const mac_addr devMac { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+    g_devMac = devMac;
+    vector<vector<uint8_t>> frames;
+    for (unsigned i = 0; i < socketCount && i < sockets.size(); i++)
+    {
+        frames.push_back(procfsFixture::buildFrame(sockets[i], frameSize, g_devMac));
+        g_localAddresses.add(&sockets[i].ip, sockets[i].ipVersion);
+    }
+    g_localAddresses.publish();
+
+    ofstream devNull("/dev/null", ios::binary);
+    unique_ptr<RingBuffer<EnhancedPacketBlock>> fileBuffer;
+    thread writer;
+    if (!flowOnly)
+    {
+        fileBuffer.reset(new RingBuffer<EnhancedPacketBlock>(FILE_RING_SIZE));
+        fileBuffer->setPolicy(storePolicy);
+        writer = thread([&fileBuffer, &devNull]() { fileBuffer->write(devNull); });
+    }
+    Cache cache;
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    cacheBuffer.setPolicy(flowPolicy);
+    thread cacheThread([&cacheBuffer, &cache]() { cacheBuffer.run(&cache); });
+
+    PacketHandlerParams ptrs{ fileBuffer.get(), &cacheBuffer, 0, DLT_EN10MB, &g_devMac, &g_storagePolicy };
+    pcap_handler handler = flowOnly ? flowHandler : packetHandler;
+    pcap_pkthdr header;
+    header.len = frames[0].size();
+    header.caplen = flowOnly ? min<unsigned>(header.len, HEADERS_SNAPLEN) : header.len;
+    header.ts.tv_sec = 1500000000;
+    header.ts.tv_usec = 0;
+
+    // let the cache thread resolve all sockets first, so the run measures the steady state
+    for (unsigned i = 0; i < frames.size(); i++)
+        handler(reinterpret_cast<u_char*>(&ptrs), &header, frames[i].data());
+    while (cacheBuffer.newItemOrStop() || (fileBuffer && fileBuffer->newItemOrStop()))
+        this_thread::sleep_for(chrono::milliseconds(1));
+    const unsigned warmupCacheDrops = cacheBuffer.getDroppedElem();
+    const unsigned warmupFileDrops = fileBuffer ? fileBuffer->getDroppedElem() : 0;
+
+    auto t0 = bench_clock::now();
+    for (unsigned long i = 0; i < packets; i++)
+    {
+        if (pps > 0)
+            while (chrono::duration<double>(bench_clock::now() - t0).count() * pps < i)
+                ;
+        header.ts.tv_usec = i % 1000000;
+        handler(reinterpret_cast<u_char*>(&ptrs), &header, frames[i % frames.size()].data());
+    }
+    auto t1 = bench_clock::now();
+    const double sec = chrono::duration<double>(t1 - t0).count();
+
+    shouldStop = 1;
+    cacheBuffer.notifyCondVar();
+    cacheThread.join();
+    if (fileBuffer)
+    {
+        fileBuffer->notifyCondVar();
+        writer.join();
+    }
+
+    cout << "mode=" << mode << " frame=" << header.len << "B caplen=" << header.caplen << "B flows=" << frames.size()
+         << " offered=" << (pps > 0 ? to_string((long)pps) + " pps" : string("max")) << endl;
+    cout << fixed << setprecision(3)
+         << packets << " packets in " << sec << " s: " << packets / sec / 1e6 << " Mpps, "
+         << sec / packets * 1e9 << " ns/packet" << endl;
+    if (fileBuffer)
+    {
+        cout << fileBuffer->getDroppedElem() - warmupFileDrops << " packets dropped by fileBuffer after warmup" << endl;
+        fileBuffer->printStats("fileBuffer", "packets");
+    }
+    cout << cacheBuffer.getDroppedElem() - warmupCacheDrops << " netflows dropped by cacheBuffer after warmup" << endl;
+    cacheBuffer.printStats("cacheBuffer", "netflows");
+    if (g_storagePolicy.enabled())
+        cout << g_storagePolicy.getSlicedPackets() << " packets stored with headers only, "
+             << g_storagePolicy.getNotStoredBytes() / 1e6 << " MB not stored" << endl;
+
+    procfsFixture::remove(root);
+    return 0;
+}
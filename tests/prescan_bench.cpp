@@ -0,0 +1,158 @@
+/**
+ *  @file       prescan_bench.cpp
+ *  @brief      Drops of the cache stage at startup with and without the socket pre-scan
+ *  @details    Builds a procfs tree with N processes x M sockets (see procfsFixture.hpp) and
+ *              offers the first netflow of every socket to the cache ring buffer at a fixed
+ *              rate, as the capturing thread does right after start on a busy server. The run
+ *              is made with an empty cache (every netflow needs getInode() and getApp()) and
+ *              with a cache filled by prescanSockets(). Reports dropped netflows, time until
+ *              the cache processed all of them and how many got an application.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 20:10
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_localAddresses, g_finalResults, shouldStop
+#include "namon_linux.hpp"  //  prescanSockets()
+#include "procfsFixture.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      CACHE_RING_SIZE     = 2000;     //!< Same as in capturing.cpp
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./prescan_bench <processes> <socketsPerProcess> [<pps> [<mix>]]" << endl;
+    cout << "\t<pps>\tRate of new netflows offered to the cache (default 100000)" << endl;
+    cout << "\t<mix>\tComma delimited list of <kind>[:<weight>], see resolver_bench" << endl;
+}
+
+
+void fillNetflow(Netflow &n, const FixtureSocket &s, uint64_t time)
+{
+    n.setIpVersion(s.ipVersion);
+    n.setProto(s.proto);
+    n.setLocalPort(s.port);
+    if (s.ipVersion == 4)
+    {
+        ip4_addr *ip = new ip4_addr;
+        memcpy(ip, &s.ip, IPv4_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+    else
+    {
+        ip6_addr *ip = new ip6_addr;
+        memcpy(ip, &s.ip, IPv6_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+    n.setStartTime(time);
+    n.setEndTime(time);
+}
+
+
+/*!
+ * @brief   Results of one startup
+ */
+struct Result
+{
+    double prescanSec = 0;      //!< Duration of the pre-scan
+    int prescanned = 0;         //!< Entries inserted by the pre-scan
+    unsigned dropped = 0;       //!< Netflows dropped by the cache ring buffer
+    double drainSec = 0;        //!< Time until the cache processed all netflows
+    size_t tagged = 0;          //!< Netflows with an application in the results
+};
+
+
+Result startup(const vector<FixtureSocket> &sockets, double pps, bool prescan)
+{
+    Result r;
+    shouldStop = 0;
+    Cache cache;
+    if (prescan)
+    {
+        auto t0 = bench_clock::now();
+        r.prescanned = prescanSockets(cache, g_localAddresses);
+        r.prescanSec = chrono::duration<double>(bench_clock::now() - t0).count();
+    }
+
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    thread cacheThread([&cacheBuffer, &cache]() { cacheBuffer.run(&cache); });
+    auto t0 = bench_clock::now();
+    for (unsigned i = 0; i < sockets.size(); i++)
+    {
+        while (chrono::duration<double>(bench_clock::now() - t0).count() * pps < i)
+            ;
+        Netflow n;
+        fillNetflow(n, sockets[i], 1500000000ULL * 1000000 + i);
+        cacheBuffer.push(n);
+    }
+    while (cacheBuffer.newItemOrStop())
+        this_thread::sleep_for(chrono::microseconds(100));
+    r.drainSec = chrono::duration<double>(bench_clock::now() - t0).count();
+    shouldStop = 1;
+    cacheBuffer.notifyCondVar();
+    cacheThread.join();
+    r.dropped = cacheBuffer.getDroppedElem();
+
+    cache.saveResults();
+    r.tagged = g_finalResults.flows();
+    g_finalResults.clear();
+    return r;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned processes = strtoul(argv[1], nullptr, 10);
+    const unsigned socketsPerProcess = strtoul(argv[2], nullptr, 10);
+    const double pps = (argc > 3) ? strtod(argv[3], nullptr) : 100000;
+    const string mix = (argc > 4) ? argv[4] : "tcp4,tcp6,udp4,udp6";
+    if (processes == 0 || socketsPerProcess == 0 || pps <= 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    string root;
+    vector<FixtureSocket> sockets;
+    if (procfsFixture::setUp(root, processes, socketsPerProcess, mix, sockets))
+        return 1;
+    for (const FixtureSocket &s : sockets)
+        g_localAddresses.add(&s.ip, s.ipVersion);
+    g_localAddresses.publish();
+
+    cout << "Fixture: " << processes << " processes x " << socketsPerProcess << " sockets (" << mix << "), "
+         << sockets.size() << " new netflows offered at " << (long)pps << " netflows/s" << endl << endl;
+    cout << left << setw(10) << "cache" << right << setw(12) << "prescan s" << setw(12) << "loaded"
+         << setw(10) << "dropped" << setw(10) << "drop %" << setw(12) << "drain s" << setw(10) << "tagged" << endl;
+    for (int prescan = 0; prescan < 2; prescan++)
+    {
+        const Result r = startup(sockets, pps, prescan != 0);
+        cout << left << setw(10) << (prescan ? "prescan" : "empty") << right << fixed << setprecision(3)
+             << setw(12) << r.prescanSec << setw(12) << r.prescanned
+             << setw(10) << r.dropped << setw(10) << setprecision(1) << 100.0 * r.dropped / sockets.size()
+             << setw(12) << setprecision(3) << r.drainSec << setw(10) << r.tagged << endl;
+    }
+
+    procfsFixture::remove(root);
+    return 0;
+}
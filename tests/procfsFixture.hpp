@@ -0,0 +1,416 @@
+/**
+ *  @file       procfsFixture.hpp
+ *  @brief      Generator of synthetic procfs trees used by resolver tests and benchmarks
+ *  @details    Builds <root>/net/{tcp,tcp6,udp,udp6,udplite,udplite6} in the same format
+ *              as the Linux kernel prints them, <root>/stat with the boot time and
+ *              <root>/<pid>/{fd/,cmdline,stat} for every process. Socket file descriptors
+ *              are symlinks to "socket:[<inode>]", so readlink() returns the same string
+ *              as on a real procfs.
+ *              setUp() builds the tree in a temporary directory and points the resolver to it,
+ *              buildFrame() makes packets of the sockets for the capturing handlers.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 10:20
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#pragma once
+
+#include <iostream>         //  cerr, endl
+#include <string>           //  string
+#include <vector>           //  vector
+#include <fstream>          //  ofstream
+#include <cstdlib>          //  mkdtemp()
+#include <cstdio>           //  snprintf()
+#include <cstring>          //  memcpy()
+#include <cstdint>          //  uint32_t
+#include <algorithm>        //  max()
+#include <ftw.h>            //  nftw()
+#include <sys/stat.h>       //  mkdir()
+#include <unistd.h>         //  symlink(), getpid()
+
+#include "tcpip_headers.hpp"    //  ip6_addr, PROTO_*
+#include "namon_linux.hpp"      //  setProcfsRoot()
+
+
+
+
+/*!
+ * @brief   Socket created in the synthetic procfs tree
+ */
+struct FixtureSocket
+{
+    unsigned char ipVersion = 4;    //!< IP version of the socket
+    unsigned char proto = 0;        //!< Layer 4 protocol
+    NAMON::ip6_addr ip;             //!< Local IP address (first 4 bytes are used for IPv4)
+    uint16_t port = 0;              //!< Local port
+    int inode = 0;                  //!< Socket inode number
+    int pid = 0;                    //!< PID of the owning process
+    std::string cmdline;            //!< Content of the owning process' cmdline file
+};
+
+
+namespace procfsFixture
+{
+
+
+//! Width of the kernel's /proc/net/tcp lines (without '\n')
+const int TCP4_LINE_WIDTH   = 149;
+//! Width of the kernel's /proc/net/udp lines (without '\n')
+const int UDP4_LINE_WIDTH   = 127;
+//! First inode number, all inodes have the same number of digits as on a freshly booted host
+const int FIRST_INODE       = 1000000;
+//! First PID used by the fixture
+const int FIRST_PID         = 100;
+//! Start time of the process with PID 0 in clock ticks after boot (see <root>/<pid>/stat)
+const unsigned long long FIRST_START = 500000;
+//! Boot time of the fixture host (see <root>/stat)
+const unsigned long long BOOT_TIME   = 1760000000;
+
+
+/*!
+ * @brief   Kind of the socket and the file it is listed in
+ */
+struct SocketKind
+{
+    const char *name;           //!< Name used in the mix specification and as the file name
+    unsigned char ipVersion;    //!< IP version
+    unsigned char proto;        //!< Layer 4 protocol
+};
+
+//! All socket kinds the kernel lists in /proc/net
+const SocketKind KINDS[] = {
+    { "tcp4",      4, PROTO_TCP     }, { "tcp6",      6, PROTO_TCP     },
+    { "udp4",      4, PROTO_UDP     }, { "udp6",      6, PROTO_UDP     },
+    { "udplite4",  4, PROTO_UDPLITE }, { "udplite6",  6, PROTO_UDPLITE },
+};
+const unsigned KINDS_COUNT = sizeof(KINDS) / sizeof(KINDS[0]);
+
+
+/*!
+ * @brief       Parses a mix specification, e.g. "tcp4:2,udp6:1"
+ * @param[in]   mix     Comma delimited list of <kind>[:<weight>]
+ * @param[out]  order   Sequence of indexes to KINDS which is cycled while sockets are created
+ * @return      Zero on success, -1 if the specification is invalid
+ */
+inline int parseMix(const std::string &mix, std::vector<unsigned> &order)
+{
+    order.clear();
+    size_t pos = 0;
+    while (pos < mix.length())
+    {
+        size_t end = mix.find(',', pos);
+        if (end == std::string::npos)
+            end = mix.length();
+        std::string item = mix.substr(pos, end - pos);
+        unsigned weight = 1;
+        size_t colon = item.find(':');
+        if (colon != std::string::npos)
+        {
+            weight = std::stoul(item.substr(colon + 1));
+            item.erase(colon);
+        }
+        unsigned k = 0;
+        for ( ; k < KINDS_COUNT && item != KINDS[k].name; k++)
+            ;
+        if (k == KINDS_COUNT)
+            return -1;
+        while (weight--)
+            order.push_back(k);
+        pos = end + 1;
+    }
+    return order.empty() ? -1 : 0;
+}
+
+
+/*!
+ * @brief       Prints one IPv4 or IPv6 address the same way as the kernel does (%08X of host order words)
+ */
+inline void formatIp(char *dst, const FixtureSocket &s)
+{
+    const int words = (s.ipVersion == 4) ? 1 : 4;
+    for (int i = 0; i < words; i++)
+    {
+        uint32_t w;
+        memcpy(&w, &s.ip.addr.addr32[i], sizeof(w));
+        dst += sprintf(dst, "%08X", w);
+    }
+}
+
+
+/*!
+ * @brief       Formats one line of the /proc/net socket file
+ * @param[in]   sl  Slot number
+ * @param[in]   s   Socket
+ * @return      Line including the terminating '\n'
+ */
+inline std::string formatLine(int sl, const FixtureSocket &s)
+{
+    char ip[33], zeroIp[33], line[512];
+    formatIp(ip, s);
+    FixtureSocket zero;
+    memset(&zero.ip, 0, sizeof(zero.ip));
+    zero.ipVersion = s.ipVersion;
+    formatIp(zeroIp, zero);
+
+    if (s.proto == PROTO_TCP)
+        // get_tcp4_sock() / get_tcp6_sock(), a listening socket
+        snprintf(line, sizeof(line), "%4d: %s:%04X %s:%04X %02X %08X:%08X %02X:%08lX %08X %5u %8d %d %d %s %lu %lu %u %u %d",
+                 sl, ip, s.port, zeroIp, 0, 0x0A, 0, 0, 0, 0UL, 0, 1000u, 0, s.inode, 1,
+                 "0000000000000000", 100UL, 0UL, 0u, 10u, -1);
+    else
+        // udp4_format_sock() / __ip6_dgram_sock_seq_show()
+        snprintf(line, sizeof(line), "%5d: %s:%04X %s:%04X %02X %08X:%08X %02X:%08lX %08X %5u %8d %d %d %s %u",
+                 sl, ip, s.port, zeroIp, 0, 0x07, 0, 0, 0, 0UL, 0, 1000u, 0, s.inode, 2,
+                 "0000000000000000", 0u);
+
+    std::string res(line);
+    // IPv4 files are padded by seq_pad(), IPv6 files are not
+    if (s.ipVersion == 4)
+        res.resize(s.proto == PROTO_TCP ? TCP4_LINE_WIDTH : UDP4_LINE_WIDTH, ' ');
+    return res + '\n';
+}
+
+
+/*!
+ * @brief       Returns the header line of the /proc/net socket file
+ */
+inline std::string headerLine(const SocketKind &k)
+{
+    std::string res;
+    if (k.ipVersion == 4)
+    {
+        if (k.proto == PROTO_TCP)
+            res = "  sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode";
+        else
+            res = "   sl  local_address rem_address   st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode ref pointer drops";
+        res.resize(k.proto == PROTO_TCP ? TCP4_LINE_WIDTH : UDP4_LINE_WIDTH, ' ');
+    }
+    else
+    {
+        res = "  sl  local_address                         remote_address                        st tx_queue rx_queue tr tm->when retrnsmt   uid  timeout inode";
+        if (k.proto != PROTO_TCP)
+            res += " ref pointer drops";
+    }
+    return res + '\n';
+}
+
+
+/*!
+ * @brief       Builds a synthetic procfs tree
+ * @param[in]   root                Directory in which the tree is created (must exist)
+ * @param[in]   processes           Number of processes
+ * @param[in]   socketsPerProcess   Number of sockets opened by every process
+ * @param[in]   mix                 Mix of socket kinds, see parseMix()
+ * @param[out]  sockets             All created sockets
+ * @return      Zero on success, -1 otherwise
+ */
+inline int build(const std::string &root, unsigned processes, unsigned socketsPerProcess,
+                 const std::string &mix, std::vector<FixtureSocket> &sockets)
+{
+    std::vector<unsigned> order;
+    if (parseMix(mix, order))
+        return -1;
+
+    if (mkdir((root + "/net").c_str(), 0755))
+        return -1;
+    std::ofstream(root + "/stat", std::ios::binary) << "cpu  1 2 3 4 5 6 7 0 0 0\nctxt 123456\nbtime " << BOOT_TIME << "\nprocesses 4242\n";
+
+    std::vector<std::string> files(KINDS_COUNT);
+    std::vector<int> slots(KINDS_COUNT, 0);
+    for (unsigned k = 0; k < KINDS_COUNT; k++)
+        files[k] = headerLine(KINDS[k]);
+
+    sockets.clear();
+    sockets.reserve(processes * socketsPerProcess);
+    const int myPid = ::getpid();
+    int pid = FIRST_PID;
+    int inode = FIRST_INODE;
+    unsigned kindCounter = 0;
+    for (unsigned p = 0; p < processes; p++, pid++)
+    {
+        if (pid == myPid)
+            pid++;
+        const std::string pidDir = root + "/" + std::to_string(pid);
+        if (mkdir(pidDir.c_str(), 0755) || mkdir((pidDir + "/fd").c_str(), 0755))
+            return -1;
+
+        const std::string cmdline = "/usr/bin/fixture-app-" + std::to_string(p) + std::string("\0--instance\0", 12) + std::to_string(pid) + '\0';
+        std::ofstream(pidDir + "/cmdline", std::ios::binary) << cmdline;
+        // the start time (22nd field) is FIRST_START + pid
+        std::ofstream(pidDir + "/stat", std::ios::binary) << pid << " (fixture app " << p << ") S 1 " << pid
+            << " " << pid << " 0 -1 4194560 120 0 0 0 10 5 0 0 20 0 1 0 " << FIRST_START + pid << " 12345678 456 18446744073709551615\n";
+
+        // stdin, stdout, stderr and a few descriptors which are not sockets
+        const char *nonSockets[] = { "/dev/null", "/dev/null", "/dev/null", "pipe:[42]", "/var/log/fixture.log", "anon_inode:[eventpoll]" };
+        int fd = 0;
+        for (const char *target : nonSockets)
+            if (symlink(target, (pidDir + "/fd/" + std::to_string(fd++)).c_str()))
+                return -1;
+
+        for (unsigned i = 0; i < socketsPerProcess; i++, inode++, fd++)
+        {
+            const SocketKind &k = KINDS[order[kindCounter++ % order.size()]];
+            FixtureSocket s;
+            s.ipVersion = k.ipVersion;
+            s.proto = k.proto;
+            memset(&s.ip, 0, sizeof(s.ip));
+            const unsigned n = sockets.size();
+            if (k.ipVersion == 4)
+            {   // 10.<n>
+                s.ip.addr.addr8[0] = 10;
+                s.ip.addr.addr8[1] = (n >> 16) & 0xff;
+                s.ip.addr.addr8[2] = (n >> 8) & 0xff;
+                s.ip.addr.addr8[3] = n & 0xff;
+            }
+            else
+            {   // fd00::<n>
+                s.ip.addr.addr8[0] = 0xfd;
+                s.ip.addr.addr8[13] = (n >> 16) & 0xff;
+                s.ip.addr.addr8[14] = (n >> 8) & 0xff;
+                s.ip.addr.addr8[15] = n & 0xff;
+            }
+            s.port = 1024 + n % (65535 - 1024);
+            s.inode = inode;
+            s.pid = pid;
+            s.cmdline = cmdline;
+
+            const unsigned kIdx = &k - KINDS;
+            files[kIdx] += formatLine(slots[kIdx]++, s);
+            const std::string link = "socket:[" + std::to_string(inode) + "]";
+            if (symlink(link.c_str(), (pidDir + "/fd/" + std::to_string(fd)).c_str()))
+                return -1;
+            sockets.push_back(s);
+        }
+    }
+
+    const char *fileNames[] = { "tcp", "tcp6", "udp", "udp6", "udplite", "udplite6" };
+    for (unsigned k = 0; k < KINDS_COUNT; k++)
+    {
+        std::ofstream f(root + "/net/" + fileNames[k], std::ios::binary);
+        f << files[k];
+        if (!f)
+            return -1;
+    }
+    return 0;
+}
+
+
+/*!
+ * @brief   nftw() callback removing one file or directory
+ */
+inline int removeEntry(const char *path, const struct stat *, int, struct FTW *)
+{
+    return ::remove(path);
+}
+
+
+/*!
+ * @brief       Removes the whole synthetic tree including the root
+ * @param[in]   root    Root of the tree
+ * @return      Zero on success
+ */
+inline int remove(const std::string &root)
+{
+    return nftw(root.c_str(), removeEntry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+
+/*!
+ * @brief       Creates a new temporary directory
+ * @param[in]   prefix  Path of the directory without its random suffix
+ * @return      Path of the directory, an empty string if it can't be created
+ */
+inline std::string makeTempDir(const std::string &prefix)
+{
+    std::vector<char> path(prefix.begin(), prefix.end());
+    const char suffix[] = "XXXXXX";
+    path.insert(path.end(), suffix, suffix + sizeof(suffix));
+    return (mkdtemp(path.data()) == nullptr) ? std::string() : std::string(path.data());
+}
+
+
+/*!
+ * @brief       Builds a synthetic procfs tree in a new temporary directory and points the resolver to it
+ * @details     Parameters are the same as of build(), an error is printed on failure.
+ * @param[out]  root    The temporary directory, remove() deletes it
+ * @return      Zero on success, -1 otherwise
+ */
+inline int setUp(std::string &root, unsigned processes, unsigned socketsPerProcess,
+                 const std::string &mix, std::vector<FixtureSocket> &sockets)
+{
+    root = makeTempDir("/tmp/namon_procfs_");
+    if (root.empty())
+    {
+        std::cerr << "Can't create temporary directory" << std::endl;
+        return -1;
+    }
+    if (build(root, processes, socketsPerProcess, mix, sockets))
+    {
+        std::cerr << "Can't build procfs fixture in " << root << std::endl;
+        remove(root);
+        return -1;
+    }
+    NAMON::setProcfsRoot(root);
+    return 0;
+}
+
+
+/*!
+ * @brief       Builds an outbound Ethernet frame of the socket s to a remote host (port 443)
+ * @param[in]   s           Socket
+ * @param[in]   frameSize   Length of the frame, at least the headers
+ * @param[in]   srcMac      MAC address of the capturing device
+ */
+inline std::vector<uint8_t> buildFrame(const FixtureSocket &s, unsigned frameSize, const NAMON::mac_addr &srcMac)
+{
+    using namespace NAMON;
+    const unsigned ipLen = (s.ipVersion == 4) ? 20 : IPv6_HDRLEN;
+    const unsigned l4Len = (s.proto == PROTO_TCP) ? 20 : 8;
+    frameSize = std::max(frameSize, ETHER_HDRLEN + ipLen + l4Len);
+    std::vector<uint8_t> f(frameSize, 0);
+
+    ether_hdr *eth = reinterpret_cast<ether_hdr*>(f.data());
+    memcpy(eth->ether_shost, srcMac.bytes, ETHER_ADDRLEN);
+    memset(eth->ether_dhost, 0x02, ETHER_ADDRLEN);
+    eth->ether_type = (s.ipVersion == 4) ? PROTO_IPv4 : PROTO_IPv6;
+
+    uint8_t *l3 = f.data() + ETHER_HDRLEN;
+    const uint16_t l3Payload = frameSize - ETHER_HDRLEN - ((s.ipVersion == 4) ? 0 : IPv6_HDRLEN);
+    if (s.ipVersion == 4)
+    {
+        l3[0] = 0x45;
+        l3[2] = l3Payload >> 8;     l3[3] = l3Payload & 0xff;
+        l3[8] = 64;
+        l3[9] = s.proto;
+        memcpy(l3 + 12, &s.ip, IPv4_ADDRLEN);
+        l3[16] = 192; l3[17] = 0; l3[18] = 2; l3[19] = 1;
+    }
+    else
+    {
+        l3[0] = 0x60;
+        l3[4] = l3Payload >> 8;     l3[5] = l3Payload & 0xff;
+        l3[6] = s.proto;
+        l3[7] = 64;
+        memcpy(l3 + 8, &s.ip, IPv6_ADDRLEN);
+        l3[24] = 0x20; l3[25] = 0x01; l3[26] = 0x0d; l3[27] = 0xb8; l3[39] = 1;
+    }
+
+    uint8_t *l4 = l3 + ipLen;
+    l4[0] = s.port >> 8;    l4[1] = s.port & 0xff;
+    l4[2] = 443 >> 8;       l4[3] = 443 & 0xff;
+    if (s.proto == PROTO_TCP)
+    {
+        l4[12] = 5 << 4;
+        l4[13] = 0x10;  // ACK
+    }
+    else
+    {
+        const uint16_t udpLen = frameSize - ETHER_HDRLEN - ipLen;
+        l4[4] = udpLen >> 8;    l4[5] = udpLen & 0xff;
+    }
+    return f;
+}
+
+
+}   // namespace procfsFixture
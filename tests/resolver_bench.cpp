@@ -0,0 +1,259 @@
+/**
+ *  @file       resolver_bench.cpp
+ *  @brief      Microbenchmarks of getInode() and getApp() above a synthetic procfs
+ *  @details    Builds a procfs tree with N processes x M sockets (see procfsFixture.hpp),
+ *              points the resolver to it and measures lookups per second and procfs
+ *              accesses per lookup for random sockets and for the worst case, when the
+ *              socket belongs to the process which readdir() returns as the last one.
+ *              Revalidation of a known socket owner by isSocketOwner() is measured too.
+ *              It does not need root privileges or any real traffic. It fails if any socket
+ *              of the fixture is not resolved to its inode and application.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 10:35
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw()
+#include <chrono>           //  steady_clock
+#include <dirent.h>         //  opendir(), readdir()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "netflow.hpp"      //  Netflow
+#include "utils.hpp"        //  chToInt()
+#include "namon_linux.hpp"  //  getInode(), getApp(), isSocketOwner()
+#include "procfsFixture.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./resolver_bench <processes> <socketsPerProcess> [<lookups> [<mix>]]" << endl;
+    cout << "\t<mix>\tComma delimited list of <kind>[:<weight>], kinds: tcp4, tcp6, udp4, udp6, udplite4, udplite6" << endl;
+    cout << "\t\tDefault mix is \"tcp4,tcp6,udp4,udp6\"." << endl;
+}
+
+
+/*!
+ * @brief   Results of one benchmark run
+ */
+struct Result
+{
+    unsigned lookups = 0;       //!< Number of lookups
+    unsigned inodesFound = 0;   //!< Lookups where getInode() returned expected inode
+    unsigned appsFound = 0;     //!< Lookups where getApp() returned expected cmdline
+    double inodeSec = 0;        //!< Time spent in getInode()
+    double appSec = 0;          //!< Time spent in getApp()
+    unsigned long inodeCalls = 0;   //!< Procfs accesses made by getInode()
+    unsigned long appCalls = 0;     //!< Procfs accesses made by getApp()
+};
+
+
+void fillNetflow(Netflow &n, const FixtureSocket &s)
+{
+    n.setIpVersion(s.ipVersion);
+    n.setProto(s.proto);
+    n.setLocalPort(s.port);
+    if (s.ipVersion == 4)
+    {
+        ip4_addr *ip = new ip4_addr;
+        memcpy(ip, &s.ip, IPv4_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+    else
+    {
+        ip6_addr *ip = new ip6_addr;
+        memcpy(ip, &s.ip, IPv6_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+}
+
+
+void lookup(const FixtureSocket &s, Result &r)
+{
+    Netflow n;
+    fillNetflow(n, s);
+
+    unsigned long calls = g_procfsCalls;
+    auto t0 = bench_clock::now();
+    int inode = getInode(&n);
+    auto t1 = bench_clock::now();
+    r.inodeCalls += g_procfsCalls - calls;
+    r.inodeSec += chrono::duration<double>(t1 - t0).count();
+    r.lookups++;
+    if (inode != s.inode)
+        return;
+    r.inodesFound++;
+
+    string appName;
+    calls = g_procfsCalls;
+    t0 = bench_clock::now();
+    int ret = getApp(inode, appName);
+    t1 = bench_clock::now();
+    r.appCalls += g_procfsCalls - calls;
+    r.appSec += chrono::duration<double>(t1 - t0).count();
+    if (!ret && appName == s.cmdline)
+        r.appsFound++;
+}
+
+
+void printResult(const string &name, const Result &r)
+{
+    auto perSec = [](unsigned n, double sec) { return sec > 0 ? n / sec : 0; };
+    auto perLookup = [](unsigned long calls, unsigned n) { return n ? (double)calls / n : 0; };
+    cout << left << setw(16) << name << right << fixed << setprecision(1)
+         << setw(8)  << r.lookups
+         << setw(10) << r.inodesFound
+         << setw(10) << r.appsFound
+         << setw(14) << perSec(r.lookups, r.inodeSec)
+         << setw(12) << perLookup(r.inodeCalls, r.lookups)
+         << setw(14) << perSec(r.inodesFound, r.appSec)
+         << setw(12) << perLookup(r.appCalls, r.inodesFound)
+         << setw(14) << perSec(r.lookups, r.inodeSec + r.appSec) << endl;
+}
+
+
+/*!
+ * @brief   Finds the PID which is returned by readdir() as the last one, getApp() visits it last
+ */
+int lastPid(const string &root)
+{
+    int res = -1, pid = 0;
+    DIR *d = opendir(root.c_str());
+    if (d == nullptr)
+        return -1;
+    while (dirent *e = readdir(d))
+        if (!chToInt(e->d_name, pid))
+            res = pid;
+    closedir(d);
+    return res;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned processes = strtoul(argv[1], nullptr, 10);
+    const unsigned socketsPerProcess = strtoul(argv[2], nullptr, 10);
+    const unsigned lookups = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 1000;
+    const string mix = (argc > 4) ? argv[4] : "tcp4,tcp6,udp4,udp6";
+    if (processes == 0 || socketsPerProcess == 0 || lookups == 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    string root;
+    vector<FixtureSocket> sockets;
+    auto t0 = bench_clock::now();
+    if (procfsFixture::setUp(root, processes, socketsPerProcess, mix, sockets))
+        return 1;
+    auto t1 = bench_clock::now();
+    cout << "Fixture: " << processes << " processes x " << socketsPerProcess << " sockets (" << mix << ") in "
+         << root << ", built in " << chrono::duration<double>(t1 - t0).count() << " s" << endl << endl;
+
+    cout << left << setw(16) << "case" << right
+         << setw(8)  << "lookups" << setw(10) << "inodes" << setw(10) << "apps"
+         << setw(14) << "inode/s" << setw(12) << "calls/inode"
+         << setw(14) << "app/s" << setw(12) << "calls/app"
+         << setw(14) << "lookup/s" << endl;
+
+    // random sockets, the same sequence every run
+    Result all;
+    vector<Result> perKind(procfsFixture::KINDS_COUNT);
+    uint32_t seed = 12345;
+    for (unsigned i = 0; i < lookups; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const FixtureSocket &s = sockets[(seed >> 8) % sockets.size()];
+        Result r;
+        lookup(s, r);
+        for (unsigned k = 0; k < procfsFixture::KINDS_COUNT; k++)
+        {
+            if (procfsFixture::KINDS[k].ipVersion != s.ipVersion || procfsFixture::KINDS[k].proto != s.proto)
+                continue;
+            Result &p = perKind[k];
+            p.lookups += r.lookups;         p.inodesFound += r.inodesFound;  p.appsFound += r.appsFound;
+            p.inodeSec += r.inodeSec;       p.appSec += r.appSec;
+            p.inodeCalls += r.inodeCalls;   p.appCalls += r.appCalls;
+        }
+        all.lookups += r.lookups;           all.inodesFound += r.inodesFound;  all.appsFound += r.appsFound;
+        all.inodeSec += r.inodeSec;         all.appSec += r.appSec;
+        all.inodeCalls += r.inodeCalls;     all.appCalls += r.appCalls;
+    }
+    for (unsigned k = 0; k < procfsFixture::KINDS_COUNT; k++)
+        if (perKind[k].lookups)
+            printResult(procfsFixture::KINDS[k].name, perKind[k]);
+    printResult("random", all);
+
+    // worst case: the last socket of the process visited as the last one
+    const int worstPid = lastPid(root);
+    const FixtureSocket *worst = nullptr;
+    for (const FixtureSocket &s : sockets)
+        if (s.pid == worstPid)
+            worst = &s;
+    Result worstResult;
+    if (worst != nullptr)
+    {
+        Result &r = worstResult;
+        for (unsigned i = 0; i < lookups; i++)
+            lookup(*worst, r);
+        string kind;
+        for (unsigned k = 0; k < procfsFixture::KINDS_COUNT; k++)
+            if (procfsFixture::KINDS[k].ipVersion == worst->ipVersion && procfsFixture::KINDS[k].proto == worst->proto)
+                kind = procfsFixture::KINDS[k].name;
+        printResult("last-PID/" + kind, r);
+    }
+
+    // an expired cache entry with a known owner, only its descriptor and start time are read
+    vector<pair<int, SocketOwner>> owners;
+    seed = 12345;
+    for (unsigned i = 0; i < lookups; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        const FixtureSocket &s = sockets[(seed >> 8) % sockets.size()];
+        string appName;
+        SocketOwner o;
+        if (!getApp(s.inode, appName, &o))
+            owners.emplace_back(s.inode, o);
+    }
+    unsigned owned = 0;
+    unsigned long calls = g_procfsCalls;
+    t0 = bench_clock::now();
+    for (const auto &o : owners)
+        owned += isSocketOwner(o.first, o.second);
+    t1 = bench_clock::now();
+    const double sec = chrono::duration<double>(t1 - t0).count();
+    cout << endl << "Revalidation: " << owned << " of " << owners.size() << " owners confirmed, "
+         << fixed << setprecision(1) << (sec > 0 ? owners.size() / sec : 0) << " checks/s, "
+         << (owners.empty() ? 0 : (double)(g_procfsCalls - calls) / owners.size()) << " calls/check "
+         << "(random lookup/s above is the cost without a known owner)" << endl;
+
+#ifndef DEBUG_BUILD
+    cout << endl << "Note: procfs accesses are counted only in DEBUG_BUILD." << endl;
+#endif
+
+    procfsFixture::remove(root);
+    // every socket of the fixture can be resolved
+    const unsigned worstLookups = (worst != nullptr) ? lookups : 0;
+    if (all.inodesFound != all.lookups || all.appsFound != all.lookups
+        || worstResult.inodesFound != worstLookups || worstResult.appsFound != worstLookups || owned != owners.size() || owners.size() != lookups)
+    {
+        cout << "INVALID: not all sockets were resolved" << endl;
+        return 1;
+    }
+    cout << "valid" << endl;
+    return 0;
+}
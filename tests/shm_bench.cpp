@@ -0,0 +1,211 @@
+/**
+ *  @file       shm_bench.cpp
+ *  @brief      Throughput of the shared memory stream and overruns of its readers
+ *  @details    Creates the stream with a small ring and writes N packets of 64 to 1500 bytes
+ *              into it as fast as possible (or at the given rate), a packet carries its sequence
+ *              number in the timestamp and in the data and most of them have an application.
+ *              Readers run in their own threads, the first one polls the ring all the time and
+ *              the other ones pause after every 256 records, so they get overrun. Every record
+ *              must be a whole EPB, sequence numbers may skip only after a reported overrun,
+ *              the application option and its name must match and every reader must see the
+ *              last packet and the end of the stream.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 01:50
+ *   - Edited:  20.10.2026 01:50
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+#include <atomic>           //  atomic
+#include <cstring>          //  memcpy()
+#include <unistd.h>         //  getpid()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "pcapng_blocks.hpp"//  EnhancedPacketBlock
+#include "shmStream.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+const unsigned int      APPS            = 8;        //!< Applications of the packets, every 16th packet has none
+const unsigned int      SLOW_BATCH      = 256;      //!< Slow readers pause after this many records
+const unsigned int      EPB_DATA        = 28;       //!< Offset of the packet data in an EPB
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./shm_bench <packets> <readers> [<ringMiB> [<pps>]]" << endl;
+    cout << "\t<ringMiB>\tSize of the ring (default 4)" << endl;
+    cout << "\t<pps>\tPackets per second, 0 means as fast as possible (default 0)" << endl;
+}
+
+
+AppId appOf(uint64_t seq)               { return (seq % 16 == 0) ? NO_APP : seq % APPS + 1; }
+uint32_t lengthOf(uint64_t seq)         { return 64 + (seq * 7919) % 1437; }
+
+
+/*!
+ * @brief   What one reader saw
+ */
+struct ReaderResult
+{
+    unsigned long records = 0;          //!< Records read
+    unsigned long overruns = 0;         //!< Overruns reported by the reader
+    uint64_t lostBytes = 0;             //!< Bytes skipped by overruns
+    unsigned long wrong = 0;            //!< Broken records, unexpected gaps and wrong applications
+    uint64_t lastSeq = 0;               //!< Sequence number of the last record
+    bool closed = false;                //!< The reader saw the end of the stream
+};
+
+
+/*!
+ * @brief   Reads the stream until it is closed and checks every record
+ */
+void readStream(const string &name, bool slow, atomic<int> &ready, ReaderResult &r)
+{
+    ShmStreamReader reader;
+    if (reader.open(name))
+    {
+        r.wrong++;
+        ready++;
+        return;
+    }
+    ready++;
+    vector<string> appNames(1);
+    vector<pair<AppId, string>> names;
+    string block;
+    bool overrun = true;    // the first record may be anything
+    while (true)
+    {
+        const ShmRead res = reader.next(block);
+        if (res == ShmRead::CLOSED)
+        {
+            r.closed = true;
+            break;
+        }
+        if (res == ShmRead::EMPTY)
+        {
+            this_thread::yield();
+            continue;
+        }
+        if (res == ShmRead::OVERRUN)
+        {
+            overrun = true;
+            continue;
+        }
+
+        const uint32_t *w = reinterpret_cast<const uint32_t *>(block.data());
+        const uint64_t seq = (uint64_t)w[3] << 32 | w[4];
+        uint64_t dataSeq = 0;
+        memcpy(&dataSeq, block.data() + EPB_DATA, sizeof(dataSeq));
+        const uint32_t caplen = w[5];
+        const size_t options = EPB_DATA + caplen + computePaddingLen(caplen, 4);
+        bool ok = w[0] == 6 && w[1] == block.size() && w[block.size() / 4 - 1] == block.size() && seq == dataSeq
+                  && caplen == lengthOf(seq) && (overrun ? (r.records == 0 || seq > r.lastSeq) : seq == r.lastSeq + 1);
+        if (ok)
+        {
+            AppId app = NO_APP;
+            if (block.size() > options + 4)
+                memcpy(&app, block.data() + options + 8, sizeof(app));
+            if (app >= appNames.size() || (app != NO_APP && appNames[app].empty()))
+            {
+                reader.takeNames(names);
+                for (auto &n : names)
+                {
+                    if (n.first >= appNames.size())
+                        appNames.resize(n.first + 1);
+                    appNames[n.first] = n.second;
+                }
+            }
+            ok = app == appOf(seq) && (app == NO_APP || (app < appNames.size() && appNames[app] == "app" + to_string(app)));
+        }
+        r.wrong += !ok;
+        r.records++;
+        r.lastSeq = seq;
+        overrun = false;
+        if (slow && r.records % SLOW_BATCH == 0)
+            this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    r.overruns = reader.getOverruns();
+    r.lostBytes = reader.getLostBytes();
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = strtoul(argv[1], nullptr, 10);
+    const unsigned readers = strtoul(argv[2], nullptr, 10);
+    const unsigned ringMiB = (argc > 3) ? strtoul(argv[3], nullptr, 10) : 4;
+    const double pps = (argc > 4) ? strtod(argv[4], nullptr) : 0;
+    if (packets == 0 || ringMiB == 0 || pps < 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    const string name = "namon_shm_bench_" + to_string(getpid());
+    ShmStream shm;
+    if (shm.create(name, ringMiB, string(28, '\0')))
+    {
+        cerr << "Can't create shared memory '" << name << "'" << endl;
+        return 1;
+    }
+
+    vector<ReaderResult> results(readers);
+    vector<thread> threads;
+    atomic<int> ready{ 0 };
+    for (unsigned i = 0; i < readers; i++)
+        threads.emplace_back(readStream, name, i > 0, ref(ready), ref(results[i]));
+    while (ready < (int)readers)
+        this_thread::yield();
+
+    EnhancedPacketBlock epb;
+    vector<uint8_t> data(1500, 0xab);
+    uint64_t bytes = 0;
+    const auto t0 = bench_clock::now();
+    for (uint64_t seq = 0; seq < packets; seq++)
+    {
+        while (pps > 0 && chrono::duration<double>(bench_clock::now() - t0).count() * pps < seq)
+            this_thread::yield();
+        memcpy(data.data(), &seq, sizeof(seq));
+        epb.setTimestamp(seq);
+        epb.setOriginalPacketLength(lengthOf(seq));
+        epb.setPacketData(data.data(), lengthOf(seq));
+        const AppId app = appOf(seq);
+        shm.write(epb, app, "app" + to_string(app));
+        bytes += epb.getBlockLength(app);
+    }
+    const double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    shm.close();
+    for (thread &t : threads)
+        t.join();
+
+    cout << packets << " packets, " << ringMiB << " MiB ring, " << readers << " readers" << endl;
+    cout << "Producer: " << fixed << setprecision(3) << sec * 1000 << " ms, " << setprecision(2) << packets / sec / 1e6
+         << " Mpps, " << bytes / sec / (1 << 20) << " MiB/s" << endl << endl;
+    cout << left << setw(8) << "reader" << right << setw(12) << "records" << setw(10) << "overruns" << setw(12) << "lost MiB"
+         << setw(8) << "wrong" << setw(8) << "last" << endl;
+    int ret = 0;
+    for (unsigned i = 0; i < readers; i++)
+    {
+        const ReaderResult &r = results[i];
+        const bool last = r.records && r.lastSeq == packets - 1 && r.closed;
+        cout << left << setw(8) << (i ? "slow" : "fast") << right << setw(12) << r.records << setw(10) << r.overruns
+             << setw(12) << setprecision(2) << r.lostBytes / double(1 << 20) << setw(8) << r.wrong << setw(8) << (last ? "yes" : "no") << endl;
+        if (r.wrong || !last)
+            ret = 1;
+    }
+    return ret;
+}
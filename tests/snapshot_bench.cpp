@@ -0,0 +1,149 @@
+/**
+ *  @file       snapshot_bench.cpp
+ *  @brief      Save and load times of the cache snapshot compared with the socket pre-scan
+ *  @details    Builds a procfs tree with N processes x M sockets (see procfsFixture.hpp),
+ *              fills the cache by prescanSockets() and saves it by saveCacheSnapshot().
+ *              The snapshot is loaded into an empty cache as after a restart, then again
+ *              after every other process was restarted (another start time with the same
+ *              PID), whose entries must be skipped. Every loaded entry is checked against
+ *              the fixture.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 21:00
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <set>              //  set
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_localAddresses
+#include "namon_linux.hpp"  //  prescanSockets(), saveCacheSnapshot(), loadCacheSnapshot()
+#include "procfsFixture.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./snapshot_bench <processes> <socketsPerProcess> [<mix>]" << endl;
+    cout << "\t<mix>\tComma delimited list of <kind>[:<weight>], see resolver_bench" << endl;
+}
+
+
+/*!
+ * @brief       Finds the entry of a fixture socket in the cache
+ * @return      Application of the entry or an empty string if it's not there
+ */
+string findApp(Cache &cache, const FixtureSocket &s)
+{
+    Netflow n;
+    n.setIpVersion(s.ipVersion);
+    n.setProto(s.proto);
+    n.setLocalPort(s.port);
+    if (s.ipVersion == 4)
+    {
+        ip4_addr *ip = new ip4_addr;
+        memcpy(ip, &s.ip, IPv4_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+    else
+    {
+        ip6_addr *ip = new ip6_addr;
+        memcpy(ip, &s.ip, IPv6_ADDRLEN);
+        n.setLocalIp(ip);
+    }
+    TEntryOrTTree *found = cache.find(n);
+    if (found != nullptr && !found->isEntry())
+        found = static_cast<TTree *>(found)->find(n);
+    return (found != nullptr && found->isEntry()) ? static_cast<TEntry *>(found)->getAppName() : "";
+}
+
+
+/*!
+ * @brief   Loads the snapshot into an empty cache and checks its entries
+ */
+void load(const string &file, const vector<FixtureSocket> &sockets, const char *name, const set<int> &restarted)
+{
+    Cache cache;
+    const auto t0 = bench_clock::now();
+    const int loaded = loadCacheSnapshot(cache, file);
+    const double sec = chrono::duration<double>(bench_clock::now() - t0).count();
+
+    unsigned correct = 0, wrong = 0;
+    for (const FixtureSocket &s : sockets)
+    {
+        const string app = findApp(cache, s);
+        const bool expected = restarted.count(s.pid) == 0;
+        if (expected && app == s.cmdline)
+            correct++;
+        else if (!app.empty() || expected)
+            wrong++;
+    }
+    cout << left << setw(20) << name << right << fixed << setprecision(4) << setw(10) << sec
+         << setw(10) << loaded << setw(10) << correct << setw(10) << wrong << endl;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 4)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned processes = strtoul(argv[1], nullptr, 10);
+    const unsigned socketsPerProcess = strtoul(argv[2], nullptr, 10);
+    const string mix = (argc > 3) ? argv[3] : "tcp4,tcp6,udp4,udp6";
+    if (processes == 0 || socketsPerProcess == 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+
+    string root;
+    vector<FixtureSocket> sockets;
+    if (procfsFixture::setUp(root, processes, socketsPerProcess, mix, sockets))
+        return 1;
+    // the snapshot is kept outside of the procfs tree
+    const string file = root + ".snapshot";
+
+    cout << "Fixture: " << processes << " processes x " << socketsPerProcess << " sockets (" << mix << ")" << endl << endl;
+    cout << left << setw(20) << "step" << right << setw(10) << "s" << setw(10) << "entries"
+         << setw(10) << "correct" << setw(10) << "wrong" << endl;
+    {
+        Cache cache;
+        auto t0 = bench_clock::now();
+        const int prescanned = prescanSockets(cache, g_localAddresses);
+        cout << left << setw(20) << "prescan" << right << fixed << setprecision(4)
+             << setw(10) << chrono::duration<double>(bench_clock::now() - t0).count() << setw(10) << prescanned << endl;
+        t0 = bench_clock::now();
+        const int saved = saveCacheSnapshot(cache, file);
+        cout << left << setw(20) << "save" << right << fixed << setprecision(4)
+             << setw(10) << chrono::duration<double>(bench_clock::now() - t0).count() << setw(10) << saved << endl;
+    }
+    load(file, sockets, "load", set<int>());
+
+    // a restarted process gets another start time, its sockets belong to somebody else now
+    set<int> restarted;
+    for (unsigned p = 0; p < processes; p += 2)
+    {
+        const int pid = sockets[p * socketsPerProcess].pid;
+        restarted.insert(pid);
+        ofstream(root + "/" + to_string(pid) + "/stat", ios::binary) << pid << " (restarted) S 1 " << pid << " " << pid
+            << " 0 -1 4194560 120 0 0 0 10 5 0 0 20 0 1 0 " << procfsFixture::FIRST_START + pid + 1000 << " 12345678 456 0\n";
+    }
+    load(file, sockets, "load (half restarted)", restarted);
+
+    ::remove(file.c_str());
+    procfsFixture::remove(root);
+    return 0;
+}
@@ -0,0 +1,191 @@
+/**
+ *  @file       split_bench.cpp
+ *  @brief      Share of packets written into files of their applications and the cost of splitting
+ *  @details    Offers frames of sockets of a procfs tree to packetHandler() at a fixed rate
+ *              (see writerHarness.hpp), the writer writes into a temporary directory.
+ *              The run is repeated without splitting, with a file per application and with two
+ *              rules sharing one file. Every file is read back: a file of an application must
+ *              contain only its packets, a file of rules only packets of matching applications,
+ *              and no packet may be lost or written twice.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 19.10.2026 23:40
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <fstream>          //  ofstream
+#include <map>              //  map
+#include <set>              //  set
+#include <memory>           //  unique_ptr
+#include <dirent.h>         //  opendir()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "capturing.hpp"    //  g_split, AppFiles, DEFAULT_SPLIT_DELAY
+#include "fileHandler.hpp"  //  initOFile()
+#include "writerHarness.hpp"
+
+using namespace std;
+using namespace NAMON;
+
+const char * const      OUTPUT              = "out.pcapng"; //!< Name of the output file in the directory
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./split_bench <packets> <sockets> [<pps> [<delay>]]" << endl;
+    cout << "\t<pps>\tOffered load in packets per second (default 200000)" << endl;
+    cout << "\t<delay>\t--split delay in ms (default 100)" << endl;
+}
+
+
+/*!
+ * @brief   Results of one run
+ */
+struct Result
+{
+    unsigned dropped = 0;       //!< Packets dropped by the file buffer
+    unsigned written = 0;       //!< Packets in all files
+    unsigned split = 0;         //!< Packets in files of applications
+    unsigned files = 0;         //!< Files of applications
+    unsigned wrong = 0;         //!< Packets in a file of another application
+    size_t bytes = 0;           //!< Size of all files
+};
+
+
+/*!
+ * @brief   Returns local ports of packets in the capture file
+ */
+vector<uint16_t> readPorts(const string &file, size_t &bytes)
+{
+    vector<uint16_t> ports;
+    bytes += writerHarness::forEachBlock(file, [&ports](uint32_t type, const char *block, uint32_t) {
+        if (type == writerHarness::EPB_TYPE)
+            ports.push_back(writerHarness::localPort(block));
+    });
+    return ports;
+}
+
+
+/*!
+ * @brief   Reads all files in the directory back and checks them against the sockets and rules
+ */
+void check(const string &dir, const map<uint16_t, string> &appOfPort, const vector<SplitRule> &rules, Result &r)
+{
+    DIR *d = opendir(dir.c_str());
+    if (d == nullptr)
+        return;
+    while (dirent *e = readdir(d))
+    {
+        const string name = e->d_name;
+        if (name == "." || name == "..")
+            continue;
+        const vector<uint16_t> ports = readPorts(dir + "/" + name, r.bytes);
+        r.written += ports.size();
+        if (name == OUTPUT)
+            continue;
+        r.files++;
+        r.split += ports.size();
+        set<string> apps;
+        for (uint16_t p : ports)
+        {
+            auto app = appOfPort.find(p);
+            if (app == appOfPort.end())
+            {
+                r.wrong++;
+                continue;
+            }
+            apps.insert(app->second);
+            bool matches = rules.empty();
+            for (const SplitRule &rule : rules)
+                if (name == "out_" + rule.file + ".pcapng" && app->second.find(rule.pattern) != string::npos)
+                    matches = true;
+            // a file of one application has its program in the name
+            const string program = app->second.substr(0, app->second.find('\0'));
+            if (rules.empty() && name.find(program.substr(program.rfind('/') + 1)) == string::npos)
+                matches = false;
+            if (!matches)
+                r.wrong++;
+        }
+        if (rules.empty() && apps.size() > 1)
+            r.wrong += ports.size();
+    }
+    closedir(d);
+}
+
+
+Result run(const writerHarness::Flows &flows, unsigned long packets, double pps, bool split, const vector<SplitRule> &rules, unsigned delay)
+{
+    Result r;
+    g_split = split;
+    const string dir = procfsFixture::makeTempDir("/tmp/namon_split_");
+    if (dir.empty())
+        return r;
+    const string file = dir + "/" + OUTPUT;
+    ofstream out(file, ios::binary | ios::trunc);
+    vector<const char *> devs { "bench" };
+    initOFile(out, devs, { 1 });
+
+    FlowApps flowApps;
+    unique_ptr<AppFiles> appFiles;
+    if (split)
+    {
+        flowApps.enable();
+        appFiles.reset(new AppFiles(file, devs, { 1 }, rules));
+    }
+    r.dropped = writerHarness::offer(flows, packets, pps, out, split ? &flowApps : nullptr,
+                                     chrono::milliseconds(delay), false, appFiles.get());
+    out.close();
+    appFiles.reset();   // closes the files
+
+    check(dir, flows.appOfPort, rules, r);
+    procfsFixture::remove(dir);
+    return r;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3 || argc > 5)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = strtoul(argv[1], nullptr, 10);
+    const unsigned socketCount = strtoul(argv[2], nullptr, 10);
+    const double pps = (argc > 3) ? strtod(argv[3], nullptr) : 200000;
+    const unsigned delay = (argc > 4) ? strtoul(argv[4], nullptr, 10) : DEFAULT_SPLIT_DELAY;
+    if (packets == 0 || socketCount == 0 || pps <= 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    writerHarness::Flows flows;
+    if (writerHarness::setUp(socketCount, flows))
+        return 1;
+    const vector<vector<uint8_t>> &frames = flows.frames;
+
+    cout << packets << " packets of " << frames.size() << " flows of " << (frames.size() + 7) / 8
+         << " applications offered at " << (long)pps << " pps, delay " << delay << " ms" << endl << endl;
+    cout << left << setw(14) << "split" << right << setw(10) << "dropped" << setw(10) << "written"
+         << setw(10) << "split" << setw(8) << "%" << setw(8) << "files" << setw(8) << "wrong" << setw(12) << "bytes" << endl;
+    unsigned wrong = 0;
+    auto print = [&wrong, packets](const string &name, const Result &r) {
+        cout << left << setw(14) << name << right << fixed << setprecision(1) << setw(10) << r.dropped
+             << setw(10) << r.written << setw(10) << r.split << setw(8) << (r.written ? 100.0 * r.split / r.written : 0)
+             << setw(8) << r.files << setw(8) << r.wrong << setw(12) << r.bytes << endl;
+        // every packet is either dropped or in exactly one file
+        wrong += r.wrong + (r.written + r.dropped != packets);
+    };
+    print("off", run(flows, packets, pps, false, {}, delay));
+    print("per app", run(flows, packets, pps, true, {}, delay));
+    print("rules", run(flows, packets, pps, true, { { "low", "fixture-app-0" }, { "low", "fixture-app-1" } }, delay));
+
+    procfsFixture::remove(flows.root);
+    return wrong ? 1 : 0;
+}
@@ -0,0 +1,272 @@
+/**
+ *  @file       stream_bench.cpp
+ *  @brief      Writes into a FIFO with and without batching and checks the stream
+ *  @details    Creates a FIFO in a temporary directory, a reader thread reads it at the given
+ *              rate (or as fast as possible) and keeps everything it read. The writer writes
+ *              the SHB and IDB, N packets of 64 to 1500 bytes with the application option and
+ *              the mapping block, first through #NAMON::StreamOutput with a flush every round
+ *              of packets as the writer thread does it, then every block by its own write().
+ *              The stream must be a valid pcapng: the SHB first, both lengths of every block
+ *              equal, all packets in order and the mapping block last.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 02:20
+ *   - Edited:  20.10.2026 02:20
+ */
+
+#include <iostream>         //  cout, cerr, endl
+#include <iomanip>          //  setw(), setprecision()
+#include <chrono>           //  steady_clock
+#include <thread>           //  thread
+#include <string>           //  string
+#include <sstream>          //  ostringstream
+#include <cstring>          //  memcpy()
+#include <cstdlib>          //  mkdtemp()
+#include <fcntl.h>          //  open()
+#include <unistd.h>         //  read(), write(), close(), rmdir(), unlink()
+#include <sys/stat.h>       //  mkfifo()
+
+#include "debug.hpp"        //  setLogLevel()
+#include "fileHandler.hpp"  //  initOFile()
+#include "pcapng_blocks.hpp"//  EnhancedPacketBlock, CustomBlock
+#include "streamOutput.hpp"
+
+using namespace std;
+using namespace NAMON;
+using bench_clock = chrono::steady_clock;
+
+extern bool g_legacyMapping;
+
+const unsigned int      ROUND           = 64;           //!< Packets written between flushes of the stream
+const size_t            READ_SIZE       = 64 * 1024;    //!< Bytes read by one read() of the reader
+const uint32_t          CUSTOM_BLOCK    = 0x40000BAD;   //!< Type of the mapping block
+
+
+
+void printHelp()
+{
+    cout << "Usage: ./stream_bench <packets> [<readerMiBps> [legacy]]" << endl;
+    cout << "\t<readerMiBps>\tRate of the reader, 0 means as fast as possible (default 0)" << endl;
+    cout << "\tlegacy\tThe mapping block is written record by record" << endl;
+}
+
+
+AppId appOf(uint64_t seq)               { return (seq % 16 == 0) ? NO_APP : seq % 8 + 1; }
+uint32_t lengthOf(uint64_t seq)         { return 64 + (seq * 7919) % 1437; }
+
+
+/*!
+ * @brief   What the reader got
+ */
+struct ReaderResult
+{
+    string data;                        //!< The whole stream
+    unsigned long reads = 0;            //!< Successful read() calls
+};
+
+
+/*!
+ * @brief   Reads the FIFO until the writer closes it, at most rate MiB/s
+ */
+void readFifo(const string &path, double rate, ReaderResult &r)
+{
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    vector<char> buf(READ_SIZE);
+    const auto t0 = bench_clock::now();
+    ssize_t n;
+    while ((n = read(fd, buf.data(), buf.size())) > 0)
+    {
+        r.data.append(buf.data(), n);
+        r.reads++;
+        while (rate > 0 && chrono::duration<double>(bench_clock::now() - t0).count() * rate * (1 << 20) < r.data.size())
+            this_thread::sleep_for(chrono::microseconds(200));
+    }
+    close(fd);
+}
+
+
+/*!
+ * @brief   Checks the blocks of the stream
+ * @return  Empty string if the stream is valid, what is wrong otherwise
+ */
+string checkStream(const string &data, unsigned long packets)
+{
+    size_t pos = 0;
+    unsigned long seq = 0, blocks = 0;
+    uint32_t type = 0;
+    while (pos < data.size())
+    {
+        uint32_t hdr[2], trailer;
+        if (pos + 3 * sizeof(uint32_t) > data.size())
+            return "truncated block at " + to_string(pos);
+        memcpy(hdr, data.data() + pos, sizeof(hdr));
+        type = hdr[0];
+        if (hdr[1] < 3 * sizeof(uint32_t) || hdr[1] % 4 || pos + hdr[1] > data.size())
+            return "wrong length of block " + to_string(blocks);
+        memcpy(&trailer, data.data() + pos + hdr[1] - sizeof(trailer), sizeof(trailer));
+        if (trailer != hdr[1])
+            return "lengths of block " + to_string(blocks) + " differ";
+        if (blocks == 0 && type != 0x0A0D0D0A)
+            return "the first block isn't a SHB";
+        if (type == 6)
+        {
+            uint32_t w[6];
+            memcpy(w, data.data() + pos, sizeof(w));
+            if (((uint64_t)w[3] << 32 | w[4]) != seq || w[5] != lengthOf(seq))
+                return "packet " + to_string(seq) + " is wrong";
+            seq++;
+        }
+        pos += hdr[1];
+        blocks++;
+    }
+    if (seq != packets)
+        return to_string(seq) + " packets instead of " + to_string(packets);
+    if (type != CUSTOM_BLOCK)
+        return "the mapping block isn't the last one";
+    return "";
+}
+
+
+/*!
+ * @brief   Result of one run
+ */
+struct RunResult
+{
+    double sec = 0;                     //!< Time of the writer
+    double longestRound = 0;            //!< The longest round of the writer (s)
+    unsigned long writes = 0;           //!< write() calls of the writer (without batching)
+};
+
+
+/*!
+ * @brief   Writes the capture into the FIFO
+ * @param[in]   batched Through StreamOutput, otherwise every block by its own write()
+ */
+int writeFifo(const string &path, unsigned long packets, bool batched, RunResult &res)
+{
+    StreamOutput streamOut;
+    ostream stream(&streamOut);
+    int fd = -1;
+    if (batched ? streamOut.open(path.c_str()) : (fd = open(path.c_str(), O_WRONLY)) < 0)
+        return -1;
+    auto writeBlock = [fd, &res](const string &block) {
+        if (write(fd, block.data(), block.size()) == (ssize_t)block.size())
+            res.writes++;
+    };
+
+    ostringstream preamble;
+    initOFile(preamble, { "bench0" }, { 1 });
+    EnhancedPacketBlock epb;
+    vector<uint8_t> data(1500, 0xab);
+    string block;
+    const auto t0 = bench_clock::now();
+    auto roundStart = t0;
+    if (batched)
+        stream << preamble.str();
+    else
+        writeBlock(preamble.str());
+    for (uint64_t seq = 0; seq < packets; seq++)
+    {
+        memcpy(data.data(), &seq, sizeof(seq));
+        epb.setTimestamp(seq);
+        epb.setOriginalPacketLength(lengthOf(seq));
+        epb.setPacketData(data.data(), lengthOf(seq));
+        const AppId app = appOf(seq);
+        if (batched)
+            epb.write(stream, app);
+        else
+        {
+            block.resize(epb.getBlockLength(app));
+            epb.copyTo(reinterpret_cast<uint8_t *>(&block[0]), app);
+            writeBlock(block);
+        }
+        if (seq % ROUND == ROUND - 1)
+        {
+            if (batched)
+                stream.flush();
+            const auto now = bench_clock::now();
+            res.longestRound = max(res.longestRound, chrono::duration<double>(now - roundStart).count());
+            roundStart = now;
+        }
+    }
+    CustomBlock cBlock;
+    if (batched)
+    {
+        cBlock.write(stream);
+        streamOut.close();
+    }
+    else
+    {
+        ostringstream mapping;
+        cBlock.write(mapping);
+        writeBlock(mapping.str());
+        close(fd);
+    }
+    res.sec = chrono::duration<double>(bench_clock::now() - t0).count();
+    if (batched)
+        streamOut.printStats();
+    return 0;
+}
+
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2 || argc > 4)
+    {
+        printHelp();
+        return 1;
+    }
+    const unsigned long packets = strtoul(argv[1], nullptr, 10);
+    const double rate = (argc > 2) ? strtod(argv[2], nullptr) : 0;
+    g_legacyMapping = (argc > 3 && string(argv[3]) == "legacy");
+    if (packets == 0 || rate < 0)
+    {
+        printHelp();
+        return 1;
+    }
+
+    char logLevel[] = "0";
+    setLogLevel(logLevel);
+    char dir[] = "/tmp/namon_stream_bench_XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        cerr << "Can't create a temporary directory" << endl;
+        return 1;
+    }
+    const string path = string(dir) + "/capture";
+    if (mkfifo(path.c_str(), 0600))
+    {
+        cerr << "Can't create FIFO '" << path << "'" << endl;
+        rmdir(dir);
+        return 1;
+    }
+
+    cout << packets << " packets, reader " << (rate > 0 ? to_string((int)rate) + " MiB/s" : "unlimited")
+         << (g_legacyMapping ? ", legacy mapping" : "") << endl;
+    int ret = 0;
+    for (bool batched : { true, false })
+    {
+        ReaderResult r;
+        thread reader(readFifo, path, rate, ref(r));
+        RunResult res;
+        if (writeFifo(path, packets, batched, res))
+        {
+            cerr << "Can't open FIFO '" << path << "'" << endl;
+            ret = 1;
+        }
+        reader.join();
+        const string err = checkStream(r.data, packets);
+        cout << left << setw(10) << (batched ? "batched" : "direct") << right << fixed << setprecision(1)
+             << setw(10) << res.sec * 1000 << " ms" << setw(10) << r.data.size() / res.sec / (1 << 20) << " MiB/s"
+             << setw(16) << (batched ? "see above" : to_string(res.writes) + " writes") << setw(10) << r.reads << " reads"
+             << "  longest round " << setprecision(2) << res.longestRound * 1000 << " ms  "
+             << (err.empty() ? "valid" : "INVALID: " + err) << endl;
+        if (!err.empty())
+            ret = 1;
+    }
+    unlink(path.c_str());
+    rmdir(dir);
+    return ret;
+}
@@ -0,0 +1,167 @@
+/**
+ *  @file       writerHarness.hpp
+ *  @brief      Capturing of synthetic flows into files of the writer thread used by benchmarks
+ *  @details    setUp() builds a procfs tree (see procfsFixture.hpp) and one frame of every
+ *              socket, offer() passes the frames to packetHandler() at a fixed rate while the
+ *              writer and cache threads run as they do in namon. forEachBlock() reads the
+ *              written file back. Benchmarks of the writer (annotating, splitting) differ only
+ *              in the files they write and check.
+ *  @author     Jozef Zuzelka <xzuzel00@stud.fit.vutbr.cz>
+ *  @date
+ *   - Created: 20.10.2026 04:20
+ *   - Edited:  20.10.2026 04:20
+ */
+
+#pragma once
+
+#include <string>           //  string
+#include <vector>           //  vector
+#include <map>              //  map
+#include <chrono>           //  steady_clock, milliseconds
+#include <thread>           //  thread
+#include <fstream>          //  ifstream
+#include <iterator>         //  istreambuf_iterator
+#include <cstring>          //  memcpy()
+#include <pcap.h>           //  pcap_pkthdr
+
+#include "capturing.hpp"    //  packetHandler(), PacketHandlerParams, shouldStop
+#include "procfsFixture.hpp"
+
+extern NAMON::mac_addr g_devMac;
+
+
+
+
+namespace writerHarness
+{
+
+
+const unsigned int      FILE_RING_SIZE      = 2000;     //!< Same as in capturing.cpp
+const unsigned int      CACHE_RING_SIZE     = 2000;     //!< Same as in capturing.cpp
+const unsigned int      FRAME_SIZE          = 128;      //!< Length of the frames
+const uint32_t          EPB_TYPE            = 6;        //!< Type of the enhanced packet block
+
+
+/*!
+ * @brief   Flows offered to packetHandler()
+ */
+struct Flows
+{
+    std::string root;                               //!< Root of the procfs tree
+    std::vector<std::vector<uint8_t>> frames;       //!< One outbound frame of every socket
+    std::map<uint16_t, std::string> appOfPort;      //!< Local port and the command line of its application
+};
+
+
+/*!
+ * @brief       Builds the procfs tree with 8 sockets per process and frames of the first sockets
+ * @details     The device MAC address and local addresses are set, so every frame is outbound.
+ * @param[in]   socketCount     Number of flows
+ * @param[out]  f               Frames and applications of their ports
+ * @return      Zero on success, -1 otherwise
+ */
+inline int setUp(unsigned socketCount, Flows &f)
+{
+    std::vector<FixtureSocket> sockets;
+    if (procfsFixture::setUp(f.root, (socketCount + 7) / 8, 8, "tcp4:3,udp4:1", sockets))
+        return -1;
+    const NAMON::mac_addr devMac { { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 } };
+    g_devMac = devMac;
+    for (unsigned i = 0; i < socketCount && i < sockets.size(); i++)
+    {
+        f.frames.push_back(procfsFixture::buildFrame(sockets[i], FRAME_SIZE, g_devMac));
+        f.appOfPort[sockets[i].port] = sockets[i].cmdline;
+        g_localAddresses.add(&sockets[i].ip, sockets[i].ipVersion);
+    }
+    g_localAddresses.publish();
+    return 0;
+}
+
+
+/*!
+ * @brief       Offers the frames to packetHandler() at the rate while the writer and cache threads run
+ * @details     Every flow starts when the run starts, so its first packets come before the cache
+ *              knows the flow. The function returns when both buffers are empty and the threads ended.
+ * @param[in]   f       Flows
+ * @param[in]   packets Number of packets, the frames are repeated
+ * @param[in]   pps     Offered load in packets per second
+ * @param[in]   out     Output file with the section header
+ * @param[in]   apps    Applications of flows shared by the threads, nullptr if they aren't used
+ * @param[in]   delay   How long the writer waits for the application of a packet
+ * @param[in]   annotate    Whether packets are annotated
+ * @param[in]   split       Files of applications, nullptr if the capture isn't split
+ * @return      Number of packets dropped by the file buffer
+ */
+inline unsigned offer(const Flows &f, unsigned long packets, double pps, std::ostream &out, NAMON::FlowApps *apps,
+                      std::chrono::milliseconds delay, bool annotate = true, NAMON::AppFiles *split = nullptr)
+{
+    using namespace NAMON;
+    shouldStop = 0;
+    RingBuffer<EnhancedPacketBlock> fileBuffer(FILE_RING_SIZE);
+    std::thread writer([&fileBuffer, &out, apps, delay, annotate, split]() {
+        RingBuffer<EnhancedPacketBlock>::write({ &fileBuffer }, out, apps, delay, annotate, split);
+    });
+    Cache cache;
+    RingBuffer<Netflow> cacheBuffer(CACHE_RING_SIZE);
+    std::thread cacheThread([&cacheBuffer, &cache, apps]() { RingBuffer<Netflow>::run({ &cacheBuffer }, &cache, nullptr, std::chrono::seconds(0), apps); });
+
+    PacketHandlerParams ptrs{ &fileBuffer, &cacheBuffer, 0, DLT_EN10MB, &g_devMac, &g_storagePolicy };
+    pcap_pkthdr header;
+    header.len = header.caplen = f.frames[0].size();
+    header.ts.tv_sec = 1500000000;
+    const auto t0 = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < packets; i++)
+    {
+        while (std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count() * pps < i)
+            ;
+        header.ts.tv_usec = i % 1000000;
+        packetHandler(reinterpret_cast<u_char*>(&ptrs), &header, f.frames[i % f.frames.size()].data());
+    }
+    while (cacheBuffer.newItemOrStop() || fileBuffer.newItemOrStop())
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    shouldStop = 1;
+    cacheBuffer.notifyCondVar();
+    fileBuffer.notifyCondVar();
+    cacheThread.join();
+    writer.join();
+    return fileBuffer.getDroppedElem();
+}
+
+
+/*!
+ * @brief       Reads the blocks of a capture file
+ * @param[in]   file    The file
+ * @param[in]   block   Called with the type, the whole block and the length of every block
+ * @return      Size of the file
+ */
+template <class Callback>
+inline size_t forEachBlock(const std::string &file, Callback block)
+{
+    std::ifstream in(file, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    for (size_t pos = 0; pos + 12 <= data.size(); )
+    {
+        uint32_t type, len;
+        memcpy(&type, &data[pos], 4);
+        memcpy(&len, &data[pos + 4], 4);
+        if (len < 12 || pos + len > data.size())
+            break;
+        block(type, data.data() + pos, len);
+        pos += len;
+    }
+    return data.size();
+}
+
+
+/*!
+ * @param[in]   epb     Enhanced packet block of an outbound frame made by setUp()
+ * @return      Local port of the packet (the source port)
+ */
+inline uint16_t localPort(const char *epb)
+{
+    const uint8_t *l4 = reinterpret_cast<const uint8_t *>(epb + 28) + ETHER_HDRLEN + 20;
+    return l4[0] << 8 | l4[1];
+}
+
+
+}   // namespace writerHarness